@@ -107,6 +107,595 @@ def _time_painter_init():
         print(f'  * from Color:       {res/runs:.3f} ms')
 
 
+def _time_canvas_reuse():
+    print('-------------------------------------')
+    print("Timings for steady-state canvas setup")
+    print('-------------------------------------')
+    painter = viren2d.Painter()
+    for width, height in [(1920, 1080), (3840, 2160)]:
+        print(f'{width}x{height} frames')
+        print('~~~~~~~~~~~~~~~~~~~~~~')
+        # The first call allocates the surface, all subsequent
+        # calls with the same size reuse it:
+        pu.tic()
+        painter.set_canvas_rgb(height, width)
+        res = pu.ttoc()
+        print(f'Initial canvas setup: {res:.3f} ms')
+        for runs in REPETITIONS:
+            print(f'* {runs} repetitions')
+            res = timeit.timeit(
+                lambda: painter.set_canvas_rgb(height, width, 'azure'),
+                number=runs) * 1e3
+            print(f'  * From color:                  {res/runs:.3f} ms/frame')
+
+            gray = (255 * np.random.rand(height, width)).astype(np.uint8)
+            res = timeit.timeit(
+                lambda: painter.set_canvas_image(gray),
+                number=runs) * 1e3
+            print(f'  * From numpy, 1 channel (copy):  {res/runs:.3f} ms/frame')
+
+            for channels in [3, 4]:
+                frame = (255 * np.random.rand(height, width, channels)).astype(np.uint8)
+                res = timeit.timeit(
+                    lambda: painter.set_canvas_image(frame),
+                    number=runs) * 1e3
+                print(f'  * From numpy, {channels} channels (copy): {res/runs:.3f} ms/frame')
+                res = timeit.timeit(
+                    lambda: painter.set_canvas_image(frame, is_bgr=True),
+                    number=runs) * 1e3
+                print(f'  * From numpy, {channels} channels (BGR):  {res/runs:.3f} ms/frame')
+
+            res = timeit.timeit(
+                lambda: painter.set_canvas_image(frame, copy=False),
+                number=runs) * 1e3
+            print(f'  * From numpy, 4 channels (shared): {res/runs:.3f} ms/frame')
+
+
+def _time_canvas_export():
+    print('-------------------------------------')
+    print("Timings for canvas export")
+    print('-------------------------------------')
+    painter = viren2d.Painter()
+    for width, height in [(1920, 1080), (3840, 2160)]:
+        print(f'{width}x{height} frames')
+        print('~~~~~~~~~~~~~~~~~~~~~~')
+        painter.set_canvas_rgb(height, width, 'azure')
+        for runs in REPETITIONS:
+            print(f'* {runs} repetitions')
+            res = timeit.timeit(
+                lambda: np.array(painter.get_canvas(copy=False).to_channels(3), copy=False),
+                number=runs) * 1e3
+            print(f'  * to_channels(3):             {res/runs:.3f} ms/frame')
+
+            for layout, channels in [('rgb', 3), ('bgr', 3), ('bgra', 4), ('gray', 1)]:
+                shape = (height, width, channels) if channels > 1 else (height, width)
+                out = np.empty(shape, dtype=np.uint8)
+                res = timeit.timeit(
+                    lambda: painter.get_canvas(layout=layout, out=out),
+                    number=runs) * 1e3
+                print(f'  * {layout:4s} into preallocated:  {res/runs:.3f} ms/frame')
+
+
+def _dense_overlay(width, height, num_boxes=2000, num_markers=5000, seed=23):
+    """Records a dense overlay, i.e. boxes, markers and labels."""
+    rng = np.random.default_rng(seed)
+    overlay = viren2d.DisplayList()
+    painter = viren2d.Painter()
+    painter.begin_recording(overlay)
+    line_style = viren2d.LineStyle(width=2, color='navy-blue')
+    for _ in range(num_boxes):
+        cx, cy = rng.uniform(0, width), rng.uniform(0, height)
+        painter.draw_rect(
+            viren2d.Rect((cx, cy), (rng.uniform(20, 120), rng.uniform(20, 120))),
+            line_style, fill_color='same!20')
+        painter.draw_text(['label'], (cx, cy), anchor='center')
+    marker_style = viren2d.MarkerStyle(marker='o', size=7, color='crimson')
+    painter.draw_markers(
+        [((rng.uniform(0, width), rng.uniform(0, height)), 'invalid')
+         for _ in range(num_markers)], marker_style)
+    painter.end_recording()
+    return overlay
+
+
+def _time_tiled_rendering():
+    print('-------------------------------------')
+    print("Timings for tile-parallel rendering")
+    print('-------------------------------------')
+    painter = viren2d.Painter()
+    for width, height in [(1920, 1080), (3840, 2160)]:
+        print(f'{width}x{height} frames')
+        print('~~~~~~~~~~~~~~~~~~~~~~')
+        overlay = _dense_overlay(width, height)
+        for runs in REPETITIONS:
+            print(f'* {runs} repetitions, {len(overlay)} commands')
+            serial = None
+            for threads in [1, 2, 4, 8, 16]:
+                painter.render_threads = threads
+                def _render():
+                    painter.set_canvas_rgb(height, width, 'white')
+                    painter.draw_display_list(overlay)
+                res = timeit.timeit(_render, number=runs) * 1e3
+                serial = res if serial is None else serial
+                print(f'  * {threads:2d} thread(s): {res/runs:8.3f} ms/frame, '
+                      f'speedup {serial/res:.2f}x')
+
+
+def _time_markers():
+    print('----------------------------')
+    print("Timings for batched markers")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(7)
+    palette = ['crimson', 'navy-blue', 'teal-green', 'black']
+    for num_markers in [1000, 10000, 50000]:
+        pts = rng.uniform((0, 0), (1920, 1080), size=(num_markers, 2))
+        single = [((x, y), 'invalid') for x, y in pts]
+        colored = [((x, y), palette[i % len(palette)]) for i, (x, y) in enumerate(pts)]
+        print(f'* {num_markers} markers')
+        for marker in ['o', '+', '*']:
+            style = viren2d.MarkerStyle(marker=marker, size=7, color='crimson')
+            for name, markers in [('1 color', single), ('4 colors', colored)]:
+                for cache_size in [0, 128]:
+                    painter.marker_cache_size = cache_size
+                    res = timeit.timeit(
+                        lambda: painter.draw_markers(markers, style),
+                        number=REPETITIONS[0]) * 1e3
+                    print(f"  * '{marker}', {name}, sprite cache {cache_size:3d}: "
+                          f"{res/REPETITIONS[0]:.3f} ms")
+
+
+def _time_bounding_boxes():
+    print('----------------------------')
+    print("Timings for bounding boxes")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(7)
+    styles = [
+        viren2d.BoundingBox2DStyle(
+            line_style=viren2d.LineStyle(width=2, color=color),
+            box_fill_color='same!20', text_fill_color='white!60',
+            clip_label=True)
+        for color in ['crimson', 'navy-blue', 'teal-green', 'black']]
+    for num_boxes in [100, 500, 2000]:
+        lt = rng.uniform((0, 0), (1800, 980), size=(num_boxes, 2))
+        wh = rng.uniform((20, 40), (120, 100), size=(num_boxes, 2))
+        boxes = np.column_stack((lt, wh))
+        indices = rng.integers(0, len(styles), size=num_boxes)
+        labels = [f'Object {i}' for i in range(num_boxes)]
+
+        def _single():
+            for box, idx, label in zip(boxes, indices, labels):
+                painter.draw_bounding_box_2d(
+                    viren2d.Rect.from_ltwh(*box), styles[idx], [label])
+
+        res_single = timeit.timeit(_single, number=REPETITIONS[0]) * 1e3
+        res_batch = timeit.timeit(
+            lambda: painter.draw_bounding_boxes_2d(
+                boxes, styles, indices, labels),
+            number=REPETITIONS[0]) * 1e3
+        print(f'* {num_boxes} boxes: one by one {res_single/REPETITIONS[0]:.3f} ms, '
+              f'batched {res_batch/REPETITIONS[0]:.3f} ms')
+
+
+def _time_fading_trajectories():
+    print('----------------------------')
+    print("Timings for fading trajectories")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(7)
+    num_tracks, num_points = 200, 300
+    trajectories = list()
+    for _ in range(num_tracks):
+        steps = rng.normal(0, 3, size=(num_points, 2))
+        start = rng.uniform((0, 0), (1920, 1080))
+        pts = start + np.cumsum(steps, axis=0)
+        trajectories.append(([(x, y) for x, y in pts], 'same'))
+    line_style = viren2d.LineStyle(width=3, color='crimson')
+    for levels in [0, 64, 16, 8]:
+        painter.trajectory_fade_out_levels = levels
+        res = timeit.timeit(
+            lambda: painter.draw_trajectories(
+                trajectories, line_style, 'white!40'),
+            number=REPETITIONS[0]) * 1e3
+        mode = 'exact gradients' if levels == 0 else f'{levels} color levels'
+        print(f'* {num_tracks} tracks x {num_points} points, {mode}: '
+              f'{res/REPETITIONS[0]:.3f} ms')
+    painter.trajectory_fade_out_levels = 0
+
+
+def _time_bitmap_text():
+    print('----------------------------')
+    print("Timings for bitmap text")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(13)
+    num_labels = 1000
+    positions = rng.uniform((0, 0), (1920, 1080), size=(num_labels, 2))
+    labels = [f'{rng.integers(0, 1000)}: {rng.uniform():.2f}'
+              for _ in range(num_labels)]
+    text_style = viren2d.TextStyle(size=12, family='monospace')
+
+    def _draw():
+        for pos, label in zip(positions, labels):
+            painter.draw_text([label], pos, 'center', text_style)
+
+    for enabled in [False, True]:
+        painter.bitmap_text = enabled
+        res = timeit.timeit(_draw, number=REPETITIONS[0]) * 1e3
+        mode = 'glyph atlas' if enabled else 'cairo'
+        print(f'* {num_labels} labels, {mode}: {res/REPETITIONS[0]:.3f} ms')
+    painter.bitmap_text = False
+
+
+def _time_render_quality():
+    print('----------------------------')
+    print("Timings for render quality modes")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(17)
+    num_shapes = 500
+    boxes = [viren2d.Rect.from_ltwh(*rng.uniform((0, 0, 20, 20), (1800, 1000, 120, 80)))
+             for _ in range(num_shapes)]
+    centers = rng.uniform((0, 0), (1920, 1080), size=(num_shapes, 2))
+    image = rng.integers(0, 256, size=(120, 160, 3), dtype=np.uint8)
+    line_style = viren2d.LineStyle(width=2, color='navy-blue')
+
+    def _boxes():
+        for box in boxes:
+            painter.draw_rect(box, line_style, 'same!20')
+
+    def _circles():
+        for center in centers:
+            painter.draw_circle(center, 25, line_style, 'same!20')
+
+    def _grid():
+        painter.draw_grid(10, 10, line_style)
+
+    def _image():
+        painter.draw_image(image, (960, 540), 'center', scale_x=6, scale_y=6,
+                           rotation=10)
+
+    for quality in ['fast', 'balanced', 'best']:
+        painter.render_quality = quality
+        for name, fx in [(f'{num_shapes} boxes', _boxes),
+                         (f'{num_shapes} circles', _circles),
+                         ('grid', _grid), ('scaled image', _image)]:
+            res = timeit.timeit(fx, number=REPETITIONS[0]) * 1e3
+            print(f'* {quality}, {name}: {res/REPETITIONS[0]:.3f} ms')
+    painter.render_quality = 'balanced'
+
+
+def _time_native_rasterizer():
+    print('----------------------------')
+    print("Timings for natively rasterized primitives")
+    print('----------------------------')
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(1080, 1920)
+    rng = np.random.default_rng(23)
+    num_boxes = 1000
+    boxes = rng.integers((0, 0, 10, 10), (1800, 1000, 120, 80), size=(num_boxes, 4))
+    polygons = [[(l, t), (l + w, t), (l + w, t + h), (l, t + h), (l, t), (l + w, t)]
+                for l, t, w, h in boxes]
+    rects = [viren2d.Rect.from_ltwh(*box) for box in boxes]
+    for width, fill in [(1, None), (3, None), (3, 'same!30')]:
+        line_style = viren2d.LineStyle(width=width, color='navy-blue')
+        res_native = timeit.timeit(
+            lambda: [painter.draw_rect(r, line_style, fill) for r in rects],
+            number=REPETITIONS[0]) * 1e3
+        res_cairo = timeit.timeit(
+            lambda: [painter.draw_polygon(poly, line_style, fill) for poly in polygons],
+            number=REPETITIONS[0]) * 1e3
+        print(f'* {num_boxes} boxes, width {width}, fill {fill}: '
+              f'native {res_native/REPETITIONS[0]:.3f} ms, '
+              f'cairo {res_cairo/REPETITIONS[0]:.3f} ms')
+
+    for color in ['black', 'black!40']:
+        res = timeit.timeit(
+            lambda: painter.draw_grid(10, 10, viren2d.LineStyle(width=1, color=color)),
+            number=REPETITIONS[0]) * 1e3
+        print(f'* Full-HD grid, 10px spacing, {color}: {res/REPETITIONS[0]:.3f} ms')
+
+    centers = rng.uniform((0, 0), (1920, 1080), size=(num_boxes, 2))
+    for quality in ['balanced', 'fast']:
+        painter.render_quality = quality
+        res = timeit.timeit(
+            lambda: [painter.draw_circle(c, 4, viren2d.LineStyle(width=1, color='black'),
+                                         'crimson') for c in centers],
+            number=REPETITIONS[0]) * 1e3
+        print(f'* {num_boxes} dots, {quality}: {res/REPETITIONS[0]:.3f} ms')
+    painter.render_quality = 'balanced'
+
+
+def _time_culling():
+    print('----------------------------')
+    print("Timings for viewport culling")
+    print('----------------------------')
+    # Wide-area tracking: Most objects lie outside of the visualized
+    # region, e.g. a 640x480 detail view of a much larger scene.
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(480, 640)
+    rng = np.random.default_rng(23)
+    num_objects = 500
+    trajectories = list()
+    for _ in range(num_objects):
+        steps = rng.normal(0, 8, size=(200, 2))
+        start = rng.uniform((-3000, -3000), (3000, 3000))
+        pts = start + np.cumsum(steps, axis=0)
+        trajectories.append([(x, y) for x, y in pts])
+    boxes = [viren2d.Rect.from_ltwh(*traj[-1], 60, 100) for traj in trajectories]
+    line_style = viren2d.LineStyle(width=3, color='navy-blue')
+    box_style = viren2d.BoundingBox2DStyle()
+
+    painter.reset_num_culled_primitives()
+    res_traj = timeit.timeit(
+        lambda: [painter.draw_trajectory(traj, line_style) for traj in trajectories],
+        number=REPETITIONS[0]) * 1e3
+    res_box = timeit.timeit(
+        lambda: [painter.draw_bounding_box_2d(box, box_style, label_top=['ID'])
+                 for box in boxes],
+        number=REPETITIONS[0]) * 1e3
+    culled = painter.num_culled_primitives / REPETITIONS[0]
+    print(f'* {num_objects} trajectories: {res_traj/REPETITIONS[0]:.3f} ms')
+    print(f'* {num_objects} bounding boxes: {res_box/REPETITIONS[0]:.3f} ms')
+    print(f'* {culled:.0f} of {2 * num_objects} primitives culled per frame')
+
+
+def _time_simplification():
+    print('----------------------------')
+    print("Timings for polyline simplification")
+    print('----------------------------')
+    # Tracks recorded at high frame rates contain many (almost) collinear
+    # points which don't contribute visible detail.
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(480, 640)
+    rng = np.random.default_rng(17)
+    t = np.linspace(0, 1, 20000)
+    xs = 20 + 600 * t + rng.normal(0, 0.1, t.size)
+    ys = 240 + 180 * np.sin(6 * np.pi * t) + rng.normal(0, 0.1, t.size)
+    trajectory = [(x, y) for x, y in zip(xs, ys)]
+    line_style = viren2d.LineStyle(width=3, color='navy-blue')
+
+    for tolerance in [0, 0.5]:
+        painter.simplification_tolerance = tolerance
+        for fade_out in ['invalid', 'white!0']:
+            res = timeit.timeit(
+                lambda: painter.draw_trajectory(
+                    trajectory, line_style, fade_out_color=fade_out),
+                number=REPETITIONS[0]) * 1e3
+            print(f'* {len(trajectory)} points, tolerance {tolerance}, '
+                  f'fade-out {fade_out}: {res/REPETITIONS[0]:.3f} ms')
+    painter.simplification_tolerance = 0
+
+
+def _time_trajectory_store():
+    print('----------------------------')
+    print("Timings for incremental trajectories")
+    print('----------------------------')
+    # Resending and smoothing the full history of each track per frame vs.
+    # appending only the latest positions to a TrajectoryStore.
+    painter = viren2d.Painter()
+    painter.set_canvas_rgb(480, 640)
+    rng = np.random.default_rng(18)
+    num_tracks, history, smoothing = 50, 300, 7
+    line_style = viren2d.LineStyle(width=3, color='navy-blue')
+    histories = [[tuple(rng.uniform((0, 0), (640, 480)))] for _ in range(num_tracks)]
+    store = viren2d.TrajectoryStore(capacity=history, smoothing_window=smoothing)
+
+    def _next_positions():
+        for tid, hist in enumerate(histories):
+            x, y = hist[-1]
+            pos = (x + rng.normal(0, 2), y + rng.normal(0, 2))
+            hist.append(pos)
+            if len(hist) > history:
+                del hist[0]
+            yield tid, pos
+
+    # Warm up, i.e. fill the histories:
+    for _ in range(history):
+        for tid, pos in _next_positions():
+            store.append(tid, pos)
+
+    def _resend():
+        list(_next_positions())
+        painter.draw_trajectories(
+            [(hist, 'invalid') for hist in histories], line_style,
+            smoothing_window=smoothing)
+
+    def _incremental():
+        for tid, pos in _next_positions():
+            store.append(tid, pos)
+        painter.draw_trajectory_store(store, line_style)
+
+    res_resend = timeit.timeit(_resend, number=REPETITIONS[0]) * 1e3
+    res_store = timeit.timeit(_incremental, number=REPETITIONS[0]) * 1e3
+    print(f'* {num_tracks} tracks, {history} positions each:')
+    print(f'  * draw_trajectories (full history): {res_resend/REPETITIONS[0]:.3f} ms/frame')
+    print(f'  * TrajectoryStore (incremental):    {res_store/REPETITIONS[0]:.3f} ms/frame')
+
+
+def _time_layers():
+    print('----------------------------')
+    print("Timings for retained layers")
+    print('----------------------------')
+    # Static overlay content, which is re-rasterized for each frame vs.
+    # rendered once into a layer and composited per frame.
+    painter = viren2d.Painter()
+    width, height = 1280, 720
+    frame = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    grid_style = viren2d.LineStyle(width=1, color='light-gray!60')
+    zone_style = viren2d.LineStyle(width=3, color='crimson')
+    rng = np.random.default_rng(19)
+    zones = [[tuple(c + rng.uniform(-60, 60, 2)) for _ in range(8)]
+             for c in rng.uniform((100, 100), (width - 100, height - 100), (10, 2))]
+
+    def _draw_static():
+        painter.draw_grid(
+            spacing_x=20, spacing_y=20, line_style=grid_style,
+            top_left=(0, height / 2), bottom_right=(width, height))
+        for zone in zones:
+            painter.draw_polygon(zone, zone_style, 'crimson!20')
+        painter.draw_text_box(
+            ['Legend', 'Zone: restricted area'], (20, 20),
+            anchor='top-left', fill_color='white!80')
+
+    def _direct():
+        painter.set_canvas_image(frame)
+        _draw_static()
+
+    def _layer():
+        painter.set_canvas_image(frame)
+        if not painter.has_layer('static'):
+            painter.begin_layer('static')
+            _draw_static()
+            painter.end_layer()
+        painter.draw_layer('static')
+
+    res_direct = timeit.timeit(_direct, number=REPETITIONS[0]) * 1e3
+    res_layer = timeit.timeit(_layer, number=REPETITIONS[0]) * 1e3
+    print(f'* {width}x{height} frames:')
+    print(f'  * Re-rasterized per frame: {res_direct/REPETITIONS[0]:.3f} ms/frame')
+    print(f'  * Composited layer:        {res_layer/REPETITIONS[0]:.3f} ms/frame')
+
+
+def _time_dirty_rects():
+    print('----------------------------')
+    print("Timings for dirty rectangles")
+    print('----------------------------')
+    # A few small, moving overlays per frame: Full canvas reset & export
+    # vs. restoring & exporting only the dirty regions.
+    painter = viren2d.Painter()
+    width, height = 1280, 720
+    background = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    out = np.zeros((height, width, 3), dtype=np.uint8)
+    style = viren2d.LineStyle(width=3, color='crimson')
+    painter.set_canvas_image(background)
+    painter.get_canvas(out=out)
+    frame_idx = [0]
+
+    def _draw_overlays():
+        offset = 5 * (frame_idx[0] % 100)
+        frame_idx[0] += 1
+        for i in range(5):
+            painter.draw_circle((100 + offset + 30 * i, 100 + 100 * i), 15, style)
+        painter.draw_text(['Frame'], (20 + offset, 40))
+
+    def _full():
+        painter.set_canvas_image(background)
+        _draw_overlays()
+        painter.get_canvas(out=out)
+
+    def _dirty():
+        painter.restore_dirty_rects(background)
+        _draw_overlays()
+        painter.copy_dirty_rects(out)
+
+    res_full = timeit.timeit(_full, number=REPETITIONS[0]) * 1e3
+    painter.set_canvas_image(background)
+    painter.get_canvas(out=out)
+    res_dirty = timeit.timeit(_dirty, number=REPETITIONS[0]) * 1e3
+    print(f'* {width}x{height} frames:')
+    print(f'  * Full reset & export:  {res_full/REPETITIONS[0]:.3f} ms/frame')
+    print(f'  * Dirty rects only:     {res_dirty/REPETITIONS[0]:.3f} ms/frame')
+
+
+def _time_buffer_pool():
+    print('----------------------------')
+    print("Timings for the buffer pool")
+    print('----------------------------')
+    # Steady-state video pipeline: the same shapes are allocated and
+    # released for every frame.
+    width, height = 1280, 720
+    frame = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    overlay = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    buf = viren2d.ImageBuffer(frame, copy=False)
+
+    def _process():
+        rgba = buf.to_channels(4)
+        dimmed = buf.dim(0.5)
+        blended = buf.blend_constant(overlay, 0.3)
+        return rgba, dimmed, blended
+
+    capacity = viren2d.image_buffer_pool_capacity()
+    viren2d.set_image_buffer_pool_capacity(0)
+    res_malloc = timeit.timeit(_process, number=REPETITIONS[0]) * 1e3
+    viren2d.set_image_buffer_pool_capacity(capacity)
+    viren2d.image_buffer_pool_statistics(reset=True)
+    res_pool = timeit.timeit(_process, number=REPETITIONS[0]) * 1e3
+    stats = viren2d.image_buffer_pool_statistics()
+    print(f'* {width}x{height} to_channels + dim + blend_constant:')
+    print(f'  * Without pool: {res_malloc/REPETITIONS[0]:.3f} ms/frame')
+    print(f'  * With pool:    {res_pool/REPETITIONS[0]:.3f} ms/frame')
+    print(f'  * {stats}')
+
+
+def _time_parallel_operations():
+    print('----------------------------')
+    print("Timings for multi-threaded ImageBuffer operations")
+    print('----------------------------')
+    # Scaling of the per-pixel operations with the number of threads.
+    width, height = 3840, 2160
+    frame = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    overlay = (255 * np.random.rand(height, width, 3)).astype(np.uint8)
+    buf = viren2d.ImageBuffer(frame, copy=False)
+    flow = viren2d.ImageBuffer(
+        np.random.randn(height, width, 2).astype(np.float32))
+
+    operations = [
+        ('to_channels(4)', lambda: buf.to_channels(4)),
+        ('convert_rgb2gray', lambda: viren2d.convert_rgb2gray(buf)),
+        ('blend_constant', lambda: buf.blend_constant(overlay, 0.3)),
+        ('dim', lambda: buf.dim(0.5)),
+        ('to_float32', lambda: buf.to_float32()),
+        ('magnitude', lambda: flow.magnitude()),
+        ('min_max', lambda: flow.min_max(0)),
+    ]
+    thread_counts = [1, 2, 4, 8]
+    print(f'* {width}x{height} frames, ms/frame for ' + ', '.join(
+        [f'{t} thread(s)' for t in thread_counts]) + ':')
+    for name, op in operations:
+        timings = []
+        for num_threads in thread_counts:
+            with viren2d.ImageBufferThreadsScope(num_threads):
+                res = timeit.timeit(op, number=REPETITIONS[0]) * 1e3
+            timings.append(f'{res/REPETITIONS[0]:7.3f}')
+        print(f'  * {name:16s} ' + ' '.join(timings))
+
+
+def _time_channel_conversions():
+    print('----------------------------')
+    print("Timings for channel conversions")
+    print('----------------------------')
+    # Packed uint8 & float32 buffers use the SIMD channel shuffle kernels,
+    # the strided views (every other column of a numpy array) fall back to
+    # the generic pixel loops.
+    width, height = 3840, 2160
+    for dtype in [np.uint8, np.float32]:
+        gray = (255 * np.random.rand(height, 2 * width, 1)).astype(dtype)
+        rgb = (255 * np.random.rand(height, 2 * width, 3)).astype(dtype)
+        for layout, cols in [('packed', slice(0, width)),
+                             ('strided', slice(0, 2 * width, 2))]:
+            gray_buf = viren2d.ImageBuffer(
+                np.ascontiguousarray(gray[:, cols]) if layout == 'packed'
+                else gray[:, cols], copy=False)
+            rgb_buf = viren2d.ImageBuffer(
+                np.ascontiguousarray(rgb[:, cols]) if layout == 'packed'
+                else rgb[:, cols], copy=False)
+            operations = [
+                ('gray to_channels(4)', lambda: gray_buf.to_channels(4)),
+                ('rgb to_channels(4)', lambda: rgb_buf.to_channels(4)),
+                ('rgb channel(1)', lambda: rgb_buf.channel(1)),
+            ]
+            for name, op in operations:
+                res = timeit.timeit(op, number=REPETITIONS[0]) * 1e3
+                print(f'* {np.dtype(dtype).name:7s} {layout:7s} {name:20s} '
+                      f'{res/REPETITIONS[0]:7.3f} ms/frame')
+
+
 def _time_primitives():
     print('----------------------------')
     print("Timings for primitives")
@@ -450,6 +1039,34 @@ def compute_timings():
     print()
     _time_painter_init()
     print()
+    _time_canvas_reuse()
+    print()
+    _time_canvas_export()
+    print()
+    _time_tiled_rendering()
+    print()
+    _time_markers()
+    print()
+    _time_bounding_boxes()
+    print()
+    _time_fading_trajectories()
+    print()
+    _time_bitmap_text()
+    print()
+    _time_render_quality()
+    print()
+    _time_native_rasterizer()
+    print()
+    _time_culling()
+    _time_simplification()
+    _time_trajectory_store()
+    _time_layers()
+    _time_dirty_rects()
+    _time_buffer_pool()
+    _time_parallel_operations()
+    print()
+    _time_channel_conversions()
+    print()
     _time_primitives()
     print()
     _time_surveillance()
@@ -0,0 +1,292 @@
+#ifndef __VIREN2D_DISPLAY_LIST_H__
+#define __VIREN2D_DISPLAY_LIST_H__
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <viren2d/primitives.h>
+#include <viren2d/colors.h>
+#include <viren2d/positioning.h>
+#include <viren2d/styles.h>
+
+
+namespace viren2d {
+//-------------------------------------------------  Draw commands
+
+/// Type of a recorded drawing command.
+enum class DrawCommandType : unsigned char {
+  Arc = 0,        ///< See `Painter::DrawArc`.
+  Arrow,          ///< See `Painter::DrawArrow`.
+  BoundingBox2D,  ///< See `Painter::DrawBoundingBox2D`.
+  Circle,         ///< See `Painter::DrawCircle`.
+  Ellipse,        ///< See `Painter::DrawEllipse`.
+  Grid,           ///< See `Painter::DrawGrid`.
+  Line,           ///< See `Painter::DrawLine`.
+  Lines,          ///< Multiple line segments, stroked at once (created by `DisplayList::Optimized`).
+  Marker,         ///< See `Painter::DrawMarker`.
+  Markers,        ///< See `Painter::DrawMarkers`.
+  Polygon,        ///< See `Painter::DrawPolygon`.
+  Rect,           ///< See `Painter::DrawRect`.
+  Text,           ///< See `Painter::DrawText`.
+  TextBox,        ///< See `Painter::DrawTextBox`.
+  Trajectory      ///< See `Painter::DrawTrajectory`.
+};
+
+
+/// Returns the string representation.
+std::string DrawCommandTypeToString(DrawCommandType t);
+
+
+/// Output stream operator to print a DrawCommandType.
+std::ostream &operator<<(std::ostream &os, DrawCommandType t);
+
+
+/// A compact drawing command as stored in a `DisplayList`.
+///
+/// The command only holds indices into the storage of its list, *i.e.*
+/// the interned styles and the flat geometry parameters.
+struct DrawCommand {
+  /// Marks an unused style/color ID.
+  static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+
+  /// Type of the command, which also determines the meaning of the IDs.
+  DrawCommandType type;
+
+  /// Interned ID of the primary style, *i.e.* the line style for shapes,
+  /// the arrow, marker, text or bounding box style, respectively.
+  std::uint32_t style;
+
+  /// Interned line style ID of a text box (or `kNone`).
+  std::uint32_t box_style;
+
+  /// Interned ID of the fill color (or `kNone`).
+  std::uint32_t fill;
+
+  /// Index of the first geometry parameter.
+  std::uint32_t offset;
+
+  /// Number of geometry parameters.
+  std::uint32_t count;
+
+  /// Index into the auxiliary storage, *i.e.* the text lines (text,
+  /// text box, bounding box labels) or trajectory mix factor functions.
+  std::uint32_t extra;
+};
+
+
+//-------------------------------------------------  DisplayList
+
+/// Records drawing commands to replay them later on (any number of times).
+///
+/// Commands are stored compactly: each drawing command refers to interned
+/// styles (*i.e.* identical styles are stored only once) and to a flat
+/// parameter array for its geometry. A list can either be filled directly
+/// via its `AddXXX` methods or by recording a painter's drawing calls, see
+/// `Painter::BeginRecording`. To render a list, use
+/// `Painter::DrawDisplayList`.
+///
+/// Before replaying a list many times, consider `Optimized`, which drops
+/// invisible commands and merges consecutive commands of the same style.
+class DisplayList {
+public:
+  DisplayList() = default;
+  ~DisplayList() = default;
+  DisplayList(const DisplayList &other) = default;
+  DisplayList &operator=(const DisplayList &other) = default;
+  DisplayList(DisplayList &&other) noexcept = default;
+  DisplayList &operator=(DisplayList &&other) noexcept = default;
+
+
+  /// Returns the number of recorded commands.
+  inline std::size_t NumCommands() const { return commands_.size(); }
+
+
+  /// Returns true if no commands have been recorded.
+  inline bool Empty() const { return commands_.empty(); }
+
+
+  /// Returns the total number of interned styles and colors.
+  std::size_t NumStyles() const;
+
+
+  /// Removes all commands and styles.
+  void Clear();
+
+
+  /// Appends all commands of the other list.
+  void Append(const DisplayList &other);
+
+
+  /// Returns an optimized copy of this list.
+  ///
+  /// The optimized list produces the same visualization, but:
+  ///
+  /// * Invisible commands are dropped, *i.e.* commands with invalid or
+  ///   fully transparent styles and degenerate geometries (such as
+  ///   circles with a non-positive radius or empty text).
+  /// * Consecutive lines with the same opaque style will be merged into a
+  ///   single stroke and consecutive markers with the same style will be
+  ///   merged into a single `Markers` command. Note that anti-aliasing
+  ///   may slightly differ where merged line segments intersect.
+  ///
+  /// Args:
+  ///   sort_by_state: If true, commands will additionally be (stably)
+  ///     sorted by their type and style, which yields larger batches and
+  ///     fewer state changes. However, this changes the drawing order.
+  ///     Thus, only use this if the primitives don't overlap or if their
+  ///     order doesn't matter.
+  DisplayList Optimized(bool sort_by_state = false) const;
+
+
+  /// Returns a human-readable string representation.
+  std::string ToString() const;
+
+
+  /// Overloaded stream operator.
+  friend std::ostream &operator<<(std::ostream &os, const DisplayList &list) {
+    os << list.ToString();
+    return os;
+  }
+
+
+  //------------------------------------------------- Recording
+  // The following methods append a command. Their parameters are the same
+  // as for the corresponding `Painter::DrawXXX` calls.
+
+  void AddArc(
+      const Vec2d &center, double radius, double angle1, double angle2,
+      const LineStyle &line_style, bool include_center,
+      const Color &fill_color);
+
+  void AddArrow(
+      const Vec2d &from, const Vec2d &to, const ArrowStyle &arrow_style);
+
+  void AddBoundingBox2D(
+      const Rect &box, const BoundingBox2DStyle &style,
+      const std::vector<std::string> &label_top,
+      const std::vector<std::string> &label_bottom,
+      const std::vector<std::string> &label_left, bool left_top_to_bottom,
+      const std::vector<std::string> &label_right, bool right_top_to_bottom);
+
+  void AddCircle(
+      const Vec2d &center, double radius, const LineStyle &line_style,
+      const Color &fill_color);
+
+  void AddEllipse(
+      const Ellipse &ellipse, const LineStyle &line_style,
+      const Color &fill_color);
+
+  void AddGrid(
+      const Vec2d &top_left, const Vec2d &bottom_right,
+      double spacing_x, double spacing_y, const LineStyle &line_style);
+
+  void AddLine(const Vec2d &from, const Vec2d &to, const LineStyle &line_style);
+
+  void AddMarker(const Vec2d &pos, const MarkerStyle &style);
+
+  void AddMarkers(
+      const std::vector<std::pair<Vec2d, Color>> &markers,
+      const MarkerStyle &style);
+
+  void AddPolygon(
+      const std::vector<Vec2d> &points, const LineStyle &line_style,
+      const Color &fill_color);
+
+  void AddRect(
+      const Rect &rect, const LineStyle &line_style, const Color &fill_color);
+
+  void AddText(
+      const std::vector<std::string> &text, const Vec2d &position,
+      Anchor anchor, const TextStyle &text_style, const Vec2d &padding,
+      double rotation);
+
+  void AddTextBox(
+      const std::vector<std::string> &text, const Vec2d &position,
+      Anchor anchor, const TextStyle &text_style, const Vec2d &padding,
+      double rotation, const LineStyle &box_line_style,
+      const Color &box_fill_color, double box_corner_radius,
+      const Vec2d &fixed_box_size);
+
+  /// Records a trajectory. Smoothing must be applied beforehand.
+  void AddTrajectory(
+      const std::vector<Vec2d> &points, const LineStyle &style,
+      const Color &color_fade_out, bool oldest_position_first,
+      const std::function<double(double)> &mix_factor);
+
+
+  //------------------------------------------------- Access
+  // Used to replay the commands.
+
+  /// Returns the recorded commands.
+  inline const std::vector<DrawCommand> &Commands() const { return commands_; }
+
+  /// Returns the geometry parameters of the given command.
+  inline const double *Parameters(const DrawCommand &cmd) const {
+    return geometry_.data() + cmd.offset;
+  }
+
+  inline const LineStyle &GetLineStyle(std::uint32_t id) const { return line_styles_[id]; }
+  inline const ArrowStyle &GetArrowStyle(std::uint32_t id) const { return arrow_styles_[id]; }
+  inline const MarkerStyle &GetMarkerStyle(std::uint32_t id) const { return marker_styles_[id]; }
+  inline const TextStyle &GetTextStyle(std::uint32_t id) const { return text_styles_[id]; }
+  inline const BoundingBox2DStyle &GetBoundingBox2DStyle(std::uint32_t id) const { return bbox_styles_[id]; }
+
+  /// Computes a conservative, axis-aligned bounding box of the pixels
+  /// which can be touched by the given command (including line joins,
+  /// caps and anti-aliasing).
+  ///
+  /// Returns false if the extent cannot be bounded without rendering,
+  /// *e.g.* for text or a grid which spans the whole canvas. Such
+  /// commands must always be drawn.
+  bool CommandExtent(
+      const DrawCommand &cmd, Vec2d &top_left, Vec2d &bottom_right) const;
+
+  /// Returns the color with the given ID, or `Color::Invalid` for `kNone`.
+  const Color &GetColor(std::uint32_t id) const;
+
+  /// Returns the text lines with the given index.
+  inline const std::vector<std::string> &GetText(std::uint32_t idx) const { return texts_[idx]; }
+
+  /// Returns the trajectory mix factor function with the given index.
+  inline const std::function<double(double)> &GetFunction(std::uint32_t idx) const { return functions_[idx]; }
+
+
+private:
+  std::vector<DrawCommand> commands_;
+  std::vector<double> geometry_;
+
+  // Interned styles
+  std::vector<LineStyle> line_styles_;
+  std::vector<ArrowStyle> arrow_styles_;
+  std::vector<MarkerStyle> marker_styles_;
+  std::vector<TextStyle> text_styles_;
+  std::vector<BoundingBox2DStyle> bbox_styles_;
+  std::vector<Color> colors_;
+
+  // Auxiliary storage
+  std::vector<std::vector<std::string>> texts_;
+  std::vector<std::function<double(double)>> functions_;
+
+  /// Appends a new command, whose parameters must be pushed to
+  /// `geometry_` afterwards.
+  DrawCommand &NewCommand(
+      DrawCommandType type, std::uint32_t style,
+      std::uint32_t fill = DrawCommand::kNone);
+
+  /// Copies the given command (which refers to the storage of `src`).
+  void CopyCommand(const DisplayList &src, const DrawCommand &cmd);
+
+  std::uint32_t InternColor(const Color &color);
+  std::uint32_t InternText(const std::vector<std::string> &text);
+
+  template <typename _Tp>
+  static std::uint32_t Intern(std::vector<_Tp> &table, const _Tp &style);
+};
+
+} // namespace viren2d
+
+#endif // __VIREN2D_DISPLAY_LIST_H__
@@ -1,6 +1,7 @@
 #ifndef __VIREN2D_DRAWING_H__
 #define __VIREN2D_DRAWING_H__
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -14,7 +15,9 @@
 #include <viren2d/imagebuffer.h>
 #include <viren2d/colors.h>
 #include <viren2d/colorgradients.h>
+#include <viren2d/display_list.h>
 #include <viren2d/styles.h>
+#include <viren2d/trajectory_store.h>
 
 
 namespace viren2d {
@@ -28,6 +31,53 @@ using Matrix3x3d = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
 using Matrix3x4d = Eigen::Matrix<double, 3, 4, Eigen::RowMajor>;
 
 
+/// Pixel formats to export the canvas, see `Painter::GetCanvas`.
+enum class CanvasLayout : unsigned char {
+  RGB = 0,  ///< 3-channel RGB.
+  BGR,      ///< 3-channel BGR, *e.g.* for OpenCV.
+  RGBA,     ///< 4-channel RGBA with straight (not premultiplied) alpha.
+  BGRA,     ///< 4-channel BGRA with straight (not premultiplied) alpha.
+  Gray      ///< Single-channel grayscale.
+};
+
+
+/// Returns the string representation.
+std::string CanvasLayoutToString(CanvasLayout layout);
+
+
+/// Returns a CanvasLayout from its string representation.
+CanvasLayout CanvasLayoutFromString(const std::string &layout);
+
+
+/// Output stream operator to print a CanvasLayout.
+std::ostream &operator<<(std::ostream &os, CanvasLayout layout);
+
+
+/// Returns the number of channels of the given CanvasLayout.
+int CanvasLayoutChannels(CanvasLayout layout);
+
+
+/// Trade-off between rendering speed and quality, see
+/// `Painter::SetRenderQuality`.
+enum class RenderQuality : unsigned char {
+  Fast = 0,  ///< Coarse curves, no anti-aliasing of axis-aligned boxes & grids, nearest-neighbor image scaling.
+  Balanced,  ///< Cairo's defaults.
+  Best       ///< Finest curves, best anti-aliasing & image filtering.
+};
+
+
+/// Returns the string representation.
+std::string RenderQualityToString(RenderQuality quality);
+
+
+/// Returns a RenderQuality from its string representation.
+RenderQuality RenderQualityFromString(const std::string &quality);
+
+
+/// Output stream operator to print a RenderQuality.
+std::ostream &operator<<(std::ostream &os, RenderQuality quality);
+
+
 /// The Painter provides functionality to draw on a canvas.
 class Painter {
 public:
@@ -51,6 +101,10 @@ public:
   ///
   /// This or any overloaded SetCanvas() must be called before
   /// any other DrawXXX calls can be performed.
+  ///
+  /// If the size of the canvas doesn't change, the painter reuses its
+  /// previously allocated memory. Any clip region or other drawing
+  /// state will be reset nonetheless.
   virtual void SetCanvas(int height, int width, const Color &color) = 0;
 
 
@@ -68,10 +122,59 @@ public:
   /// Initializes the canvas from the given image.
   /// The image can be grayscale (1-channel), RGB or RGBA.
   /// The painter will always create a copy - thus, the image
-  /// buffer can be safely destroyed afterwards.
+  /// buffer can be safely destroyed afterwards. If the canvas
+  /// size doesn't change, the image will be copied into the
+  /// previously allocated memory.
+  ///
+  /// Translucent RGBA pixels will be premultiplied by their alpha
+  /// value, as required by Cairo's image surface.
   virtual void SetCanvas(const ImageBuffer &image_buffer) = 0;
 
 
+  /// Initializes the canvas from the given BGR(A) image, *e.g.* an
+  /// OpenCV frame.
+  ///
+  /// Behaves exactly like `SetCanvas(const ImageBuffer &)`, except that
+  /// the color channels will be reordered while copying. Thus, the image
+  /// doesn't need to be converted via `SwapChannels` beforehand.
+  /// Grayscale images are supported as well.
+  virtual void SetCanvasBGR(const ImageBuffer &image_buffer) = 0;
+
+
+  /// Initializes the canvas from the given image and - if possible - draws
+  /// directly onto the image's memory.
+  ///
+  /// If ``copy`` is false and the buffer's memory layout is compatible with
+  /// Cairo's ARGB32 image surface (*i.e.* 4-channel ``uint8`` data with
+  /// a pixel stride of 4 bytes, a row stride which matches
+  /// ``cairo_format_stride_for_width`` and a 4-byte aligned data pointer),
+  /// the painter will wrap the given memory without allocating or copying.
+  /// Subsequent drawing operations will then directly modify the buffer.
+  ///
+  /// If the buffer owns its memory, the painter pins it (see
+  /// `ImageBuffer::PinData`) until a new canvas is set up or the painter
+  /// is destroyed. Thus, the memory stays valid even if the buffer is
+  /// destroyed and the buffer won't switch to a copy upon mutable access.
+  /// Copies of the buffer (*e.g.* ``ImageBuffer snapshot = buffer;``),
+  /// however, are deep copies which don't change along with subsequent
+  /// drawing operations.
+  /// For shared buffers (*e.g.* views onto caller-managed memory), the
+  /// caller must ensure that the memory stays valid until a new canvas
+  /// is set up or the painter is destroyed.
+  ///
+  /// Otherwise, the image will be copied, the same as with the overloaded
+  /// `SetCanvas(const ImageBuffer &)`.
+  ///
+  /// Args:
+  ///   image_buffer: The image.
+  ///   copy: If true, the image will always be copied.
+  ///
+  /// Returns:
+  ///   ``True`` if the painter draws directly onto the given buffer,
+  ///   ``false`` if the image data has been copied.
+  virtual bool SetCanvas(ImageBuffer &image_buffer, bool copy) = 0;
+
+
   /// Returns the size of the canvas.
   virtual Vec2i GetCanvasSize() const = 0;
 
@@ -85,6 +188,78 @@ public:
   virtual ImageBuffer GetCanvas(bool copy) const = 0;
 
 
+  /// Converts the current visualization (canvas) into the given
+  /// output buffer.
+  ///
+  /// The canvas will be converted in a single pass, *i.e.* without any
+  /// intermediate buffer. For 4-channel layouts, the alpha values will be
+  /// un-premultiplied (Cairo stores premultiplied alpha internally). For
+  /// RGB, BGR and grayscale outputs, the alpha channel will be dropped.
+  ///
+  /// If ``out`` is a ``uint8`` buffer of the canvas size and with the
+  /// layout's number of channels, its memory will be reused - so exporting
+  /// a sequence of frames doesn't allocate. Its strides will be honored, so
+  /// ``out`` can also be a shared view (*e.g.* onto an encoder's frame
+  /// buffer). Otherwise, if ``out`` is invalid or owns its memory, it will
+  /// be reallocated. A shared view with a mismatching shape raises an
+  /// `std::invalid_argument`, as does a view onto the canvas itself.
+  ///
+  /// Args:
+  ///   out: The output buffer.
+  ///   layout: The pixel format of the output buffer.
+  virtual void GetCanvas(ImageBuffer &out, CanvasLayout layout) const = 0;
+
+
+  /// Returns the canvas regions which have been drawn onto since the
+  /// canvas was set up or since the last `ResetDirtyRects` call.
+  ///
+  /// Each drawing call reports the (conservative) bounding box of its
+  /// visible primitives, the same one which is used for culling (see
+  /// `NumCulledPrimitives`), in canvas pixels. These boxes are merged
+  /// into at most 16 axis-aligned, pixel-aligned rectangles, which may
+  /// overlap. Direct modifications of the canvas memory (*e.g.* via a
+  /// shared `GetCanvas` view) are not tracked. Drawing into a layer (see
+  /// `BeginLayer`) doesn't modify the canvas, but `DrawLayer` does.
+  virtual std::vector<Rect> DirtyRects() const = 0;
+
+
+  /// Marks the whole canvas as clean, see `DirtyRects`.
+  virtual void ResetDirtyRects() = 0;
+
+
+  /// Converts only the dirty regions of the canvas (see `DirtyRects`)
+  /// into the given output buffer.
+  ///
+  /// If ``out`` holds the previously exported frame, this yields the same
+  /// result as `GetCanvas(out, layout)` at a fraction of the cost. If
+  /// ``out`` is not compatible with the canvas (see `GetCanvas`), the
+  /// whole canvas will be exported instead. The dirty regions are not
+  /// reset.
+  ///
+  /// Args:
+  ///   out: The output buffer.
+  ///   layout: The pixel format of the output buffer.
+  virtual void CopyDirtyRects(ImageBuffer &out, CanvasLayout layout) const = 0;
+
+
+  /// Copies the dirty regions (see `DirtyRects`) from the given background
+  /// image into the canvas and marks the canvas as clean afterwards.
+  ///
+  /// If the canvas has been set up from this background, the canvas will
+  /// equal the background afterwards, *i.e.* all overlays are erased
+  /// without copying the full frame. Throws a `std::logic_error` if the
+  /// canvas is invalid and a `std::invalid_argument` if the background
+  /// is invalid or its size differs from the canvas size.
+  ///
+  /// Args:
+  ///   background: The background image, supports the same formats as
+  ///     `SetCanvas`.
+  ///   is_bgr: Set to ``true`` if the color channels of the background
+  ///     are in BGR(A) order.
+  virtual void RestoreDirtyRects(
+      const ImageBuffer &background, bool is_bgr = false) = 0;
+
+
   ///  Draws a circular arc.
   ///
   /// Args:
@@ -154,6 +329,33 @@ public:
   }
 
 
+  /// Draws many 2D bounding boxes at once.
+  ///
+  /// Instead of drawing each box separately (see `DrawBoundingBox2D`),
+  /// boxes are grouped by their style and rendered in layers: first all
+  /// box fills and label backgrounds, then all contours and finally all
+  /// labels. Thus, labels are never occluded by other boxes, but
+  /// overlapping boxes may look different than when drawn one by one.
+  /// Rotated or rounded boxes cannot be batched and will be drawn
+  /// one by one on top of all other boxes.
+  ///
+  /// Args:
+  ///   boxes: The bounding boxes.
+  ///   styles: A (usually small) table of box styles.
+  ///   style_indices: For each box, the index into the `styles` table.
+  ///     If empty, all boxes will be drawn with the first style.
+  ///   labels: For each box, a single-line label which will be displayed
+  ///     at the top of the box. Boxes with an empty string will not be
+  ///     labeled. If empty, no labels will be drawn at all.
+  bool DrawBoundingBoxes2D(
+      const std::vector<Rect> &boxes,
+      const std::vector<BoundingBox2DStyle> &styles = {BoundingBox2DStyle()},
+      const std::vector<std::size_t> &style_indices = {},
+      const std::vector<std::string> &labels = {}) {
+    return DrawBoundingBoxes2DImpl(boxes, styles, style_indices, labels);
+  }
+
+
   /// Draws a circle.
   ///
   /// Args:
@@ -387,6 +589,9 @@ public:
   ///
   ///   To avoid this behavior, the trajectory needs to be drawn with
   ///   a single color, *i.e.* pass `Color::Invalid` as ``color_fade_out``.
+  ///
+  ///   For faster rendering, the fade-out colors can be quantized, see
+  ///   `SetTrajectoryFadeOutLevels`.
   bool DrawTrajectory(
       const std::vector<Vec2d> &points,
       const LineStyle &style = LineStyle(),
@@ -416,6 +621,24 @@ public:
   }
 
 
+  /// Draws all tracks of the given store. This is the per-frame
+  /// alternative to `DrawTrajectories`: the store only needs to be
+  /// updated with the new positions and the tracks will be drawn
+  /// directly from its storage. Smoothing has already been applied
+  /// by the store, see `TrajectoryStore`.
+  ///
+  /// As for `DrawTrajectories`, a track's color overrides the style's
+  /// color unless it is `Color::Invalid` or `Color::Same`. Tracks with
+  /// less than 2 positions will be skipped.
+  bool DrawTrajectoryStore(
+      const TrajectoryStore &store,
+      const LineStyle &style = LineStyle(),
+      const Color &color_fade_out = Color::White.WithAlpha(0.4),
+      const std::function<double(double)> &mix_factor = ColorFadeOutQuadratic) {
+    return DrawTrajectoryStoreImpl(store, style, color_fade_out, mix_factor);
+  }
+
+
   /// Draws the coordinate system axes for the pinhole camera calibration.
   ///
   /// Args:
@@ -504,6 +727,248 @@ public:
   virtual bool ResetClipRegion() = 0;
 
 
+  /// Starts recording the drawing calls into the given display list.
+  ///
+  /// While recording, the `DrawXXX` calls will not change the canvas.
+  /// Instead, they append the corresponding command to the display list.
+  /// Thus, a painter doesn't need a valid canvas for recording. Note that
+  /// methods which return geometric information about the drawn result
+  /// cannot provide it while recording, *i.e.* `DrawText` and `DrawTextBox`
+  /// return an invalid bounding box.
+  /// Drawing an image, the horizon line or the XYZ axes as well as changing
+  /// the clip region are not supported while recording. These calls will
+  /// fail (and log a warning).
+  ///
+  /// The caller must ensure that the display list stays valid until
+  /// `EndRecording` is called.
+  virtual void BeginRecording(DisplayList &list) = 0;
+
+
+  /// Stops recording, see `BeginRecording`.
+  virtual void EndRecording() = 0;
+
+
+  /// Returns true if the painter currently records into a display list.
+  virtual bool IsRecording() const = 0;
+
+
+  /// Replays all commands of the given display list onto the canvas.
+  ///
+  /// If the painter is recording, the commands will be appended to its
+  /// current display list instead.
+  ///
+  /// If multiple render threads are configured (see `SetRenderThreads`),
+  /// the canvas will be split into horizontal tiles, which are rendered
+  /// concurrently. Each tile only replays the commands which intersect
+  /// it. The result is identical to the serial rendering.
+  ///
+  /// Returns:
+  ///   ``True`` if all commands have been drawn successfully.
+  virtual bool DrawDisplayList(const DisplayList &list) = 0;
+
+
+  /// Starts rendering into the offscreen layer with the given name.
+  ///
+  /// Layers retain overlay content which doesn't change between frames,
+  /// *e.g.* a ground plane grid, the horizon line, coordinate axes,
+  /// legends, logos or zone polygons. Render such content once into a
+  /// layer and composite it onto each new canvas via `DrawLayer`:
+  ///
+  ///   if (!painter->HasLayer("static")) {
+  ///     painter->BeginLayer("static");
+  ///     painter->DrawGrid(...);
+  ///     painter->DrawXYZAxes(...);
+  ///     painter->EndLayer();
+  ///   }
+  ///   painter->DrawLayer("static");
+  ///
+  /// Until `EndLayer` is called, all drawing calls render into the layer
+  /// instead of the canvas. The layer has the size of the current canvas
+  /// and is initially transparent. While a layer is active, the canvas
+  /// accessors (*e.g.* `GetCanvas`) refer to the layer. Changing the
+  /// canvas ends the active layer.
+  ///
+  /// Returns false (and logs a warning) if the canvas is invalid, the
+  /// name is empty, the painter is recording or another layer is active.
+  virtual bool BeginLayer(const std::string &name) = 0;
+
+
+  /// Finishes the active layer, see `BeginLayer`. This replaces any
+  /// previous content of the layer with the same name.
+  ///
+  /// The layer is cropped to the bounding box of its non-transparent
+  /// pixels, so that `DrawLayer` only has to blend this region.
+  ///
+  /// Returns false if no layer is active.
+  virtual bool EndLayer() = 0;
+
+
+  /// Returns true if the painter currently renders into a layer.
+  virtual bool IsLayerActive() const = 0;
+
+
+  /// Returns true if the layer exists and has been rendered for the
+  /// current canvas size, *i.e.* it doesn't need to be re-rendered.
+  virtual bool HasLayer(const std::string &name) const = 0;
+
+
+  /// Blends the layer onto the canvas (honoring the current clip region).
+  ///
+  /// Returns false (and logs a warning) if the layer doesn't exist or
+  /// has been rendered for a different canvas size. In the latter case,
+  /// the layer will be invalidated.
+  virtual bool DrawLayer(const std::string &name) = 0;
+
+
+  /// Discards the layer, *e.g.* because its content changed and it
+  /// needs to be rendered again. Returns false if the layer is unknown.
+  virtual bool InvalidateLayer(const std::string &name) = 0;
+
+
+  /// Discards all layers.
+  virtual void ClearLayers() = 0;
+
+
+  /// Sets the number of threads used to render a display list.
+  ///
+  /// The tiles are rendered by the persistent workers of the thread pool
+  /// which is shared with the ImageBuffer operations (see
+  /// `SetImageBufferThreads`). If the pool is busy (*e.g.* with an
+  /// ImageBuffer operation of another thread), the display list will be
+  /// rendered by the calling thread alone.
+  ///
+  /// Args:
+  ///   num_threads: Number of worker threads. Use 1 (the default) for
+  ///     serial rendering or 0 to use all hardware threads.
+  ///     Parallel rendering falls back to the serial path if a (non-full)
+  ///     clip region is active or if the canvas is too small.
+  virtual void SetRenderThreads(int num_threads) = 0;
+
+
+  /// Returns the number of threads used to render a display list.
+  virtual int RenderThreads() const = 0;
+
+
+  /// Sets the capacity of the marker sprite cache.
+  ///
+  /// Markers are rasterized once per shape (*i.e.* marker style except
+  /// for its colors) into small alpha masks, which are then stamped onto
+  /// the canvas. This is considerably faster than rendering the marker
+  /// paths, but positions will be quantized to 1/4 pixel.
+  /// The cache keeps the most recently used sprites. Each style requires
+  /// up to 16 sprites, one for each sub-pixel position.
+  ///
+  /// The cache is disabled by default.
+  ///
+  /// Args:
+  ///   num_sprites: Maximum number of cached sprites. Set to 0 to disable
+  ///     the cache, *i.e.* to always render the exact marker paths.
+  ///     Each style requires up to 16 sprites, thus 128 is a sensible
+  ///     capacity for typical visualizations.
+  virtual void SetMarkerCacheSize(std::size_t num_sprites) = 0;
+
+
+  /// Returns the capacity of the marker sprite cache.
+  virtual std::size_t MarkerCacheSize() const = 0;
+
+
+  /// Sets how trajectories fade out, see `DrawTrajectory`.
+  ///
+  /// By default, each segment of a fading trajectory is drawn with its
+  /// own linear color gradient. This is exact, but slow for long (or many)
+  /// trajectories. Alternatively, the colors can be quantized into a fixed
+  /// number of levels. Then, all segments of the same level are stroked
+  /// as a single path with a solid color.
+  ///
+  /// Args:
+  ///   num_levels: Number of color levels, *e.g.* 16. Use 0 (the default)
+  ///     to draw the exact color gradients.
+  virtual void SetTrajectoryFadeOutLevels(int num_levels) = 0;
+
+
+  /// Returns the number of color levels used to fade out trajectories,
+  /// or 0 if the exact color gradients are drawn.
+  virtual int TrajectoryFadeOutLevels() const = 0;
+
+
+  /// Enables the level-of-detail simplification of polylines, *i.e.*
+  /// the points passed to `DrawPolygon`, `DrawTrajectory` and
+  /// `DrawTrajectories`.
+  ///
+  /// Densely sampled tracks often contain many nearly collinear points,
+  /// which end up on the same few pixels. If enabled, such points are
+  /// removed (via a radial distance pass followed by Douglas-Peucker)
+  /// before the path is constructed. The first and last point are always
+  /// kept, and the simplified polyline deviates at most `tolerance` pixels
+  /// from the original one. Fade-out colors of trajectories still follow
+  /// the length along the original points.
+  ///
+  /// Args:
+  ///   tolerance: Maximum deviation in pixels, *e.g.* 0.5. Use 0 (the
+  ///     default) to draw all points.
+  virtual void SetSimplificationTolerance(double tolerance) = 0;
+
+
+  /// Returns the polyline simplification tolerance in pixels, or 0 if
+  /// polylines are not simplified.
+  virtual double SimplificationTolerance() const = 0;
+
+
+  /// Enables the bitmap text renderer for `DrawText` and `DrawTextBox`.
+  ///
+  /// If enabled, the glyphs of each font are rasterized only once into
+  /// an atlas. Text is then composited directly from this atlas onto the
+  /// canvas, which is considerably faster for many short labels, *e.g.*
+  /// object IDs or scores. Anchors, padding and text boxes are not
+  /// affected. Glyphs are placed on the same sub-pixel grid as Cairo
+  /// uses, thus the result matches the default rendering up to rounding.
+  ///
+  /// Only printable ASCII text without rotation is supported. Any other
+  /// text is rendered via Cairo as usual.
+  virtual void SetBitmapTextEnabled(bool enabled) = 0;
+
+
+  /// Returns true if the bitmap text renderer is enabled.
+  virtual bool IsBitmapTextEnabled() const = 0;
+
+
+  /// Sets the trade-off between rendering speed and quality for all
+  /// subsequent drawing operations.
+  ///
+  /// * `Fast` is intended for live previews: Curves are flattened with
+  ///   a coarser tolerance, axis-aligned boxes and grids are drawn
+  ///   without anti-aliasing and `DrawImage` uses nearest-neighbor
+  ///   interpolation.
+  /// * `Balanced` (the default) uses Cairo's default settings.
+  /// * `Best` is intended for exported frames: It uses the finest
+  ///   tolerance, the best anti-aliasing and image filtering.
+  ///
+  /// Text rendering is not affected.
+  virtual void SetRenderQuality(RenderQuality quality) = 0;
+
+
+  /// Returns the current render quality.
+  virtual RenderQuality GetRenderQuality() const = 0;
+
+
+  /// Returns the number of primitives which have been skipped because
+  /// they lie completely outside the canvas or the current clip region.
+  ///
+  /// Each primitive is tested against the visible region via its
+  /// (conservative) bounding box, including the line width, before its
+  /// path is constructed. For batch calls, *e.g.* `DrawMarkers`, each
+  /// skipped element counts. Polylines (`DrawPolygon` without fill and
+  /// `DrawTrajectory`) which are partially visible are trimmed to their
+  /// visible segments instead, which is not counted.
+  /// Culling within the worker threads of a parallel display list replay
+  /// (see `SetRenderThreads`) is not counted either.
+  virtual std::size_t NumCulledPrimitives() const = 0;
+
+
+  /// Resets the counter of culled primitives, see `NumCulledPrimitives`.
+  virtual void ResetNumCulledPrimitives() = 0;
+
+
 protected:
   /// Internal helper to enable default values in public interface.
   virtual bool DrawArcImpl(
@@ -530,6 +995,14 @@ protected:
       bool right_top_to_bottom) = 0;
 
 
+  /// Internal helper to enable default values in public interface.
+  virtual bool DrawBoundingBoxes2DImpl(
+      const std::vector<Rect> &boxes,
+      const std::vector<BoundingBox2DStyle> &styles,
+      const std::vector<std::size_t> &style_indices,
+      const std::vector<std::string> &labels) = 0;
+
+
   /// Internal helper to enable default values in public interface.
   virtual bool DrawCircleImpl(
       const Vec2d &center, double radius,
@@ -628,6 +1101,13 @@ protected:
       const std::function<double(double)> &mix_factor) = 0;
 
 
+  /// Internal helper to allow default values in public interface.
+  virtual bool DrawTrajectoryStoreImpl(
+      const TrajectoryStore &store, const LineStyle &style,
+      const Color &color_fade_out,
+      const std::function<double(double)> &mix_factor) = 0;
+
+
   /// Internal helper to allow default values in public interface.
   virtual std::tuple<bool, Vec2d, Vec2d, Vec2d, Vec2d> DrawXYZAxesImpl(
       const Matrix3x3d &K, const Matrix3x3d &R, const Vec3d &t,
@@ -638,6 +1118,63 @@ protected:
 
 /// Creates a Painter object for drawing.
 std::unique_ptr<Painter> CreatePainter();
+
+
+/// Usage statistics of the text cache, see `SetTextCacheSize`.
+struct TextCacheStatistics {
+  /// Number of currently cached text lines.
+  std::size_t size;
+
+  /// Maximum number of cached text lines.
+  std::size_t capacity;
+
+  /// Number of text lines which were found in the cache.
+  std::size_t hits;
+
+  /// Number of text lines which had to be converted to glyphs.
+  std::size_t misses;
+};
+
+
+/// Sets the capacity of the process-wide text cache.
+///
+/// Text lines are converted to glyphs and measured only once per
+/// font. Subsequent draws of the same text (*e.g.* recurring labels
+/// of tracked objects) reuse the cached glyphs. The cache is shared
+/// by all painters and keeps the most recently used lines.
+///
+/// Args:
+///   num_lines: Maximum number of cached text lines. Set to 0 to
+///     disable the cache.
+void SetTextCacheSize(std::size_t num_lines);
+
+
+/// Returns the capacity of the process-wide text cache.
+std::size_t TextCacheSize();
+
+
+/// Returns the usage statistics of the text cache, which can be used to
+/// choose a suitable cache size.
+///
+/// Args:
+///   reset: If true, the hit/miss counters will be reset afterwards.
+TextCacheStatistics GetTextCacheStatistics(bool reset = false);
+
+
+/// Sets the capacity of the process-wide font cache.
+///
+/// Fonts are resolved only once per text style (family, slant, weight
+/// and size) and then reused by all painters. If the number of styles
+/// exceeds the capacity, the cache is flushed.
+///
+/// Args:
+///   num_fonts: Maximum number of cached fonts. Set to 0 to disable the
+///     cache, *i.e.* to select the font via Cairo for each text draw.
+void SetFontCacheSize(std::size_t num_fonts);
+
+
+/// Returns the capacity of the process-wide font cache.
+std::size_t FontCacheSize();
 //TODO How should we handle SVG vs image painters? CreateRasterizedPainter vs CreateVectorizedPainter ? or ImagePainter/SVGPainter?
 
 
@@ -5,12 +5,14 @@
 #include <ostream>
 #include <sstream>
 #include <exception>
+#include <cstddef>  // size_t
 #include <cstdint>  // For fixed width integer types (stdint.h in C)
 #include <type_traits>
 #include <algorithm> // std::min
 #include <limits> // quiet nan
 #include <initializer_list>
 #include <utility> // pair
+#include <memory> // shared_ptr
 
 #include <viren2d/primitives.h>
 
@@ -98,6 +100,23 @@ std::ostream &operator<<(std::ostream &os, ImageBufferType t);
 ///   share the same memory via `CreateSharedBuffer`. The latter
 ///   does NOT take ownership of the memory (i.e. cleaning up
 ///   remains the caller's responsibility).
+///
+/// Owned memory is reference-counted, thus copying an ImageBuffer is
+/// cheap (no pixel data is copied). Instead, the memory will be copied
+/// upon the first mutable access (copy-on-write), *i.e.* via
+/// `MutableData`, `MutablePtr`, `AtUnchecked`/`AtChecked` or any
+/// in-place operation such as `SwapChannels`. Pointers and references
+/// obtained via these mutable accessors must not be used after the buffer
+/// has been copied, because they would then modify the copy, too.
+/// Shared views created via `CreateSharedBuffer` don't hold a reference,
+/// whereas `ROI` views pin the owned memory (see below) for as long as
+/// they exist. Thus, a buffer can safely be copied while it is being
+/// modified through an ROI.
+///
+/// Owned memory which is modified externally, *e.g.* by a `Painter` which
+/// draws directly onto this buffer (see `Painter::SetCanvas`), is pinned
+/// via `PinData`. Copies of a pinned buffer are deep copies, because its
+/// content may change with every drawing operation.
 class ImageBuffer {
 public:
   /// Creates an empty ImageBuffer.
@@ -105,18 +124,27 @@ public:
 
 
   /// Allocates memory to hold a H x W x CH image of the specified type.
-  ImageBuffer(int h, int w, int ch, ImageBufferType buf_type);
+  ///
+  /// The memory starts at a 64-byte boundary. If `pad_rows` is true,
+  /// each row will be padded to a multiple of 64 bytes, such that every
+  /// row is aligned, too. This allows vectorized kernels to use aligned
+  /// loads and satisfies Cairo's stride requirements. Note that a
+  /// padded buffer is not contiguous, unless the row size already is a
+  /// multiple of 64 bytes.
+  ImageBuffer(int h, int w, int ch, ImageBufferType buf_type, bool pad_rows = false);
 
 
-  /// Destructor frees the memory, if it was allocated
-  /// by this ImageBuffer.
+  /// Destructor frees the memory, if this is the last ImageBuffer
+  /// which owns it.
   ~ImageBuffer();
 
 
-  /// Copy c'tor: Copies the data IFF other.owns_data is true.
-  /// Otherwise, this ImageBuffer will also be a shared buffer.
-  /// For a guaranteed deep copy, use `DeepCopy`!
-  ImageBuffer(const ImageBuffer &other) noexcept;
+  /// Copy c'tor: Shares the data with `other` in constant time. If
+  /// `other` owns its memory, it will be copied upon the first mutable
+  /// access (of either buffer). Otherwise, this ImageBuffer will also
+  /// be a shared buffer. For an immediate deep copy, use `DeepCopy`!
+  /// Pinned memory (see `PinData`) will always be copied immediately.
+  ImageBuffer(const ImageBuffer &other);
 
 
   /// Move constructor.
@@ -178,12 +206,41 @@ public:
   inline int NumBytes() const { return NumElements() * element_size; }
 
 
-  /// Returns true if this ImageBuffer is responsible for
+  /// Returns true if this ImageBuffer is (jointly) responsible for
   /// cleaning up the corresponding data.
-  inline bool OwnsData() const { return owns_data; }
+  inline bool OwnsData() const { return storage != nullptr; }
+
+
+  /// Returns the number of ImageBuffers which reference this buffer's
+  /// owned memory, or 0 for a shared buffer. A pin handle (see `PinData`)
+  /// doesn't count as a reference.
+  inline long UseCount() const {
+    return storage.use_count() - (IsPinned() ? 1 : 0);
+  }
+
+
+  /// Pins the owned memory, *i.e.* marks it as being modified by an
+  /// external writer, such as a `Painter` which draws directly onto this
+  /// buffer. Until the returned handle is released:
+  /// * The handle keeps the memory alive, even if this buffer is
+  ///   destroyed or switches to other memory.
+  /// * Copies of this buffer will be deep copies (snapshots), since they
+  ///   would otherwise change along with the writer's modifications.
+  /// * Mutable access doesn't detach this buffer from the writer's memory,
+  ///   *i.e.* the handle doesn't count as another owner.
+  ///
+  /// If the memory is shared with other buffers, this buffer will switch
+  /// to its own copy first. Returns nullptr for shared buffers, because
+  /// these don't own their memory.
+  std::shared_ptr<void> PinData();
+
 
+  /// Returns true if the owned memory is pinned, see `PinData`.
+  bool IsPinned() const;
 
-  /// Sets this->owns_data = true;
+
+  /// Takes (reference-counted) ownership of the memory of a shared
+  /// buffer, which must have been allocated via `std::malloc`.
   /// Obviously to be used only, if the calling code ensures that
   /// the former `data` owner will NOT free the memory.
   void TakeOwnership();
@@ -196,8 +253,13 @@ public:
   }
 
 
-  /// Returns a mutable pointer to the underlying `data` memory.
-  inline unsigned char *MutableData() { return data; }
+  /// Returns a mutable pointer to the underlying `data` memory. If the
+  /// memory is referenced by other ImageBuffers, it will be copied first.
+  /// The pointer must not be used after this buffer has been copied.
+  inline unsigned char *MutableData() {
+    EnsureUniqueData();
+    return data;
+  }
 
 
   /// Returns an immutable pointer to the underlying `data` memory.
@@ -205,9 +267,10 @@ public:
 
 
   /// Returns a mutable pointer of the specified type to the
-  /// underlying `data` memory.
+  /// underlying `data` memory, see `MutableData`.
   template<typename _Tp> inline
   _Tp *MutablePtr(int row, int col, int channel=0) {
+    EnsureUniqueData();
     return reinterpret_cast<_Tp *>(data + ByteOffset(row, col, channel));
   }
 
@@ -440,6 +503,11 @@ public:
 
   /// Returns a shared ImageBuffer which points to the specified axis-aligned
   /// region-of-interest. This buffer will usually NOT be contiguous.
+  ///
+  /// If this buffer owns its memory, the view pins it (see `PinData`)
+  /// until the view (and all of its copies) have been destroyed. Thus,
+  /// copies of this buffer will be snapshots, which are not affected by
+  /// writes through the view.
   ImageBuffer ROI(int left, int top, int roi_width, int roi_height);
 
 
@@ -610,16 +678,39 @@ private:
   /// This buffer's data type.
   ImageBufferType buffer_type;
 
-  /// Flag which indicates if this buffer owns the
-  /// memory, i.e. if it is responsible for cleaning up.
-  bool owns_data;
+  /// Reference-counted owner of the memory, or nullptr if this
+  /// buffer only shares the memory (i.e. the caller is responsible
+  /// for cleaning up).
+  std::shared_ptr<unsigned char> storage;
+
+  /// Handle of an external writer, see `PinData`. The handle refers to
+  /// the pinned memory, which is only valid as long as it matches `storage`.
+  std::weak_ptr<std::shared_ptr<unsigned char>> pin;
 
+  /// Pin handle of the owning buffer if this is an `ROI` view.
+  std::shared_ptr<void> view_pin;
 
-  /// Frees the memory if needed and resets
+
+  /// Releases the memory if needed and resets
   /// the members accordingly.
   void Cleanup();
 
 
+  /// Copy-on-write: Ensures that no other ImageBuffer references
+  /// the owned memory before it will be modified.
+  inline void EnsureUniqueData() {
+    // The pin handle of an external writer doesn't count as an owner:
+    if (storage && (storage.use_count() > 1)
+        && ((storage.use_count() > 2) || !IsPinned())) {
+      DetachData();
+    }
+  }
+
+
+  /// Replaces the owned memory by a (contiguous) copy.
+  void DetachData();
+
+
   /// Checks that the given indices are valid.
   inline void CheckIndexedAccess(int row, int col, int channel) const {
     if ((row < 0) || (row >= height)
@@ -765,6 +856,151 @@ ImageBuffer LoadImageUInt8(const std::string &image_filename, int force_num_chan
 void SaveImageUInt8(const std::string &image_filename, const ImageBuffer &image);
 
 
+/// Alignment (in bytes) of the memory which ImageBuffers allocate.
+constexpr int kImageBufferAlignment = 64;
+
+
+/// Provides the memory for the pixel data of all ImageBuffers which
+/// allocate their own memory, see `SetImageBufferAllocator`.
+class ImageBufferAllocator {
+public:
+  virtual ~ImageBufferAllocator() = default;
+
+  /// Returns at least `num_bytes` of memory, which must be aligned to
+  /// `kImageBufferAlignment` bytes, or nullptr if the allocation failed.
+  virtual unsigned char *Allocate(std::size_t num_bytes) = 0;
+
+  /// Releases memory which has been returned by `Allocate` for the same
+  /// `num_bytes`. This may be called from any thread.
+  virtual void Deallocate(unsigned char *memory, std::size_t num_bytes) = 0;
+};
+
+
+/// Replaces the allocator for subsequently created ImageBuffers.
+///
+/// Memory is always returned to the allocator which provided it, *i.e.*
+/// existing buffers keep their allocator alive. Both `Allocate` and
+/// `Deallocate` must be thread-safe.
+///
+/// Args:
+///   allocator: The new allocator. Pass nullptr to restore the default,
+///     *i.e.* the process-wide buffer pool.
+void SetImageBufferAllocator(std::shared_ptr<ImageBufferAllocator> allocator);
+
+
+/// Returns the allocator which is used for new ImageBuffers.
+std::shared_ptr<ImageBufferAllocator> GetImageBufferAllocator();
+
+
+/// Usage statistics of the process-wide buffer pool, see
+/// `SetImageBufferPoolCapacity`.
+struct ImageBufferPoolStatistics {
+  /// Number of bytes which are currently kept for reuse.
+  std::size_t bytes_retained;
+
+  /// Number of memory blocks which are currently kept for reuse.
+  std::size_t blocks_retained;
+
+  /// Maximum number of bytes which will be kept for reuse.
+  std::size_t capacity;
+
+  /// Number of allocations which reused a retained block.
+  std::size_t hits;
+
+  /// Number of allocations which requested memory from the system.
+  std::size_t misses;
+};
+
+
+/// Sets the capacity of the process-wide buffer pool, which is the
+/// default `ImageBufferAllocator`.
+///
+/// Video pipelines usually allocate and free the same few image shapes
+/// for every frame. Instead of returning the memory to the system, the
+/// pool keeps freed blocks and hands them out again for requests of the
+/// same size class (sizes are rounded up by at most 12.5%). Each thread
+/// caches its most recently freed blocks, such that these can be reused
+/// without locking.
+///
+/// Args:
+///   num_bytes: Maximum number of bytes which the pool may retain
+///     (including the thread caches). Set to 0 to always return freed
+///     memory to the system.
+void SetImageBufferPoolCapacity(std::size_t num_bytes);
+
+
+/// Returns the capacity of the process-wide buffer pool.
+std::size_t ImageBufferPoolCapacity();
+
+
+/// Returns the usage statistics of the buffer pool, which can be used
+/// to choose a suitable capacity.
+///
+/// Args:
+///   reset: If true, the hit/miss counters will be reset afterwards.
+ImageBufferPoolStatistics GetImageBufferPoolStatistics(bool reset = false);
+
+
+/// Returns all memory retained by the buffer pool to the system. Blocks
+/// cached by other threads will be released once these threads exit.
+void ReleaseImageBufferPool();
+
+
+/// Sets the number of threads for per-pixel ImageBuffer operations.
+///
+/// Conversions (*e.g.* `ToChannels`, `ToUInt8`, `AsType`), blending,
+/// dimming, `Magnitude`, `Orientation` and `MinMaxLocation` split the
+/// image into chunks of rows, which are processed by a persistent pool
+/// of worker threads. Images smaller than the
+/// `ImageBufferParallelThreshold` are always processed serially.
+///
+/// Args:
+///   num_threads: Maximum number of threads (including the calling
+///     one). Set to 0 to use all hardware threads (default), or to 1
+///     to disable multi-threading.
+void SetImageBufferThreads(int num_threads);
+
+
+/// Returns the number of threads for per-pixel ImageBuffer operations,
+/// *i.e.* 0 if all hardware threads will be used.
+int ImageBufferThreads();
+
+
+/// Sets the minimum number of pixels of an ImageBuffer, for which per-pixel
+/// operations will be distributed among multiple threads. Below this
+/// threshold, synchronizing the threads would take longer than processing
+/// the image serially.
+void SetImageBufferParallelThreshold(int num_pixels);
+
+
+/// Returns the minimum number of pixels for multi-threaded processing.
+int ImageBufferParallelThreshold();
+
+
+/// Overrides the number of threads for per-pixel ImageBuffer operations
+/// which are invoked by the calling thread, as long as this object exists.
+///
+/// This allows changing the setting for a single call without affecting
+/// other threads, *e.g.*:
+///   {
+///     ImageBufferThreadsScope serial(1);
+///     ImageBuffer gray = ConvertRGB2Gray(img);
+///   }
+class ImageBufferThreadsScope {
+public:
+  /// Args:
+  ///   num_threads: Number of threads, see `SetImageBufferThreads`.
+  explicit ImageBufferThreadsScope(int num_threads);
+  ~ImageBufferThreadsScope();
+
+  ImageBufferThreadsScope(const ImageBufferThreadsScope &) = delete;
+  ImageBufferThreadsScope &operator=(const ImageBufferThreadsScope &) = delete;
+
+private:
+  int previous_;
+};
+
+
 } // namespace viren2d
 
 // Include fmt formatter specializations for ImageBufferType and ImageBuffer,
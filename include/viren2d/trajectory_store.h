@@ -0,0 +1,187 @@
+#ifndef __VIREN2D_TRAJECTORY_STORE_H__
+#define __VIREN2D_TRAJECTORY_STORE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <viren2d/primitives.h>
+#include <viren2d/colors.h>
+
+
+namespace viren2d {
+
+/// Keeps the most recent positions of multiple tracks across frames.
+///
+/// Instead of passing the complete history of each track to
+/// `Painter::DrawTrajectories` for every frame, append only the latest
+/// position of each track and render the store via
+/// `Painter::DrawTrajectoryStore`. Each track keeps at most `Capacity`
+/// positions in a fixed-size ring buffer, *i.e.* the oldest positions
+/// will be dropped.
+///
+/// The ring buffer is double-mapped (each position is stored twice),
+/// such that the retained positions of a track are always contiguous
+/// in memory and can be rendered without copying.
+///
+/// If a smoothing window is set, the store keeps the moving average
+/// instead of the raw positions. This is updated incrementally upon
+/// each `Append`, *i.e.* the cost doesn't depend on the length of the
+/// history. The average at each position is computed over its
+/// `smoothing_window / 2` neighbors on either side (fewer at the start
+/// and the end of the track). Consequently, the most recent
+/// `smoothing_window / 2` averages change as new positions arrive.
+/// Note that positions which have already been dropped from the ring
+/// buffer still contribute to the average of their neighbors.
+class TrajectoryStore {
+public:
+  /// Type of the track identifiers.
+  using TrackID = std::int64_t;
+
+
+  /// Creates an empty store.
+  ///
+  /// Args:
+  ///   capacity: Maximum number of positions kept per track. Must be
+  ///     at least 2, otherwise an `std::invalid_argument` will be thrown.
+  ///   smoothing_window: Window size of the moving average. Values below
+  ///     2 disable smoothing.
+  explicit TrajectoryStore(std::size_t capacity = 100, int smoothing_window = 0);
+
+  ~TrajectoryStore() = default;
+  TrajectoryStore(const TrajectoryStore &other) = default;
+  TrajectoryStore &operator=(const TrajectoryStore &other) = default;
+  TrajectoryStore(TrajectoryStore &&other) noexcept = default;
+  TrajectoryStore &operator=(TrajectoryStore &&other) noexcept = default;
+
+
+  /// Returns the maximum number of positions per track.
+  inline std::size_t Capacity() const { return capacity_; }
+
+
+  /// Returns the window size of the moving average.
+  inline int SmoothingWindow() const { return smoothing_window_; }
+
+
+  /// Returns the number of tracks.
+  inline std::size_t NumTracks() const { return tracks_.size(); }
+
+
+  /// Returns true if the store doesn't contain any track.
+  inline bool Empty() const { return tracks_.empty(); }
+
+
+  /// Returns true if the store contains the given track.
+  bool Contains(TrackID track_id) const;
+
+
+  /// Returns the identifiers of all tracks in ascending order, which is
+  /// also the order in which they will be drawn.
+  std::vector<TrackID> TrackIDs() const;
+
+
+  /// Returns the number of positions currently kept for the given
+  /// track, or 0 if the track is unknown.
+  std::size_t NumPoints(TrackID track_id) const;
+
+
+  /// Returns a copy of the (smoothed) positions of the given track,
+  /// ordered from the oldest to the most recent one. Returns an empty
+  /// vector if the track is unknown.
+  std::vector<Vec2d> Points(TrackID track_id) const;
+
+
+  /// Appends the position to the given track. Unknown tracks will be
+  /// created on the fly.
+  void Append(TrackID track_id, const Vec2d &position);
+
+
+  /// Sets the color used to draw the given track. If the color is
+  /// invalid (the default) or `Color::Same`, the line style's color
+  /// will be used instead (see `Painter::DrawTrajectories`).
+  /// Returns false if the track is unknown.
+  bool SetColor(TrackID track_id, const Color &color);
+
+
+  /// Returns the color of the given track, or `Color::Invalid` if the
+  /// track is unknown.
+  Color GetColor(TrackID track_id) const;
+
+
+  /// Removes the given track, *e.g.* after it has been lost by the
+  /// tracker. Returns false if the track is unknown.
+  bool Remove(TrackID track_id);
+
+
+  /// Removes all tracks.
+  void Clear();
+
+
+  /// Invokes the visitor for each track (in ascending order of the
+  /// identifiers) with its color and its contiguous, (smoothed)
+  /// positions, ordered from the oldest to the most recent one.
+  /// The pointer is only valid until the store is modified.
+  void ForEachTrack(
+      const std::function<void(
+        TrackID track_id, const Vec2d *points, std::size_t num_points,
+        const Color &color)> &visitor) const;
+
+
+  /// Returns a human-readable string representation.
+  std::string ToString() const;
+
+
+  /// Overloaded stream operator.
+  friend std::ostream &operator<<(
+      std::ostream &os, const TrajectoryStore &store) {
+    os << store.ToString();
+    return os;
+  }
+
+
+private:
+  /// State of a single track.
+  struct Track {
+    /// Double-mapped ring buffer of the (smoothed) positions. Until the
+    /// buffer is full for the first time, only the first half is used.
+    std::vector<Vec2d> points;
+
+    /// Ring buffer of the most recent raw positions, which are needed
+    /// to update the moving average.
+    std::vector<Vec2d> recent;
+
+    /// Sum of the raw positions within the current averaging window.
+    Vec2d window_sum;
+
+    /// Total number of positions appended to this track.
+    std::size_t num_appended = 0;
+
+    /// Color of this track.
+    Color color = Color::Invalid;
+  };
+
+
+  /// Stores the (smoothed) position with the given absolute index.
+  void Store(Track &track, std::size_t index, const Vec2d &position) const;
+
+
+  /// Returns the number of positions currently kept for the track.
+  std::size_t NumPoints(const Track &track) const;
+
+
+  /// Returns the first of the contiguous (smoothed) positions.
+  const Vec2d *Data(const Track &track) const;
+
+
+  std::size_t capacity_;
+  int smoothing_window_;
+  std::map<TrackID, Track> tracks_;
+};
+
+} // namespace viren2d
+
+#endif // __VIREN2D_TRAJECTORY_STORE_H__
@@ -5,11 +5,13 @@
 #include <viren2d/colorgradients.h>
 #include <viren2d/colormaps.h>
 #include <viren2d/collage.h>
+#include <viren2d/display_list.h>
 #include <viren2d/drawing.h>
 #include <viren2d/imagebuffer.h>
 #include <viren2d/opticalflow.h>
 #include <viren2d/primitives.h>
 #include <viren2d/styles.h>
+#include <viren2d/trajectory_store.h>
 #include <viren2d/version.h>
 
 #endif // __VIREN2D_VIREN2D_H__
@@ -69,6 +69,7 @@ PYBIND11_MODULE(viren2d_PYMODULE_NAME, m) {
 
   viren2d::bindings::RegisterAnchors(m);
   viren2d::bindings::RegisterTextStyle(m);
+  viren2d::bindings::RegisterTextCache(m);
 
   viren2d::bindings::RegisterBoundingBox2DStyle(m);
 
@@ -76,6 +77,10 @@ PYBIND11_MODULE(viren2d_PYMODULE_NAME, m) {
   viren2d::bindings::RegisterImageBuffer(m);
 
   //------------------------------------------------- Drawing - Painter
+  viren2d::bindings::RegisterCanvasLayout(m);
+  viren2d::bindings::RegisterRenderQuality(m);
+  viren2d::bindings::RegisterDisplayList(m);
+  viren2d::bindings::RegisterTrajectoryStore(m);
   viren2d::bindings::RegisterPainter(m);
 
   //------------------------------------------------- Visualization - Collage
@@ -52,6 +52,8 @@ void RegisterLine2d(pybind11::module &m);
 //------------------------------------------------- ImageBuffer
 void RegisterImageBuffer(pybind11::module &m);
 ImageBuffer CastToImageBufferUInt8C4(pybind11::array buf);
+ImageBuffer CreateImageBuffer(
+    pybind11::array &buf, bool copy, bool disable_warnings);
 
 
 //-------------------------------------------------  Styles (MarkerStyle & LineStyle)
@@ -70,6 +72,7 @@ void RegisterArrowStyle(pybind11::module &m);
 //-------------------------------------------------  Styles (TextStyle)
 void RegisterAnchors(pybind11::module &m);
 void RegisterTextStyle(pybind11::module &m);
+void RegisterTextCache(pybind11::module &m);
 
 //-------------------------------------------------  Styles (BoundingBox2DStyle)
 void RegisterBoundingBox2DStyle(pybind11::module &m);
@@ -79,6 +82,10 @@ void RegisterVectors(pybind11::module &m);
 
 //-------------------------------------------------  Painter
 std::string PathStringFromPyObject(const pybind11::object &path);
+void RegisterCanvasLayout(pybind11::module &m);
+void RegisterRenderQuality(pybind11::module &m);
+void RegisterDisplayList(pybind11::module &m);
+void RegisterTrajectoryStore(pybind11::module &m);
 void RegisterPainter(pybind11::module &m);
 
 //------------------------------------------------- Collage
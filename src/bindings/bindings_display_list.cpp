@@ -0,0 +1,109 @@
+#include <sstream>
+
+#include <viren2d/display_list.h>
+
+#include <bindings/binding_helpers.h>
+
+namespace py = pybind11;
+
+namespace viren2d {
+namespace bindings {
+
+void RegisterDisplayList(py::module &m) {
+  py::class_<DisplayList> dl(m, "DisplayList", R"docstr(
+        Records drawing commands to replay them later on.
+
+        Typical use case: overlays which stay the same over several
+        frames, *e.g.* a region of interest or a static legend. Instead of
+        issuing all the ``draw_xxx`` calls for each frame, record them once
+        via :meth:`~viren2d.Painter.begin_recording` and render them via
+        :meth:`~viren2d.Painter.draw_display_list`.
+
+        Commands are stored compactly, *i.e.* identical styles are
+        stored only once.
+
+        **Corresponding C++ API:** ``viren2d::DisplayList``.
+
+        Example:
+          >>> overlay = viren2d.DisplayList()
+          >>> painter.begin_recording(overlay)
+          >>> painter.draw_rect(roi, line_style)
+          >>> painter.draw_text(['Region of interest'], (10, 10))
+          >>> painter.end_recording()
+          >>> overlay = overlay.optimized()
+          >>> for frame in frames:
+          >>>     painter.set_canvas_image(frame)
+          >>>     painter.draw_display_list(overlay)
+        )docstr");
+
+  dl.def(
+        py::init<>(), R"docstr(
+        Creates an empty display list.
+        )docstr");
+
+  dl.def(
+        "__str__", [](const DisplayList &l) -> std::string {
+          return l.ToString();
+        });
+
+  dl.def(
+        "__repr__", [](const DisplayList &l) -> std::string {
+          std::ostringstream s;
+          s << '<' << l.ToString() << '>';
+          return s.str();
+        });
+
+  dl.def(
+        "__len__", &DisplayList::NumCommands, R"docstr(
+        Returns the number of recorded commands.
+        )docstr");
+
+  dl.def_property_readonly(
+        "num_commands", &DisplayList::NumCommands, R"docstr(
+        int: Number of recorded commands (read-only).
+        )docstr");
+
+  dl.def_property_readonly(
+        "num_styles", &DisplayList::NumStyles, R"docstr(
+        int: Total number of stored (*i.e.* unique) styles and colors
+          (read-only).
+        )docstr");
+
+  dl.def(
+        "clear", &DisplayList::Clear, R"docstr(
+        Removes all recorded commands.
+        )docstr");
+
+  dl.def(
+        "append", &DisplayList::Append, R"docstr(
+        Appends all commands of the other display list.
+        )docstr",
+        py::arg("other"));
+
+  dl.def(
+        "copy", [](const DisplayList &l) { return DisplayList(l); }, R"docstr(
+        Returns a deep copy.
+        )docstr");
+
+  dl.def(
+        "optimized", &DisplayList::Optimized, R"docstr(
+        Returns an optimized copy of this display list.
+
+        The optimized list produces the same visualization, but invisible
+        commands are dropped, consecutive lines with the same opaque style
+        are merged into a single stroke and consecutive markers with the
+        same style are merged into a single batch.
+
+        **Corresponding C++ API:** ``viren2d::DisplayList::Optimized``.
+
+        Args:
+          sort_by_state: If ``True``, commands are additionally sorted by
+            their type and style, which yields larger batches. Since this
+            changes the drawing order, only use it if the recorded primitives
+            don't overlap.
+        )docstr",
+        py::arg("sort_by_state") = false);
+}
+
+} // namespace bindings
+} // namespace viren2d
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <memory>
 
 #include <pybind11/operators.h>
 #include <pybind11/numpy.h>
@@ -16,6 +17,16 @@ namespace py = pybind11;
 
 namespace viren2d {
 namespace bindings {
+/// Exposes `ImageBufferThreadsScope` as a Python context manager, *i.e.*
+/// the override only becomes active within the `with` block.
+struct ImageBufferThreadsContext {
+  explicit ImageBufferThreadsContext(int threads) : num_threads(threads) {}
+
+  int num_threads;
+  std::unique_ptr<ImageBufferThreadsScope> scope;
+};
+
+
 //------------------------------------------------- ImageBuffer from numpy array
 //FIXME extend imagebuffer conversion by:
   // 1) enable creation from int8, bool (also provide bool.convert_to_uchar)
@@ -973,6 +984,194 @@ void RegisterImageBuffer(py::module &m) {
         py::arg("saturation_range") = std::make_pair<float, float>(0.0f, 1.0f),
         py::arg("value_range") = std::make_pair<float, float>(0.0f, 1.0f),
         py::arg("is_bgr") = false);
+
+
+  py::class_<ImageBufferPoolStatistics> pool_stats(
+        m, "ImageBufferPoolStatistics", R"docstr(
+      Usage statistics of the buffer pool, see
+      :func:`~viren2d.image_buffer_pool_statistics`.
+
+      **Corresponding C++ API:** ``viren2d::ImageBufferPoolStatistics``.
+      )docstr");
+
+  pool_stats.def_readonly(
+        "bytes_retained", &ImageBufferPoolStatistics::bytes_retained, R"docstr(
+        int: Number of bytes which are currently kept for reuse (read-only).
+        )docstr")
+      .def_readonly(
+        "blocks_retained", &ImageBufferPoolStatistics::blocks_retained, R"docstr(
+        int: Number of memory blocks which are currently kept for
+          reuse (read-only).
+        )docstr")
+      .def_readonly(
+        "capacity", &ImageBufferPoolStatistics::capacity, R"docstr(
+        int: Maximum number of bytes which will be kept for reuse (read-only).
+        )docstr")
+      .def_readonly(
+        "hits", &ImageBufferPoolStatistics::hits, R"docstr(
+        int: Number of allocations which reused a retained block (read-only).
+        )docstr")
+      .def_readonly(
+        "misses", &ImageBufferPoolStatistics::misses, R"docstr(
+        int: Number of allocations which requested memory from the
+          system (read-only).
+        )docstr")
+      .def(
+        "__repr__", [](const ImageBufferPoolStatistics &st) {
+          std::ostringstream s;
+          s << "<ImageBufferPoolStatistics(bytes_retained=" << st.bytes_retained
+            << ", blocks_retained=" << st.blocks_retained
+            << ", capacity=" << st.capacity << ", hits=" << st.hits
+            << ", misses=" << st.misses << ")>";
+          return s.str();
+        });
+
+
+  m.def("set_image_buffer_pool_capacity",
+        &SetImageBufferPoolCapacity, R"docstr(
+        Sets the capacity of the process-wide buffer pool.
+
+        Video pipelines usually allocate and free the same few image
+        shapes for every frame. Instead of returning the memory to the
+        system, the pool keeps freed blocks and hands them out again for
+        requests of the same size class (sizes are rounded up by at most
+        12.5%). Each thread caches its most recently freed blocks, such
+        that these can be reused without locking.
+
+        **Corresponding C++ API:** ``viren2d::SetImageBufferPoolCapacity``.
+
+        Args:
+          num_bytes: Maximum number of bytes as :class:`int` which the pool
+            may retain. Set to 0 to always return freed memory to the system.
+        )docstr", py::arg("num_bytes"));
+
+  m.def("image_buffer_pool_capacity",
+        &ImageBufferPoolCapacity, R"docstr(
+        Returns the capacity of the process-wide buffer pool in bytes.
+
+        **Corresponding C++ API:** ``viren2d::ImageBufferPoolCapacity``.
+        )docstr");
+
+  m.def("image_buffer_pool_statistics",
+        &GetImageBufferPoolStatistics, R"docstr(
+        Returns the :class:`~viren2d.ImageBufferPoolStatistics`, which can be
+        used to choose a suitable pool capacity.
+
+        **Corresponding C++ API:** ``viren2d::GetImageBufferPoolStatistics``.
+
+        Args:
+          reset: If ``True``, the hit/miss counters will be reset afterwards.
+        )docstr", py::arg("reset") = false);
+
+  m.def("release_image_buffer_pool",
+        &ReleaseImageBufferPool, R"docstr(
+        Returns all memory retained by the buffer pool to the system.
+
+        Blocks cached by other threads will be released once these
+        threads exit.
+
+        **Corresponding C++ API:** ``viren2d::ReleaseImageBufferPool``.
+        )docstr");
+
+
+  m.def("set_image_buffer_threads",
+        &SetImageBufferThreads, R"docstr(
+        Sets the number of threads for per-pixel :class:`~viren2d.ImageBuffer`
+        operations.
+
+        Conversions (*e.g.* :meth:`~viren2d.ImageBuffer.to_channels`,
+        :meth:`~viren2d.ImageBuffer.to_uint8`), blending, dimming,
+        :meth:`~viren2d.ImageBuffer.magnitude`,
+        :meth:`~viren2d.ImageBuffer.orientation` and
+        :meth:`~viren2d.ImageBuffer.min_max` split the image into chunks
+        of rows, which are processed by a persistent pool of worker
+        threads. Images smaller than the
+        :func:`~viren2d.image_buffer_parallel_threshold` are always
+        processed serially.
+
+        **Corresponding C++ API:** ``viren2d::SetImageBufferThreads``.
+
+        Args:
+          num_threads: Maximum number of threads as :class:`int` (including
+            the calling one). Set to 0 to use all hardware threads (default),
+            or to 1 to disable multi-threading.
+        )docstr", py::arg("num_threads"));
+
+  m.def("image_buffer_threads",
+        &ImageBufferThreads, R"docstr(
+        Returns the number of threads for per-pixel operations, *i.e.* 0 if
+        all hardware threads will be used.
+
+        **Corresponding C++ API:** ``viren2d::ImageBufferThreads``.
+        )docstr");
+
+  m.def("set_image_buffer_parallel_threshold",
+        &SetImageBufferParallelThreshold, R"docstr(
+        Sets the minimum number of pixels of an :class:`~viren2d.ImageBuffer`,
+        for which per-pixel operations will be distributed among multiple
+        threads.
+
+        Below this threshold, synchronizing the threads would take longer
+        than processing the image serially.
+
+        **Corresponding C++ API:** ``viren2d::SetImageBufferParallelThreshold``.
+
+        Args:
+          num_pixels: The threshold as :class:`int`.
+        )docstr", py::arg("num_pixels"));
+
+  m.def("image_buffer_parallel_threshold",
+        &ImageBufferParallelThreshold, R"docstr(
+        Returns the minimum number of pixels for multi-threaded processing.
+
+        **Corresponding C++ API:** ``viren2d::ImageBufferParallelThreshold``.
+        )docstr");
+
+
+  py::class_<ImageBufferThreadsContext> threads_scope(
+        m, "ImageBufferThreadsScope", R"docstr(
+      Context manager which overrides the number of threads for per-pixel
+      :class:`~viren2d.ImageBuffer` operations of the current thread.
+
+      Other threads are not affected, in contrast to
+      :func:`~viren2d.set_image_buffer_threads`.
+
+      **Corresponding C++ API:** ``viren2d::ImageBufferThreadsScope``.
+
+      Example:
+        >>> with viren2d.ImageBufferThreadsScope(1):
+        >>>     gray = viren2d.convert_rgb2gray(img)
+      )docstr");
+
+  threads_scope.def(
+        py::init<int>(), R"docstr(
+        Creates the context manager.
+
+        Args:
+          num_threads: Number of threads as :class:`int`, see
+            :func:`~viren2d.set_image_buffer_threads`.
+        )docstr", py::arg("num_threads"))
+      .def(
+        "__enter__", [](ImageBufferThreadsContext &ctx) {
+          ctx.scope.reset(new ImageBufferThreadsScope(ctx.num_threads));
+          return &ctx;
+        }, py::return_value_policy::reference)
+      .def(
+        "__exit__", [](ImageBufferThreadsContext &ctx,
+                       py::object, py::object, py::object) {
+          ctx.scope.reset();
+        })
+      .def_readonly(
+        "num_threads", &ImageBufferThreadsContext::num_threads, R"docstr(
+        int: Number of threads within this context (read-only).
+        )docstr")
+      .def(
+        "__repr__", [](const ImageBufferThreadsContext &ctx) {
+          std::ostringstream s;
+          s << "<ImageBufferThreadsScope(num_threads="
+            << ctx.num_threads << ")>";
+          return s.str();
+        });
 }
 } // namespace bindings
 } // namespace viren2d
@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <memory>
 #include <tuple>
 #include <sstream>
@@ -33,6 +34,150 @@ ImageBuffer ImageBufferU8C4FromPyObject(py::object o) {
 }
 
 
+/// Returns an ImageBuffer which can be passed on to `Painter::SetCanvas`.
+/// Whenever possible, this will be a shared view onto the given object.
+ImageBuffer ImageBufferForCanvasFromPyObject(py::object o) {
+  if (py::isinstance<ImageBuffer>(o)) {
+    ImageBuffer &buffer = py::cast<ImageBuffer&>(o);
+    ImageBuffer view;
+    view.CreateSharedBuffer(
+          buffer.MutableData(), buffer.Height(), buffer.Width(),
+          buffer.Channels(), buffer.RowStride(), buffer.PixelStride(),
+          buffer.BufferType());
+    return view;
+  } else if (py::isinstance<py::array>(o)) {
+    py::array arr = py::cast<py::array>(o);
+    const int channels = (arr.ndim() == 2)
+        ? 1 : ((arr.ndim() == 3) ? static_cast<int>(arr.shape(2)) : 0);
+    if (py::isinstance<py::array_t<uint8_t>>(arr)
+        && ((channels == 1) || (channels == 3) || (channels == 4))) {
+      return CreateImageBuffer(arr, false, true);
+    }
+  }
+  return ImageBufferU8C4FromPyObject(o);
+}
+
+
+CanvasLayout CanvasLayoutFromPyObject(const py::object &o) {
+  if (py::isinstance<py::str>(o)) {
+    return CanvasLayoutFromString(py::cast<std::string>(o));
+  } else if (py::isinstance<CanvasLayout>(o)) {
+    return py::cast<CanvasLayout>(o);
+  } else {
+    const std::string tp = py::cast<std::string>(
+        o.attr("__class__").attr("__name__"));
+    std::ostringstream str;
+    str << "Cannot cast type `" << tp
+        << "` to `viren2d.CanvasLayout`!";
+    throw std::invalid_argument(str.str());
+  }
+}
+
+
+RenderQuality RenderQualityFromPyObject(const py::object &o) {
+  if (py::isinstance<py::str>(o)) {
+    return RenderQualityFromString(py::cast<std::string>(o));
+  } else if (py::isinstance<RenderQuality>(o)) {
+    return py::cast<RenderQuality>(o);
+  } else {
+    const std::string tp = py::cast<std::string>(
+        o.attr("__class__").attr("__name__"));
+    std::ostringstream str;
+    str << "Cannot cast type `" << tp
+        << "` to `viren2d.RenderQuality`!";
+    throw std::invalid_argument(str.str());
+  }
+}
+
+
+/// Returns a writeable, shared ImageBuffer view onto the given
+/// `numpy.ndarray` or `viren2d.ImageBuffer`.
+ImageBuffer OutputImageBufferFromPyObject(py::object o) {
+  ImageBuffer view;
+  if (py::isinstance<ImageBuffer>(o)) {
+    ImageBuffer &buffer = py::cast<ImageBuffer&>(o);
+    view.CreateSharedBuffer(
+          buffer.MutableData(), buffer.Height(), buffer.Width(),
+          buffer.Channels(), buffer.RowStride(), buffer.PixelStride(),
+          buffer.BufferType());
+    return view;
+  }
+
+  if (!py::isinstance<py::array>(o)) {
+    std::string msg("Cannot use type `");
+    msg += py::cast<std::string>(
+          o.attr("__class__").attr("__name__"));
+    msg += "` as output buffer, expected `numpy.ndarray` or `viren2d.ImageBuffer`!";
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  py::array arr = py::cast<py::array>(o);
+  const bool valid_shape = (arr.ndim() == 2)
+      || ((arr.ndim() == 3) && ((arr.shape(2) == 1) || (arr.strides(2) == 1)));
+  if (!py::isinstance<py::array_t<uint8_t>>(arr) || !arr.writeable()
+      || !valid_shape || (arr.strides(0) <= 0) || (arr.strides(1) <= 0)) {
+    const std::string msg(
+          "Output array must be a writeable `numpy.uint8` array of shape "
+          "(H, W) or (H, W, C) with positive strides and contiguous channels!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  view.CreateSharedBuffer(
+        static_cast<unsigned char *>(arr.mutable_data()),
+        static_cast<int>(arr.shape(0)), static_cast<int>(arr.shape(1)),
+        (arr.ndim() == 2) ? 1 : static_cast<int>(arr.shape(2)),
+        static_cast<int>(arr.strides(0)), static_cast<int>(arr.strides(1)),
+        ImageBufferType::UInt8);
+  return view;
+}
+
+
+/// Converts a list of `viren2d.Rect` or a Nx4 `numpy.ndarray` to
+/// rectangles. The array rows are interpreted according to `box_format`,
+/// *i.e.* ``ltwh``, ``lrtb`` or ``cwh``.
+std::vector<Rect> RectsFromPyObject(
+    const py::object &o, const std::string &box_format) {
+  if (!py::isinstance<py::array>(o)) {
+    return py::cast<std::vector<Rect>>(o);
+  }
+
+  using ArrayType = py::array_t<double, py::array::c_style | py::array::forcecast>;
+  ArrayType arr = ArrayType::ensure(o);
+  if (!arr || (arr.ndim() != 2) || (arr.shape(1) != 4)) {
+    const std::string msg(
+          "Bounding boxes must be given as Nx4 `numpy.ndarray`!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  Rect (*factory)(double, double, double, double, double) = nullptr;
+  if (box_format == "ltwh") {
+    factory = &Rect::FromLTWH;
+  } else if (box_format == "lrtb") {
+    factory = &Rect::FromLRTB;
+  } else if (box_format == "cwh") {
+    factory = &Rect::FromCWH;
+  } else {
+    std::string msg("Invalid box format `");
+    msg += box_format;
+    msg += "`, expected `ltwh`, `lrtb` or `cwh`!";
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  const std::size_t num_boxes = static_cast<std::size_t>(arr.shape(0));
+  const double *data = arr.data();
+  std::vector<Rect> boxes;
+  boxes.reserve(num_boxes);
+  for (std::size_t idx = 0; idx < num_boxes; ++idx, data += 4) {
+    boxes.push_back(factory(data[0], data[1], data[2], data[3], 0.0));
+  }
+  return boxes;
+}
+
+
 /// A wrapper for the abstract `Painter`
 ///
 /// This is necessary because I don't want to expose
@@ -48,7 +193,7 @@ public:
 
   PainterWrapper(const py::object &image)
     : painter_(CreatePainter()) {
-    SetCanvasImage(image);
+    SetCanvasImage(image, true, false);
   }
 
 
@@ -60,17 +205,31 @@ public:
 
   void SetCanvasColor(int height, int width, const Color &color) {
     painter_->SetCanvas(height, width, color);
+    canvas_owner_ = py::none();
   }
 
 
   void SetCanvasFilename(const py::object &image_filename) {
     painter_->SetCanvas(PathStringFromPyObject(image_filename));
+    canvas_owner_ = py::none();
   }
 
 
-  void SetCanvasImage(py::object image) {
-    const ImageBuffer img_u8c4 = ImageBufferU8C4FromPyObject(image);
-    painter_->SetCanvas(img_u8c4);
+  bool SetCanvasImage(py::object image, bool copy, bool is_bgr) {
+    // The painter converts uint8 grayscale, RGB(A) and BGR(A) images
+    // directly into its canvas. Thus, we only set up a shared view onto
+    // the input (if possible) and avoid an intermediate 4-channel copy:
+    ImageBuffer img = ImageBufferForCanvasFromPyObject(image);
+    bool shared = false;
+    if (is_bgr) {
+      painter_->SetCanvasBGR(img);
+    } else {
+      shared = painter_->SetCanvas(img, copy);
+    }
+    // If the painter draws onto the caller's memory, we have to keep the
+    // corresponding python object alive:
+    canvas_owner_ = shared ? image : py::none();
+    return shared;
   }
 
 
@@ -79,6 +238,34 @@ public:
   }
 
 
+  py::object GetCanvasWithLayout(
+      bool copy, const py::object &layout, py::object out) {
+    if (layout.is_none() && out.is_none()) {
+      return py::cast(painter_->GetCanvas(copy));
+    }
+
+    if (out.is_none()) {
+      ImageBuffer buffer;
+      painter_->GetCanvas(buffer, CanvasLayoutFromPyObject(layout));
+      return py::cast(std::move(buffer));
+    }
+
+    // Write into the caller's buffer. If no layout is specified, we
+    // deduce it from the number of channels:
+    ImageBuffer view = OutputImageBufferFromPyObject(out);
+    CanvasLayout cl = CanvasLayout::RGBA;
+    if (!layout.is_none()) {
+      cl = CanvasLayoutFromPyObject(layout);
+    } else if (view.Channels() == 1) {
+      cl = CanvasLayout::Gray;
+    } else if (view.Channels() == 3) {
+      cl = CanvasLayout::RGB;
+    }
+    painter_->GetCanvas(view, cl);
+    return out;
+  }
+
+
   py::tuple GetCanvasSize() {
     auto sz = painter_->GetCanvasSize();
     return py::make_tuple(sz.Width(), sz.Height());
@@ -136,6 +323,50 @@ public:
   }
 
 
+  bool DrawBoundingBoxes2D(
+      const py::object &boxes, const py::object &styles,
+      const py::object &style_indices, const py::object &labels,
+      const std::string &box_format) {
+    std::vector<BoundingBox2DStyle> style_table;
+    if (py::isinstance<BoundingBox2DStyle>(styles)) {
+      style_table.push_back(py::cast<BoundingBox2DStyle>(styles));
+    } else {
+      style_table = py::cast<std::vector<BoundingBox2DStyle>>(styles);
+    }
+
+    std::vector<std::size_t> indices;
+    if (!style_indices.is_none()) {
+      using IndexArray = py::array_t<std::int64_t, py::array::c_style | py::array::forcecast>;
+      IndexArray arr = IndexArray::ensure(style_indices);
+      if (!arr || (arr.ndim() != 1)) {
+        const std::string msg(
+              "Style indices must be given as 1D array or list of int!");
+        SPDLOG_ERROR(msg);
+        throw std::invalid_argument(msg);
+      }
+      const std::int64_t *data = arr.data();
+      indices.reserve(static_cast<std::size_t>(arr.shape(0)));
+      for (py::ssize_t idx = 0; idx < arr.shape(0); ++idx) {
+        if (data[idx] < 0) {
+          const std::string msg("Style indices must not be negative!");
+          SPDLOG_ERROR(msg);
+          throw std::invalid_argument(msg);
+        }
+        indices.push_back(static_cast<std::size_t>(data[idx]));
+      }
+    }
+
+    std::vector<std::string> label_texts;
+    if (!labels.is_none()) {
+      label_texts = py::cast<std::vector<std::string>>(labels);
+    }
+
+    return painter_->DrawBoundingBoxes2D(
+          RectsFromPyObject(boxes, box_format), style_table,
+          indices, label_texts);
+  }
+
+
   bool DrawCircle(
       const Vec2d &center, double radius,
       const LineStyle &line_style, const Color &fill_color) {
@@ -262,6 +493,177 @@ public:
           smoothing_window, fading_factor);
   }
 
+
+  bool DrawTrajectoryStore(
+      const TrajectoryStore &store, const LineStyle &style,
+      const Color &color_fade_out,
+      const std::function<double(double)> &fading_factor) {
+    return painter_->DrawTrajectoryStore(
+          store, style, color_fade_out, fading_factor);
+  }
+
+  void BeginRecording(const py::object &display_list) {
+    DisplayList &list = display_list.cast<DisplayList &>();
+    painter_->BeginRecording(list);
+    // The painter only stores a pointer to the list, so we have to keep
+    // the python object alive while recording:
+    recording_owner_ = display_list;
+  }
+
+
+  void EndRecording() {
+    painter_->EndRecording();
+    recording_owner_ = py::none();
+  }
+
+
+  bool IsRecording() const {
+    return painter_->IsRecording();
+  }
+
+
+  bool DrawDisplayList(const DisplayList &display_list) {
+    return painter_->DrawDisplayList(display_list);
+  }
+
+
+  bool BeginLayer(const std::string &name) {
+    return painter_->BeginLayer(name);
+  }
+
+
+  bool EndLayer() {
+    return painter_->EndLayer();
+  }
+
+
+  bool IsLayerActive() const {
+    return painter_->IsLayerActive();
+  }
+
+
+  bool HasLayer(const std::string &name) const {
+    return painter_->HasLayer(name);
+  }
+
+
+  bool DrawLayer(const std::string &name) {
+    return painter_->DrawLayer(name);
+  }
+
+
+  bool InvalidateLayer(const std::string &name) {
+    return painter_->InvalidateLayer(name);
+  }
+
+
+  void ClearLayers() {
+    painter_->ClearLayers();
+  }
+
+
+  int GetRenderThreads() const {
+    return painter_->RenderThreads();
+  }
+
+
+  void SetRenderThreads(int num_threads) {
+    painter_->SetRenderThreads(num_threads);
+  }
+
+
+  std::size_t GetMarkerCacheSize() const {
+    return painter_->MarkerCacheSize();
+  }
+
+
+  void SetMarkerCacheSize(std::size_t num_sprites) {
+    painter_->SetMarkerCacheSize(num_sprites);
+  }
+
+
+  int GetTrajectoryFadeOutLevels() const {
+    return painter_->TrajectoryFadeOutLevels();
+  }
+
+
+  void SetTrajectoryFadeOutLevels(int num_levels) {
+    painter_->SetTrajectoryFadeOutLevels(num_levels);
+  }
+
+
+  double GetSimplificationTolerance() const {
+    return painter_->SimplificationTolerance();
+  }
+
+
+  void SetSimplificationTolerance(double tolerance) {
+    painter_->SetSimplificationTolerance(tolerance);
+  }
+
+
+  bool IsBitmapTextEnabled() const {
+    return painter_->IsBitmapTextEnabled();
+  }
+
+
+  void SetBitmapTextEnabled(bool enabled) {
+    painter_->SetBitmapTextEnabled(enabled);
+  }
+
+
+  RenderQuality GetRenderQuality() const {
+    return painter_->GetRenderQuality();
+  }
+
+
+  void SetRenderQuality(const py::object &quality) {
+    painter_->SetRenderQuality(RenderQualityFromPyObject(quality));
+  }
+
+
+  std::size_t NumCulledPrimitives() const {
+    return painter_->NumCulledPrimitives();
+  }
+
+
+  void ResetNumCulledPrimitives() {
+    painter_->ResetNumCulledPrimitives();
+  }
+
+
+  std::vector<Rect> DirtyRects() const {
+    return painter_->DirtyRects();
+  }
+
+
+  void ResetDirtyRects() {
+    painter_->ResetDirtyRects();
+  }
+
+
+  py::object CopyDirtyRects(py::object out, const py::object &layout) {
+    // Same layout deduction as for `get_canvas`:
+    ImageBuffer view = OutputImageBufferFromPyObject(out);
+    CanvasLayout cl = CanvasLayout::RGBA;
+    if (!layout.is_none()) {
+      cl = CanvasLayoutFromPyObject(layout);
+    } else if (view.Channels() == 1) {
+      cl = CanvasLayout::Gray;
+    } else if (view.Channels() == 3) {
+      cl = CanvasLayout::RGB;
+    }
+    painter_->CopyDirtyRects(view, cl);
+    return out;
+  }
+
+
+  void RestoreDirtyRects(py::object background, bool is_bgr) {
+    ImageBuffer img = ImageBufferForCanvasFromPyObject(background);
+    painter_->RestoreDirtyRects(img, is_bgr);
+  }
+
+
   std::tuple<bool, Vec2d, Vec2d, Vec2d, Vec2d> DrawXYZAxes(
       const py::EigenDRef<const Matrix3x3d> K,
       const py::EigenDRef<const Matrix3x3d> R,
@@ -301,9 +703,127 @@ public:
 
 private:
   std::unique_ptr<Painter> painter_;
+
+  /// Python object which provides the canvas memory if the painter
+  /// draws directly onto a caller-owned image (see `SetCanvasImage`).
+  py::object canvas_owner_;
+
+  /// Python object which holds the display list, while the painter
+  /// is in recording mode (see `BeginRecording`).
+  py::object recording_owner_;
 };
 
 
+void RegisterCanvasLayout(py::module &m) {
+  py::enum_<CanvasLayout> layout(m, "CanvasLayout", R"docstr(
+        Enumeration specifying the pixel format when exporting the canvas,
+        see :meth:`~viren2d.Painter.get_canvas`.
+
+        Explicit instantiation:
+          >>> layout = viren2d.CanvasLayout.BGR
+
+        Implicit conversion:
+          >>> img = painter.get_canvas(layout='bgr')
+
+        **Corresponding C++ API:** ``viren2d::CanvasLayout``.
+        )docstr");
+  layout.value(
+        "RGB",
+        CanvasLayout::RGB, R"docstr(
+        3-channel RGB image.
+        )docstr")
+      .value(
+        "BGR",
+        CanvasLayout::BGR, R"docstr(
+        3-channel BGR image, *e.g.* to pass the canvas on to OpenCV.
+        )docstr")
+      .value(
+        "RGBA",
+        CanvasLayout::RGBA, R"docstr(
+        4-channel RGBA image with straight (*i.e.* not premultiplied) alpha.
+        )docstr")
+      .value(
+        "BGRA",
+        CanvasLayout::BGRA, R"docstr(
+        4-channel BGRA image with straight (*i.e.* not premultiplied) alpha.
+        )docstr")
+      .value(
+        "Gray",
+        CanvasLayout::Gray, R"docstr(
+        Single-channel grayscale image.
+        )docstr");
+
+  layout.def(
+        "__str__", [](CanvasLayout l) -> py::str {
+            return py::str(CanvasLayoutToString(l));
+        }, py::name("__str__"), py::is_method(m));
+
+  layout.def(
+        "__repr__", [](CanvasLayout l) -> py::str {
+            std::ostringstream s;
+            s << "<CanvasLayout." << CanvasLayoutToString(l) << '>';
+            return py::str(s.str());
+        }, py::name("__repr__"), py::is_method(m));
+
+  layout.def(py::init<>(&CanvasLayoutFromPyObject),
+        "Custom constructor to support implicit conversion from a :class:`str`.",
+        py::arg("obj"));
+
+  py::implicitly_convertible<py::str, CanvasLayout>();
+}
+
+
+void RegisterRenderQuality(py::module &m) {
+  py::enum_<RenderQuality> quality(m, "RenderQuality", R"docstr(
+        Enumeration specifying the trade-off between rendering speed and
+        quality, see :attr:`~viren2d.Painter.render_quality`.
+
+        Explicit instantiation:
+          >>> quality = viren2d.RenderQuality.Fast
+
+        Implicit conversion:
+          >>> painter.render_quality = 'best'
+
+        **Corresponding C++ API:** ``viren2d::RenderQuality``.
+        )docstr");
+  quality.value(
+        "Fast",
+        RenderQuality::Fast, R"docstr(
+        For live previews: Coarse curves, no anti-aliasing of axis-aligned
+        boxes and grids, nearest-neighbor interpolation of images.
+        )docstr")
+      .value(
+        "Balanced",
+        RenderQuality::Balanced, R"docstr(
+        Cairo's default settings.
+        )docstr")
+      .value(
+        "Best",
+        RenderQuality::Best, R"docstr(
+        For exported frames: Finest curves, best anti-aliasing and image
+        interpolation.
+        )docstr");
+
+  quality.def(
+        "__str__", [](RenderQuality q) -> py::str {
+            return py::str(RenderQualityToString(q));
+        }, py::name("__str__"), py::is_method(m));
+
+  quality.def(
+        "__repr__", [](RenderQuality q) -> py::str {
+            std::ostringstream s;
+            s << "<RenderQuality." << RenderQualityToString(q) << '>';
+            return py::str(s.str());
+        }, py::name("__repr__"), py::is_method(m));
+
+  quality.def(py::init<>(&RenderQualityFromPyObject),
+        "Custom constructor to support implicit conversion from a :class:`str`.",
+        py::arg("obj"));
+
+  py::implicitly_convertible<py::str, RenderQuality>();
+}
+
+
 void RegisterPainter(py::module &m) {
   py::class_<PainterWrapper> painter(m, "Painter", R"docstr(
         A *Painter* lets you draw on its canvas.
@@ -446,18 +966,46 @@ void RegisterPainter(py::module &m) {
         &PainterWrapper::SetCanvasImage, R"docstr(
         Initializes the canvas from the given image.
 
-        **Corresponding C++ API:** ``viren2d::Painter::SetCanvas``.
+        **Corresponding C++ API:** ``viren2d::Painter::SetCanvas``
+        and ``viren2d::Painter::SetCanvasBGR``.
 
         Args:
           img_np: Image as either a :class:`numpy.ndarray` (currently,
             only :class:`numpy.uint8` is supported) or an :class:`~viren2d.ImageBuffer`.
             The image can either be grayscale, RGB or RGBA.
+          copy: If ``False`` and the image is a row-major, writeable
+            RGBA image of type :class:`numpy.uint8`, the painter will
+            draw directly onto the image's memory instead of copying it.
+            If the memory layout is not compatible, the image will be
+            copied nonetheless.
+          is_bgr: Set to ``True`` if the image is in BGR(A) format,
+            *e.g.* an OpenCV frame. The channels will then be reordered
+            while copying the image into the canvas. A BGR(A) image will
+            always be copied, *i.e.* ``copy`` will be ignored.
+
+        Returns:
+          ``True`` if the painter draws directly onto the given image,
+          ``False`` if the image has been copied.
 
         Example:
           >>> img_np = np.zeros((480, 640, 3), dtype=np.uint8)
           >>> painter.set_canvas_image(img_np)
+          False
+
+          >>> # Annotate a RGBA frame in-place:
+          >>> frame = np.zeros((480, 640, 4), dtype=np.uint8)
+          >>> painter.set_canvas_image(frame, copy=False)
+          True
+          >>> painter.draw_line((0, 0), (640, 480))
+
+          >>> # Initialize the canvas from an OpenCV frame:
+          >>> frame = cv2.imread('image.jpg')
+          >>> painter.set_canvas_image(frame, is_bgr=True)
+          False
         )docstr",
-        py::arg("image"));
+        py::arg("image"),
+        py::arg("copy") = true,
+        py::arg("is_bgr") = false);
 
 
   //----------------------------------------------------------------------
@@ -521,14 +1069,19 @@ void RegisterPainter(py::module &m) {
   //----------------------------------------------------------------------
   painter.def(
         "get_canvas",
-        &PainterWrapper::GetCanvas, R"docstr(
-        Returns the current visualization in RGBA format.
+        &PainterWrapper::GetCanvasWithLayout, R"docstr(
+        Returns the current visualization.
 
         Returns an :class:`~viren2d.ImageBuffer`, which implements
         the Python buffer protocol. This means, it can be easily
         converted to other buffer types, such as :class:`numpy.ndarray`,
         see the examples below.
 
+        By default, this returns the canvas' raw memory, *i.e.* RGBA with
+        premultiplied alpha. If you specify a ``layout`` or an ``out``
+        buffer, the canvas will be converted into the requested pixel
+        format in a single pass instead.
+
         **Corresponding C++ API:** ``viren2d::Painter::GetCanvas``.
 
         Args:
@@ -540,9 +1093,23 @@ void RegisterPainter(py::module &m) {
             a shared view, this view will also change. You could
             even externally modify the canvas pixels.
 
+            Ignored if ``layout`` or ``out`` is specified, because
+            the canvas will then always be converted/copied.
+          layout: Optional :class:`~viren2d.CanvasLayout` or its
+            string representation, *e.g.* ``'bgr'``. If ``out`` is
+            given but ``layout`` is not, the layout will be deduced from
+            the number of channels of ``out`` (grayscale, RGB or RGBA).
+          out: Optional, preallocated output buffer, *i.e.* a writeable
+            :class:`numpy.ndarray` of type :class:`numpy.uint8` (or an
+            :class:`~viren2d.ImageBuffer`) with the same width & height
+            as the canvas. Its memory will be reused, which avoids any
+            allocation when exporting a sequence of frames.
+
         Returns:
-          The current visualization as a 4-channel, ``uint8``
-          :class:`~viren2d.ImageBuffer` with pixel format **RGBA**.
+          The current visualization. If neither ``layout`` nor ``out``
+          is given, a 4-channel, ``uint8`` :class:`~viren2d.ImageBuffer`
+          with pixel format **RGBA**. If ``out`` is given, ``out``
+          will be returned.
 
         Examples:
           Get canvas as :class:`numpy.ndarray`, where the **memory is
@@ -564,13 +1131,21 @@ void RegisterPainter(py::module &m) {
           >>> # ... because the following performs a deep copy:
           >>> img_np = np.array(img_buf.to_channels(3))
 
+          To avoid the intermediate copy, use the ``layout`` parameter. For
+          a video, we can additionally reuse the same output buffer:
+
+          >>> frame = np.empty((painter.height, painter.width, 3), dtype=np.uint8)
+          >>> painter.get_canvas(layout='bgr', out=frame)
+
         .. tip::
             If you can ensure that the painter is not destroyed while
             you display/process the visualization, use the shared view
             (*i.e.* ``copy = False``) on its canvas to avoid unnecessary
             memory allocation.
         )docstr",
-        py::arg("copy") = true);
+        py::arg("copy") = true,
+        py::arg("layout") = py::none(),
+        py::arg("out") = py::none());
 
 
   painter.def(
@@ -756,6 +1331,57 @@ void RegisterPainter(py::module &m) {
         py::arg("right_t2b") = true);
 
 
+  painter.def(
+        "draw_bounding_boxes_2d",
+        &PainterWrapper::DrawBoundingBoxes2D, R"docstr(
+        Draws many 2D bounding boxes at once.
+
+        Use this instead of repeated :meth:`draw_bounding_box_2d` calls
+        for the typical object detection output. Boxes are grouped by
+        their style and rendered in layers: first all box fills and
+        label backgrounds, then all contours and finally all labels. Thus,
+        labels are never occluded by other boxes, but overlapping boxes
+        may look different than when drawn one by one. Rotated or
+        rounded boxes will be drawn one by one on top of all others.
+
+        **Corresponding C++ API:** ``viren2d::Painter::DrawBoundingBoxes2D``.
+
+        Args:
+          boxes: The boxes as :class:`numpy.ndarray` of shape ``(N, 4)``,
+            see ``box_format``, or as :class:`list` of
+            :class:`~viren2d.Rect`.
+          box_styles: A single :class:`~viren2d.BoundingBox2DStyle` or a
+            (usually short) :class:`list` of styles.
+          style_indices: For each box, the index into ``box_styles``,
+            given as :class:`list` of :class:`int` or as
+            :class:`numpy.ndarray`. If ``None``, all boxes will be drawn
+            with the first style.
+          labels: For each box, a single-line label as :class:`str` which
+            will be displayed at the top edge. Boxes with an empty
+            string will not be labeled.
+          box_format: How to interpret the rows of a ``boxes`` array,
+            *i.e.* ``'ltwh'`` (left, top, width, height), ``'lrtb'`` (left,
+            right, top, bottom) or ``'cwh'`` (center x, center y,
+            width, height).
+
+        Returns:
+          ``True`` if drawing completed successfully. Otherwise, check the log
+          messages. Drawing errors are most likely caused by invalid inputs.
+
+        Example:
+          >>> detections = np.array([[20, 40, 100, 200], [300, 50, 80, 80]])
+          >>> styles = [person_style, vehicle_style]
+          >>> painter.draw_bounding_boxes_2d(
+          >>>     detections, box_styles=styles, style_indices=[0, 1],
+          >>>     labels=['Person', 'Car'])
+        )docstr",
+        py::arg("boxes"),
+        py::arg("box_styles") = BoundingBox2DStyle(),
+        py::arg("style_indices") = py::none(),
+        py::arg("labels") = py::none(),
+        py::arg("box_format") = "ltwh");
+
+
   //----------------------------------------------------------------------
   painter.def(
         "draw_circle",
@@ -1453,6 +2079,49 @@ void RegisterPainter(py::module &m) {
         py::arg("fading_factor") = std::function<double(double)>(ColorFadeOutQuadratic));
 
 
+  painter.def(
+        "draw_trajectory_store",
+        &PainterWrapper::DrawTrajectoryStore, R"docstr(
+        Draws all tracks of a :class:`~viren2d.TrajectoryStore`.
+
+        **Corresponding C++ API:** ``viren2d::Painter::DrawTrajectoryStore``.
+
+        Use this instead of :meth:`~viren2d.Painter.draw_trajectories` to
+        visualize the tracks of a video: Append only the latest position of
+        each track to the store for each frame. The tracks are then drawn
+        directly from the store, *i.e.* without converting and smoothing
+        the full history again.
+
+        A track's color (see :meth:`~viren2d.TrajectoryStore.set_color`)
+        overrides the color of the ``line_style``, unless it is
+        :attr:`Color.Invalid` or :attr:`Color.Same`. Tracks with less than
+        2 positions will be skipped.
+
+        Args:
+          store: The :class:`~viren2d.TrajectoryStore`.
+          others: For details on all other parameters, refer to the
+            documentation of :meth:`~viren2d.Painter.draw_trajectory`.
+            Since the store keeps the positions from oldest to most
+            recent, the ``fade_out_color`` is applied to the oldest ones.
+
+        Returns:
+          ``True`` if drawing all tracks completed successfully.
+          Otherwise, check the log messages.
+
+        Example:
+          >>> store = viren2d.TrajectoryStore(capacity=100, smoothing_window=5)
+          >>> for frame, detections in video:
+          >>>     for track_id, position in detections:
+          >>>         store.append(track_id, position)
+          >>>     painter.set_canvas_image(frame)
+          >>>     painter.draw_trajectory_store(store, line_style)
+        )docstr",
+        py::arg("store"),
+        py::arg("line_style") = default_trajectory_style,
+        py::arg("fade_out_color") = default_trajectory_fade_out_color,
+        py::arg("fading_factor") = std::function<double(double)>(ColorFadeOutQuadratic));
+
+
   //----------------------------------------------------------------------
   painter.def(
         "draw_xyz_axes",
@@ -1607,6 +2276,422 @@ void RegisterPainter(py::module &m) {
 
         **Corresponding C++ API:** ``viren2d::Painter::ResetClipRegion``.
         )docstr");
+
+
+  //----------------------------------------------------------------------  Display lists
+  painter.def(
+        "begin_recording",
+        &PainterWrapper::BeginRecording, R"docstr(
+        Starts recording subsequent drawing calls into a display list.
+
+        While recording, the ``draw_xxx`` calls don't modify the canvas.
+        Instead, they are appended to the given :class:`~viren2d.DisplayList`,
+        which can then be rendered (any number of times, onto any canvas)
+        via :meth:`draw_display_list`.
+
+        Image, gradient, horizon line and coordinate axes drawing, as well as
+        clipping, are not supported while recording. Such calls will be
+        skipped, which will be indicated by log messages.
+
+        **Corresponding C++ API:** ``viren2d::Painter::BeginRecording``.
+
+        Args:
+          display_list: The :class:`~viren2d.DisplayList` to record into.
+            Note that previously recorded commands are kept.
+
+        Example:
+          >>> overlay = viren2d.DisplayList()
+          >>> painter.begin_recording(overlay)
+          >>> painter.draw_line((0, 0), (50, 50), line_style)
+          >>> painter.end_recording()
+          >>> # Then, for each frame:
+          >>> painter.set_canvas_image(frame)
+          >>> painter.draw_display_list(overlay)
+        )docstr",
+        py::arg("display_list"));
+
+  painter.def(
+        "end_recording",
+        &PainterWrapper::EndRecording, R"docstr(
+        Stops recording, see :meth:`begin_recording`.
+
+        **Corresponding C++ API:** ``viren2d::Painter::EndRecording``.
+        )docstr");
+
+  painter.def_property_readonly(
+        "is_recording",
+        &PainterWrapper::IsRecording, R"docstr(
+        bool: Whether the painter currently records its drawing calls
+          into a :class:`~viren2d.DisplayList` (read-only).
+
+          **Corresponding C++ API:** ``viren2d::Painter::IsRecording``.
+        )docstr");
+
+  painter.def(
+        "draw_display_list",
+        &PainterWrapper::DrawDisplayList, R"docstr(
+        Renders all commands of the given display list.
+
+        If the painter is currently recording, the commands will be
+        appended to its recording instead.
+
+        If :attr:`render_threads` is larger than 1, the canvas is split into
+        horizontal tiles which are rendered concurrently. The result is
+        identical to the serial rendering. The GIL is released meanwhile.
+
+        **Corresponding C++ API:** ``viren2d::Painter::DrawDisplayList``.
+
+        Args:
+          display_list: The :class:`~viren2d.DisplayList` to render.
+
+        Returns:
+          ``True`` if all commands were drawn successfully. Otherwise, check
+          the log messages.
+        )docstr",
+        py::arg("display_list"),
+        py::call_guard<py::gil_scoped_release>());
+
+  painter.def(
+        "begin_layer",
+        &PainterWrapper::BeginLayer, R"docstr(
+        Starts rendering subsequent drawing calls into an offscreen layer.
+
+        Layers retain overlay content which doesn't change between frames,
+        *e.g.* a ground plane grid, the horizon line, coordinate axes,
+        legends, logos or zone polygons. Render such content once and
+        composite it onto each new canvas via :meth:`draw_layer`, which is
+        a single blend operation.
+
+        Until :meth:`end_layer` is called, all ``draw_xxx`` calls render
+        into the layer instead of the canvas. The layer has the size of
+        the current canvas and is initially transparent. While a layer is
+        active, :meth:`get_canvas` returns the layer's content. Changing
+        the canvas ends the active layer.
+
+        **Corresponding C++ API:** ``viren2d::Painter::BeginLayer``.
+
+        Args:
+          name: The name of the layer as :class:`str`.
+
+        Returns:
+          ``False`` if the canvas is invalid, the name is empty, the
+          painter is recording or another layer is already active.
+
+        Example:
+          >>> for frame in frames:
+          >>>     painter.set_canvas_image(frame)
+          >>>     if not painter.has_layer('static'):
+          >>>         painter.begin_layer('static')
+          >>>         painter.draw_grid(...)
+          >>>         painter.draw_xyz_axes(...)
+          >>>         painter.end_layer()
+          >>>     painter.draw_layer('static')
+          >>>     # Draw the dynamic content
+        )docstr",
+        py::arg("name"));
+
+  painter.def(
+        "end_layer",
+        &PainterWrapper::EndLayer, R"docstr(
+        Finishes the active layer, see :meth:`begin_layer`.
+
+        This replaces any previous content of the layer with the same
+        name. The layer is cropped to the bounding box of its
+        non-transparent pixels, so that :meth:`draw_layer` only has to
+        blend this region.
+
+        **Corresponding C++ API:** ``viren2d::Painter::EndLayer``.
+
+        Returns:
+          ``False`` if no layer is active.
+        )docstr");
+
+  painter.def_property_readonly(
+        "is_layer_active",
+        &PainterWrapper::IsLayerActive, R"docstr(
+        bool: Whether the painter currently renders into a layer
+          (read-only).
+
+          **Corresponding C++ API:** ``viren2d::Painter::IsLayerActive``.
+        )docstr");
+
+  painter.def(
+        "has_layer",
+        &PainterWrapper::HasLayer, R"docstr(
+        Checks if the layer exists and matches the current canvas size.
+
+        **Corresponding C++ API:** ``viren2d::Painter::HasLayer``.
+
+        Returns:
+          ``True`` if the layer doesn't need to be rendered again.
+        )docstr",
+        py::arg("name"));
+
+  painter.def(
+        "draw_layer",
+        &PainterWrapper::DrawLayer, R"docstr(
+        Blends the layer onto the canvas.
+
+        The current clip region is honored.
+
+        **Corresponding C++ API:** ``viren2d::Painter::DrawLayer``.
+
+        Args:
+          name: The name of the layer as :class:`str`.
+
+        Returns:
+          ``False`` if the layer doesn't exist or has been rendered for a
+          different canvas size (then, it will also be invalidated).
+        )docstr",
+        py::arg("name"));
+
+  painter.def(
+        "invalidate_layer",
+        &PainterWrapper::InvalidateLayer, R"docstr(
+        Discards the layer, *e.g.* because its content changed.
+
+        **Corresponding C++ API:** ``viren2d::Painter::InvalidateLayer``.
+
+        Returns:
+          ``False`` if the layer is unknown.
+        )docstr",
+        py::arg("name"));
+
+  painter.def(
+        "clear_layers",
+        &PainterWrapper::ClearLayers, R"docstr(
+        Discards all layers.
+
+        **Corresponding C++ API:** ``viren2d::Painter::ClearLayers``.
+        )docstr");
+
+  painter.def_property(
+        "render_threads",
+        &PainterWrapper::GetRenderThreads,
+        &PainterWrapper::SetRenderThreads, R"docstr(
+        int: Number of threads used by :meth:`draw_display_list`.
+
+          Defaults to 1, *i.e.* serial rendering. Set to 0 to use all
+          hardware threads. Note that rendering falls back to a single thread
+          if a clip region is active. The tiles are rendered by persistent
+          worker threads, which are shared with the
+          :class:`~viren2d.ImageBuffer` operations.
+
+          **Corresponding C++ API:** ``viren2d::Painter::SetRenderThreads``.
+        )docstr");
+
+  painter.def_property(
+        "marker_cache_size",
+        &PainterWrapper::GetMarkerCacheSize,
+        &PainterWrapper::SetMarkerCacheSize, R"docstr(
+        int: Maximum number of pre-rasterized marker sprites.
+
+          Markers are rasterized once per shape (*i.e.* per
+          :class:`~viren2d.MarkerStyle`, ignoring its colors) and then
+          stamped onto the canvas, which is considerably faster than
+          rendering each marker's path. The marker positions will be
+          quantized to 1/4 pixel. Each style requires up to 16 sprites.
+          The cache is disabled (*i.e.* 0) by default, set it to *e.g.*
+          128 to enable it.
+
+          **Corresponding C++ API:** ``viren2d::Painter::SetMarkerCacheSize``.
+        )docstr");
+
+  painter.def_property(
+        "trajectory_fade_out_levels",
+        &PainterWrapper::GetTrajectoryFadeOutLevels,
+        &PainterWrapper::SetTrajectoryFadeOutLevels, R"docstr(
+        int: Number of color levels used to fade out trajectories.
+
+          By default (*i.e.* 0), each segment of a fading trajectory is
+          drawn with its exact linear color gradient, see
+          :meth:`draw_trajectory`. For long or many trajectories, this
+          is slow. Instead, the fade-out colors can be quantized into
+          a fixed number of levels, *e.g.* 16. Then, all segments of the
+          same level will be drawn at once with a solid color.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::SetTrajectoryFadeOutLevels``.
+        )docstr");
+
+  painter.def_property(
+        "simplification_tolerance",
+        &PainterWrapper::GetSimplificationTolerance,
+        &PainterWrapper::SetSimplificationTolerance, R"docstr(
+        float: Tolerance in pixels to simplify polylines before drawing.
+
+          Densely sampled tracks often contain many nearly collinear
+          points, which end up on the same few pixels. If the tolerance is
+          positive, :meth:`draw_polygon`, :meth:`draw_trajectory` and
+          :meth:`draw_trajectories` remove such points first (radial
+          distance followed by Douglas-Peucker). The first and last point
+          are always kept and the simplified polyline deviates at most
+          ``tolerance`` pixels from the original one. Fade-out colors still
+          follow the length along the original points.
+
+          Defaults to 0, *i.e.* all points are drawn.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::SetSimplificationTolerance``.
+        )docstr");
+
+  painter.def_property(
+        "bitmap_text",
+        &PainterWrapper::IsBitmapTextEnabled,
+        &PainterWrapper::SetBitmapTextEnabled, R"docstr(
+        bool: Whether text should be composited from pre-rasterized glyphs.
+
+          If enabled, the glyphs of each font are rasterized only once.
+          :meth:`draw_text` and :meth:`draw_text_box` then copy them
+          directly onto the canvas, which is considerably faster for many
+          short labels, *e.g.* track IDs or scores. Glyphs are placed
+          on the same sub-pixel grid as in the default rendering, thus
+          the results match up to rounding.
+
+          Only printable ASCII text without rotation is supported. Any
+          other text is rendered as usual.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::SetBitmapTextEnabled``.
+        )docstr");
+
+  painter.def_property(
+        "render_quality",
+        &PainterWrapper::GetRenderQuality,
+        &PainterWrapper::SetRenderQuality, R"docstr(
+        :class:`~viren2d.RenderQuality`: Trade-off between rendering speed
+          and quality for all subsequent drawing operations.
+
+          * ``Fast`` is intended for live previews. Curves are flattened
+            coarsely, axis-aligned boxes and grids are drawn without
+            anti-aliasing and :meth:`draw_image` uses nearest-neighbor
+            interpolation.
+          * ``Balanced`` (default) uses Cairo's default settings.
+          * ``Best`` is intended for exported frames.
+
+          Text rendering is not affected. Can be set via its enum or
+          string representation, *e.g.* ``'fast'``.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::SetRenderQuality``.
+        )docstr");
+
+  painter.def_property_readonly(
+        "num_culled_primitives",
+        &PainterWrapper::NumCulledPrimitives, R"docstr(
+        int: Number of primitives which have been skipped, because they
+          lie completely outside the canvas or the clip region (read-only).
+
+          Each primitive is tested via its bounding box (including the
+          line width) before its path is constructed. For batch calls,
+          *e.g.* :meth:`draw_markers`, each skipped element counts.
+          Partially visible polylines, *i.e.* unfilled polygons and
+          trajectories, are trimmed to their visible segments instead.
+          Primitives skipped by a parallel :meth:`draw_display_list`
+          are not counted.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::NumCulledPrimitives``.
+        )docstr");
+
+  painter.def(
+        "reset_num_culled_primitives",
+        &PainterWrapper::ResetNumCulledPrimitives, R"docstr(
+        Resets :attr:`num_culled_primitives` to 0.
+
+        **Corresponding C++ API:**
+        ``viren2d::Painter::ResetNumCulledPrimitives``.
+        )docstr");
+
+  painter.def_property_readonly(
+        "dirty_rects",
+        &PainterWrapper::DirtyRects, R"docstr(
+        list: Canvas regions which have been drawn onto since the canvas
+          was set up or since the last :meth:`reset_dirty_rects` call,
+          as a list of axis-aligned, pixel-aligned :class:`~viren2d.Rect`
+          (read-only).
+
+          Each drawing call reports the bounding box of its visible
+          primitives (the same one which is used for culling, see
+          :attr:`num_culled_primitives`). These are merged into at most
+          16 (possibly overlapping) rectangles. Direct modifications
+          of a shared :meth:`get_canvas` view are not tracked.
+
+          **Corresponding C++ API:**
+          ``viren2d::Painter::DirtyRects``.
+        )docstr");
+
+  painter.def(
+        "reset_dirty_rects",
+        &PainterWrapper::ResetDirtyRects, R"docstr(
+        Marks the whole canvas as clean, see :attr:`dirty_rects`.
+
+        **Corresponding C++ API:**
+        ``viren2d::Painter::ResetDirtyRects``.
+        )docstr");
+
+  painter.def(
+        "copy_dirty_rects",
+        &PainterWrapper::CopyDirtyRects, R"docstr(
+        Converts only the dirty regions of the canvas into ``out``.
+
+        If ``out`` holds the previously exported frame, this yields the
+        same result as :meth:`get_canvas` with ``out``, but only the
+        :attr:`dirty_rects` will be converted. The dirty regions are
+        not reset.
+
+        **Corresponding C++ API:**
+        ``viren2d::Painter::CopyDirtyRects``.
+
+        Args:
+          out: Preallocated output buffer, *i.e.* a writeable
+            :class:`numpy.ndarray` of type :class:`numpy.uint8` (or an
+            :class:`~viren2d.ImageBuffer`) with the same width & height
+            as the canvas.
+          layout: Optional :class:`~viren2d.CanvasLayout` or its
+            string representation. If not given, the layout will be
+            deduced from the number of channels of ``out``.
+
+        Returns:
+          The ``out`` buffer.
+
+        Example:
+          >>> frame = painter.get_canvas(layout='rgb')
+          >>> painter.reset_dirty_rects()
+          >>> painter.draw_circle((30, 30), 10, line_style)
+          >>> painter.copy_dirty_rects(frame)
+        )docstr",
+        py::arg("out"),
+        py::arg("layout") = py::none());
+
+  painter.def(
+        "restore_dirty_rects",
+        &PainterWrapper::RestoreDirtyRects, R"docstr(
+        Copies the dirty regions from the background into the canvas.
+
+        Afterwards, the canvas is marked as clean. If the canvas has been
+        set up from this background, all overlays will be erased without
+        copying the full frame.
+
+        **Corresponding C++ API:**
+        ``viren2d::Painter::RestoreDirtyRects``.
+
+        Args:
+          background: The background image as :class:`numpy.ndarray` or
+            :class:`~viren2d.ImageBuffer`, with the same width & height
+            as the canvas. Supports the same formats as
+            :meth:`set_canvas_image`.
+          is_bgr: Set to ``True`` if the color channels of the background
+            are in BGR(A) order.
+
+        Example:
+          >>> painter.set_canvas_image(background)
+          >>> for frame_idx in range(num_frames):
+          >>>     painter.restore_dirty_rects(background)
+          >>>     # Draw this frame's overlays...
+        )docstr",
+        py::arg("background"),
+        py::arg("is_bgr") = false);
 }
 
 } // namespace bindings
@@ -5,6 +5,7 @@
 #include <pybind11/stl.h>
 
 #include <viren2d/styles.h>
+#include <viren2d/drawing.h>
 
 #include <bindings/binding_helpers.h>
 #include <helpers/logging.h>
@@ -579,6 +580,100 @@ void RegisterTextStyle(py::module &m) {
         )docstr");
 }
 
+
+//-------------------------------------------------  Text cache
+void RegisterTextCache(py::module &m) {
+  py::class_<TextCacheStatistics> stats(m, "TextCacheStatistics", R"docstr(
+      Usage statistics of the text cache, see
+      :func:`~viren2d.text_cache_statistics`.
+
+      **Corresponding C++ API:** ``viren2d::TextCacheStatistics``.
+      )docstr");
+
+  stats.def_readonly(
+        "size", &TextCacheStatistics::size, R"docstr(
+        int: Number of currently cached text lines (read-only).
+        )docstr")
+      .def_readonly(
+        "capacity", &TextCacheStatistics::capacity, R"docstr(
+        int: Maximum number of cached text lines (read-only).
+        )docstr")
+      .def_readonly(
+        "hits", &TextCacheStatistics::hits, R"docstr(
+        int: Number of text lines which were found in the cache (read-only).
+        )docstr")
+      .def_readonly(
+        "misses", &TextCacheStatistics::misses, R"docstr(
+        int: Number of text lines which had to be converted to
+          glyphs (read-only).
+        )docstr")
+      .def(
+        "__repr__", [](const TextCacheStatistics &st) {
+          std::ostringstream s;
+          s << "<TextCacheStatistics(size=" << st.size
+            << ", capacity=" << st.capacity << ", hits=" << st.hits
+            << ", misses=" << st.misses << ")>";
+          return s.str();
+        });
+
+  m.def("set_text_cache_size",
+        &SetTextCacheSize, R"docstr(
+        Sets the capacity of the process-wide text cache.
+
+        Text lines are converted to glyphs and measured only once per
+        font. Subsequent draws of the same text (*e.g.* recurring labels
+        of tracked objects) reuse the cached glyphs. The cache is shared
+        by all painters and keeps the most recently used lines.
+
+        **Corresponding C++ API:** ``viren2d::SetTextCacheSize``.
+
+        Args:
+          num_lines: Maximum number of cached text lines as :class:`int`.
+            Set to 0 to disable the cache.
+        )docstr", py::arg("num_lines"));
+
+  m.def("text_cache_size",
+        &TextCacheSize, R"docstr(
+        Returns the capacity of the process-wide text cache.
+
+        **Corresponding C++ API:** ``viren2d::TextCacheSize``.
+        )docstr");
+
+  m.def("text_cache_statistics",
+        &GetTextCacheStatistics, R"docstr(
+        Returns the :class:`~viren2d.TextCacheStatistics`, which can be
+        used to choose a suitable cache size.
+
+        **Corresponding C++ API:** ``viren2d::GetTextCacheStatistics``.
+
+        Args:
+          reset: If ``True``, the hit/miss counters will be reset afterwards.
+        )docstr", py::arg("reset") = false);
+
+  m.def("set_font_cache_size",
+        &SetFontCacheSize, R"docstr(
+        Sets the capacity of the process-wide font cache.
+
+        Fonts are resolved only once per text style (family, slant,
+        weight and size) and then reused by all painters. If the number
+        of styles exceeds the capacity, the cache is flushed.
+
+        **Corresponding C++ API:** ``viren2d::SetFontCacheSize``.
+
+        Args:
+          num_fonts: Maximum number of cached fonts as :class:`int`.
+            Set to 0 to disable the cache, *i.e.* to select the font
+            via Cairo for each text draw.
+        )docstr", py::arg("num_fonts"));
+
+  m.def("font_cache_size",
+        &FontCacheSize, R"docstr(
+        Returns the capacity of the process-wide font cache.
+
+        **Corresponding C++ API:** ``viren2d::FontCacheSize``.
+        )docstr");
+}
+
 } // namespace bindings
 } // namespace viren2d
 
@@ -0,0 +1,175 @@
+#include <sstream>
+
+#include <pybind11/stl.h>
+
+#include <viren2d/trajectory_store.h>
+
+#include <bindings/binding_helpers.h>
+
+namespace py = pybind11;
+
+namespace viren2d {
+namespace bindings {
+
+void RegisterTrajectoryStore(py::module &m) {
+  py::class_<TrajectoryStore> store(m, "TrajectoryStore", R"docstr(
+        Keeps the most recent positions of multiple tracks across frames.
+
+        Typical use case: visualizing the tracks of a video. Instead of
+        passing the full history of each track to
+        :meth:`~viren2d.Painter.draw_trajectories` for each frame, only
+        append the latest positions and render the store via
+        :meth:`~viren2d.Painter.draw_trajectory_store`.
+
+        Each track keeps at most ``capacity`` positions, *i.e.* older
+        positions will be dropped. If a ``smoothing_window`` is set, the
+        store keeps the moving average, which is updated incrementally
+        upon each :meth:`append`. The average at each position is computed
+        over its ``smoothing_window // 2`` neighbors on either side, thus
+        the most recent averages change as new positions arrive.
+
+        **Corresponding C++ API:** ``viren2d::TrajectoryStore``.
+
+        Example:
+          >>> store = viren2d.TrajectoryStore(capacity=100, smoothing_window=5)
+          >>> for frame, detections in video:
+          >>>     for track_id, position in detections:
+          >>>         store.append(track_id, position)
+          >>>     for track_id in lost_tracks:
+          >>>         store.remove(track_id)
+          >>>     painter.set_canvas_image(frame)
+          >>>     painter.draw_trajectory_store(store, line_style)
+        )docstr");
+
+  store.def(
+        py::init<std::size_t, int>(), R"docstr(
+        Creates an empty store.
+
+        Args:
+          capacity: Maximum number of positions kept per track, must
+            be at least 2.
+          smoothing_window: Window size of the moving average. Values
+            below 2 disable smoothing.
+        )docstr",
+        py::arg("capacity") = 100,
+        py::arg("smoothing_window") = 0);
+
+  store.def(
+        "__str__", [](const TrajectoryStore &s) -> std::string {
+          return s.ToString();
+        });
+
+  store.def(
+        "__repr__", [](const TrajectoryStore &s) -> std::string {
+          std::ostringstream str;
+          str << '<' << s.ToString() << '>';
+          return str.str();
+        });
+
+  store.def(
+        "__len__", &TrajectoryStore::NumTracks, R"docstr(
+        Returns the number of tracks.
+        )docstr");
+
+  store.def(
+        "__contains__", &TrajectoryStore::Contains, R"docstr(
+        Returns ``True`` if the store contains the given track.
+        )docstr",
+        py::arg("track_id"));
+
+  store.def_property_readonly(
+        "capacity", &TrajectoryStore::Capacity, R"docstr(
+        int: Maximum number of positions per track (read-only).
+        )docstr");
+
+  store.def_property_readonly(
+        "smoothing_window", &TrajectoryStore::SmoothingWindow, R"docstr(
+        int: Window size of the moving average, 0 if smoothing is
+          disabled (read-only).
+        )docstr");
+
+  store.def_property_readonly(
+        "num_tracks", &TrajectoryStore::NumTracks, R"docstr(
+        int: Number of tracks (read-only).
+        )docstr");
+
+  store.def_property_readonly(
+        "track_ids", &TrajectoryStore::TrackIDs, R"docstr(
+        List[int]: Identifiers of all tracks in ascending order, which is
+          also the drawing order (read-only).
+        )docstr");
+
+  store.def(
+        "append", &TrajectoryStore::Append, R"docstr(
+        Appends the position to the given track.
+
+        Unknown tracks will be created on the fly.
+
+        Args:
+          track_id: The track identifier as :class:`int`.
+          position: The latest position as :class:`~viren2d.Vec2d`.
+        )docstr",
+        py::arg("track_id"),
+        py::arg("position"));
+
+  store.def(
+        "num_points", [](const TrajectoryStore &s, TrajectoryStore::TrackID id) {
+          return s.NumPoints(id);
+        }, R"docstr(
+        Returns the number of positions kept for the given track, or 0 if
+        the track is unknown.
+        )docstr",
+        py::arg("track_id"));
+
+  store.def(
+        "points", &TrajectoryStore::Points, R"docstr(
+        Returns the (smoothed) positions of the given track.
+
+        The positions are ordered from the oldest to the most recent one.
+        Returns an empty :class:`list` if the track is unknown.
+        )docstr",
+        py::arg("track_id"));
+
+  store.def(
+        "set_color", &TrajectoryStore::SetColor, R"docstr(
+        Sets the color used to draw the given track.
+
+        If :attr:`Color.Invalid` (the default) or :attr:`Color.Same`, the
+        color of the line style will be used instead.
+
+        Returns:
+          ``False`` if the track is unknown.
+        )docstr",
+        py::arg("track_id"),
+        py::arg("color"));
+
+  store.def(
+        "get_color", &TrajectoryStore::GetColor, R"docstr(
+        Returns the color of the given track, or :attr:`Color.Invalid` if
+        the track is unknown.
+        )docstr",
+        py::arg("track_id"));
+
+  store.def(
+        "remove", &TrajectoryStore::Remove, R"docstr(
+        Removes the given track, *e.g.* after it has been lost.
+
+        Returns:
+          ``False`` if the track is unknown.
+        )docstr",
+        py::arg("track_id"));
+
+  store.def(
+        "clear", &TrajectoryStore::Clear, R"docstr(
+        Removes all tracks.
+        )docstr");
+
+  store.def(
+        "copy", [](const TrajectoryStore &s) { return TrajectoryStore(s); },
+        R"docstr(
+        Returns a deep copy.
+        )docstr");
+}
+
+} // namespace bindings
+} // namespace viren2d
@@ -0,0 +1,791 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <viren2d/display_list.h>
+#include <helpers/culling.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+//-------------------------------------------------  DrawCommandType
+std::string DrawCommandTypeToString(DrawCommandType t) {
+  switch (t) {
+    case DrawCommandType::Arc:
+      return "Arc";
+    case DrawCommandType::Arrow:
+      return "Arrow";
+    case DrawCommandType::BoundingBox2D:
+      return "BoundingBox2D";
+    case DrawCommandType::Circle:
+      return "Circle";
+    case DrawCommandType::Ellipse:
+      return "Ellipse";
+    case DrawCommandType::Grid:
+      return "Grid";
+    case DrawCommandType::Line:
+      return "Line";
+    case DrawCommandType::Lines:
+      return "Lines";
+    case DrawCommandType::Marker:
+      return "Marker";
+    case DrawCommandType::Markers:
+      return "Markers";
+    case DrawCommandType::Polygon:
+      return "Polygon";
+    case DrawCommandType::Rect:
+      return "Rect";
+    case DrawCommandType::Text:
+      return "Text";
+    case DrawCommandType::TextBox:
+      return "TextBox";
+    case DrawCommandType::Trajectory:
+      return "Trajectory";
+  }
+
+  std::ostringstream s;
+  s << "DrawCommandType (" << static_cast<int>(t)
+    << ") is not mapped in `DrawCommandTypeToString`!";
+  throw std::logic_error(s.str());
+}
+
+
+std::ostream &operator<<(std::ostream &os, DrawCommandType t) {
+  os << DrawCommandTypeToString(t);
+  return os;
+}
+
+
+namespace helpers {
+/// Returns true if the color would result in visible pixels.
+inline bool IsVisibleColor(const Color &color) {
+  return color.IsValid() && (color.alpha > 0.0);
+}
+
+
+/// Returns true if the line style would result in visible pixels.
+inline bool IsVisibleLineStyle(const LineStyle &style) {
+  return style.IsValid() && (style.color.alpha > 0.0);
+}
+
+
+/// Resolves the special "same" fill color, see `CheckLineStyleAndFill`.
+inline Color ResolveFillColor(const LineStyle &style, const Color &fill) {
+  if (fill.IsSpecialSame()) {
+    return style.color.WithAlpha(fill.alpha);
+  }
+  return fill;
+}
+
+
+/// Returns true if any of the text lines is non-empty.
+inline bool HasText(const std::vector<std::string> &text) {
+  return std::any_of(
+        text.begin(), text.end(),
+        [](const std::string &line) { return !line.empty(); });
+}
+} // namespace helpers
+
+
+//-------------------------------------------------  DisplayList
+// Layout of the geometry parameters per command type:
+// * Arc:           cx, cy, radius, angle1, angle2, include_center
+// * Arrow, Line:   x1, y1, x2, y2
+// * BoundingBox2D: cx, cy, width, height, rotation, radius,
+//                  left_top_to_bottom, right_top_to_bottom
+// * Circle:        cx, cy, radius
+// * Ellipse:       cx, cy, major, minor, rotation, angle_from, angle_to,
+//                  include_center
+// * Grid:          x1, y1, x2, y2, spacing_x, spacing_y
+// * Lines:         [x1, y1, x2, y2] for each segment
+// * Marker:        x, y
+// * Markers:       [x, y, red, green, blue, alpha] for each marker
+// * Polygon:       [x, y] for each point
+// * Rect:          cx, cy, width, height, rotation, radius
+// * Text:          x, y, anchor, padding_x, padding_y, rotation
+// * TextBox:       Same as text, followed by corner_radius, fixed_width,
+//                  fixed_height
+// * Trajectory:    fade-out red, green, blue, alpha, oldest_position_first,
+//                  followed by [x, y] for each point
+
+std::size_t DisplayList::NumStyles() const {
+  return line_styles_.size() + arrow_styles_.size() + marker_styles_.size()
+      + text_styles_.size() + bbox_styles_.size() + colors_.size();
+}
+
+
+void DisplayList::Clear() {
+  commands_.clear();
+  geometry_.clear();
+  line_styles_.clear();
+  arrow_styles_.clear();
+  marker_styles_.clear();
+  text_styles_.clear();
+  bbox_styles_.clear();
+  colors_.clear();
+  texts_.clear();
+  functions_.clear();
+}
+
+
+void DisplayList::Append(const DisplayList &other) {
+  if (&other == this) {
+    const DisplayList copy(other);
+    Append(copy);
+    return;
+  }
+
+  commands_.reserve(commands_.size() + other.commands_.size());
+  geometry_.reserve(geometry_.size() + other.geometry_.size());
+  for (const auto &cmd : other.commands_) {
+    CopyCommand(other, cmd);
+  }
+}
+
+
+const Color &DisplayList::GetColor(std::uint32_t id) const {
+  if (id == DrawCommand::kNone) {
+    return Color::Invalid;
+  }
+  return colors_[id];
+}
+
+
+namespace helpers {
+/// Computes the bounding box of the given points (x/y interleaved).
+inline void PointExtent(
+    const double *params, std::size_t num_values, double margin,
+    Vec2d &top_left, Vec2d &bottom_right) {
+  double left = std::numeric_limits<double>::infinity();
+  double top = left;
+  double right = -left;
+  double bottom = -left;
+  for (std::size_t idx = 0; idx + 1 < num_values; idx += 2) {
+    left = std::min(left, params[idx]);
+    right = std::max(right, params[idx]);
+    top = std::min(top, params[idx + 1]);
+    bottom = std::max(bottom, params[idx + 1]);
+  }
+  top_left = {left - margin, top - margin};
+  bottom_right = {right + margin, bottom + margin};
+}
+} // namespace helpers
+
+
+bool DisplayList::CommandExtent(
+    const DrawCommand &cmd, Vec2d &top_left, Vec2d &bottom_right) const {
+  const double *p = Parameters(cmd);
+  switch (cmd.type) {
+    case DrawCommandType::Arc:
+    case DrawCommandType::Circle: {
+        const double margin = std::abs(p[2])
+            + helpers::StrokeMargin(line_styles_[cmd.style].width);
+        helpers::PointExtent(p, 2, margin, top_left, bottom_right);
+        return true;
+      }
+
+    case DrawCommandType::Arrow: {
+        const ArrowStyle &style = arrow_styles_[cmd.style];
+        const double margin = std::abs(
+              style.TipLengthForShaft({p[0], p[1]}, {p[2], p[3]}))
+            + helpers::StrokeMargin(style.width);
+        helpers::PointExtent(p, 4, margin, top_left, bottom_right);
+        return true;
+      }
+
+    case DrawCommandType::Ellipse: {
+        const double margin = 0.5 * std::max(std::abs(p[2]), std::abs(p[3]))
+            + helpers::StrokeMargin(line_styles_[cmd.style].width);
+        helpers::PointExtent(p, 2, margin, top_left, bottom_right);
+        return true;
+      }
+
+    case DrawCommandType::Grid:
+      if ((p[0] == p[2]) && (p[1] == p[3])) {
+        // The grid spans the whole canvas.
+        return false;
+      }
+      helpers::PointExtent(
+            p, 4, helpers::StrokeMargin(line_styles_[cmd.style].width),
+            top_left, bottom_right);
+      return true;
+
+    case DrawCommandType::Line:
+    case DrawCommandType::Lines:
+    case DrawCommandType::Polygon:
+      helpers::PointExtent(
+            p, cmd.count,
+            helpers::StrokeMargin(line_styles_[cmd.style].width),
+            top_left, bottom_right);
+      return true;
+
+    case DrawCommandType::Marker:
+    case DrawCommandType::Markers: {
+        const MarkerStyle &style = marker_styles_[cmd.style];
+        const double margin = std::abs(style.size)
+            + std::max(0.0, style.background_border)
+            + helpers::StrokeMargin(style.thickness);
+        if (cmd.type == DrawCommandType::Marker) {
+          helpers::PointExtent(p, 2, margin, top_left, bottom_right);
+        } else {
+          // Each marker is stored as [x, y, r, g, b, a]
+          std::vector<double> positions;
+          positions.reserve(cmd.count / 3);
+          for (std::size_t idx = 0; idx + 5 < cmd.count; idx += 6) {
+            positions.push_back(p[idx]);
+            positions.push_back(p[idx + 1]);
+          }
+          helpers::PointExtent(
+                positions.data(), positions.size(), margin,
+                top_left, bottom_right);
+        }
+        return true;
+      }
+
+    case DrawCommandType::Rect: {
+        // Half the diagonal covers any rotation
+        const double margin = 0.5 * std::sqrt(p[2] * p[2] + p[3] * p[3])
+            + helpers::StrokeMargin(line_styles_[cmd.style].width);
+        helpers::PointExtent(p, 2, margin, top_left, bottom_right);
+        return true;
+      }
+
+    case DrawCommandType::Trajectory:
+      // The first 5 parameters are the fade-out color & order flag.
+      helpers::PointExtent(
+            p + 5, cmd.count - 5,
+            helpers::StrokeMargin(line_styles_[cmd.style].width),
+            top_left, bottom_right);
+      return true;
+
+    case DrawCommandType::BoundingBox2D:
+    case DrawCommandType::Text:
+    case DrawCommandType::TextBox:
+      // Text extents depend on the font rendering.
+      return false;
+  }
+  return false;
+}
+
+
+std::string DisplayList::ToString() const {
+  std::ostringstream s;
+  s << "DisplayList(" << commands_.size()
+    << (commands_.size() == 1 ? " command, " : " commands, ")
+    << NumStyles() << (NumStyles() == 1 ? " style)" : " styles)");
+  return s.str();
+}
+
+
+template <typename _Tp>
+std::uint32_t DisplayList::Intern(std::vector<_Tp> &table, const _Tp &style) {
+  // A list typically uses only a handful of styles, which are often
+  // reused by consecutive commands. Thus, we search backwards.
+  for (std::size_t idx = table.size(); idx > 0; --idx) {
+    if (table[idx - 1] == style) {
+      return static_cast<std::uint32_t>(idx - 1);
+    }
+  }
+  table.push_back(style);
+  return static_cast<std::uint32_t>(table.size() - 1);
+}
+
+
+std::uint32_t DisplayList::InternColor(const Color &color) {
+  if (color.IsSpecialInvalid()) {
+    return DrawCommand::kNone;
+  }
+  return Intern(colors_, color);
+}
+
+
+std::uint32_t DisplayList::InternText(const std::vector<std::string> &text) {
+  texts_.push_back(text);
+  return static_cast<std::uint32_t>(texts_.size() - 1);
+}
+
+
+DrawCommand &DisplayList::NewCommand(
+    DrawCommandType type, std::uint32_t style, std::uint32_t fill) {
+  DrawCommand cmd;
+  cmd.type = type;
+  cmd.style = style;
+  cmd.box_style = DrawCommand::kNone;
+  cmd.fill = fill;
+  cmd.offset = static_cast<std::uint32_t>(geometry_.size());
+  cmd.count = 0;
+  cmd.extra = DrawCommand::kNone;
+  commands_.push_back(cmd);
+  return commands_.back();
+}
+
+
+void DisplayList::AddArc(
+    const Vec2d &center, double radius, double angle1, double angle2,
+    const LineStyle &line_style, bool include_center,
+    const Color &fill_color) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Arc, Intern(line_styles_, line_style),
+        InternColor(fill_color));
+  geometry_.insert(
+        geometry_.end(),
+        {center.X(), center.Y(), radius, angle1, angle2,
+         include_center ? 1.0 : 0.0});
+  cmd.count = 6;
+}
+
+
+void DisplayList::AddArrow(
+    const Vec2d &from, const Vec2d &to, const ArrowStyle &arrow_style) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Arrow, Intern(arrow_styles_, arrow_style));
+  geometry_.insert(geometry_.end(), {from.X(), from.Y(), to.X(), to.Y()});
+  cmd.count = 4;
+}
+
+
+void DisplayList::AddBoundingBox2D(
+    const Rect &box, const BoundingBox2DStyle &style,
+    const std::vector<std::string> &label_top,
+    const std::vector<std::string> &label_bottom,
+    const std::vector<std::string> &label_left, bool left_top_to_bottom,
+    const std::vector<std::string> &label_right, bool right_top_to_bottom) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::BoundingBox2D, Intern(bbox_styles_, style));
+  // The 4 labels are stored consecutively:
+  cmd.extra = InternText(label_top);
+  InternText(label_bottom);
+  InternText(label_left);
+  InternText(label_right);
+  geometry_.insert(
+        geometry_.end(),
+        {box.cx, box.cy, box.width, box.height, box.rotation, box.radius,
+         left_top_to_bottom ? 1.0 : 0.0, right_top_to_bottom ? 1.0 : 0.0});
+  cmd.count = 8;
+}
+
+
+void DisplayList::AddCircle(
+    const Vec2d &center, double radius, const LineStyle &line_style,
+    const Color &fill_color) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Circle, Intern(line_styles_, line_style),
+        InternColor(fill_color));
+  geometry_.insert(geometry_.end(), {center.X(), center.Y(), radius});
+  cmd.count = 3;
+}
+
+
+void DisplayList::AddEllipse(
+    const Ellipse &ellipse, const LineStyle &line_style,
+    const Color &fill_color) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Ellipse, Intern(line_styles_, line_style),
+        InternColor(fill_color));
+  geometry_.insert(
+        geometry_.end(),
+        {ellipse.cx, ellipse.cy, ellipse.major_axis, ellipse.minor_axis,
+         ellipse.rotation, ellipse.angle_from, ellipse.angle_to,
+         ellipse.include_center ? 1.0 : 0.0});
+  cmd.count = 8;
+}
+
+
+void DisplayList::AddGrid(
+    const Vec2d &top_left, const Vec2d &bottom_right,
+    double spacing_x, double spacing_y, const LineStyle &line_style) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Grid, Intern(line_styles_, line_style));
+  geometry_.insert(
+        geometry_.end(),
+        {top_left.X(), top_left.Y(), bottom_right.X(), bottom_right.Y(),
+         spacing_x, spacing_y});
+  cmd.count = 6;
+}
+
+
+void DisplayList::AddLine(
+    const Vec2d &from, const Vec2d &to, const LineStyle &line_style) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Line, Intern(line_styles_, line_style));
+  geometry_.insert(geometry_.end(), {from.X(), from.Y(), to.X(), to.Y()});
+  cmd.count = 4;
+}
+
+
+void DisplayList::AddMarker(const Vec2d &pos, const MarkerStyle &style) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Marker, Intern(marker_styles_, style));
+  geometry_.insert(geometry_.end(), {pos.X(), pos.Y()});
+  cmd.count = 2;
+}
+
+
+void DisplayList::AddMarkers(
+    const std::vector<std::pair<Vec2d, Color>> &markers,
+    const MarkerStyle &style) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Markers, Intern(marker_styles_, style));
+  geometry_.reserve(geometry_.size() + 6 * markers.size());
+  for (const auto &m : markers) {
+    geometry_.insert(
+          geometry_.end(),
+          {m.first.X(), m.first.Y(), m.second.red, m.second.green,
+           m.second.blue, m.second.alpha});
+  }
+  cmd.count = static_cast<std::uint32_t>(6 * markers.size());
+}
+
+
+void DisplayList::AddPolygon(
+    const std::vector<Vec2d> &points, const LineStyle &line_style,
+    const Color &fill_color) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Polygon, Intern(line_styles_, line_style),
+        InternColor(fill_color));
+  geometry_.reserve(geometry_.size() + 2 * points.size());
+  for (const auto &pt : points) {
+    geometry_.insert(geometry_.end(), {pt.X(), pt.Y()});
+  }
+  cmd.count = static_cast<std::uint32_t>(2 * points.size());
+}
+
+
+void DisplayList::AddRect(
+    const Rect &rect, const LineStyle &line_style, const Color &fill_color) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Rect, Intern(line_styles_, line_style),
+        InternColor(fill_color));
+  geometry_.insert(
+        geometry_.end(),
+        {rect.cx, rect.cy, rect.width, rect.height, rect.rotation,
+         rect.radius});
+  cmd.count = 6;
+}
+
+
+void DisplayList::AddText(
+    const std::vector<std::string> &text, const Vec2d &position,
+    Anchor anchor, const TextStyle &text_style, const Vec2d &padding,
+    double rotation) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Text, Intern(text_styles_, text_style));
+  cmd.extra = InternText(text);
+  geometry_.insert(
+        geometry_.end(),
+        {position.X(), position.Y(), static_cast<double>(anchor),
+         padding.X(), padding.Y(), rotation});
+  cmd.count = 6;
+}
+
+
+void DisplayList::AddTextBox(
+    const std::vector<std::string> &text, const Vec2d &position,
+    Anchor anchor, const TextStyle &text_style, const Vec2d &padding,
+    double rotation, const LineStyle &box_line_style,
+    const Color &box_fill_color, double box_corner_radius,
+    const Vec2d &fixed_box_size) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::TextBox, Intern(text_styles_, text_style),
+        InternColor(box_fill_color));
+  cmd.box_style = Intern(line_styles_, box_line_style);
+  cmd.extra = InternText(text);
+  geometry_.insert(
+        geometry_.end(),
+        {position.X(), position.Y(), static_cast<double>(anchor),
+         padding.X(), padding.Y(), rotation, box_corner_radius,
+         fixed_box_size.X(), fixed_box_size.Y()});
+  cmd.count = 9;
+}
+
+
+void DisplayList::AddTrajectory(
+    const std::vector<Vec2d> &points, const LineStyle &style,
+    const Color &color_fade_out, bool oldest_position_first,
+    const std::function<double(double)> &mix_factor) {
+  DrawCommand &cmd = NewCommand(
+        DrawCommandType::Trajectory, Intern(line_styles_, style));
+  functions_.push_back(mix_factor);
+  cmd.extra = static_cast<std::uint32_t>(functions_.size() - 1);
+  geometry_.reserve(geometry_.size() + 5 + 2 * points.size());
+  geometry_.insert(
+        geometry_.end(),
+        {color_fade_out.red, color_fade_out.green, color_fade_out.blue,
+         color_fade_out.alpha, oldest_position_first ? 1.0 : 0.0});
+  for (const auto &pt : points) {
+    geometry_.insert(geometry_.end(), {pt.X(), pt.Y()});
+  }
+  cmd.count = static_cast<std::uint32_t>(5 + 2 * points.size());
+}
+
+
+void DisplayList::CopyCommand(
+    const DisplayList &src, const DrawCommand &cmd) {
+  std::uint32_t style = DrawCommand::kNone;
+  switch (cmd.type) {
+    case DrawCommandType::Arrow:
+      style = Intern(arrow_styles_, src.arrow_styles_[cmd.style]);
+      break;
+
+    case DrawCommandType::BoundingBox2D:
+      style = Intern(bbox_styles_, src.bbox_styles_[cmd.style]);
+      break;
+
+    case DrawCommandType::Marker:
+    case DrawCommandType::Markers:
+      style = Intern(marker_styles_, src.marker_styles_[cmd.style]);
+      break;
+
+    case DrawCommandType::Text:
+    case DrawCommandType::TextBox:
+      style = Intern(text_styles_, src.text_styles_[cmd.style]);
+      break;
+
+    default:
+      style = Intern(line_styles_, src.line_styles_[cmd.style]);
+      break;
+  }
+
+  DrawCommand &copy = NewCommand(
+        cmd.type, style, InternColor(src.GetColor(cmd.fill)));
+  if (cmd.box_style != DrawCommand::kNone) {
+    copy.box_style = Intern(line_styles_, src.line_styles_[cmd.box_style]);
+  }
+
+  if (cmd.extra != DrawCommand::kNone) {
+    if (cmd.type == DrawCommandType::Trajectory) {
+      functions_.push_back(src.functions_[cmd.extra]);
+      copy.extra = static_cast<std::uint32_t>(functions_.size() - 1);
+    } else {
+      const std::uint32_t num_texts =
+          (cmd.type == DrawCommandType::BoundingBox2D) ? 4 : 1;
+      copy.extra = static_cast<std::uint32_t>(texts_.size());
+      texts_.insert(
+            texts_.end(), src.texts_.begin() + cmd.extra,
+            src.texts_.begin() + cmd.extra + num_texts);
+    }
+  }
+
+  const double *params = src.Parameters(cmd);
+  geometry_.insert(geometry_.end(), params, params + cmd.count);
+  copy.count = cmd.count;
+}
+
+
+namespace helpers {
+/// Returns true if replaying the command would change any pixel.
+bool IsVisibleCommand(const DisplayList &list, const DrawCommand &cmd) {
+  const double *params = list.Parameters(cmd);
+  switch (cmd.type) {
+    case DrawCommandType::Arc:
+    case DrawCommandType::Circle: {
+        const LineStyle &style = list.GetLineStyle(cmd.style);
+        return (params[2] > 0.0)
+            && (IsVisibleLineStyle(style)
+                || IsVisibleColor(
+                  ResolveFillColor(style, list.GetColor(cmd.fill))));
+      }
+
+    case DrawCommandType::Ellipse:
+    case DrawCommandType::Rect: {
+        const LineStyle &style = list.GetLineStyle(cmd.style);
+        return (params[2] > 0.0) && (params[3] > 0.0)
+            && (IsVisibleLineStyle(style)
+                || IsVisibleColor(
+                  ResolveFillColor(style, list.GetColor(cmd.fill))));
+      }
+
+    case DrawCommandType::Polygon: {
+        const LineStyle &style = list.GetLineStyle(cmd.style);
+        return (cmd.count >= 6)
+            && (IsVisibleLineStyle(style)
+                || IsVisibleColor(
+                  ResolveFillColor(style, list.GetColor(cmd.fill))));
+      }
+
+    case DrawCommandType::Arrow: {
+        const ArrowStyle &style = list.GetArrowStyle(cmd.style);
+        return style.IsValid() && (style.color.alpha > 0.0);
+      }
+
+    case DrawCommandType::Grid:
+      return (params[4] > 0.0) && (params[5] > 0.0)
+          && IsVisibleLineStyle(list.GetLineStyle(cmd.style));
+
+    case DrawCommandType::Line:
+    case DrawCommandType::Lines:
+      return (cmd.count > 0)
+          && IsVisibleLineStyle(list.GetLineStyle(cmd.style));
+
+    case DrawCommandType::Marker: {
+        // A transparent marker may still have a visible background:
+        const MarkerStyle &style = list.GetMarkerStyle(cmd.style);
+        return style.IsValid()
+            && ((style.color.alpha > 0.0)
+                || IsVisibleColor(style.background_color));
+      }
+
+    case DrawCommandType::Markers:
+      // Markers can override the style's color, so we only
+      // check the shape:
+      return (cmd.count > 0)
+          && (list.GetMarkerStyle(cmd.style).size > 0.0);
+
+    case DrawCommandType::Text: {
+        const TextStyle &style = list.GetTextStyle(cmd.style);
+        return style.IsValid() && (style.color.alpha > 0.0)
+            && HasText(list.GetText(cmd.extra));
+      }
+
+    case DrawCommandType::TextBox: {
+        const TextStyle &style = list.GetTextStyle(cmd.style);
+        const LineStyle &box_style = list.GetLineStyle(cmd.box_style);
+        return style.IsValid()
+            && ((HasText(list.GetText(cmd.extra)) && (style.color.alpha > 0.0))
+                || IsVisibleLineStyle(box_style)
+                || IsVisibleColor(
+                  ResolveFillColor(box_style, list.GetColor(cmd.fill))));
+      }
+
+    case DrawCommandType::Trajectory:
+      return (cmd.count >= 9)
+          && list.GetLineStyle(cmd.style).IsValid();
+
+    case DrawCommandType::BoundingBox2D:
+      return list.GetBoundingBox2DStyle(cmd.style).IsValid()
+          && (params[2] > 0.0) && (params[3] > 0.0);
+  }
+  return true;
+}
+
+
+/// Returns the ID of the command's primary style table.
+inline int StyleTableID(DrawCommandType t) {
+  switch (t) {
+    case DrawCommandType::Arrow:
+      return 1;
+    case DrawCommandType::Marker:
+    case DrawCommandType::Markers:
+      return 2;
+    case DrawCommandType::Text:
+    case DrawCommandType::TextBox:
+      return 3;
+    case DrawCommandType::BoundingBox2D:
+      return 4;
+    default:
+      return 0;
+  }
+}
+} // namespace helpers
+
+
+DisplayList DisplayList::Optimized(bool sort_by_state) const {
+  SPDLOG_DEBUG(
+        "DisplayList::Optimized: {:d} commands, sort_by_state={}.",
+        commands_.size(), sort_by_state);
+
+  std::vector<std::size_t> order;
+  order.reserve(commands_.size());
+  for (std::size_t idx = 0; idx < commands_.size(); ++idx) {
+    if (helpers::IsVisibleCommand(*this, commands_[idx])) {
+      order.push_back(idx);
+    }
+  }
+
+  if (sort_by_state) {
+    // Lines and markers are sorted next to their merged counterparts.
+    auto sort_type = [](DrawCommandType t) -> int {
+      if (t == DrawCommandType::Lines) {
+        return static_cast<int>(DrawCommandType::Line);
+      }
+      if (t == DrawCommandType::Markers) {
+        return static_cast<int>(DrawCommandType::Marker);
+      }
+      return static_cast<int>(t);
+    };
+
+    std::stable_sort(
+          order.begin(), order.end(),
+          [this, &sort_type](std::size_t lhs, std::size_t rhs) -> bool {
+      const DrawCommand &a = commands_[lhs];
+      const DrawCommand &b = commands_[rhs];
+      const int ta = sort_type(a.type);
+      const int tb = sort_type(b.type);
+      if (ta != tb) {
+        return ta < tb;
+      }
+      if (a.style != b.style) {
+        return a.style < b.style;
+      }
+      return a.fill < b.fill;
+    });
+  }
+
+  DisplayList optimized;
+  optimized.commands_.reserve(order.size());
+  optimized.geometry_.reserve(geometry_.size());
+  for (std::size_t idx : order) {
+    const DrawCommand &cmd = commands_[idx];
+    const bool is_line = (cmd.type == DrawCommandType::Line)
+        || (cmd.type == DrawCommandType::Lines);
+    const bool is_marker = (cmd.type == DrawCommandType::Marker)
+        || (cmd.type == DrawCommandType::Markers);
+
+    DrawCommand *prev = optimized.commands_.empty()
+        ? nullptr : &optimized.commands_.back();
+
+    // Merge consecutive lines. This is only allowed for opaque colors,
+    // because translucent overlapping segments would look differently
+    // if stroked at once.
+    if (is_line && prev
+        && ((prev->type == DrawCommandType::Line)
+            || (prev->type == DrawCommandType::Lines))
+        && (optimized.line_styles_[prev->style] == line_styles_[cmd.style])
+        && (line_styles_[cmd.style].color.alpha >= 1.0)) {
+      const double *params = Parameters(cmd);
+      optimized.geometry_.insert(
+            optimized.geometry_.end(), params, params + cmd.count);
+      prev->type = DrawCommandType::Lines;
+      prev->count += cmd.count;
+      continue;
+    }
+
+    // Merge consecutive markers of the same style. The merged command
+    // draws the markers in the same order, so this is always allowed.
+    if (is_marker && prev
+        && ((prev->type == DrawCommandType::Marker)
+            || (prev->type == DrawCommandType::Markers))
+        && (optimized.marker_styles_[prev->style] == marker_styles_[cmd.style])) {
+      if (prev->type == DrawCommandType::Marker) {
+        // A single marker uses the style's color:
+        optimized.geometry_.insert(
+              optimized.geometry_.end(), {-1.0, -1.0, -1.0, -1.0});
+        prev->type = DrawCommandType::Markers;
+        prev->count = 6;
+      }
+      const double *params = Parameters(cmd);
+      if (cmd.type == DrawCommandType::Marker) {
+        optimized.geometry_.insert(
+              optimized.geometry_.end(),
+              {params[0], params[1], -1.0, -1.0, -1.0, -1.0});
+        prev->count += 6;
+      } else {
+        optimized.geometry_.insert(
+              optimized.geometry_.end(), params, params + cmd.count);
+        prev->count += cmd.count;
+      }
+      continue;
+    }
+
+    optimized.CopyCommand(*this, cmd);
+  }
+
+  SPDLOG_DEBUG(
+        "DisplayList::Optimized: Reduced {:d} to {:d} commands.",
+        commands_.size(), optimized.commands_.size());
+  return optimized;
+}
+
+} // namespace viren2d
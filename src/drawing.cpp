@@ -1,6 +1,14 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <sstream>
 #include <iomanip>
+#include <map>
+#include <string>
 #include <stdexcept>
 #include <cassert>
 #include <cstring> // memcpy
@@ -17,10 +25,125 @@
 
 // private viren2d headers
 #include <helpers/drawing_helpers.h>
+#include <helpers/canvas_helpers.h>
+#include <helpers/dirty_region.h>
+#include <helpers/marker_sprite_cache.h>
+#include <helpers/overlay_layer.h>
+#include <helpers/thread_pool.h>
 #include <helpers/logging.h>
 
 
+namespace wks = werkzeugkiste::strings;
+
 namespace viren2d {
+//-------------------------------------------------  CanvasLayout
+std::string CanvasLayoutToString(CanvasLayout layout) {
+  switch (layout) {
+    case CanvasLayout::RGB:
+      return "RGB";
+    case CanvasLayout::BGR:
+      return "BGR";
+    case CanvasLayout::RGBA:
+      return "RGBA";
+    case CanvasLayout::BGRA:
+      return "BGRA";
+    case CanvasLayout::Gray:
+      return "Gray";
+  }
+
+  std::ostringstream s;
+  s << "CanvasLayout (" << static_cast<int>(layout)
+    << ") is not mapped in `CanvasLayoutToString`!";
+  throw std::logic_error(s.str());
+}
+
+
+CanvasLayout CanvasLayoutFromString(const std::string &layout) {
+  const auto lower = wks::Trim(wks::Lower(layout));
+  if (lower.compare("rgb") == 0) {
+    return CanvasLayout::RGB;
+  } else if (lower.compare("bgr") == 0) {
+    return CanvasLayout::BGR;
+  } else if (lower.compare("rgba") == 0) {
+    return CanvasLayout::RGBA;
+  } else if (lower.compare("bgra") == 0) {
+    return CanvasLayout::BGRA;
+  } else if ((lower.compare("gray") == 0)
+             || (lower.compare("grey") == 0)) {
+    return CanvasLayout::Gray;
+  }
+
+  std::string s("Could not deduce `CanvasLayout` from string representation \"");
+  s += layout;
+  s += "\"!";
+  throw std::logic_error(s);
+}
+
+
+std::ostream &operator<<(std::ostream &os, CanvasLayout layout) {
+  os << CanvasLayoutToString(layout);
+  return os;
+}
+
+
+int CanvasLayoutChannels(CanvasLayout layout) {
+  switch (layout) {
+    case CanvasLayout::RGB:
+    case CanvasLayout::BGR:
+      return 3;
+    case CanvasLayout::RGBA:
+    case CanvasLayout::BGRA:
+      return 4;
+    case CanvasLayout::Gray:
+      return 1;
+  }
+
+  std::ostringstream s;
+  s << "CanvasLayout (" << static_cast<int>(layout)
+    << ") is not mapped in `CanvasLayoutChannels`!";
+  throw std::logic_error(s.str());
+}
+
+
+//-------------------------------------------------  RenderQuality
+std::string RenderQualityToString(RenderQuality quality) {
+  switch (quality) {
+    case RenderQuality::Fast:
+      return "Fast";
+    case RenderQuality::Balanced:
+      return "Balanced";
+    case RenderQuality::Best:
+      return "Best";
+  }
+
+  std::ostringstream s;
+  s << "RenderQuality (" << static_cast<int>(quality)
+    << ") is not mapped in `RenderQualityToString`!";
+  throw std::logic_error(s.str());
+}
+
+
+RenderQuality RenderQualityFromString(const std::string &quality) {
+  const auto lower = wks::Trim(wks::Lower(quality));
+  if (lower.compare("fast") == 0) {
+    return RenderQuality::Fast;
+  } else if (lower.compare("balanced") == 0) {
+    return RenderQuality::Balanced;
+  } else if (lower.compare("best") == 0) {
+    return RenderQuality::Best;
+  }
+
+  std::string s("Could not deduce `RenderQuality` from string representation \"");
+  s += quality;
+  s += "\"!";
+  throw std::logic_error(s);
+}
+
+
+std::ostream &operator<<(std::ostream &os, RenderQuality quality) {
+  os << RenderQualityToString(quality);
+  return os;
+}
 
 
 //TODO(svg-extension) outsource surface handling (SVG vs Image)
@@ -53,13 +176,22 @@ public:
 
   void SetCanvas(const ImageBuffer &image_buffer) override;
 
+  bool SetCanvas(ImageBuffer &image_buffer, bool copy) override;
+
+  void SetCanvasBGR(const ImageBuffer &image_buffer) override;
+
   Vec2i GetCanvasSize() const override;
 
   ImageBuffer GetCanvas(bool copy) const override;
 
+  void GetCanvas(ImageBuffer &out, CanvasLayout layout) const override;
+
 
   bool SetClipRegion(const Rect &clip) override {
     SPDLOG_DEBUG("SetClipRection: clip={:s}.", clip);
+    if (IsUnsupportedWhileRecording("SetClipRegion")) {
+      return false;
+    }
     return helpers::SetClipRegion(
           surface_, context_, clip);
   }
@@ -67,6 +199,9 @@ public:
 
   bool SetClipRegion(const Vec2d &center, double radius) override {
     SPDLOG_DEBUG("SetClipRection: c={:s}, r={:.2f}.", center, radius);
+    if (IsUnsupportedWhileRecording("SetClipRegion")) {
+      return false;
+    }
     return helpers::SetClipRegion(
           surface_, context_, center, radius);
   }
@@ -74,16 +209,178 @@ public:
 
   bool ResetClipRegion() override {
     SPDLOG_DEBUG("ResetClipRegion.");
+    if (IsUnsupportedWhileRecording("ResetClipRegion")) {
+      return false;
+    }
     return helpers::ResetClipRegion(surface_, context_);
   }
 
 
   bool DrawGradient(const ColorGradient &gradient) override {
     SPDLOG_DEBUG("DrawGradient: {:s}.", gradient);
+    if (IsUnsupportedWhileRecording("DrawGradient")) {
+      return false;
+    }
     return helpers::DrawGradient(surface_, context_, gradient);
   }
 
 
+  void BeginRecording(DisplayList &list) override {
+    SPDLOG_DEBUG("BeginRecording: {:s}.", list.ToString());
+    recording_ = &list;
+  }
+
+
+  void EndRecording() override {
+    SPDLOG_DEBUG("EndRecording.");
+    recording_ = nullptr;
+  }
+
+
+  bool IsRecording() const override {
+    return recording_ != nullptr;
+  }
+
+
+  bool DrawDisplayList(const DisplayList &list) override;
+
+
+  bool BeginLayer(const std::string &name) override;
+
+
+  bool EndLayer() override;
+
+
+  bool IsLayerActive() const override {
+    return canvas_context_ != nullptr;
+  }
+
+
+  bool HasLayer(const std::string &name) const override;
+
+
+  bool DrawLayer(const std::string &name) override;
+
+
+  bool InvalidateLayer(const std::string &name) override {
+    SPDLOG_DEBUG("InvalidateLayer: {:s}.", name);
+    return layers_.erase(name) > 0;
+  }
+
+
+  void ClearLayers() override {
+    SPDLOG_DEBUG("ClearLayers.");
+    layers_.clear();
+  }
+
+
+  void SetRenderThreads(int num_threads) override {
+    SPDLOG_DEBUG("SetRenderThreads: {:d}.", num_threads);
+    render_threads_ = std::max(0, num_threads);
+  }
+
+
+  int RenderThreads() const override {
+    return render_threads_;
+  }
+
+
+  void SetMarkerCacheSize(std::size_t num_sprites) override {
+    SPDLOG_DEBUG("SetMarkerCacheSize: {:d}.", num_sprites);
+    if (marker_sprites_) {
+      marker_sprites_->SetCapacity(num_sprites);
+    } else {
+      marker_sprites_ = std::make_unique<helpers::MarkerSpriteCache>(
+            num_sprites);
+    }
+  }
+
+
+  std::size_t MarkerCacheSize() const override {
+    return marker_sprites_ ? marker_sprites_->Capacity() : 0;
+  }
+
+
+  void SetTrajectoryFadeOutLevels(int num_levels) override {
+    SPDLOG_DEBUG("SetTrajectoryFadeOutLevels: {:d}.", num_levels);
+    fade_out_levels_ = std::max(0, num_levels);
+  }
+
+
+  int TrajectoryFadeOutLevels() const override {
+    return fade_out_levels_;
+  }
+
+
+  void SetSimplificationTolerance(double tolerance) override {
+    SPDLOG_DEBUG("SetSimplificationTolerance: {:f}.", tolerance);
+    simplify_tolerance_ = std::isfinite(tolerance)
+        ? std::max(0.0, tolerance) : 0.0;
+  }
+
+
+  double SimplificationTolerance() const override {
+    return simplify_tolerance_;
+  }
+
+
+  void SetBitmapTextEnabled(bool enabled) override {
+    SPDLOG_DEBUG("SetBitmapTextEnabled: {:s}.", enabled);
+    bitmap_text_ = enabled;
+  }
+
+
+  bool IsBitmapTextEnabled() const override {
+    return bitmap_text_;
+  }
+
+
+  void SetRenderQuality(RenderQuality quality) override {
+    SPDLOG_DEBUG(
+          "SetRenderQuality: {:s}.", RenderQualityToString(quality));
+    render_quality_ = quality;
+    helpers::ApplyRenderQuality(context_, render_quality_);
+    if (canvas_context_) {
+      helpers::ApplyRenderQuality(canvas_context_, render_quality_);
+    }
+  }
+
+
+  RenderQuality GetRenderQuality() const override {
+    return render_quality_;
+  }
+
+
+  std::size_t NumCulledPrimitives() const override {
+    return culled_primitives_ ? culled_primitives_->load() : 0;
+  }
+
+
+  void ResetNumCulledPrimitives() override {
+    if (culled_primitives_) {
+      culled_primitives_->store(0);
+    }
+  }
+
+
+  std::vector<Rect> DirtyRects() const override;
+
+
+  void ResetDirtyRects() override {
+    SPDLOG_DEBUG("ResetDirtyRects.");
+    if (dirty_region_) {
+      dirty_region_->Clear();
+    }
+  }
+
+
+  void CopyDirtyRects(ImageBuffer &out, CanvasLayout layout) const override;
+
+
+  void RestoreDirtyRects(
+      const ImageBuffer &background, bool is_bgr) override;
+
+
 protected:
   bool DrawArcImpl(
       const Vec2d &center, double radius,
@@ -95,6 +392,13 @@ protected:
           center, radius, angle1, angle2, line_style,
           include_center, fill_color);
 
+    if (recording_) {
+      recording_->AddArc(
+            center, radius, angle1, angle2, line_style,
+            include_center, fill_color);
+      return true;
+    }
+
     return helpers::DrawArc(
           surface_, context_, center, radius,
           angle1, angle2, line_style,
@@ -109,6 +413,11 @@ protected:
           "DrawArrow: p1={:s} --> p2={:s}, style={:s}.",
           from, to, arrow_style);
 
+    if (recording_) {
+      recording_->AddArrow(from, to, arrow_style);
+      return true;
+    }
+
     return helpers::DrawArrow(surface_, context_, from, to, arrow_style);
   }
 
@@ -122,12 +431,56 @@ protected:
       const std::vector<std::string> &label_right,
       bool right_top_to_bottom) override {
     SPDLOG_DEBUG("DrawBoundingBox2D: {:s}, style={:s}.", rect, style);
+    if (recording_) {
+      recording_->AddBoundingBox2D(
+            rect, style, label_top, label_bottom, label_left,
+            left_top_to_bottom, label_right, right_top_to_bottom);
+      return true;
+    }
+
     return helpers::DrawBoundingBox2D(
           surface_, context_, rect, style, label_top, label_bottom,
           label_left, left_top_to_bottom, label_right, right_top_to_bottom);
   }
 
 
+  bool DrawBoundingBoxes2DImpl(
+      const std::vector<Rect> &boxes,
+      const std::vector<BoundingBox2DStyle> &styles,
+      const std::vector<std::size_t> &style_indices,
+      const std::vector<std::string> &labels) override {
+    SPDLOG_DEBUG(
+          "DrawBoundingBoxes2D: {:d} boxes, {:d} styles.",
+          boxes.size(), styles.size());
+    if (recording_) {
+      // Display lists store each box as a separate command.
+      bool success = true;
+      for (std::size_t idx = 0; idx < boxes.size(); ++idx) {
+        const std::size_t style_idx = (idx < style_indices.size())
+            ? style_indices[idx] : 0;
+        if (style_idx >= styles.size()) {
+          SPDLOG_WARN(
+                "Skipping bounding box #{:d}, its style index {:d} is out "
+                "of range!", idx, style_idx);
+          success = false;
+          continue;
+        }
+        std::vector<std::string> label_top;
+        if ((idx < labels.size()) && !labels[idx].empty()) {
+          label_top.push_back(labels[idx]);
+        }
+        recording_->AddBoundingBox2D(
+              boxes[idx], styles[style_idx], label_top,
+              {}, {}, false, {}, true);
+      }
+      return success;
+    }
+
+    return helpers::DrawBoundingBoxes2D(
+          surface_, context_, boxes, styles, style_indices, labels);
+  }
+
+
   bool DrawCircleImpl(
       const Vec2d &center, double radius,
       const LineStyle &line_style,
@@ -136,6 +489,11 @@ protected:
           "DrawCircle: c={:s}, r={:.1f}, style={:s}, fill={:s}.",
           center, radius, line_style, fill_color);
 
+    if (recording_) {
+      recording_->AddCircle(center, radius, line_style, fill_color);
+      return true;
+    }
+
     return helpers::DrawCircle(
           surface_, context_, center, radius,
           line_style, fill_color);
@@ -149,6 +507,11 @@ protected:
           "DrawEllipse: {:s}, style={:s}, fill={:s}.",
           ellipse, line_style, fill_color);
 
+    if (recording_) {
+      recording_->AddEllipse(ellipse, line_style, fill_color);
+      return true;
+    }
+
     return helpers::DrawEllipse(
           surface_, context_, ellipse, line_style, fill_color);
   }
@@ -162,6 +525,12 @@ protected:
           "DrawGrid: cells={:.1f}x{:.1f}, tl={:s}, br={:s}, style={:s}.",
           spacing_x, spacing_y, top_left, bottom_right, line_style);
 
+    if (recording_) {
+      recording_->AddGrid(
+            top_left, bottom_right, spacing_x, spacing_y, line_style);
+      return true;
+    }
+
     return helpers::DrawGrid(
           surface_, context_, top_left, bottom_right,
           spacing_x, spacing_y, line_style);
@@ -173,6 +542,9 @@ protected:
       const LineStyle &line_style) override {
     SPDLOG_DEBUG(
           "DrawHorizonLineImpl: style={:s}.", line_style);
+    if (IsUnsupportedWhileRecording("DrawHorizonLine")) {
+      return Line2d();
+    }
     return helpers::DrawHorizonLineImpl(
           surface_, context_, K, R, t, line_style, GetCanvasSize());
   }
@@ -190,6 +562,10 @@ protected:
           image.ToString(), AnchorToString(anchor), position.ToString(),
           alpha, scale_x, scale_y, rotation, clip_factor, line_style.ToString());
 
+    if (IsUnsupportedWhileRecording("DrawImage")) {
+      return false;
+    }
+
     return helpers::DrawImage(
           surface_, context_, image, position, anchor, alpha,
           scale_x, scale_y, rotation, clip_factor, line_style);
@@ -202,6 +578,11 @@ protected:
     SPDLOG_DEBUG(
           "DrawLine: p1={:s}, p2={:s}, style={:s}.", from, to, line_style);
 
+    if (recording_) {
+      recording_->AddLine(from, to, line_style);
+      return true;
+    }
+
     return helpers::DrawLine(
           surface_, context_, from, to, line_style);
   }
@@ -211,7 +592,13 @@ protected:
       const Vec2d &pos, const MarkerStyle &style) override {
     SPDLOG_DEBUG("DrawMarker: pos={:s}, style={:s}.", pos, style);
 
-    return helpers::DrawMarker(surface_, context_, pos, style);
+    if (recording_) {
+      recording_->AddMarker(pos, style);
+      return true;
+    }
+
+    return helpers::DrawMarker(
+          surface_, context_, pos, style, marker_sprites_.get());
   }
 
 
@@ -221,26 +608,13 @@ protected:
     SPDLOG_DEBUG(
           "DrawMarkers: {:d} markers, style={:s}.", markers.size(), style);
 
-    // Currently, we simply forward each point to the
-    // "single marker" Cairo helper. While there is undoubtedly
-    // potential for performance improvement, this is not
-    // my current focus, because:
-    // a) viren2d is neither a high-speed library nor
-    //    is it noticably slow, and
-    // b) unless we're drawing hundreds+ points at once,
-    //    I doubt that the speedup would be noticable
-    MarkerStyle s(style);
-    bool success = true;
-    for (const auto &p : markers) {
-      if (p.second.IsValid()) {
-        s.color = p.second;
-      } else {
-        s.color = style.color;
-      }
-      const bool result = helpers::DrawMarker(surface_, context_, p.first, s);
-      success = success && result;
+    if (recording_) {
+      recording_->AddMarkers(markers, style);
+      return true;
     }
-    return success;
+
+    return helpers::DrawMarkers(
+          surface_, context_, markers, style, marker_sprites_.get());
   }
 
 
@@ -252,8 +626,14 @@ protected:
           "DrawPolygon: {:d} points, style={:s}, fill={:s}.",
           points.size(), line_style, fill_color);
 
+    if (recording_) {
+      recording_->AddPolygon(points, line_style, fill_color);
+      return true;
+    }
+
     return helpers::DrawPolygon(
-          surface_, context_, points, line_style, fill_color);
+          surface_, context_, points, line_style, fill_color,
+          simplify_tolerance_);
   }
 
 
@@ -264,6 +644,11 @@ protected:
           "DrawRect: {:s}, style={:s}, fill={:s}.",
           rect, line_style, fill_color);
 
+    if (recording_) {
+      recording_->AddRect(rect, line_style, fill_color);
+      return true;
+    }
+
     return helpers::DrawRect(
           surface_, context_, rect, line_style, fill_color);
   }
@@ -279,10 +664,16 @@ protected:
           "rotation={:.1f}°.",
           text.size(), position, anchor, text_style, padding, rotation);
 
+    if (recording_) {
+      recording_->AddText(
+            text, position, anchor, text_style, padding, rotation);
+      return Rect();
+    }
+
     return helpers::DrawText(
           surface_, context_, text, position, anchor, text_style,
           padding, rotation, LineStyle::Invalid, Color::Invalid,
-          0.0, {-1.0, -1.0});
+          0.0, {-1.0, -1.0}, bitmap_text_);
   }
 
 
@@ -301,10 +692,18 @@ protected:
           box_line_style, box_fill_color, box_corner_radius,
           (int)fixed_box_size.width(), (int)fixed_box_size.height());
 
+    if (recording_) {
+      recording_->AddTextBox(
+            text, position, anchor, text_style, padding, rotation,
+            box_line_style, box_fill_color, box_corner_radius,
+            fixed_box_size);
+      return Rect();
+    }
+
     return helpers::DrawText(
           surface_, context_, text, position, anchor, text_style,
           padding, rotation, box_line_style, box_fill_color,
-          box_corner_radius, fixed_box_size);
+          box_corner_radius, fixed_box_size, bitmap_text_);
   }
 
 
@@ -327,9 +726,17 @@ protected:
             points, smoothing_window)
         : points;
 
+    if (recording_) {
+      recording_->AddTrajectory(
+            smoothed, style, color_fade_out, oldest_position_first,
+            mix_factor);
+      return true;
+    }
+
     return helpers::DrawTrajectory(
           surface_, context_, smoothed, style, color_fade_out,
-          oldest_position_first, mix_factor);
+          oldest_position_first, mix_factor, fade_out_levels_,
+          simplify_tolerance_);
   }
 
 
@@ -361,9 +768,16 @@ protected:
         s.color = style.color;
       }
 
+      if (recording_) {
+        recording_->AddTrajectory(
+              smoothed, s, color_fade_out, oldest_position_first, mix_factor);
+        continue;
+      }
+
       const bool result = helpers::DrawTrajectory(
             surface_, context_, smoothed, s, color_fade_out,
-            oldest_position_first, mix_factor);
+            oldest_position_first, mix_factor, fade_out_levels_,
+            simplify_tolerance_);
       // Avoid combining the flag update. This way, valid trajectories will
       // still be drawn after we skipped an invalid one.
       success = success && result;
@@ -372,6 +786,49 @@ protected:
   }
 
 
+  bool DrawTrajectoryStoreImpl(
+      const TrajectoryStore &store, const LineStyle &style,
+      const Color &color_fade_out,
+      const std::function<double(double)> &mix_factor) override {
+    SPDLOG_DEBUG(
+          "DrawTrajectoryStore: {:d} tracks, style={:s}, fade_out={:s}.",
+          store.NumTracks(), style, color_fade_out);
+
+    LineStyle s(style);
+    bool success = true;
+    store.ForEachTrack(
+          [&](TrajectoryStore::TrackID, const Vec2d *points,
+              std::size_t num_points, const Color &color) {
+      // Freshly started tracks are not an error:
+      if (num_points < 2) {
+        return;
+      }
+
+      if (color.IsValid()) {
+        s.color = color;
+      } else if (color.IsSpecialSame()) {
+        s.color = style.color.WithAlpha(color.alpha);
+      } else {
+        s.color = style.color;
+      }
+
+      if (recording_) {
+        recording_->AddTrajectory(
+              std::vector<Vec2d>(points, points + num_points), s,
+              color_fade_out, true, mix_factor);
+        return;
+      }
+
+      // The store keeps the positions from oldest to most recent:
+      const bool result = helpers::DrawTrajectory(
+            surface_, context_, points, num_points, s, color_fade_out,
+            true, mix_factor, fade_out_levels_, simplify_tolerance_);
+      success = success && result;
+    });
+    return success;
+  }
+
+
   std::tuple<bool, Vec2d, Vec2d, Vec2d, Vec2d> DrawXYZAxesImpl(
       const Matrix3x3d &K, const Matrix3x3d &R, const Vec3d &t,
       const Vec3d &origin, const Vec3d &lengths, const ArrowStyle &style,
@@ -380,6 +837,9 @@ protected:
     SPDLOG_DEBUG(
           "DrawXYZAxes: Axis lengths {:s}.", lengths);
     Vec2d img_origin, img_x, img_y, img_z;
+    if (IsUnsupportedWhileRecording("DrawXYZAxes")) {
+      return std::make_tuple(false, img_origin, img_x, img_y, img_z);
+    }
     bool any_visible = helpers::DrawXYZAxes(
           surface_, context_, K, R, t, origin, lengths, style,
           color_x, color_y, color_z, GetCanvasSize(), img_origin,
@@ -391,17 +851,132 @@ protected:
 private:
   cairo_surface_t *surface_;
   cairo_t *context_;
+
+  /// Whether the surface wraps caller-owned memory (see the
+  /// zero-copy `SetCanvas` overload).
+  bool shared_canvas_;
+
+  /// Keeps the wrapped memory alive if it is owned by an ImageBuffer,
+  /// see `ImageBuffer::PinData`.
+  std::shared_ptr<void> canvas_pin_;
+
+  /// The display list to record into (if in recording mode).
+  DisplayList *recording_;
+
+  /// Number of threads to render a display list (0 to use all
+  /// hardware threads).
+  int render_threads_;
+
+  /// Tiles must be at least this high, otherwise the overhead of
+  /// replaying the commands per tile outweighs the parallelization.
+  static constexpr int kMinRenderTileHeight = 32;
+
+  /// Pre-rasterized markers, see `SetMarkerCacheSize`.
+  std::unique_ptr<helpers::MarkerSpriteCache> marker_sprites_;
+
+  /// Default capacity of the marker sprite cache, *i.e.* disabled. Sprites
+  /// quantize the marker positions, thus users have to opt in via
+  /// `SetMarkerCacheSize`.
+  static constexpr std::size_t kDefaultMarkerCacheSize = 0;
+
+  /// Number of color levels to fade out trajectories (0 for exact
+  /// gradients), see `SetTrajectoryFadeOutLevels`.
+  int fade_out_levels_;
+
+  /// Polyline simplification tolerance in pixels (0 to disable), see
+  /// `SetSimplificationTolerance`.
+  double simplify_tolerance_;
+
+  /// If set, text will be composited from pre-rasterized glyphs, see
+  /// `SetBitmapTextEnabled`.
+  bool bitmap_text_;
+
+  /// Speed vs. quality trade-off, see `SetRenderQuality`. Must be
+  /// applied to each newly created context.
+  RenderQuality render_quality_;
+
+  /// Number of primitives skipped by the drawing helpers, see
+  /// `NumCulledPrimitives`. Allocated on the heap, because the
+  /// contexts refer to it (and must stay valid upon moving a painter).
+  std::unique_ptr<std::atomic<std::size_t>> culled_primitives_;
+
+  /// Canvas regions which have been drawn onto, see `DirtyRects`. Also
+  /// allocated on the heap, because the canvas context refers to it.
+  std::unique_ptr<helpers::DirtyRegion> dirty_region_;
+
+  /// Retained overlay layers, see `BeginLayer`.
+  std::map<std::string, std::unique_ptr<helpers::OverlayLayer>> layers_;
+
+  /// Name of the layer which is currently rendered into.
+  std::string active_layer_;
+
+  /// While a layer is active, `surface_` and `context_` refer to the
+  /// layer and these hold the actual canvas (otherwise, nullptr).
+  cairo_surface_t *canvas_surface_;
+  cairo_t *canvas_context_;
+
+  /// Finishes the active layer (if any) before the canvas is changed.
+  void EndActiveLayer(const char *operation);
+
+  /// Returns the actual canvas surface, *i.e.* not the active layer's.
+  cairo_surface_t *CanvasSurface() const {
+    return canvas_context_ ? canvas_surface_ : surface_;
+  }
+
+  /// Applies the painter's settings (render quality, culling counter and
+  /// dirty region) to a newly created or reset context.
+  void ApplyContextSettings();
+
+  /// Logs a warning if the painter is in recording mode and returns
+  /// true, *i.e.* the given operation must be skipped.
+  bool IsUnsupportedWhileRecording(const char *operation) const;
+
+  /// Releases the current Cairo context & surface.
+  void ReleaseCanvas();
+
+  /// Copies the given image into the canvas, reusing the current
+  /// surface if possible.
+  void ImportCanvas(const ImageBuffer &image_buffer, bool is_bgr);
+
+  /// Checks whether the current surface & context can be reused for
+  /// a canvas of the given size. If so, the context state will be reset
+  /// and true is returned.
+  bool PrepareCanvasReuse(int width, int height);
+
+  /// Ensures that `out` can hold the given surface in the given layout,
+  /// see `GetCanvas`. Returns false if `out` had to be (re)allocated.
+  bool PrepareExportBuffer(
+      cairo_surface_t *surface, ImageBuffer &out, CanvasLayout layout) const;
+
+  /// Returns true if the given buffer points into the current
+  /// canvas' memory.
+  bool PointsToCanvasMemory(const ImageBuffer &buffer) const;
 };
 
 
 PainterImpl::PainterImpl() : Painter(),
-  surface_(nullptr), context_(nullptr) {
+  surface_(nullptr), context_(nullptr), shared_canvas_(false),
+  recording_(nullptr), render_threads_(1),
+  marker_sprites_(std::make_unique<helpers::MarkerSpriteCache>(
+      kDefaultMarkerCacheSize)),
+  fade_out_levels_(0), simplify_tolerance_(0.0), bitmap_text_(false),
+  render_quality_(RenderQuality::Balanced),
+  culled_primitives_(std::make_unique<std::atomic<std::size_t>>(0)),
+  dirty_region_(std::make_unique<helpers::DirtyRegion>()),
+  canvas_surface_(nullptr), canvas_context_(nullptr) {
   SPDLOG_DEBUG("PainterImpl default constructor.");
 }
 
 
 PainterImpl::~PainterImpl() {
   SPDLOG_DEBUG("PainterImpl destructor.");
+  if (IsLayerActive()) {
+    // Discard the unfinished layer:
+    cairo_destroy(context_);
+    cairo_surface_destroy(surface_);
+    context_ = canvas_context_;
+    surface_ = canvas_surface_;
+  }
   if (context_)
     cairo_destroy(context_);
   if (surface_)
@@ -411,26 +986,44 @@ PainterImpl::~PainterImpl() {
 
 PainterImpl::PainterImpl(const PainterImpl &other) // copy constructor
   : Painter(),
-    surface_(nullptr), context_(nullptr) {
+    surface_(nullptr), context_(nullptr), shared_canvas_(false),
+    recording_(nullptr), render_threads_(other.render_threads_),
+    marker_sprites_(std::make_unique<helpers::MarkerSpriteCache>(
+        other.MarkerCacheSize())),
+    fade_out_levels_(other.fade_out_levels_),
+    simplify_tolerance_(other.simplify_tolerance_),
+    bitmap_text_(other.bitmap_text_),
+    render_quality_(other.render_quality_),
+    culled_primitives_(std::make_unique<std::atomic<std::size_t>>(
+        other.NumCulledPrimitives())),
+    dirty_region_(other.dirty_region_
+        ? std::make_unique<helpers::DirtyRegion>(*other.dirty_region_)
+        : std::make_unique<helpers::DirtyRegion>()),
+    canvas_surface_(nullptr), canvas_context_(nullptr) {
+  // The copy doesn't continue the other painter's recording or active
+  // layer. Retained layers are not copied either (they will simply be
+  // rendered again, see `HasLayer`).
   SPDLOG_DEBUG("PainterImpl copy constructor.");
-  if (other.surface_)
+  cairo_surface_t *other_surface = other.CanvasSurface();
+  if (other_surface)
   {
     SPDLOG_TRACE("Copying other PainterImpl's surface.");
-    cairo_format_t format = cairo_image_surface_get_format(other.surface_);
+    cairo_format_t format = cairo_image_surface_get_format(other_surface);
     assert(format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24);
-    const int width = cairo_image_surface_get_width(other.surface_);
-    const int height = cairo_image_surface_get_height(other.surface_);
+    const int width = cairo_image_surface_get_width(other_surface);
+    const int height = cairo_image_surface_get_height(other_surface);
 
-    surface_ = cairo_image_surface_create(cairo_image_surface_get_format(other.surface_),
+    surface_ = cairo_image_surface_create(cairo_image_surface_get_format(other_surface),
                                           width, height);
     memcpy(cairo_image_surface_get_data(surface_),
-           cairo_image_surface_get_data(other.surface_),
+           cairo_image_surface_get_data(other_surface),
            width*height*4);
 
     // We don't reuse the context on purpose. If someone
     // really wants a copy of an ImagePainter, they can
     // afford the extra allocation
     context_ = cairo_create(surface_);
+    ApplyContextSettings();
   }
 }
 
@@ -438,7 +1031,22 @@ PainterImpl::PainterImpl(const PainterImpl &other) // copy constructor
 PainterImpl::PainterImpl(PainterImpl &&other) noexcept
   : Painter(),
     surface_(std::exchange(other.surface_, nullptr)),
-    context_(std::exchange(other.context_, nullptr)) {
+    context_(std::exchange(other.context_, nullptr)),
+    shared_canvas_(std::exchange(other.shared_canvas_, false)),
+    canvas_pin_(std::move(other.canvas_pin_)),
+    recording_(std::exchange(other.recording_, nullptr)),
+    render_threads_(other.render_threads_),
+    marker_sprites_(std::move(other.marker_sprites_)),
+    fade_out_levels_(other.fade_out_levels_),
+    simplify_tolerance_(other.simplify_tolerance_),
+    bitmap_text_(other.bitmap_text_),
+    render_quality_(other.render_quality_),
+    culled_primitives_(std::move(other.culled_primitives_)),
+    dirty_region_(std::move(other.dirty_region_)),
+    layers_(std::move(other.layers_)),
+    active_layer_(std::move(other.active_layer_)),
+    canvas_surface_(std::exchange(other.canvas_surface_, nullptr)),
+    canvas_context_(std::exchange(other.canvas_context_, nullptr)) {
   SPDLOG_DEBUG("PainterImpl move constructor.");
 }
 
@@ -453,6 +1061,21 @@ PainterImpl& PainterImpl::operator=(PainterImpl &&other) noexcept { // Move assi
   SPDLOG_DEBUG("PainterImpl move assignment operator.");
   std::swap(surface_, other.surface_);
   std::swap(context_, other.context_);
+  std::swap(shared_canvas_, other.shared_canvas_);
+  std::swap(canvas_pin_, other.canvas_pin_);
+  std::swap(recording_, other.recording_);
+  std::swap(render_threads_, other.render_threads_);
+  std::swap(marker_sprites_, other.marker_sprites_);
+  std::swap(fade_out_levels_, other.fade_out_levels_);
+  std::swap(simplify_tolerance_, other.simplify_tolerance_);
+  std::swap(bitmap_text_, other.bitmap_text_);
+  std::swap(render_quality_, other.render_quality_);
+  std::swap(culled_primitives_, other.culled_primitives_);
+  std::swap(dirty_region_, other.dirty_region_);
+  std::swap(layers_, other.layers_);
+  std::swap(active_layer_, other.active_layer_);
+  std::swap(canvas_surface_, other.canvas_surface_);
+  std::swap(canvas_context_, other.canvas_context_);
   return *this;
 }
 
@@ -480,31 +1103,28 @@ void PainterImpl::SetCanvas(int height, int width, const Color &color) {
     throw std::invalid_argument(msg);
   }
 
-  // Simplest solution is to create a new surface:
-  if (context_) {
-    cairo_destroy(context_);
-    context_ = nullptr;
-  }
-  if (surface_) {
-    cairo_surface_destroy(surface_);
-    surface_ = nullptr;
-  }
+  EndActiveLayer("SetCanvas");
+  ResetDirtyRects();
 
+  // If the size matches, we can reuse the previous surface & context.
+  // Otherwise, we need to create a new surface:
+  if (!PrepareCanvasReuse(width, height)) {
+    ReleaseCanvas();
 
-  if (!surface_) {
     SPDLOG_TRACE(
           "SetCanvas: Creating Cairo image surface for w={:d}, h={:d} canvas.",
           width, height);
     surface_ = cairo_image_surface_create(
           CAIRO_FORMAT_ARGB32, width, height);
-  }
-
-  if (!context_) {
     context_ = cairo_create(surface_);
+    ApplyContextSettings();
   }
 
-  // Now simply fill the canvas with the given color:
+  // Now simply fill the canvas with the given color. We replace the
+  // previous content (instead of blending over it), so that a reused
+  // surface yields the same result as a freshly created one:
   cairo_save(context_);
+  cairo_set_operator(context_, CAIRO_OPERATOR_SOURCE);
   helpers::ApplyColor(context_, color);
   cairo_paint(context_);
   cairo_restore(context_);
@@ -522,6 +1142,17 @@ void PainterImpl::SetCanvas(const std::string &image_filename) {
 
 void PainterImpl::SetCanvas(const ImageBuffer &image_buffer) {
   SPDLOG_DEBUG("SetCanvas: {:s}).", image_buffer.ToString());
+  ImportCanvas(image_buffer, false);
+}
+
+
+void PainterImpl::SetCanvasBGR(const ImageBuffer &image_buffer) {
+  SPDLOG_DEBUG("SetCanvasBGR: {:s}).", image_buffer.ToString());
+  ImportCanvas(image_buffer, true);
+}
+
+
+void PainterImpl::ImportCanvas(const ImageBuffer &image_buffer, bool is_bgr) {
   if (!image_buffer.IsValid()) {
     const std::string msg(
           "Cannot initialize canvas from invalid ImageBuffer!");
@@ -529,50 +1160,115 @@ void PainterImpl::SetCanvas(const ImageBuffer &image_buffer) {
     throw std::invalid_argument(msg);
   }
 
-  if (image_buffer.Channels() != 4) {
-    SetCanvas(image_buffer.ToChannels(4));
+  EndActiveLayer("SetCanvas");
+  ResetDirtyRects();
+
+  // The import kernels support uint8 grayscale, RGB(A) and BGR(A) images.
+  // Anything else needs to be converted first:
+  if (image_buffer.BufferType() != ImageBufferType::UInt8) {
+    ImportCanvas(image_buffer.ToUInt8(image_buffer.Channels()), is_bgr);
+    return;
+  }
+
+  if ((image_buffer.Channels() != 1)
+      && (image_buffer.Channels() != 3)
+      && (image_buffer.Channels() != 4)) {
+    ImportCanvas(image_buffer.ToChannels(4), is_bgr);
+    return;
+  }
+
+  // If the previous canvas has the same size, we only overwrite its
+  // pixels. Otherwise, we clean up previously created contexts/surfaces
+  // and copy the given ImageBuffer into a new surface. If the caller
+  // doesn't need a copy, the `SetCanvas(ImageBuffer &, bool)` overload
+  // can wrap compatible buffers without allocating.
+  // Note that the buffer could also be a view onto the current canvas
+  // (e.g. obtained via `GetCanvas(false)`), which must not be reused.
+  const bool aliases_canvas = PointsToCanvasMemory(image_buffer);
+  cairo_t *previous_context = nullptr;
+  cairo_surface_t *previous_surface = nullptr;
+  std::shared_ptr<void> previous_pin;
+  if (!aliases_canvas
+      && PrepareCanvasReuse(image_buffer.Width(), image_buffer.Height())) {
+    // Complete any pending drawing operations before we directly
+    // modify the surface memory:
+    cairo_surface_flush(surface_);
   } else {
-    // Currently, we clean up previously created contexts/surfaces to
-    // avoid unnecessarily cluttering the implementation. Then, we
-    // copy the given ImageBuffer.
-    // If this becomes a bottleneck, we need to provide a boolean "copy"
-    // flag and distinguish 4 scenarios:
-    // * copy-flag true, existing data --> check if it surface can
-    //   be reused (memcpy)
-    // * copy-flag true, no surface --> malloc(surface create) + memcpy
-    // * copy-flag false, existing data --> clean up data, reuse surface
-    // * copy-flag false, no surface --> surface create_for_data
-    if (context_) {
-      SPDLOG_TRACE("SetCanvas: Releasing previous Cairo context.");
-      cairo_destroy(context_);
-      context_ = nullptr;
-    }
-
-    if (surface_) {
-      SPDLOG_TRACE("SetCanvas: Releasing previous Cairo surface.");
-      cairo_surface_destroy(surface_);
-      surface_ = nullptr;
-    }
+    // Release the previous canvas only after copying, because the
+    // input buffer may point to its memory:
+    previous_context = std::exchange(context_, nullptr);
+    previous_surface = std::exchange(surface_, nullptr);
+    previous_pin = std::move(canvas_pin_);
+    shared_canvas_ = false;
 
     SPDLOG_TRACE(
           "SetCanvas: Creating Cairo surface and context from image buffer.");
     surface_ = cairo_image_surface_create(
           CAIRO_FORMAT_ARGB32, image_buffer.Width(), image_buffer.Height());
-    //FIXME refactor - check stride/memory alignment before copying!
-    // make it reusable in DrawImage (create surface_t for image; add flag to
-    // "try" copying (if the memory alignment is suitable)
-    std::memcpy(
-          cairo_image_surface_get_data(surface_),
-          image_buffer.ImmutableData(),
-          4 * image_buffer.Width() * image_buffer.Height());
     context_ = cairo_create(surface_);
+    ApplyContextSettings();
+  }
+
+  // Convert the pixels (channel order, premultiplied alpha) directly
+  // into the surface memory. The import honors the strides of both the
+  // input buffer (which may be a non-contiguous view) and the surface.
+  helpers::ImportCanvasData(
+        cairo_image_surface_get_data(surface_),
+        cairo_image_surface_get_stride(surface_),
+        image_buffer, is_bgr);
 
-    // Ensure that the underlying image surface will be rendered immediately:
-    cairo_surface_mark_dirty(surface_);
+  // Ensure that the underlying image surface will be rendered immediately:
+  cairo_surface_mark_dirty(surface_);
+
+  if (previous_context) {
+    cairo_destroy(previous_context);
+  }
+  if (previous_surface) {
+    cairo_surface_destroy(previous_surface);
   }
 }
 
 
+bool PainterImpl::SetCanvas(ImageBuffer &image_buffer, bool copy) {
+  SPDLOG_DEBUG(
+        "SetCanvas: {:s}, copy={}.", image_buffer.ToString(), copy);
+  EndActiveLayer("SetCanvas");
+  ResetDirtyRects();
+
+  // If the buffer points to the current canvas, we must not release its
+  // surface. Thus, we need to copy it:
+  if (copy || !helpers::IsCairoCompatibleBuffer(image_buffer)
+      || PointsToCanvasMemory(image_buffer)) {
+    if (!copy) {
+      SPDLOG_DEBUG(
+            "SetCanvas: Cannot wrap {:s} (incompatible memory layout "
+            "or view onto the current canvas), falling back to copying.",
+            image_buffer.ToString());
+    }
+    SetCanvas(static_cast<const ImageBuffer &>(image_buffer));
+    return false;
+  }
+
+  ReleaseCanvas();
+
+  // If the buffer owns its memory, we keep it alive and ensure that
+  // copies of the buffer won't change along with our drawings:
+  canvas_pin_ = image_buffer.PinData();
+
+  SPDLOG_TRACE(
+        "SetCanvas: Creating Cairo surface and context on top of "
+        "the image buffer's memory.");
+  surface_ = cairo_image_surface_create_for_data(
+        image_buffer.MutableData(), CAIRO_FORMAT_ARGB32,
+        image_buffer.Width(), image_buffer.Height(),
+        image_buffer.RowStride());
+  context_ = cairo_create(surface_);
+  ApplyContextSettings();
+  shared_canvas_ = true;
+  return true;
+}
+
+
 Vec2i PainterImpl::GetCanvasSize() const {
   if (IsValid()) {
     return Vec2i(
@@ -614,10 +1310,748 @@ ImageBuffer PainterImpl::GetCanvas(bool copy) const {
 }
 
 
+void PainterImpl::GetCanvas(ImageBuffer &out, CanvasLayout layout) const {
+  SPDLOG_DEBUG(
+        "GetCanvas: out={:s}, layout={:s}.",
+        out.ToString(), CanvasLayoutToString(layout));
+
+  if (!IsValid()) {
+    throw std::logic_error("Invalid canvas - did you forget `SetCanvas()`?");
+  }
+
+  PrepareExportBuffer(surface_, out, layout);
+
+  // Complete any pending drawing operations before reading the memory:
+  cairo_surface_flush(surface_);
+  helpers::ExportCanvasData(
+        cairo_image_surface_get_data(surface_),
+        cairo_image_surface_get_stride(surface_), out,
+        (layout == CanvasLayout::BGR) || (layout == CanvasLayout::BGRA));
+}
+
+
+bool PainterImpl::PrepareExportBuffer(
+    cairo_surface_t *surface, ImageBuffer &out, CanvasLayout layout) const {
+  const int width = cairo_image_surface_get_width(surface);
+  const int height = cairo_image_surface_get_height(surface);
+  const int channels = CanvasLayoutChannels(layout);
+
+  const bool compatible = out.IsValid()
+      && (out.BufferType() == ImageBufferType::UInt8)
+      && (out.Width() == width) && (out.Height() == height)
+      && (out.Channels() == channels);
+  if (!compatible) {
+    if (out.IsValid() && !out.OwnsData()) {
+      std::ostringstream msg;
+      msg << "Cannot export " << width << "x" << height << " canvas as "
+          << CanvasLayoutToString(layout) << " into a shared buffer of "
+             "different shape/type: " << out.ToString() << '!';
+      SPDLOG_ERROR(msg.str());
+      throw std::invalid_argument(msg.str());
+    }
+    SPDLOG_TRACE(
+          "GetCanvas: Allocating {:d}x{:d}x{:d} output buffer.",
+          width, height, channels);
+    out = ImageBuffer(height, width, channels, ImageBufferType::UInt8);
+    return false;
+  }
+
+  if (PointsToCanvasMemory(out)) {
+    const std::string msg(
+          "Cannot export the canvas into a view onto its own memory!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+  return true;
+}
+
+
+std::vector<Rect> PainterImpl::DirtyRects() const {
+  std::vector<Rect> rects;
+  if (dirty_region_) {
+    rects.reserve(dirty_region_->Boxes().size());
+    for (const auto &box : dirty_region_->Boxes()) {
+      rects.push_back(Rect::FromLTWH(
+          box.left, box.top, box.Width(), box.Height()));
+    }
+  }
+  return rects;
+}
+
+
+void PainterImpl::CopyDirtyRects(ImageBuffer &out, CanvasLayout layout) const {
+  SPDLOG_DEBUG(
+        "CopyDirtyRects: out={:s}, layout={:s}.",
+        out.ToString(), CanvasLayoutToString(layout));
+
+  if (!IsValid()) {
+    throw std::logic_error("Invalid canvas - did you forget `SetCanvas()`?");
+  }
+
+  // The dirty region refers to the actual canvas, even if a layer is
+  // currently active.
+  cairo_surface_t *canvas = CanvasSurface();
+  const int width = cairo_image_surface_get_width(canvas);
+  const int height = cairo_image_surface_get_height(canvas);
+  std::vector<helpers::PixelBox> boxes;
+  if (!PrepareExportBuffer(canvas, out, layout)) {
+    // A newly allocated buffer needs the whole canvas:
+    helpers::PixelBox full;
+    full.right = width;
+    full.bottom = height;
+    boxes.push_back(full);
+  } else if (dirty_region_) {
+    boxes = dirty_region_->Boxes();
+  }
+
+  cairo_surface_flush(canvas);
+  const unsigned char *data = cairo_image_surface_get_data(canvas);
+  const int stride = cairo_image_surface_get_stride(canvas);
+  const bool is_bgr = (layout == CanvasLayout::BGR)
+      || (layout == CanvasLayout::BGRA);
+  for (const auto &box : boxes) {
+    ImageBuffer roi = out.ROI(box.left, box.top, box.Width(), box.Height());
+    helpers::ExportCanvasData(
+          data + static_cast<std::size_t>(box.top) * stride + box.left * 4,
+          stride, roi, is_bgr);
+  }
+}
+
+
+void PainterImpl::RestoreDirtyRects(
+    const ImageBuffer &background, bool is_bgr) {
+  SPDLOG_DEBUG(
+        "RestoreDirtyRects: {:s}, is_bgr={}.", background.ToString(), is_bgr);
+
+  if (!IsValid()) {
+    throw std::logic_error("Invalid canvas - did you forget `SetCanvas()`?");
+  }
+
+  if (!background.IsValid()) {
+    const std::string msg(
+          "Cannot restore the canvas from an invalid ImageBuffer!");
+    SPDLOG_ERROR(msg);
+    throw std::invalid_argument(msg);
+  }
+
+  // Same conversions as for `SetCanvas`:
+  if (background.BufferType() != ImageBufferType::UInt8) {
+    RestoreDirtyRects(background.ToUInt8(background.Channels()), is_bgr);
+    return;
+  }
+
+  if ((background.Channels() != 1)
+      && (background.Channels() != 3)
+      && (background.Channels() != 4)) {
+    RestoreDirtyRects(background.ToChannels(4), is_bgr);
+    return;
+  }
+
+  cairo_surface_t *canvas = CanvasSurface();
+  const int width = cairo_image_surface_get_width(canvas);
+  const int height = cairo_image_surface_get_height(canvas);
+  if ((background.Width() != width) || (background.Height() != height)) {
+    std::ostringstream msg;
+    msg << "Cannot restore a " << width << "x" << height
+        << " canvas from a background of different size: "
+        << background.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  if (!dirty_region_ || dirty_region_->IsEmpty()) {
+    return;
+  }
+
+  // Complete any pending drawing operations before we directly
+  // modify the surface memory:
+  cairo_surface_flush(canvas);
+  unsigned char *data = cairo_image_surface_get_data(canvas);
+  const int stride = cairo_image_surface_get_stride(canvas);
+  for (const auto &box : dirty_region_->Boxes()) {
+    // Read-only view onto the background region (`ROI` would request
+    // mutable access to the background's memory):
+    ImageBuffer roi;
+    roi.CreateSharedBuffer(
+          const_cast<unsigned char *>(
+            background.ImmutablePtr<unsigned char>(box.top, box.left)),
+          box.Height(), box.Width(), background.Channels(),
+          background.RowStride(), background.PixelStride(),
+          background.BufferType());
+    helpers::ImportCanvasData(
+          data + static_cast<std::size_t>(box.top) * stride + box.left * 4,
+          stride, roi, is_bgr);
+  }
+  cairo_surface_mark_dirty(canvas);
+  dirty_region_->Clear();
+}
+
+
+void PainterImpl::ReleaseCanvas() {
+  if (context_) {
+    SPDLOG_TRACE("Releasing previous Cairo context.");
+    cairo_destroy(context_);
+    context_ = nullptr;
+  }
+
+  if (surface_) {
+    SPDLOG_TRACE("Releasing previous Cairo surface.");
+    cairo_surface_destroy(surface_);
+    surface_ = nullptr;
+  }
+
+  canvas_pin_.reset();
+  shared_canvas_ = false;
+}
+
+
+bool PainterImpl::PrepareCanvasReuse(int width, int height) {
+  // A surface which wraps caller-owned memory must not be reused, because
+  // we would overwrite the caller's image. Similarly, a surface/context
+  // in an error state has to be replaced.
+  if (!IsValid() || shared_canvas_
+      || (cairo_surface_status(surface_) != CAIRO_STATUS_SUCCESS)
+      || (cairo_status(context_) != CAIRO_STATUS_SUCCESS)
+      || (cairo_image_surface_get_width(surface_) != width)
+      || (cairo_image_surface_get_height(surface_) != height)) {
+    return false;
+  }
+
+  SPDLOG_TRACE(
+        "Reusing Cairo surface and context for w={:d}, h={:d} canvas.",
+        width, height);
+  helpers::ResetContext(context_);
+  ApplyContextSettings();
+  return true;
+}
+
+
+void PainterImpl::ApplyContextSettings() {
+  helpers::ApplyRenderQuality(context_, render_quality_);
+  // A moved-from painter has to start counting anew:
+  if (!culled_primitives_) {
+    culled_primitives_ = std::make_unique<std::atomic<std::size_t>>(0);
+  }
+  helpers::SetCullingCounter(context_, culled_primitives_.get());
+  if (!dirty_region_) {
+    dirty_region_ = std::make_unique<helpers::DirtyRegion>();
+  }
+  helpers::SetDirtyRegion(context_, dirty_region_.get());
+}
+
+
+bool PainterImpl::PointsToCanvasMemory(const ImageBuffer &buffer) const {
+  if (!IsValid()) {
+    return false;
+  }
+
+  const unsigned char *canvas_begin = cairo_image_surface_get_data(surface_);
+  const unsigned char *canvas_end = canvas_begin
+      + static_cast<std::size_t>(cairo_image_surface_get_stride(surface_))
+        * cairo_image_surface_get_height(surface_);
+  return (buffer.ImmutableData() >= canvas_begin)
+      && (buffer.ImmutableData() < canvas_end);
+}
+
+
+bool PainterImpl::BeginLayer(const std::string &name) {
+  SPDLOG_DEBUG("BeginLayer: {:s}.", name);
+  if (IsUnsupportedWhileRecording("BeginLayer")
+      || !helpers::CheckCanvas(surface_, context_)) {
+    return false;
+  }
+
+  if (name.empty()) {
+    SPDLOG_WARN("Cannot begin a layer without a name!");
+    return false;
+  }
+
+  if (IsLayerActive()) {
+    SPDLOG_WARN(
+          "Cannot begin layer `{:s}` while layer `{:s}` is active!",
+          name, active_layer_);
+    return false;
+  }
+
+  cairo_surface_t *layer = helpers::CreateLayerSurface(
+        cairo_image_surface_get_width(surface_),
+        cairo_image_surface_get_height(surface_));
+  if (!layer) {
+    return false;
+  }
+
+  // Redirect all drawing calls into the layer:
+  canvas_surface_ = std::exchange(surface_, layer);
+  canvas_context_ = std::exchange(context_, cairo_create(layer));
+  ApplyContextSettings();
+  // The canvas only becomes dirty once the layer is drawn:
+  helpers::SetDirtyRegion(context_, nullptr);
+  active_layer_ = name;
+  return true;
+}
+
+
+bool PainterImpl::EndLayer() {
+  SPDLOG_DEBUG("EndLayer: {:s}.", active_layer_);
+  if (!IsLayerActive()) {
+    SPDLOG_WARN("`EndLayer` called, but no layer is active!");
+    return false;
+  }
+
+  cairo_destroy(context_);
+  // Takes ownership of the layer's surface:
+  layers_[active_layer_] = helpers::FinalizeLayer(surface_);
+  surface_ = std::exchange(canvas_surface_, nullptr);
+  context_ = std::exchange(canvas_context_, nullptr);
+  active_layer_.clear();
+  return true;
+}
+
+
+void PainterImpl::EndActiveLayer(const char *operation) {
+  // Only used for logging, which may be disabled:
+  (void)operation;
+  if (IsLayerActive()) {
+    SPDLOG_WARN(
+          "`{:s}` ends the active layer `{:s}`.", operation, active_layer_);
+    EndLayer();
+  }
+}
+
+
+bool PainterImpl::HasLayer(const std::string &name) const {
+  const auto it = layers_.find(name);
+  if (it == layers_.end()) {
+    return false;
+  }
+  const Vec2i size = IsValid()
+      ? Vec2i(cairo_image_surface_get_width(CanvasSurface()),
+              cairo_image_surface_get_height(CanvasSurface()))
+      : Vec2i(0, 0);
+  return (it->second->canvas_width == size.X())
+      && (it->second->canvas_height == size.Y());
+}
+
+
+bool PainterImpl::DrawLayer(const std::string &name) {
+  SPDLOG_DEBUG("DrawLayer: {:s}.", name);
+  if (IsUnsupportedWhileRecording("DrawLayer")
+      || !helpers::CheckCanvas(surface_, context_)) {
+    return false;
+  }
+
+  const auto it = layers_.find(name);
+  if (it == layers_.end()) {
+    SPDLOG_WARN("Layer `{:s}` does not exist!", name);
+    return false;
+  }
+
+  if (!HasLayer(name)) {
+    SPDLOG_WARN(
+          "Layer `{:s}` has been rendered for a {:d}x{:d} canvas, "
+          "thus it will be invalidated!", name,
+          it->second->canvas_width, it->second->canvas_height);
+    layers_.erase(it);
+    return false;
+  }
+
+  helpers::CompositeLayer(context_, *it->second);
+  return true;
+}
+
+
+bool PainterImpl::IsUnsupportedWhileRecording(const char *operation) const {
+  // Only used for logging, which may be disabled:
+  (void)operation;
+  if (recording_) {
+    SPDLOG_WARN(
+          "`{:s}` is not supported while recording a display list!",
+          operation);
+    return true;
+  }
+  return false;
+}
+
+
+namespace helpers {
+/// Restores a color from the display list parameters (without
+/// clamping, so that special colors remain valid).
+inline Color ColorFromParameters(const double *params) {
+  Color color;
+  color.red = params[0];
+  color.green = params[1];
+  color.blue = params[2];
+  color.alpha = params[3];
+  return color;
+}
+
+
+/// Collects the points of a display list command.
+inline std::vector<Vec2d> PointsFromParameters(
+    const double *params, std::size_t num_values) {
+  std::vector<Vec2d> points;
+  points.reserve(num_values / 2);
+  for (std::size_t idx = 0; idx + 1 < num_values; idx += 2) {
+    points.emplace_back(params[idx], params[idx + 1]);
+  }
+  return points;
+}
+
+
+/// Painter settings which affect how display list commands are rendered.
+struct ReplaySettings {
+  /// Pre-rasterized markers, see `Painter::SetMarkerCacheSize`.
+  MarkerSpriteCache *sprite_cache;
+
+  /// See `Painter::SetTrajectoryFadeOutLevels`.
+  int fade_out_levels;
+
+  /// See `Painter::SetSimplificationTolerance`.
+  double simplify_tolerance;
+
+  /// See `Painter::SetBitmapTextEnabled`.
+  bool bitmap_text;
+};
+
+
+/// Replays a single display list command onto the given surface/context.
+bool ReplayCommand(
+    cairo_surface_t *surface, cairo_t *context,
+    const DisplayList &list, const DrawCommand &cmd,
+    const ReplaySettings &settings) {
+  const double *p = list.Parameters(cmd);
+  switch (cmd.type) {
+    case DrawCommandType::Arc:
+      return DrawArc(
+            surface, context, {p[0], p[1]}, p[2], p[3], p[4],
+            list.GetLineStyle(cmd.style), p[5] > 0.0,
+            list.GetColor(cmd.fill));
+
+    case DrawCommandType::Arrow:
+      return DrawArrow(
+            surface, context, {p[0], p[1]}, {p[2], p[3]},
+            list.GetArrowStyle(cmd.style));
+
+    case DrawCommandType::BoundingBox2D:
+      return DrawBoundingBox2D(
+            surface, context, Rect(p[0], p[1], p[2], p[3], p[4], p[5]),
+            list.GetBoundingBox2DStyle(cmd.style),
+            list.GetText(cmd.extra), list.GetText(cmd.extra + 1),
+            list.GetText(cmd.extra + 2), p[6] > 0.0,
+            list.GetText(cmd.extra + 3), p[7] > 0.0);
+
+    case DrawCommandType::Circle:
+      return DrawCircle(
+            surface, context, {p[0], p[1]}, p[2],
+            list.GetLineStyle(cmd.style), list.GetColor(cmd.fill));
+
+    case DrawCommandType::Ellipse: {
+        Ellipse ellipse;
+        ellipse.cx = p[0];
+        ellipse.cy = p[1];
+        ellipse.major_axis = p[2];
+        ellipse.minor_axis = p[3];
+        ellipse.rotation = p[4];
+        ellipse.angle_from = p[5];
+        ellipse.angle_to = p[6];
+        ellipse.include_center = p[7] > 0.0;
+        return DrawEllipse(
+              surface, context, ellipse, list.GetLineStyle(cmd.style),
+              list.GetColor(cmd.fill));
+      }
+
+    case DrawCommandType::Grid:
+      return DrawGrid(
+            surface, context, {p[0], p[1]}, {p[2], p[3]}, p[4], p[5],
+            list.GetLineStyle(cmd.style));
+
+    case DrawCommandType::Line:
+      return DrawLine(
+            surface, context, {p[0], p[1]}, {p[2], p[3]},
+            list.GetLineStyle(cmd.style));
+
+    case DrawCommandType::Lines:
+      return DrawLineSegments(
+            surface, context, PointsFromParameters(p, cmd.count),
+            list.GetLineStyle(cmd.style));
+
+    case DrawCommandType::Marker:
+      return DrawMarker(
+            surface, context, {p[0], p[1]}, list.GetMarkerStyle(cmd.style),
+            settings.sprite_cache);
+
+    case DrawCommandType::Markers: {
+        std::vector<std::pair<Vec2d, Color>> markers;
+        markers.reserve(cmd.count / 6);
+        for (std::size_t idx = 0; idx + 5 < cmd.count; idx += 6) {
+          markers.push_back(std::make_pair(
+                Vec2d(p[idx], p[idx + 1]), ColorFromParameters(p + idx + 2)));
+        }
+        return DrawMarkers(
+              surface, context, markers, list.GetMarkerStyle(cmd.style),
+              settings.sprite_cache);
+      }
+
+    case DrawCommandType::Polygon:
+      return DrawPolygon(
+            surface, context, PointsFromParameters(p, cmd.count),
+            list.GetLineStyle(cmd.style), list.GetColor(cmd.fill),
+            settings.simplify_tolerance);
+
+    case DrawCommandType::Rect:
+      return DrawRect(
+            surface, context, Rect(p[0], p[1], p[2], p[3], p[4], p[5]),
+            list.GetLineStyle(cmd.style), list.GetColor(cmd.fill));
+
+    case DrawCommandType::Text:
+      return DrawText(
+            surface, context, list.GetText(cmd.extra), {p[0], p[1]},
+            static_cast<Anchor>(static_cast<int>(p[2])),
+            list.GetTextStyle(cmd.style), {p[3], p[4]}, p[5],
+            LineStyle::Invalid, Color::Invalid, 0.0, {-1.0, -1.0},
+            settings.bitmap_text).IsValid();
+
+    case DrawCommandType::TextBox:
+      return DrawText(
+            surface, context, list.GetText(cmd.extra), {p[0], p[1]},
+            static_cast<Anchor>(static_cast<int>(p[2])),
+            list.GetTextStyle(cmd.style), {p[3], p[4]}, p[5],
+            list.GetLineStyle(cmd.box_style), list.GetColor(cmd.fill),
+            p[6], {p[7], p[8]}, settings.bitmap_text).IsValid();
+
+    case DrawCommandType::Trajectory:
+      return DrawTrajectory(
+            surface, context, PointsFromParameters(p + 5, cmd.count - 5),
+            list.GetLineStyle(cmd.style), ColorFromParameters(p),
+            p[4] > 0.0, list.GetFunction(cmd.extra),
+            settings.fade_out_levels, settings.simplify_tolerance);
+  }
+  return false;
+}
+
+
+/// Vertical extent of a display list command, used to assign the
+/// commands to the render tiles.
+struct CommandRows {
+  bool bounded;
+  double top;
+  double bottom;
+};
+
+
+/// Returns true if the given clip rectangle list covers the whole canvas,
+/// *i.e.* no clip region is active.
+inline bool IsUnclipped(cairo_t *context, int width, int height) {
+  cairo_rectangle_list_t *rects = cairo_copy_clip_rectangle_list(context);
+  const bool unclipped = (rects->status == CAIRO_STATUS_SUCCESS)
+      && (rects->num_rectangles == 1)
+      && (rects->rectangles[0].x <= 0.0)
+      && (rects->rectangles[0].y <= 0.0)
+      && (rects->rectangles[0].x + rects->rectangles[0].width >= width)
+      && (rects->rectangles[0].y + rects->rectangles[0].height >= height);
+  cairo_rectangle_list_destroy(rects);
+  return unclipped;
+}
+} // namespace helpers
+
+
+bool PainterImpl::DrawDisplayList(const DisplayList &list) {
+  SPDLOG_DEBUG(
+        "DrawDisplayList: {:s}, {:d} render thread(s).",
+        list.ToString(), render_threads_);
+
+  if (recording_) {
+    recording_->Append(list);
+    return true;
+  }
+
+  if (!helpers::CheckCanvas(surface_, context_)) {
+    return false;
+  }
+
+  const helpers::ReplaySettings settings{
+    marker_sprites_.get(), fade_out_levels_, simplify_tolerance_,
+    bitmap_text_};
+  const int num_threads = (render_threads_ > 0)
+      ? render_threads_
+      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  const int width = cairo_image_surface_get_width(surface_);
+  const int height = cairo_image_surface_get_height(surface_);
+  // Using more tiles than threads balances the load if the
+  // primitives are not distributed uniformly.
+  const int num_tiles = std::min(
+        2 * num_threads, height / kMinRenderTileHeight);
+
+  if ((num_threads < 2) || (num_tiles < 2) || (list.NumCommands() < 2)
+      || !helpers::IsUnclipped(context_, width, height)) {
+    bool success = true;
+    for (const DrawCommand &cmd : list.Commands()) {
+      const bool result = helpers::ReplayCommand(
+            surface_, context_, list, cmd, settings);
+      // Keep on drawing the remaining commands if one fails:
+      success = success && result;
+    }
+    return success;
+  }
+
+  // Precompute which rows each command can touch.
+  std::vector<helpers::CommandRows> rows;
+  rows.reserve(list.NumCommands());
+  for (const DrawCommand &cmd : list.Commands()) {
+    Vec2d top_left, bottom_right;
+    helpers::CommandRows r;
+    r.bounded = list.CommandExtent(cmd, top_left, bottom_right);
+    r.top = top_left.Y();
+    r.bottom = bottom_right.Y();
+    rows.push_back(r);
+  }
+
+  // Each tile gets its own surface (wrapping the same memory as the
+  // canvas) and context, which is clipped to the tile's rows. Since the
+  // tiles are pixel-aligned and disjoint, the workers never touch the
+  // same pixels and each pixel receives the same operations in the same
+  // order as in the serial path.
+  cairo_surface_flush(surface_);
+  unsigned char *data = cairo_image_surface_get_data(surface_);
+  const int stride = cairo_image_surface_get_stride(surface_);
+  const cairo_format_t format = cairo_image_surface_get_format(surface_);
+  const int tile_height = (height + num_tiles - 1) / num_tiles;
+
+  // Each tile tracks its own dirty region, which will be merged after
+  // all workers have finished. Drawing into a layer doesn't modify
+  // the canvas.
+  const bool track_dirty = !IsLayerActive();
+  std::vector<helpers::DirtyRegion> tile_regions(num_tiles);
+
+  // Culled primitives of a command are only counted by a single tile,
+  // against the whole canvas (see `SetCullingRegion`). This is the first
+  // tile which replays the command. Commands outside of all tiles are
+  // replayed by the first tile, just to count their primitives.
+  auto tile_rows = [height, tile_height](int tile, int &top, int &bottom) {
+    top = tile * tile_height;
+    bottom = std::min(height, top + tile_height);
+  };
+  auto skips_command = [&rows](std::size_t idx, int top, int bottom) {
+    return rows[idx].bounded
+        && ((rows[idx].bottom < top) || (rows[idx].top >= bottom));
+  };
+  std::vector<int> counting_tiles(list.NumCommands(), 0);
+  for (std::size_t idx = 0; idx < counting_tiles.size(); ++idx) {
+    for (int tile = 0; tile < num_tiles; ++tile) {
+      int top, bottom;
+      tile_rows(tile, top, bottom);
+      if ((top < bottom) && !skips_command(idx, top, bottom)) {
+        counting_tiles[idx] = tile;
+        break;
+      }
+    }
+  }
+
+  // The tiles are rendered by the persistent workers of the thread pool,
+  // thus replaying a display list doesn't pay the cost of spawning threads.
+  std::atomic<bool> success(true);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto render_tile = [&](int tile) {
+    int top, bottom;
+    tile_rows(tile, top, bottom);
+    if (top >= bottom) {
+      return;
+    }
+
+    cairo_surface_t *tile_surface = cairo_image_surface_create_for_data(
+          data, format, width, height, stride);
+    cairo_t *tile_context = cairo_create(tile_surface);
+    helpers::ApplyRenderQuality(tile_context, render_quality_);
+    helpers::SetCullingRegion(tile_context, width, height);
+    if (track_dirty) {
+      helpers::SetDirtyRegion(tile_context, &tile_regions[tile]);
+    }
+    cairo_rectangle(tile_context, 0, top, width, bottom - top);
+    cairo_clip(tile_context);
+
+    // Exceptions (e.g. raised by a user-defined trajectory mix factor)
+    // are rethrown after all tiles have been rendered, such that each
+    // tile releases its Cairo objects.
+    try {
+      const auto &commands = list.Commands();
+      for (std::size_t idx = 0; idx < commands.size(); ++idx) {
+        const bool counts_culled = (counting_tiles[idx] == tile);
+        if (!counts_culled && skips_command(idx, top, bottom)) {
+          continue;
+        }
+        helpers::SetCullingCounter(
+              tile_context,
+              counts_culled ? culled_primitives_.get() : nullptr);
+        if (!helpers::ReplayCommand(
+              tile_surface, tile_context, list, commands[idx],
+              settings)) {
+          success = false;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+
+    cairo_destroy(tile_context);
+    cairo_surface_flush(tile_surface);
+    cairo_surface_destroy(tile_surface);
+  };
+  helpers::DefaultThreadPool().Run(num_tiles, num_threads, render_tile);
+
+  cairo_surface_mark_dirty(surface_);
+  if (dirty_region_) {
+    for (const auto &region : tile_regions) {
+      dirty_region_->Add(region);
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return success;
+}
+
+
 std::unique_ptr<Painter> CreatePainter() {
   return std::unique_ptr<Painter>(new PainterImpl());
 }
 
+
+void SetTextCacheSize(std::size_t num_lines) {
+  SPDLOG_DEBUG("SetTextCacheSize: {:d}.", num_lines);
+  helpers::SetTextCacheCapacity(num_lines);
+}
+
+
+std::size_t TextCacheSize() {
+  return helpers::TextCacheCapacity();
+}
+
+
+TextCacheStatistics GetTextCacheStatistics(bool reset) {
+  TextCacheStatistics stats;
+  stats.capacity = helpers::TextCacheCapacity();
+  helpers::TextCacheStatistics(stats.size, stats.hits, stats.misses);
+  if (reset) {
+    helpers::ResetTextCacheStatistics();
+  }
+  return stats;
+}
+
+
+void SetFontCacheSize(std::size_t num_fonts) {
+  SPDLOG_DEBUG("SetFontCacheSize: {:d}.", num_fonts);
+  helpers::SetFontCacheCapacity(num_fonts);
+}
+
+
+std::size_t FontCacheSize() {
+  return helpers::FontCacheCapacity();
+}
+
 } // namespace viren2d
 
 
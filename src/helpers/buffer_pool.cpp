@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif  // _MSC_VER
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <helpers/buffer_pool.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Allocates a block which starts at a `kImageBufferAlignment` boundary.
+/// The size must be a multiple of the alignment, which holds for all
+/// size classes.
+inline unsigned char *AllocateBlock(std::size_t block_size) {
+#ifdef _MSC_VER
+  return static_cast<unsigned char *>(
+        _aligned_malloc(block_size, kImageBufferAlignment));
+#else
+  return static_cast<unsigned char *>(
+        std::aligned_alloc(kImageBufferAlignment, block_size));
+#endif  // _MSC_VER
+}
+
+
+inline void FreeBlock(unsigned char *block) {
+#ifdef _MSC_VER
+  _aligned_free(block);
+#else
+  std::free(block);
+#endif  // _MSC_VER
+}
+} // anonymous namespace
+
+
+/// Shared free lists and counters. Thread caches only hold a weak
+/// reference, so the pool can be destroyed while other threads still
+/// cache some of its blocks.
+struct BufferPool::State {
+  explicit State(std::size_t max_bytes) : capacity(max_bytes) {}
+
+  ~State() {
+    for (auto &entry : free_lists) {
+      for (unsigned char *block : entry.second) {
+        FreeBlock(block);
+      }
+    }
+  }
+
+  std::mutex mutex;
+  std::unordered_map<std::size_t, std::vector<unsigned char *>> free_lists;
+
+  std::atomic<std::size_t> capacity;
+  std::atomic<std::size_t> bytes_retained{0};
+  std::atomic<std::size_t> blocks_retained{0};
+  std::atomic<std::size_t> hits{0};
+  std::atomic<std::size_t> misses{0};
+
+
+  /// Accounts for a block which should be retained. Returns false if
+  /// this would exceed the capacity.
+  bool Reserve(std::size_t block_size) {
+    std::size_t current = bytes_retained.load();
+    do {
+      if (current + block_size > capacity.load()) {
+        return false;
+      }
+    } while (!bytes_retained.compare_exchange_weak(
+               current, current + block_size));
+    ++blocks_retained;
+    return true;
+  }
+
+
+  /// Accounts for a retained block which has been handed out or freed.
+  void Unreserve(std::size_t block_size) {
+    bytes_retained -= block_size;
+    --blocks_retained;
+  }
+
+
+  void Push(std::size_t block_size, unsigned char *block) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_lists[block_size].push_back(block);
+  }
+
+
+  unsigned char *Pop(std::size_t block_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = free_lists.find(block_size);
+    if ((it == free_lists.end()) || it->second.empty()) {
+      return nullptr;
+    }
+    unsigned char *block = it->second.back();
+    it->second.pop_back();
+    return block;
+  }
+
+
+  /// Frees blocks of the shared free lists until at most `max_bytes`
+  /// are retained (or the free lists are empty).
+  void Trim(std::size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : free_lists) {
+      while (!entry.second.empty() && (bytes_retained.load() > max_bytes)) {
+        FreeBlock(entry.second.back());
+        entry.second.pop_back();
+        Unreserve(entry.first);
+      }
+    }
+  }
+};
+
+
+namespace {
+/// Recently freed blocks of a single thread.
+struct ThreadCache {
+  std::weak_ptr<BufferPool::State> owner;
+  std::size_t sizes[kThreadCacheBlocks];
+  unsigned char *blocks[kThreadCacheBlocks];
+  std::size_t num_blocks = 0;
+
+  ~ThreadCache();
+
+
+  bool IsOwner(const std::shared_ptr<BufferPool::State> &state) const {
+    return !owner.owner_before(state) && !state.owner_before(owner);
+  }
+
+
+  /// Makes this the cache of the given pool. Blocks of the previous
+  /// pool will be returned to its shared free lists.
+  void Bind(const std::shared_ptr<BufferPool::State> &state) {
+    if (!IsOwner(state)) {
+      Flush();
+      owner = state;
+    }
+  }
+
+
+  /// Returns all blocks to the owning pool (or to the system if the
+  /// pool no longer exists).
+  void Flush() {
+    std::shared_ptr<BufferPool::State> state = owner.lock();
+    for (std::size_t idx = 0; idx < num_blocks; ++idx) {
+      if (state) {
+        state->Push(sizes[idx], blocks[idx]);
+      } else {
+        FreeBlock(blocks[idx]);
+      }
+    }
+    num_blocks = 0;
+  }
+
+
+  unsigned char *Take(std::size_t block_size) {
+    // Most recently freed blocks first.
+    for (std::size_t idx = num_blocks; idx > 0; --idx) {
+      if (sizes[idx - 1] == block_size) {
+        unsigned char *block = blocks[idx - 1];
+        --num_blocks;
+        sizes[idx - 1] = sizes[num_blocks];
+        blocks[idx - 1] = blocks[num_blocks];
+        return block;
+      }
+    }
+    return nullptr;
+  }
+
+
+  bool Put(std::size_t block_size, unsigned char *block) {
+    if (num_blocks == kThreadCacheBlocks) {
+      return false;
+    }
+    sizes[num_blocks] = block_size;
+    blocks[num_blocks] = block;
+    ++num_blocks;
+    return true;
+  }
+};
+
+
+/// Set once the calling thread's cache has been destroyed, *i.e.* buffers
+/// released by other thread-local destructors bypass the cache.
+thread_local bool thread_cache_destroyed = false;
+
+
+ThreadCache::~ThreadCache() {
+  Flush();
+  thread_cache_destroyed = true;
+}
+
+
+ThreadCache *LocalCache() {
+  if (thread_cache_destroyed) {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+} // anonymous namespace
+
+
+BufferPool::BufferPool(std::size_t capacity)
+  : state_(std::make_shared<State>(capacity)) {
+}
+
+
+BufferPool::~BufferPool() {
+  ThreadCache *cache = LocalCache();
+  if (cache && cache->IsOwner(state_)) {
+    cache->Flush();
+  }
+}
+
+
+unsigned char *BufferPool::Allocate(std::size_t num_bytes) {
+  const std::size_t block_size = SizeClass(num_bytes);
+
+  ThreadCache *cache = LocalCache();
+  unsigned char *block = nullptr;
+  if (cache) {
+    cache->Bind(state_);
+    block = cache->Take(block_size);
+  }
+  if (!block) {
+    block = state_->Pop(block_size);
+  }
+
+  if (block) {
+    state_->Unreserve(block_size);
+    ++state_->hits;
+    return block;
+  }
+
+  ++state_->misses;
+  return AllocateBlock(block_size);
+}
+
+
+void BufferPool::Deallocate(unsigned char *memory, std::size_t num_bytes) {
+  if (!memory) {
+    return;
+  }
+
+  const std::size_t block_size = SizeClass(num_bytes);
+  if (!state_->Reserve(block_size)) {
+    FreeBlock(memory);
+    return;
+  }
+
+  ThreadCache *cache = LocalCache();
+  if (cache) {
+    cache->Bind(state_);
+    if (cache->Put(block_size, memory)) {
+      return;
+    }
+  }
+  state_->Push(block_size, memory);
+}
+
+
+void BufferPool::SetCapacity(std::size_t capacity) {
+  state_->capacity = capacity;
+  state_->Trim(capacity);
+}
+
+
+std::size_t BufferPool::Capacity() const {
+  return state_->capacity.load();
+}
+
+
+ImageBufferPoolStatistics BufferPool::Statistics(bool reset) {
+  ImageBufferPoolStatistics stats;
+  stats.bytes_retained = state_->bytes_retained.load();
+  stats.blocks_retained = state_->blocks_retained.load();
+  stats.capacity = state_->capacity.load();
+  stats.hits = reset ? state_->hits.exchange(0) : state_->hits.load();
+  stats.misses = reset ? state_->misses.exchange(0) : state_->misses.load();
+  return stats;
+}
+
+
+void BufferPool::Release() {
+  ThreadCache *cache = LocalCache();
+  if (cache && cache->IsOwner(state_)) {
+    cache->Flush();
+  }
+  state_->Trim(0);
+}
+
+
+std::size_t BufferPool::SizeClass(std::size_t num_bytes) {
+  if (num_bytes <= 64) {
+    return 64;
+  }
+
+  // Split each power of two into 8 classes, but keep the granularity
+  // at 64 bytes for small requests.
+  std::size_t base = 64;
+  while ((base << 1) < num_bytes) {
+    base <<= 1;
+  }
+  const std::size_t step = std::max<std::size_t>(64, base / 8);
+  return ((num_bytes + step - 1) / step) * step;
+}
+
+} // namespace helpers
+} // namespace viren2d
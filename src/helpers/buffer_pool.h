@@ -0,0 +1,71 @@
+#ifndef __VIREN2D_BUFFER_POOL_H__
+#define __VIREN2D_BUFFER_POOL_H__
+
+#include <cstddef>
+#include <memory>
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Default number of bytes which the process-wide pool may retain.
+constexpr std::size_t kDefaultBufferPoolCapacity = 256 * 1024 * 1024;
+
+
+/// Maximum number of blocks which each thread keeps in its own cache.
+constexpr std::size_t kThreadCacheBlocks = 4;
+
+
+/// Recycles freed pixel memory of matching size classes.
+///
+/// Requested sizes are rounded up to one of 8 size classes per power of
+/// two (*i.e.* at most 12.5% overhead, and always a multiple of 64
+/// bytes). All blocks are aligned to `kImageBufferAlignment` bytes.
+/// Freed blocks are kept in the calling thread's cache (at most
+/// `kThreadCacheBlocks`) or in the shared free lists, as long as the
+/// total number of retained bytes doesn't exceed the capacity.
+/// Otherwise, they are returned to the system.
+///
+/// Both `Allocate` and `Deallocate` are thread-safe. Requests served
+/// from the thread cache don't need to lock.
+class BufferPool : public ImageBufferAllocator {
+public:
+  explicit BufferPool(std::size_t capacity = kDefaultBufferPoolCapacity);
+  ~BufferPool() override;
+
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  unsigned char *Allocate(std::size_t num_bytes) override;
+
+  void Deallocate(unsigned char *memory, std::size_t num_bytes) override;
+
+  /// Changes the maximum number of retained bytes. If the pool currently
+  /// retains more, the shared free lists will be trimmed.
+  void SetCapacity(std::size_t capacity);
+
+  std::size_t Capacity() const;
+
+  ImageBufferPoolStatistics Statistics(bool reset);
+
+  /// Frees all blocks of the shared free lists and of the calling
+  /// thread's cache. Blocks cached by other threads are released
+  /// once these threads allocate from another pool or exit.
+  void Release();
+
+  /// Returns the number of bytes which will be allocated for a
+  /// request of the given size.
+  static std::size_t SizeClass(std::size_t num_bytes);
+
+  struct State;
+
+private:
+  std::shared_ptr<State> state_;
+};
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_BUFFER_POOL_H__
@@ -0,0 +1,707 @@
+// STL
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <array>
+#include <cstdint>
+
+// private viren2d headers
+#include <helpers/canvas_helpers.h>
+#include <helpers/cpu_features.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+//---------------------------------------------------- Scalar kernels
+
+/// Computes round(value * alpha / 255) without division. This is
+/// the same approximation as used by pixman, i.e. Cairo's backend.
+inline uint8_t PremultiplyChannel(unsigned int value, unsigned int alpha) {
+  const unsigned int t = value * alpha + 128;
+  return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+
+/// Signature of the row conversion kernels. The source pixels must
+/// be `pixel_stride` bytes apart, the destination row is RGBA.
+typedef void (*ImportRowKernel)(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr);
+
+
+void ImportGrayRowScalar(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool /*is_bgr*/) {
+  for (int col = 0; col < width; ++col, src += pixel_stride, dst += 4) {
+    dst[0] = src[0];
+    dst[1] = src[0];
+    dst[2] = src[0];
+    dst[3] = 255;
+  }
+}
+
+
+void ImportRGBRowScalar(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const int idx_red = is_bgr ? 2 : 0;
+  const int idx_blue = is_bgr ? 0 : 2;
+  for (int col = 0; col < width; ++col, src += pixel_stride, dst += 4) {
+    dst[0] = src[idx_red];
+    dst[1] = src[1];
+    dst[2] = src[idx_blue];
+    dst[3] = 255;
+  }
+}
+
+
+void ImportRGBARowScalar(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const int idx_red = is_bgr ? 2 : 0;
+  const int idx_blue = is_bgr ? 0 : 2;
+  for (int col = 0; col < width; ++col, src += pixel_stride, dst += 4) {
+    const unsigned int alpha = src[3];
+    if (alpha == 255) {
+      dst[0] = src[idx_red];
+      dst[1] = src[1];
+      dst[2] = src[idx_blue];
+    } else {
+      dst[0] = PremultiplyChannel(src[idx_red], alpha);
+      dst[1] = PremultiplyChannel(src[1], alpha);
+      dst[2] = PremultiplyChannel(src[idx_blue], alpha);
+    }
+    dst[3] = static_cast<uint8_t>(alpha);
+  }
+}
+
+
+#if VIREN2D_X86_SIMD
+//---------------------------------------------------- SSSE3 kernels
+// The vectorized kernels require tightly packed pixels (pixel_stride equals
+// the number of channels). The remaining pixels of each row are handled by
+// the corresponding scalar kernel.
+
+VIREN2D_TARGET_SSSE3
+void ImportGrayRowSSSE3(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  const __m128i mask0 = _mm_setr_epi8(
+        0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+  const __m128i mask1 = _mm_setr_epi8(
+        4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+  const __m128i mask2 = _mm_setr_epi8(
+        8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1);
+  const __m128i mask3 = _mm_setr_epi8(
+        12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+
+  int col = 0;
+  for (; col + 16 <= width; col += 16) {
+    const __m128i gray = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + col));
+    __m128i *out = reinterpret_cast<__m128i*>(dst + 4 * col);
+    _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(gray, mask0), alpha));
+    _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(gray, mask1), alpha));
+    _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(gray, mask2), alpha));
+    _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(gray, mask3), alpha));
+  }
+  ImportGrayRowScalar(
+        src + col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_SSSE3
+void ImportRGBRowSSSE3(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  const __m128i mask = is_bgr
+      ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+      : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+  // Each 16-byte load covers 4 pixels (12 bytes) plus 4 bytes of the next
+  // pixel. Thus, we must ensure that the loads don't exceed the row.
+  int col = 0;
+  for (; col + 6 <= width; col += 4) {
+    const __m128i rgb = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + 3 * col));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(dst + 4 * col),
+          _mm_or_si128(_mm_shuffle_epi8(rgb, mask), alpha));
+  }
+  ImportRGBRowScalar(
+        src + 3 * col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_SSSE3
+void ImportRGBARowSSSE3(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m128i swap = is_bgr
+      ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+      : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i color_bits = _mm_set1_epi32(0x00FFFFFF);
+  const __m128i all_set = _mm_set1_epi8(-1);
+  // Broadcasts each pixel's alpha into the 16-bit lanes of its color
+  // components. The alpha lane itself will be multiplied by 255, i.e.
+  // it remains unchanged.
+  const __m128i alpha_mask = _mm_setr_epi8(
+        6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+  const __m128i alpha_one = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  const __m128i rounding = _mm_set1_epi16(128);
+  const __m128i zero = _mm_setzero_si128();
+
+  int col = 0;
+  for (; col + 4 <= width; col += 4) {
+    __m128i px = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * col)),
+          swap);
+    // Skip the multiplication if all 4 pixels are opaque:
+    const __m128i opaque = _mm_cmpeq_epi8(
+          _mm_or_si128(px, color_bits), all_set);
+    if (_mm_movemask_epi8(opaque) != 0xFFFF) {
+      __m128i lo = _mm_unpacklo_epi8(px, zero);
+      __m128i hi = _mm_unpackhi_epi8(px, zero);
+      const __m128i alpha_lo = _mm_or_si128(
+            _mm_shuffle_epi8(lo, alpha_mask), alpha_one);
+      const __m128i alpha_hi = _mm_or_si128(
+            _mm_shuffle_epi8(hi, alpha_mask), alpha_one);
+      lo = _mm_add_epi16(_mm_mullo_epi16(lo, alpha_lo), rounding);
+      hi = _mm_add_epi16(_mm_mullo_epi16(hi, alpha_hi), rounding);
+      lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+      hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+      px = _mm_packus_epi16(lo, hi);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * col), px);
+  }
+  ImportRGBARowScalar(
+        src + 4 * col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+
+
+//---------------------------------------------------- AVX2 kernels
+
+VIREN2D_TARGET_AVX2
+void ImportGrayRowAVX2(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+  // The shuffles operate on each 128-bit lane separately, thus the
+  // gray values are broadcast into both lanes first.
+  const __m256i mask0 = _mm256_setr_epi8(
+        0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+        4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+  const __m256i mask1 = _mm256_setr_epi8(
+        8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+        12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+
+  int col = 0;
+  for (; col + 16 <= width; col += 16) {
+    const __m256i gray = _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + col)));
+    __m256i *out = reinterpret_cast<__m256i*>(dst + 4 * col);
+    _mm256_storeu_si256(
+          out, _mm256_or_si256(_mm256_shuffle_epi8(gray, mask0), alpha));
+    _mm256_storeu_si256(
+          out + 1, _mm256_or_si256(_mm256_shuffle_epi8(gray, mask1), alpha));
+  }
+  ImportGrayRowScalar(
+        src + col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ImportRGBRowAVX2(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+  const __m256i mask = is_bgr
+      ? _mm256_setr_epi8(
+          2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+          2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+      : _mm256_setr_epi8(
+          0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+          0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+  // Each iteration loads 4 pixels into each lane, i.e. reads 28 bytes
+  // but consumes only 24 (8 pixels).
+  int col = 0;
+  for (; col + 10 <= width; col += 8) {
+    const __m128i lo = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + 3 * col));
+    const __m128i hi = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + 3 * col + 12));
+    const __m256i rgb = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(lo), hi, 1);
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(dst + 4 * col),
+          _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha));
+  }
+  ImportRGBRowSSSE3(
+        src + 3 * col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ImportRGBARowAVX2(
+    const uint8_t *src, int pixel_stride, uint8_t *dst, int width,
+    bool is_bgr) {
+  const __m256i swap = is_bgr
+      ? _mm256_setr_epi8(
+          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+      : _mm256_setr_epi8(
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i color_bits = _mm256_set1_epi32(0x00FFFFFF);
+  const __m256i all_set = _mm256_set1_epi8(-1);
+  const __m256i alpha_mask = _mm256_setr_epi8(
+        6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1,
+        6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+  const __m256i alpha_one = _mm256_setr_epi16(
+        0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+  const __m256i rounding = _mm256_set1_epi16(128);
+  const __m256i zero = _mm256_setzero_si256();
+
+  // Unpacking and packing both operate per 128-bit lane, so the
+  // pixel order is preserved.
+  int col = 0;
+  for (; col + 8 <= width; col += 8) {
+    __m256i px = _mm256_shuffle_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * col)),
+          swap);
+    const __m256i opaque = _mm256_cmpeq_epi8(
+          _mm256_or_si256(px, color_bits), all_set);
+    if (_mm256_movemask_epi8(opaque) != -1) {
+      __m256i lo = _mm256_unpacklo_epi8(px, zero);
+      __m256i hi = _mm256_unpackhi_epi8(px, zero);
+      const __m256i alpha_lo = _mm256_or_si256(
+            _mm256_shuffle_epi8(lo, alpha_mask), alpha_one);
+      const __m256i alpha_hi = _mm256_or_si256(
+            _mm256_shuffle_epi8(hi, alpha_mask), alpha_one);
+      lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alpha_lo), rounding);
+      hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, alpha_hi), rounding);
+      lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+      hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+      px = _mm256_packus_epi16(lo, hi);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * col), px);
+  }
+  ImportRGBARowSSSE3(
+        src + 4 * col, pixel_stride, dst + 4 * col, width - col, is_bgr);
+}
+#endif  // VIREN2D_X86_SIMD
+
+
+//---------------------------------------------------- Kernel selection
+
+/// Returns the fastest row kernel which is supported by the CPU.
+ImportRowKernel SelectImportRowKernel(int channels, bool packed) {
+#if VIREN2D_X86_SIMD
+  if (packed && CPUSupportsAVX2()) {
+    switch (channels) {
+      case 1: return ImportGrayRowAVX2;
+      case 3: return ImportRGBRowAVX2;
+      case 4: return ImportRGBARowAVX2;
+    }
+  }
+
+  if (packed && CPUSupportsSSSE3()) {
+    switch (channels) {
+      case 1: return ImportGrayRowSSSE3;
+      case 3: return ImportRGBRowSSSE3;
+      case 4: return ImportRGBARowSSSE3;
+    }
+  }
+#else
+  (void)packed;
+#endif  // VIREN2D_X86_SIMD
+
+  switch (channels) {
+    case 1: return ImportGrayRowScalar;
+    case 3: return ImportRGBRowScalar;
+    case 4: return ImportRGBARowScalar;
+  }
+  return nullptr;
+}
+
+
+void ImportCanvasData(
+    unsigned char *canvas, int canvas_stride,
+    const ImageBuffer &image, bool is_bgr) {
+  if (!image.IsValid() || (image.BufferType() != ImageBufferType::UInt8)) {
+    std::ostringstream msg;
+    msg << "Canvas import requires a valid `uint8` ImageBuffer, but got: "
+        << image.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const int channels = image.Channels();
+  const ImportRowKernel kernel = SelectImportRowKernel(
+        channels, image.PixelStride() == channels);
+  if (!kernel) {
+    std::ostringstream msg;
+    msg << "Canvas import supports only grayscale, RGB(A) or BGR(A) "
+           "images, but got: " << image.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const uint8_t *src = image.ImmutableData();
+  for (int row = 0; row < image.Height(); ++row) {
+    kernel(
+          src + row * image.RowStride(), image.PixelStride(),
+          canvas + row * canvas_stride, image.Width(), is_bgr);
+  }
+}
+
+
+//---------------------------------------------------- Canvas export
+
+/// Returns the fixed point (16 bit fraction) reciprocals to revert the
+/// alpha premultiplication, i.e. `ceil(255 * 2^16 / alpha)`. This yields
+/// exactly `round(value * 255 / alpha)` for all valid inputs.
+const uint32_t *UnpremultiplyTable() {
+  static const auto table = []() {
+    std::array<uint32_t, 256> t;
+    t[0] = 0;
+    for (uint32_t alpha = 1; alpha < 256; ++alpha) {
+      t[alpha] = ((255u << 16) + alpha - 1) / alpha;
+    }
+    return t;
+  }();
+  return table.data();
+}
+
+
+inline uint8_t UnpremultiplyChannel(unsigned int value, uint32_t reciprocal) {
+  const uint32_t v = (value * reciprocal + 0x8000) >> 16;
+  return static_cast<uint8_t>((v > 255) ? 255 : v);
+}
+
+
+/// Fixed point weights (15 bit fraction) of `CvtHelperRGB2Gray`.
+constexpr int kGrayWeightRed = 9794;
+constexpr int kGrayWeightGreen = 19235;
+constexpr int kGrayWeightBlue = 3739;
+
+
+/// Signature of the row export kernels. The destination pixels must
+/// be `pixel_stride` bytes apart, the source row is (premultiplied) RGBA.
+typedef void (*ExportRowKernel)(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr);
+
+
+void ExportGrayRowScalar(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool /*is_bgr*/) {
+  for (int col = 0; col < width; ++col, src += 4, dst += pixel_stride) {
+    dst[0] = static_cast<uint8_t>(
+          (kGrayWeightRed * src[0] + kGrayWeightGreen * src[1]
+           + kGrayWeightBlue * src[2]) >> 15);
+  }
+}
+
+
+void ExportRGBRowScalar(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const int idx_red = is_bgr ? 2 : 0;
+  const int idx_blue = is_bgr ? 0 : 2;
+  for (int col = 0; col < width; ++col, src += 4, dst += pixel_stride) {
+    dst[idx_red] = src[0];
+    dst[1] = src[1];
+    dst[idx_blue] = src[2];
+  }
+}
+
+
+void ExportRGBARowScalar(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const uint32_t *reciprocals = UnpremultiplyTable();
+  const int idx_red = is_bgr ? 2 : 0;
+  const int idx_blue = is_bgr ? 0 : 2;
+  for (int col = 0; col < width; ++col, src += 4, dst += pixel_stride) {
+    const unsigned int alpha = src[3];
+    if (alpha == 255) {
+      dst[idx_red] = src[0];
+      dst[1] = src[1];
+      dst[idx_blue] = src[2];
+    } else {
+      const uint32_t reciprocal = reciprocals[alpha];
+      dst[idx_red] = UnpremultiplyChannel(src[0], reciprocal);
+      dst[1] = UnpremultiplyChannel(src[1], reciprocal);
+      dst[idx_blue] = UnpremultiplyChannel(src[2], reciprocal);
+    }
+    dst[3] = static_cast<uint8_t>(alpha);
+  }
+}
+
+
+#if VIREN2D_X86_SIMD
+// Similar to the import kernels, the vectorized export kernels require
+// tightly packed destination pixels.
+
+/// Computes the luminance of 4 RGBA pixels as 32-bit integers.
+VIREN2D_TARGET_SSSE3
+inline __m128i LuminanceSSSE3(const uint8_t *src, __m128i weights) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), weights);
+  const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), weights);
+  return _mm_srli_epi32(_mm_hadd_epi32(lo, hi), 15);
+}
+
+
+VIREN2D_TARGET_SSSE3
+void ExportGrayRowSSSE3(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m128i weights = _mm_setr_epi16(
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0,
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0);
+
+  int col = 0;
+  for (; col + 16 <= width; col += 16) {
+    const uint8_t *ptr = src + 4 * col;
+    const __m128i lum0 = _mm_packs_epi32(
+          LuminanceSSSE3(ptr, weights), LuminanceSSSE3(ptr + 16, weights));
+    const __m128i lum1 = _mm_packs_epi32(
+          LuminanceSSSE3(ptr + 32, weights), LuminanceSSSE3(ptr + 48, weights));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(dst + col), _mm_packus_epi16(lum0, lum1));
+  }
+  ExportGrayRowScalar(
+        src + 4 * col, dst + col, pixel_stride, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_SSSE3
+void ExportRGBRowSSSE3(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m128i mask = is_bgr
+      ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+      : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+  // Each 16-byte store writes 4 pixels (12 bytes) plus 4 bytes which will
+  // be overwritten by the next iteration. Thus, we must ensure that the
+  // stores don't exceed the row.
+  int col = 0;
+  for (; col + 6 <= width; col += 4) {
+    const __m128i rgba = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + 4 * col));
+    _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(dst + 3 * col),
+          _mm_shuffle_epi8(rgba, mask));
+  }
+  ExportRGBRowScalar(
+        src + 4 * col, dst + 3 * col, pixel_stride, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_SSSE3
+void ExportRGBARowSSSE3(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m128i swap = is_bgr
+      ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+      : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i color_bits = _mm_set1_epi32(0x00FFFFFF);
+  const __m128i all_set = _mm_set1_epi8(-1);
+
+  // Opaque pixels only need to be reordered. Reverting the premultiplication
+  // requires a division, so translucent pixels are handled by the scalar
+  // (lookup table-based) kernel.
+  int col = 0;
+  for (; col + 4 <= width; col += 4) {
+    const __m128i px = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + 4 * col));
+    const __m128i opaque = _mm_cmpeq_epi8(
+          _mm_or_si128(px, color_bits), all_set);
+    if (_mm_movemask_epi8(opaque) == 0xFFFF) {
+      _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(dst + 4 * col),
+            _mm_shuffle_epi8(px, swap));
+    } else {
+      ExportRGBARowScalar(src + 4 * col, dst + 4 * col, pixel_stride, 4, is_bgr);
+    }
+  }
+  ExportRGBARowScalar(
+        src + 4 * col, dst + 4 * col, pixel_stride, width - col, is_bgr);
+}
+
+
+/// Computes the luminance of 8 RGBA pixels as 32-bit integers.
+VIREN2D_TARGET_AVX2
+inline __m256i LuminanceAVX2(const uint8_t *src, __m256i weights) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+  const __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), weights);
+  const __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), weights);
+  return _mm256_srli_epi32(_mm256_hadd_epi32(lo, hi), 15);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ExportGrayRowAVX2(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m256i weights = _mm256_setr_epi16(
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0,
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0,
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0,
+        kGrayWeightRed, kGrayWeightGreen, kGrayWeightBlue, 0);
+  // The packing instructions operate per 128-bit lane, which
+  // interleaves the results. This permutation restores the pixel order:
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  int col = 0;
+  for (; col + 32 <= width; col += 32) {
+    const uint8_t *ptr = src + 4 * col;
+    const __m256i lum0 = _mm256_packs_epi32(
+          LuminanceAVX2(ptr, weights), LuminanceAVX2(ptr + 32, weights));
+    const __m256i lum1 = _mm256_packs_epi32(
+          LuminanceAVX2(ptr + 64, weights), LuminanceAVX2(ptr + 96, weights));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(dst + col),
+          _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lum0, lum1), order));
+  }
+  ExportGrayRowSSSE3(
+        src + 4 * col, dst + col, pixel_stride, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ExportRGBRowAVX2(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m256i mask = is_bgr
+      ? _mm256_setr_epi8(
+          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+      : _mm256_setr_epi8(
+          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  // Moves the 12 valid bytes of the upper lane next to the lower lane's:
+  const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+  // Each 32-byte store writes 8 pixels (24 bytes) plus 8 bytes which
+  // will be overwritten by the next iteration.
+  int col = 0;
+  for (; col + 11 <= width; col += 8) {
+    const __m256i rgba = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(src + 4 * col));
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(dst + 3 * col),
+          _mm256_permutevar8x32_epi32(
+            _mm256_shuffle_epi8(rgba, mask), compact));
+  }
+  ExportRGBRowSSSE3(
+        src + 4 * col, dst + 3 * col, pixel_stride, width - col, is_bgr);
+}
+
+
+VIREN2D_TARGET_AVX2
+void ExportRGBARowAVX2(
+    const uint8_t *src, uint8_t *dst, int pixel_stride, int width,
+    bool is_bgr) {
+  const __m256i swap = is_bgr
+      ? _mm256_setr_epi8(
+          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+      : _mm256_setr_epi8(
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i color_bits = _mm256_set1_epi32(0x00FFFFFF);
+  const __m256i all_set = _mm256_set1_epi8(-1);
+
+  int col = 0;
+  for (; col + 8 <= width; col += 8) {
+    const __m256i px = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(src + 4 * col));
+    const __m256i opaque = _mm256_cmpeq_epi8(
+          _mm256_or_si256(px, color_bits), all_set);
+    if (_mm256_movemask_epi8(opaque) == -1) {
+      _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dst + 4 * col),
+            _mm256_shuffle_epi8(px, swap));
+    } else {
+      ExportRGBARowScalar(src + 4 * col, dst + 4 * col, pixel_stride, 8, is_bgr);
+    }
+  }
+  ExportRGBARowSSSE3(
+        src + 4 * col, dst + 4 * col, pixel_stride, width - col, is_bgr);
+}
+#endif  // VIREN2D_X86_SIMD
+
+
+/// Returns the fastest export kernel which is supported by the CPU.
+ExportRowKernel SelectExportRowKernel(int channels, bool packed) {
+#if VIREN2D_X86_SIMD
+  if (packed && CPUSupportsAVX2()) {
+    switch (channels) {
+      case 1: return ExportGrayRowAVX2;
+      case 3: return ExportRGBRowAVX2;
+      case 4: return ExportRGBARowAVX2;
+    }
+  }
+
+  if (packed && CPUSupportsSSSE3()) {
+    switch (channels) {
+      case 1: return ExportGrayRowSSSE3;
+      case 3: return ExportRGBRowSSSE3;
+      case 4: return ExportRGBARowSSSE3;
+    }
+  }
+#else
+  (void)packed;
+#endif  // VIREN2D_X86_SIMD
+
+  switch (channels) {
+    case 1: return ExportGrayRowScalar;
+    case 3: return ExportRGBRowScalar;
+    case 4: return ExportRGBARowScalar;
+  }
+  return nullptr;
+}
+
+
+void ExportCanvasData(
+    unsigned char const *canvas, int canvas_stride,
+    ImageBuffer &image, bool is_bgr) {
+  if (!image.IsValid() || (image.BufferType() != ImageBufferType::UInt8)) {
+    std::ostringstream msg;
+    msg << "Canvas export requires a valid `uint8` ImageBuffer, but got: "
+        << image.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  const int channels = image.Channels();
+  const ExportRowKernel kernel = SelectExportRowKernel(
+        channels, image.PixelStride() == channels);
+  if (!kernel) {
+    std::ostringstream msg;
+    msg << "Canvas export supports only grayscale, RGB(A) or BGR(A) "
+           "images, but got: " << image.ToString() << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  uint8_t *dst = image.MutableData();
+  for (int row = 0; row < image.Height(); ++row) {
+    kernel(
+          canvas + row * canvas_stride, dst + row * image.RowStride(),
+          image.PixelStride(), image.Width(), is_bgr);
+  }
+}
+
+} // namespace helpers
+} // namespace viren2d
@@ -0,0 +1,59 @@
+#ifndef __VIREN2D_CANVAS_HELPERS_H__
+#define __VIREN2D_CANVAS_HELPERS_H__
+
+#include <viren2d/imagebuffer.h>
+
+
+namespace viren2d {
+namespace helpers {
+//---------------------------------------------------- Canvas import
+
+/// Copies an image into the memory of a Cairo ARGB32 image surface
+/// in a single pass.
+///
+/// Recall that viren2d interprets the surface memory as RGBA byte order,
+/// see `ApplyColor`. Grayscale and RGB images will be converted to opaque
+/// RGBA, BGR(A) images will be reordered on-the-fly and - as required
+/// by Cairo - the color components of translucent pixels will be
+/// premultiplied by their alpha value.
+///
+/// Args:
+///   canvas: The surface memory, *i.e.* `cairo_image_surface_get_data`.
+///   canvas_stride: Row stride of the surface memory in bytes.
+///   image: A `uint8` image with 1, 3 or 4 channels, which must have
+///     the same size as the surface (or as the surface region which
+///     starts at `canvas`, *e.g.* a dirty rectangle).
+///   is_bgr: Set to ``true`` if the color channels of the image are
+///     in BGR(A) order.
+void ImportCanvasData(
+    unsigned char *canvas, int canvas_stride,
+    const ImageBuffer &image, bool is_bgr);
+
+
+//---------------------------------------------------- Canvas export
+
+/// Copies the memory of a Cairo ARGB32 image surface into the given
+/// image in a single pass, *i.e.* the inverse of `ImportCanvasData`.
+///
+/// The output format is selected by the image's number of channels:
+/// 4-channel RGBA/BGRA outputs will be un-premultiplied (straight alpha).
+/// For 3-channel RGB/BGR and grayscale outputs, the alpha channel will be
+/// dropped, *i.e.* translucent pixels correspond to the canvas blended
+/// over black. Grayscale conversion uses the same weights as
+/// `ImageBuffer::ToChannels` (in fixed point arithmetic).
+///
+/// Args:
+///   canvas: The surface memory, *i.e.* `cairo_image_surface_get_data`.
+///   canvas_stride: Row stride of the surface memory in bytes.
+///   image: A valid `uint8` image with 1, 3 or 4 channels, which must
+///     have the same size as the surface (or as the surface region which
+///     starts at `canvas`). Its strides will be honored.
+///   is_bgr: Set to ``true`` to write the color channels in BGR(A) order.
+void ExportCanvasData(
+    unsigned char const *canvas, int canvas_stride,
+    ImageBuffer &image, bool is_bgr);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_CANVAS_HELPERS_H__
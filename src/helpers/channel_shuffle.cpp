@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <helpers/channel_shuffle.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Upper limit for the kernels of the ImageBuffer conversions.
+std::atomic<int> channel_shuffle_level{static_cast<int>(SimdLevel::AVX512)};
+
+//---------------------------------------------------- Scalar kernels
+
+template <typename _Tp>
+void ShuffleScalarImpl(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels) {
+  const _Tp *in = reinterpret_cast<const _Tp *>(src);
+  _Tp *out = reinterpret_cast<_Tp *>(dst);
+  _Tp fill;
+  std::memcpy(&fill, layout.fill_element, sizeof(_Tp));
+
+  // The input pixel is copied first, to support in-place shuffles.
+  _Tp px[kMaxShuffleChannels];
+  for (int idx = 0; idx < num_pixels; ++idx) {
+    for (int ch = 0; ch < layout.src_channels; ++ch) {
+      px[ch] = in[ch];
+    }
+    for (int ch = 0; ch < layout.dst_channels; ++ch) {
+      const int src_ch = layout.channel_map[ch];
+      out[ch] = (src_ch < 0) ? fill : px[src_ch];
+    }
+    in += layout.src_channels;
+    out += layout.dst_channels;
+  }
+}
+
+
+void ShuffleScalar(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels) {
+  switch (layout.element_size) {
+    case 1:
+      ShuffleScalarImpl<uint8_t>(layout, src, dst, num_pixels);
+      return;
+
+    case 2:
+      ShuffleScalarImpl<uint16_t>(layout, src, dst, num_pixels);
+      return;
+
+    case 4:
+      ShuffleScalarImpl<uint32_t>(layout, src, dst, num_pixels);
+      return;
+
+    case 8:
+      ShuffleScalarImpl<uint64_t>(layout, src, dst, num_pixels);
+      return;
+  }
+}
+
+
+#if VIREN2D_X86_SIMD
+//---------------------------------------------------- SSSE3 kernels
+
+/// Processes the output vectors of consecutive windows, starting at the
+/// given vector index, as long as neither the input nor the output would
+/// be accessed out of bounds. Returns the number of completed pixels.
+///
+/// Vectors of the same window are written in increasing order. If a
+/// window's output doesn't fill complete vectors, the bytes behind it
+/// will be overwritten by the next window (or the scalar kernel).
+VIREN2D_TARGET_SSSE3
+int ShuffleVectorsSSSE3(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels,
+    std::size_t first_vector) {
+  const std::size_t num_vectors = layout.vectors_per_window;
+  const std::size_t window_src = static_cast<std::size_t>(
+        layout.window_pixels) * layout.src_pixel_size;
+  const std::size_t window_dst = static_cast<std::size_t>(
+        layout.window_pixels) * layout.dst_pixel_size;
+  const std::size_t src_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.src_pixel_size;
+  const std::size_t dst_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.dst_pixel_size;
+
+  __m128i masks[4];
+  __m128i fills[4];
+  for (std::size_t vec = 0; vec < num_vectors; ++vec) {
+    masks[vec] = _mm_load_si128(
+          reinterpret_cast<const __m128i*>(layout.masks[vec]));
+    fills[vec] = _mm_load_si128(
+          reinterpret_cast<const __m128i*>(layout.fills[vec]));
+  }
+
+  std::size_t window = first_vector / num_vectors;
+  std::size_t vec = first_vector % num_vectors;
+  for (; window * window_src + 16 <= src_bytes; ++window, vec = 0) {
+    const __m128i in = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(src + window * window_src));
+    unsigned char *out = dst + window * window_dst;
+    for (; vec < num_vectors; ++vec) {
+      if (16 * (vec + 1) > dst_bytes - window * window_dst) {
+        return static_cast<int>(window * layout.window_pixels);
+      }
+      _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + 16 * vec),
+            _mm_or_si128(_mm_shuffle_epi8(in, masks[vec]), fills[vec]));
+    }
+  }
+  return static_cast<int>(window * layout.window_pixels);
+}
+
+
+void ShuffleSSSE3(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels) {
+  const int done = ShuffleVectorsSSSE3(layout, src, dst, num_pixels, 0);
+  ShuffleScalar(
+        layout, src + done * layout.src_pixel_size,
+        dst + done * layout.dst_pixel_size, num_pixels - done);
+}
+
+
+//---------------------------------------------------- AVX2 kernels
+
+/// Requires that each window fills complete output vectors, *i.e.* output
+/// vector `v` is located at byte offset `16 * v`. Each 128-bit lane
+/// computes one of these vectors from its own window.
+VIREN2D_TARGET_AVX2
+void ShuffleAVX2(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels) {
+  const std::size_t num_vectors = layout.vectors_per_window;
+  const std::size_t window_src = static_cast<std::size_t>(
+        layout.window_pixels) * layout.src_pixel_size;
+  const std::size_t src_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.src_pixel_size;
+  const std::size_t dst_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.dst_pixel_size;
+
+  std::size_t vec = 0;
+  for (; ((vec + 1) / num_vectors) * window_src + 16 <= src_bytes
+         && 16 * (vec + 2) <= dst_bytes; vec += 2) {
+    const std::size_t v0 = vec % num_vectors;
+    const std::size_t v1 = (vec + 1) % num_vectors;
+    const __m256i in = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(
+                src + (vec / num_vectors) * window_src))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+              src + ((vec + 1) / num_vectors) * window_src)), 1);
+    const __m256i mask = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_load_si128(
+              reinterpret_cast<const __m128i*>(layout.masks[v0]))),
+          _mm_load_si128(
+              reinterpret_cast<const __m128i*>(layout.masks[v1])), 1);
+    const __m256i fill = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_load_si128(
+              reinterpret_cast<const __m128i*>(layout.fills[v0]))),
+          _mm_load_si128(
+              reinterpret_cast<const __m128i*>(layout.fills[v1])), 1);
+    _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(dst + 16 * vec),
+          _mm256_or_si256(_mm256_shuffle_epi8(in, mask), fill));
+  }
+
+  const int done = ShuffleVectorsSSSE3(layout, src, dst, num_pixels, vec);
+  ShuffleScalar(
+        layout, src + done * layout.src_pixel_size,
+        dst + done * layout.dst_pixel_size, num_pixels - done);
+}
+
+
+//---------------------------------------------------- AVX-512 kernels
+
+/// Same as `ShuffleAVX2`, but with 4 lanes.
+VIREN2D_TARGET_AVX512
+void ShuffleAVX512(
+    const ChannelShuffle::Layout &layout,
+    const unsigned char *src, unsigned char *dst, int num_pixels) {
+  const std::size_t num_vectors = layout.vectors_per_window;
+  const std::size_t window_src = static_cast<std::size_t>(
+        layout.window_pixels) * layout.src_pixel_size;
+  const std::size_t src_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.src_pixel_size;
+  const std::size_t dst_bytes = static_cast<std::size_t>(
+        num_pixels) * layout.dst_pixel_size;
+
+  std::size_t vec = 0;
+  for (; ((vec + 3) / num_vectors) * window_src + 16 <= src_bytes
+         && 16 * (vec + 4) <= dst_bytes; vec += 4) {
+    __m512i in = _mm512_castsi128_si512(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(
+            src + (vec / num_vectors) * window_src)));
+    __m512i mask = _mm512_castsi128_si512(_mm_load_si128(
+          reinterpret_cast<const __m128i*>(layout.masks[vec % num_vectors])));
+    __m512i fill = _mm512_castsi128_si512(_mm_load_si128(
+          reinterpret_cast<const __m128i*>(layout.fills[vec % num_vectors])));
+    // The lane index of the insert intrinsics must be a constant
+#define VIREN2D_INSERT_LANE(lane) \
+    in = _mm512_inserti32x4(in, _mm_loadu_si128( \
+          reinterpret_cast<const __m128i*>( \
+            src + ((vec + lane) / num_vectors) * window_src)), lane); \
+    mask = _mm512_inserti32x4(mask, _mm_load_si128( \
+          reinterpret_cast<const __m128i*>( \
+            layout.masks[(vec + lane) % num_vectors])), lane); \
+    fill = _mm512_inserti32x4(fill, _mm_load_si128( \
+          reinterpret_cast<const __m128i*>( \
+            layout.fills[(vec + lane) % num_vectors])), lane)
+    VIREN2D_INSERT_LANE(1);
+    VIREN2D_INSERT_LANE(2);
+    VIREN2D_INSERT_LANE(3);
+#undef VIREN2D_INSERT_LANE
+    _mm512_storeu_si512(
+          reinterpret_cast<void*>(dst + 16 * vec),
+          _mm512_or_si512(_mm512_shuffle_epi8(in, mask), fill));
+  }
+
+  const int done = ShuffleVectorsSSSE3(layout, src, dst, num_pixels, vec);
+  ShuffleScalar(
+        layout, src + done * layout.src_pixel_size,
+        dst + done * layout.dst_pixel_size, num_pixels - done);
+}
+#endif  // VIREN2D_X86_SIMD
+
+
+/// Sets up the byte permutation of the SIMD kernels. A window contains as
+/// many pixels as fit into 16 input bytes and 4 output vectors. If
+/// possible, the window size is chosen such that its output fills complete
+/// vectors (which is required by the AVX2/AVX-512 kernels).
+void InitializeWindows(ChannelShuffle::Layout &layout) {
+  layout.window_pixels = 0;
+  layout.vectors_per_window = 0;
+  if ((layout.src_pixel_size > 16) || (layout.dst_pixel_size > 64)) {
+    return;
+  }
+
+  int max_pixels = 16 / layout.src_pixel_size;
+  while ((max_pixels * layout.dst_pixel_size) > 64) {
+    --max_pixels;
+  }
+
+  int pixels = max_pixels;
+  for (int num = max_pixels; num > 0; --num) {
+    if (((num * layout.dst_pixel_size) % 16) == 0) {
+      pixels = num;
+      break;
+    }
+  }
+
+  const int window_dst = pixels * layout.dst_pixel_size;
+  layout.window_pixels = pixels;
+  layout.vectors_per_window = (window_dst + 15) / 16;
+
+  const bool same_size = (layout.src_pixel_size == layout.dst_pixel_size);
+  for (int vec = 0; vec < 4; ++vec) {
+    for (int idx = 0; idx < 16; ++idx) {
+      const int offset = 16 * vec + idx;
+      // Bytes behind the window's output. If the pixel sizes are the same,
+      // these keep their value, which is required for in-place shuffles.
+      uint8_t mask = (same_size && (offset < 16))
+          ? static_cast<uint8_t>(offset) : 0x80;
+      uint8_t fill = 0;
+      if (offset < window_dst) {
+        const int pixel = offset / layout.dst_pixel_size;
+        const int byte = offset % layout.dst_pixel_size;
+        const int src_ch = layout.channel_map[byte / layout.element_size];
+        if (src_ch < 0) {
+          mask = 0x80;
+          fill = layout.fill_element[byte % layout.element_size];
+        } else {
+          mask = static_cast<uint8_t>(
+                pixel * layout.src_pixel_size
+                + src_ch * layout.element_size
+                + (byte % layout.element_size));
+        }
+      }
+      layout.masks[vec][idx] = mask;
+      layout.fills[vec][idx] = fill;
+    }
+  }
+}
+} // anonymous namespace
+
+
+ChannelShuffle::ChannelShuffle(
+    int element_size, int src_channels, int dst_channels,
+    const int *map, const void *fill, SimdLevel max_level) {
+  if ((element_size != 1) && (element_size != 2)
+      && (element_size != 4) && (element_size != 8)) {
+    std::ostringstream msg;
+    msg << "`ChannelShuffle` supports element sizes of 1, 2, 4 or 8 bytes, "
+           "but got " << element_size << '!';
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  if ((src_channels < 1) || (src_channels > kMaxShuffleChannels)
+      || (dst_channels < 1) || (dst_channels > kMaxShuffleChannels)) {
+    std::ostringstream msg;
+    msg << "`ChannelShuffle` supports 1 to " << kMaxShuffleChannels
+        << " channels, but got " << src_channels << " input and "
+        << dst_channels << " output channels!";
+    SPDLOG_ERROR(msg.str());
+    throw std::invalid_argument(msg.str());
+  }
+
+  layout_.element_size = element_size;
+  layout_.src_channels = src_channels;
+  layout_.dst_channels = dst_channels;
+  layout_.src_pixel_size = element_size * src_channels;
+  layout_.dst_pixel_size = element_size * dst_channels;
+  std::memset(layout_.fill_element, 0, sizeof(layout_.fill_element));
+  for (int ch = 0; ch < dst_channels; ++ch) {
+    if (map[ch] >= src_channels) {
+      std::ostringstream msg;
+      msg << "`ChannelShuffle` cannot copy input channel " << map[ch]
+          << " of a " << src_channels << "-channel pixel!";
+      SPDLOG_ERROR(msg.str());
+      throw std::invalid_argument(msg.str());
+    }
+    layout_.channel_map[ch] = std::max(-1, map[ch]);
+    if ((map[ch] < 0) && !fill) {
+      const std::string msg("`ChannelShuffle` requires a fill value!");
+      SPDLOG_ERROR(msg);
+      throw std::invalid_argument(msg);
+    }
+  }
+  if (fill) {
+    std::memcpy(layout_.fill_element, fill, element_size);
+  }
+  InitializeWindows(layout_);
+
+  const SimdLevel level = std::min(max_level, SupportedSimdLevel());
+  const bool simd = (layout_.window_pixels > 0);
+  const bool complete_vectors = simd
+      && (((layout_.window_pixels * layout_.dst_pixel_size) % 16) == 0);
+  kernel_ = ShuffleScalar;
+  level_ = SimdLevel::Scalar;
+#if VIREN2D_X86_SIMD
+  if (complete_vectors && (level >= SimdLevel::AVX512)) {
+    kernel_ = ShuffleAVX512;
+    level_ = SimdLevel::AVX512;
+  } else if (complete_vectors && (level >= SimdLevel::AVX2)) {
+    kernel_ = ShuffleAVX2;
+    level_ = SimdLevel::AVX2;
+  } else if (simd && (level >= SimdLevel::SSSE3)) {
+    kernel_ = ShuffleSSSE3;
+    level_ = SimdLevel::SSSE3;
+  }
+#else
+  (void)level;
+  (void)complete_vectors;
+#endif  // VIREN2D_X86_SIMD
+}
+
+
+void ChannelShuffle::Run(
+    const unsigned char *src, unsigned char *dst, int num_pixels) const {
+  if (num_pixels > 0) {
+    kernel_(layout_, src, dst, num_pixels);
+  }
+}
+
+
+void SetChannelShuffleLevel(SimdLevel level) {
+  channel_shuffle_level = static_cast<int>(level);
+}
+
+
+SimdLevel ChannelShuffleLevel() {
+  return std::min(
+        static_cast<SimdLevel>(channel_shuffle_level.load()),
+        SupportedSimdLevel());
+}
+
+} // namespace helpers
+} // namespace viren2d
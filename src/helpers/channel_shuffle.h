@@ -0,0 +1,107 @@
+#ifndef __VIREN2D_CHANNEL_SHUFFLE_H__
+#define __VIREN2D_CHANNEL_SHUFFLE_H__
+
+#include <cstdint>
+
+#include <helpers/cpu_features.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Maximum number of channels of a `ChannelShuffle`.
+constexpr int kMaxShuffleChannels = 4;
+
+
+/// Maximum size of an element (*i.e.* a single channel value) in bytes.
+constexpr int kMaxShuffleElementSize = 8;
+
+
+/// Copies and reorders the channels of packed pixels, *e.g.* to convert
+/// grayscale to RGB(A), RGB to RGBA (and vice versa), to extract a single
+/// channel or to swap two channels.
+///
+/// Each output channel `ch` is copied from input channel `map[ch]`, or set
+/// to the `fill` value if `map[ch]` is negative. The pixels must be packed,
+/// *i.e.* `PixelStride() == Channels() * ElementSize()`.
+///
+/// The conversion is a byte permutation, which is performed by the best
+/// SIMD kernel the CPU supports (selected at runtime):
+/// * SSSE3 shuffles a 16 byte window of input pixels per output vector.
+/// * AVX2 and AVX-512 process 2 and 4 such windows at once. These are
+///   only used if the output of a window fills complete vectors (*e.g.*
+///   gray to RGB(A), RGB to RGBA, swapping the channels of RGBA). Otherwise,
+///   the vectors of subsequent windows overlap and the SSSE3 kernel is used.
+/// * The scalar kernel processes the remaining pixels and serves as the
+///   portable fallback.
+class ChannelShuffle {
+public:
+  /// Args:
+  ///   element_size: Size of a single channel value in bytes.
+  ///   src_channels: Number of input channels.
+  ///   dst_channels: Number of output channels.
+  ///   map: Input channel index for each output channel (negative to
+  ///     use the `fill` value).
+  ///   fill: Pointer to the fill value (`element_size` bytes), may be
+  ///     nullptr if no output channel requires it.
+  ///   max_level: Most capable instruction set which should be used.
+  ChannelShuffle(
+      int element_size, int src_channels, int dst_channels,
+      const int *map, const void *fill,
+      SimdLevel max_level = SimdLevel::AVX512);
+
+  /// Converts `num_pixels` packed pixels. If the number of input and
+  /// output channels is the same, `src` may be equal to `dst`, *i.e.* the
+  /// shuffle can be performed in-place.
+  void Run(const unsigned char *src, unsigned char *dst, int num_pixels) const;
+
+  /// Returns the instruction set of the selected kernel.
+  SimdLevel Level() const { return level_; }
+
+  /// Layout of the permutation, shared with the kernels.
+  struct Layout {
+    int element_size;
+    int src_channels;
+    int dst_channels;
+    int channel_map[kMaxShuffleChannels];
+    uint8_t fill_element[kMaxShuffleElementSize];
+
+    /// Bytes per input and output pixel.
+    int src_pixel_size;
+    int dst_pixel_size;
+
+    /// Number of pixels per 16 byte input window (0 if the SIMD kernels
+    /// can't be used) and number of 16 byte output vectors per window.
+    int window_pixels;
+    int vectors_per_window;
+
+    /// Shuffle control and fill values for each output vector of a window.
+    alignas(16) uint8_t masks[4][16];
+    alignas(16) uint8_t fills[4][16];
+  };
+
+private:
+  typedef void (*Kernel)(
+      const Layout &layout, const unsigned char *src, unsigned char *dst,
+      int num_pixels);
+
+  Layout layout_;
+  Kernel kernel_;
+  SimdLevel level_;
+};
+
+
+/// Limits the instruction set of the `ChannelShuffle` kernels which are
+/// used by the ImageBuffer conversions. Levels which the CPU doesn't
+/// support will be ignored. This is mostly useful for testing & benchmarks.
+void SetChannelShuffleLevel(SimdLevel level);
+
+
+/// Returns the instruction set which ImageBuffer conversions may use,
+/// *i.e.* the lower of `SetChannelShuffleLevel` and `SupportedSimdLevel`.
+SimdLevel ChannelShuffleLevel();
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_CHANNEL_SHUFFLE_H__
@@ -0,0 +1,83 @@
+#ifndef __VIREN2D_CPU_FEATURES_H__
+#define __VIREN2D_CPU_FEATURES_H__
+
+// SIMD kernels are compiled via function-level target attributes. Thus, the
+// library doesn't need any architecture-specific compiler flags and we can
+// select the best available kernel at runtime.
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#  define VIREN2D_X86_SIMD 1
+#  define VIREN2D_TARGET_SSSE3 __attribute__((target("ssse3")))
+#  define VIREN2D_TARGET_AVX2 __attribute__((target("avx2")))
+#  define VIREN2D_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#  include <immintrin.h>
+#else
+#  define VIREN2D_X86_SIMD 0
+#endif
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Returns true if the CPU supports SSSE3 (*i.e.* byte shuffles).
+inline bool CPUSupportsSSSE3() {
+#if VIREN2D_X86_SIMD
+  static const bool supported = __builtin_cpu_supports("ssse3");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+
+/// Returns true if the CPU supports AVX2.
+inline bool CPUSupportsAVX2() {
+#if VIREN2D_X86_SIMD
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+
+/// Returns true if the CPU supports AVX-512 including the byte and word
+/// instructions (AVX512F and AVX512BW).
+inline bool CPUSupportsAVX512() {
+#if VIREN2D_X86_SIMD
+  static const bool supported = __builtin_cpu_supports("avx512f")
+      && __builtin_cpu_supports("avx512bw");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+
+/// Instruction set extensions of the SIMD kernels, in increasing order.
+enum class SimdLevel : int {
+  Scalar = 0,
+  SSSE3,
+  AVX2,
+  AVX512
+};
+
+
+/// Returns the most capable `SimdLevel` which is supported by the CPU.
+inline SimdLevel SupportedSimdLevel() {
+  if (CPUSupportsAVX512()) {
+    return SimdLevel::AVX512;
+  }
+  if (CPUSupportsAVX2()) {
+    return SimdLevel::AVX2;
+  }
+  if (CPUSupportsSSSE3()) {
+    return SimdLevel::SSSE3;
+  }
+  return SimdLevel::Scalar;
+}
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_CPU_FEATURES_H__
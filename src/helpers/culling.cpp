@@ -0,0 +1,173 @@
+#include <cmath>
+#include <limits>
+
+#include <helpers/culling.h>
+#include <helpers/dirty_region.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Key to store the culling counter as user data of a Cairo context.
+inline const cairo_user_data_key_t *CullingCounterKey() {
+  static const cairo_user_data_key_t key{};
+  return &key;
+}
+
+
+/// Key to store the counting region as user data of a Cairo context.
+inline const cairo_user_data_key_t *CullingRegionKey() {
+  static const cairo_user_data_key_t key{};
+  return &key;
+}
+
+
+/// Size of the canvas, see `SetCullingRegion`.
+struct CullingRegion {
+  int width;
+  int height;
+};
+} // anonymous namespace
+
+
+Viewport::Viewport(cairo_t *context) {
+  if (!context) {
+    return;
+  }
+  cairo_clip_extents(context, &left, &top, &right, &bottom);
+
+  const auto *region = static_cast<const CullingRegion *>(
+        cairo_get_user_data(context, CullingRegionKey()));
+  if (region) {
+    // Bounding box of the canvas in user space, the same as the clip
+    // extents of an unclipped canvas context:
+    has_counting_region = true;
+    counting_left = std::numeric_limits<double>::infinity();
+    counting_top = counting_left;
+    counting_right = -counting_left;
+    counting_bottom = -counting_left;
+    for (int corner = 0; corner < 4; ++corner) {
+      double x = (corner % 2) ? region->width : 0.0;
+      double y = (corner / 2) ? region->height : 0.0;
+      cairo_device_to_user(context, &x, &y);
+      counting_left = std::min(counting_left, x);
+      counting_top = std::min(counting_top, y);
+      counting_right = std::max(counting_right, x);
+      counting_bottom = std::max(counting_bottom, y);
+    }
+  }
+}
+
+
+Viewport Viewport::Counting() const {
+  Viewport counting(*this);
+  if (has_counting_region) {
+    counting.left = counting_left;
+    counting.top = counting_top;
+    counting.right = counting_right;
+    counting.bottom = counting_bottom;
+    counting.has_counting_region = false;
+  }
+  return counting;
+}
+
+
+void SetCullingCounter(cairo_t *context, std::atomic<std::size_t> *counter) {
+  if (context) {
+    cairo_set_user_data(context, CullingCounterKey(), counter, nullptr);
+  }
+}
+
+
+void SetCullingRegion(cairo_t *context, int width, int height) {
+  if (context) {
+    cairo_set_user_data(
+          context, CullingRegionKey(), new CullingRegion{width, height},
+          [](void *region) { delete static_cast<CullingRegion *>(region); });
+  }
+}
+
+
+void CountCulled(cairo_t *context, std::size_t num_primitives) {
+  if (!context || (num_primitives == 0)) {
+    return;
+  }
+
+  auto *counter = static_cast<std::atomic<std::size_t> *>(
+        cairo_get_user_data(context, CullingCounterKey()));
+  if (counter) {
+    counter->fetch_add(num_primitives, std::memory_order_relaxed);
+  }
+}
+
+
+bool IsOutsideViewport(
+    cairo_t *context, double left, double top, double right, double bottom) {
+  if (!context) {
+    return false;
+  }
+
+  const Viewport viewport(context);
+  if (viewport.Intersects(left, top, right, bottom)) {
+    MarkDirty(context, left, top, right, bottom);
+    return false;
+  }
+
+  if (!viewport.HasCountingRegion()
+      || !viewport.Counting().Intersects(left, top, right, bottom)) {
+    CountCulled(context);
+  }
+  return true;
+}
+
+
+bool IsOutsideViewport(
+    cairo_t *context, const Vec2d *points, std::size_t num_points,
+    double margin) {
+  double left = std::numeric_limits<double>::infinity();
+  double top = left;
+  double right = -left;
+  double bottom = -left;
+  for (std::size_t idx = 0; idx < num_points; ++idx) {
+    const Vec2d &pt = points[idx];
+    // Don't cull anything Cairo would have to deal with:
+    if (!std::isfinite(pt.X()) || !std::isfinite(pt.Y())) {
+      MarkClipDirty(context);
+      return false;
+    }
+    left = std::min(left, pt.X());
+    right = std::max(right, pt.X());
+    top = std::min(top, pt.Y());
+    bottom = std::max(bottom, pt.Y());
+  }
+
+  if (num_points == 0) {
+    return false;
+  }
+  return IsOutsideViewport(
+        context, left - margin, top - margin, right + margin, bottom + margin);
+}
+
+
+std::vector<std::pair<std::size_t, std::size_t>> VisiblePolylineRuns(
+    const Viewport &viewport, const Vec2d *points, std::size_t num_points,
+    double margin) {
+  std::vector<std::pair<std::size_t, std::size_t>> runs;
+  bool in_run = false;
+  for (std::size_t idx = 1; idx < num_points; ++idx) {
+    if (viewport.Intersects(points[idx - 1], points[idx], margin)) {
+      if (in_run) {
+        runs.back().second = idx;
+      } else {
+        runs.push_back(std::make_pair(idx - 1, idx));
+        in_run = true;
+      }
+    } else {
+      in_run = false;
+    }
+  }
+  return runs;
+}
+
+} // namespace helpers
+} // namespace viren2d
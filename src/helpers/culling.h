@@ -0,0 +1,178 @@
+#ifndef __VIREN2D_CULLING_H__
+#define __VIREN2D_CULLING_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/primitives.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Margin around a stroked path which covers the line width, miter
+/// joins (up to Cairo's default miter limit of 10) and anti-aliasing.
+inline double StrokeMargin(double line_width) {
+  return 5.0 * std::max(0.0, line_width) + 2.0;
+}
+
+
+/// The visible region of a context, *i.e.* the bounding box of its clip
+/// region (which is always limited to the canvas) in user space.
+struct Viewport {
+  double left = 0.0;
+  double top = 0.0;
+  double right = 0.0;
+  double bottom = 0.0;
+
+  /// Queries the clip extents of the given context. Since these are
+  /// given in the context's current user space, the viewport will also
+  /// be correct (but less tight) for transformed contexts.
+  explicit Viewport(cairo_t *context);
+
+
+  /// Returns the region against which culled primitives are counted,
+  /// see `SetCullingRegion`. This is the viewport itself, unless the
+  /// context renders only a tile of the canvas.
+  Viewport Counting() const;
+
+
+  /// Returns true if culled primitives are counted against a larger
+  /// region than this viewport, see `Counting`.
+  bool HasCountingRegion() const { return has_counting_region; }
+
+
+  /// Returns false if the axis-aligned box can be proven to lie
+  /// completely outside the viewport. Non-finite coordinates are
+  /// considered visible, *i.e.* they will be passed on to Cairo.
+  bool Intersects(double l, double t, double r, double b) const {
+    return !((r < left) || (l > right) || (b < top) || (t > bottom));
+  }
+
+
+  /// Returns false if the square of the given half size around the
+  /// point lies outside the viewport.
+  bool Intersects(const Vec2d &center, double margin) const {
+    return Intersects(
+          center.X() - margin, center.Y() - margin,
+          center.X() + margin, center.Y() + margin);
+  }
+
+
+  /// Returns false if the bounding box of the line segment, enlarged
+  /// by the margin, lies outside the viewport.
+  bool Intersects(const Vec2d &from, const Vec2d &to, double margin) const {
+    return Intersects(
+          std::min(from.X(), to.X()) - margin,
+          std::min(from.Y(), to.Y()) - margin,
+          std::max(from.X(), to.X()) + margin,
+          std::max(from.Y(), to.Y()) + margin);
+  }
+
+private:
+  /// The counting region in user space, see `SetCullingRegion`.
+  bool has_counting_region = false;
+  double counting_left = 0.0;
+  double counting_top = 0.0;
+  double counting_right = 0.0;
+  double counting_bottom = 0.0;
+};
+
+
+/// Attaches the counter of culled primitives to the context, *i.e.*
+/// all subsequent `CountCulled` calls for this context will increment
+/// the given counter. The counter must outlive the context (or be
+/// replaced by calling this function again).
+void SetCullingCounter(cairo_t *context, std::atomic<std::size_t> *counter);
+
+
+/// Restricts counting culled primitives to those which lie outside the
+/// given region (in device space), *i.e.* the full canvas. This is needed
+/// if the context is clipped to a tile of the canvas, such that tiles
+/// report the same primitives as rendering the whole canvas at once.
+void SetCullingRegion(cairo_t *context, int width, int height);
+
+
+/// Adds the given number of culled primitives to the context's counter,
+/// see `SetCullingCounter`.
+void CountCulled(cairo_t *context, std::size_t num_primitives = 1);
+
+
+/// Returns true if the axis-aligned box (in user space) lies completely
+/// outside the context's clip region. Then, the primitive will be
+/// counted as culled (if it also lies outside the counting region, see
+/// `SetCullingRegion`) and the caller should skip it. Otherwise, the box
+/// will be added to the context's dirty region, see `MarkDirty`.
+bool IsOutsideViewport(
+    cairo_t *context, double left, double top, double right, double bottom);
+
+
+/// Returns true if the square of the given half size around the point
+/// lies completely outside the context's clip region, see above.
+inline bool IsOutsideViewport(
+    cairo_t *context, const Vec2d &center, double margin) {
+  return IsOutsideViewport(
+        context, center.X() - margin, center.Y() - margin,
+        center.X() + margin, center.Y() + margin);
+}
+
+
+/// Returns true if the bounding box of the line segment, enlarged by
+/// the margin, lies completely outside the context's clip region, see above.
+inline bool IsOutsideViewport(
+    cairo_t *context, const Vec2d &from, const Vec2d &to, double margin) {
+  return IsOutsideViewport(
+        context,
+        std::min(from.X(), to.X()) - margin,
+        std::min(from.Y(), to.Y()) - margin,
+        std::max(from.X(), to.X()) + margin,
+        std::max(from.Y(), to.Y()) + margin);
+}
+
+
+/// Returns true if the bounding box of the points, enlarged by the
+/// margin, lies completely outside the context's clip region, see above.
+bool IsOutsideViewport(
+    cairo_t *context, const Vec2d *points, std::size_t num_points,
+    double margin);
+
+
+/// Returns true if the bounding box of the points, enlarged by the
+/// margin, lies completely outside the context's clip region, see above.
+inline bool IsOutsideViewport(
+    cairo_t *context, const std::vector<Vec2d> &points, double margin) {
+  return IsOutsideViewport(context, points.data(), points.size(), margin);
+}
+
+
+/// Splits the polyline into its visible runs, *i.e.* the maximal
+/// sequences of consecutive segments whose bounding box, enlarged by
+/// the margin, intersects the viewport. Each run is given as the
+/// indices of its first and last point.
+///
+/// Stroking only these runs yields the same pixels as stroking the full
+/// polyline as long as the margin covers the line width, joins and caps
+/// (see `StrokeMargin`) and no dash pattern is used: Each point at which
+/// a run is cut also belongs to an invisible segment and thus lies
+/// outside the viewport by at least the margin.
+std::vector<std::pair<std::size_t, std::size_t>> VisiblePolylineRuns(
+    const Viewport &viewport, const Vec2d *points, std::size_t num_points,
+    double margin);
+
+
+/// Splits the polyline into its visible runs, see above.
+inline std::vector<std::pair<std::size_t, std::size_t>> VisiblePolylineRuns(
+    const Viewport &viewport, const std::vector<Vec2d> &points,
+    double margin) {
+  return VisiblePolylineRuns(viewport, points.data(), points.size(), margin);
+}
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_CULLING_H__
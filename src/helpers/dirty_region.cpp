@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cmath>
+
+#include <helpers/dirty_region.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Key to store the dirty region as user data of a Cairo context.
+inline const cairo_user_data_key_t *DirtyRegionKey() {
+  static const cairo_user_data_key_t key{};
+  return &key;
+}
+
+
+/// Returns the number of pixels which the union of both boxes covers
+/// in addition to the boxes themselves (overlaps are counted twice).
+inline double WastedArea(const PixelBox &a, const PixelBox &b) {
+  return a.Union(b).Area() - a.Area() - b.Area();
+}
+} // anonymous namespace
+
+
+PixelBox PixelBox::Union(const PixelBox &other) const {
+  PixelBox box;
+  box.left = std::min(left, other.left);
+  box.top = std::min(top, other.top);
+  box.right = std::max(right, other.right);
+  box.bottom = std::max(bottom, other.bottom);
+  return box;
+}
+
+
+DirtyRegion::DirtyRegion(std::size_t max_boxes)
+  : max_boxes_(std::max<std::size_t>(1, max_boxes)) {
+  boxes_.reserve(max_boxes_ + 1);
+}
+
+
+void DirtyRegion::Add(const PixelBox &box) {
+  if (box.IsEmpty()) {
+    return;
+  }
+
+  // Absorb all boxes which can be merged for free. Since the merged box
+  // grows, we have to check the previously visited boxes again.
+  PixelBox merged(box);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t idx = 0; idx < boxes_.size(); ++idx) {
+      if (WastedArea(boxes_[idx], merged) <= 0.0) {
+        merged = merged.Union(boxes_[idx]);
+        boxes_[idx] = boxes_.back();
+        boxes_.pop_back();
+        changed = true;
+        break;
+      }
+    }
+  }
+
+  boxes_.push_back(merged);
+  if (boxes_.size() > max_boxes_) {
+    MergeCheapestPair();
+  }
+}
+
+
+void DirtyRegion::Add(const DirtyRegion &other) {
+  for (const PixelBox &box : other.boxes_) {
+    Add(box);
+  }
+}
+
+
+void DirtyRegion::MergeCheapestPair() {
+  std::size_t best_a = 0;
+  std::size_t best_b = 1;
+  double best_waste = std::numeric_limits<double>::infinity();
+  for (std::size_t a = 0; a < boxes_.size(); ++a) {
+    for (std::size_t b = a + 1; b < boxes_.size(); ++b) {
+      const double waste = WastedArea(boxes_[a], boxes_[b]);
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_a = a;
+        best_b = b;
+      }
+    }
+  }
+
+  const PixelBox merged = boxes_[best_a].Union(boxes_[best_b]);
+  boxes_[best_b] = boxes_.back();
+  boxes_.pop_back();
+  boxes_[best_a] = merged;
+}
+
+
+void UserBounds::Add(double l, double t, double r, double b) {
+  left = std::min(left, l);
+  top = std::min(top, t);
+  right = std::max(right, r);
+  bottom = std::max(bottom, b);
+}
+
+
+void UserBounds::Add(const Vec2d &from, const Vec2d &to, double margin) {
+  Add(std::min(from.X(), to.X()) - margin,
+      std::min(from.Y(), to.Y()) - margin,
+      std::max(from.X(), to.X()) + margin,
+      std::max(from.Y(), to.Y()) + margin);
+}
+
+
+void SetDirtyRegion(cairo_t *context, DirtyRegion *region) {
+  if (context) {
+    cairo_set_user_data(context, DirtyRegionKey(), region, nullptr);
+  }
+}
+
+
+void MarkDirty(
+    cairo_t *context, double left, double top, double right, double bottom) {
+  if (!context) {
+    return;
+  }
+
+  auto *region = static_cast<DirtyRegion *>(
+        cairo_get_user_data(context, DirtyRegionKey()));
+  if (!region) {
+    return;
+  }
+
+  // Limit the box to the visible region (in user space). Non-finite
+  // coordinates (which Cairo has to deal with) could touch any pixel.
+  double clip_left, clip_top, clip_right, clip_bottom;
+  cairo_clip_extents(context, &clip_left, &clip_top, &clip_right, &clip_bottom);
+  if (std::isfinite(left) && std::isfinite(top)
+      && std::isfinite(right) && std::isfinite(bottom)) {
+    clip_left = std::max(clip_left, left);
+    clip_top = std::max(clip_top, top);
+    clip_right = std::min(clip_right, right);
+    clip_bottom = std::min(clip_bottom, bottom);
+    if ((clip_right < clip_left) || (clip_bottom < clip_top)) {
+      return;
+    }
+  }
+
+  // The device-space bounding box of all four corners also covers
+  // rotated user spaces.
+  double xs[4] = {clip_left, clip_right, clip_right, clip_left};
+  double ys[4] = {clip_top, clip_top, clip_bottom, clip_bottom};
+  double min_x = std::numeric_limits<double>::infinity();
+  double min_y = min_x;
+  double max_x = -min_x;
+  double max_y = -min_x;
+  for (int idx = 0; idx < 4; ++idx) {
+    cairo_user_to_device(context, &xs[idx], &ys[idx]);
+    min_x = std::min(min_x, xs[idx]);
+    max_x = std::max(max_x, xs[idx]);
+    min_y = std::min(min_y, ys[idx]);
+    max_y = std::max(max_y, ys[idx]);
+  }
+
+  cairo_surface_t *target = cairo_get_target(context);
+  const double width = cairo_image_surface_get_width(target);
+  const double height = cairo_image_surface_get_height(target);
+  PixelBox box;
+  box.left = static_cast<int>(std::max(0.0, std::floor(min_x)));
+  box.top = static_cast<int>(std::max(0.0, std::floor(min_y)));
+  box.right = static_cast<int>(std::min(width, std::ceil(max_x)));
+  box.bottom = static_cast<int>(std::min(height, std::ceil(max_y)));
+  region->Add(box);
+}
+
+
+void MarkClipDirty(cairo_t *context) {
+  const double inf = std::numeric_limits<double>::infinity();
+  MarkDirty(context, -inf, -inf, inf, inf);
+}
+
+} // namespace helpers
+} // namespace viren2d
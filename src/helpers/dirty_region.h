@@ -0,0 +1,132 @@
+#ifndef __VIREN2D_DIRTY_REGION_H__
+#define __VIREN2D_DIRTY_REGION_H__
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/primitives.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Integer device-space rectangle, *i.e.* the canvas pixels
+/// [left, right) x [top, bottom).
+struct PixelBox {
+  int left = 0;
+  int top = 0;
+  int right = 0;
+  int bottom = 0;
+
+  int Width() const { return right - left; }
+  int Height() const { return bottom - top; }
+
+  bool IsEmpty() const { return (right <= left) || (bottom <= top); }
+
+  double Area() const {
+    return IsEmpty() ? 0.0 : static_cast<double>(Width()) * Height();
+  }
+
+  /// Returns the bounding box of both rectangles.
+  PixelBox Union(const PixelBox &other) const;
+};
+
+
+/// The canvas region which has been drawn onto, approximated by a small
+/// number of (possibly overlapping) pixel boxes.
+///
+/// Each drawing helper reports the device-space bounds of the visible
+/// primitive, *i.e.* the same conservative box which is used for
+/// culling. To keep the bookkeeping cheap, a new box is merged into an
+/// existing one if their union doesn't cover more pixels than both boxes
+/// separately. If the maximum number of boxes is exceeded, the pair with
+/// the least wasted area will be merged.
+class DirtyRegion {
+public:
+  explicit DirtyRegion(std::size_t max_boxes = 16);
+
+  /// Adds the given box, which must already be clamped to the canvas.
+  void Add(const PixelBox &box);
+
+  /// Adds all boxes of the other region.
+  void Add(const DirtyRegion &other);
+
+  /// Resets the region, *i.e.* nothing is dirty.
+  void Clear() { boxes_.clear(); }
+
+  bool IsEmpty() const { return boxes_.empty(); }
+
+  const std::vector<PixelBox> &Boxes() const { return boxes_; }
+
+private:
+  std::size_t max_boxes_;
+  std::vector<PixelBox> boxes_;
+
+  void MergeCheapestPair();
+};
+
+
+/// Accumulates the user-space bounding box of several primitives, *e.g.*
+/// to report all visible primitives of a batch via a single `MarkDirty`.
+struct UserBounds {
+  double left = std::numeric_limits<double>::infinity();
+  double top = std::numeric_limits<double>::infinity();
+  double right = -std::numeric_limits<double>::infinity();
+  double bottom = -std::numeric_limits<double>::infinity();
+
+  bool IsEmpty() const { return (right < left) || (bottom < top); }
+
+  void Add(double l, double t, double r, double b);
+
+  void Add(const Vec2d &center, double margin) {
+    Add(center.X() - margin, center.Y() - margin,
+        center.X() + margin, center.Y() + margin);
+  }
+
+  void Add(const Vec2d &from, const Vec2d &to, double margin);
+};
+
+
+/// Attaches the dirty region to the context, *i.e.* all subsequent
+/// `MarkDirty` calls for this context will extend the given region.
+/// The region must outlive the context (or be replaced by calling this
+/// function again, *e.g.* with nullptr to stop tracking).
+void SetDirtyRegion(cairo_t *context, DirtyRegion *region);
+
+
+/// Adds the axis-aligned box (in the context's current user space) to
+/// the context's dirty region, see `SetDirtyRegion`. The box will be
+/// limited to the clip region and transformed to device space.
+/// Non-finite coordinates mark the whole clip region as dirty.
+void MarkDirty(
+    cairo_t *context, double left, double top, double right, double bottom);
+
+
+/// Adds the square of the given half size around the point to the
+/// context's dirty region, see above.
+inline void MarkDirty(cairo_t *context, const Vec2d &center, double margin) {
+  MarkDirty(
+        context, center.X() - margin, center.Y() - margin,
+        center.X() + margin, center.Y() + margin);
+}
+
+
+/// Adds the accumulated bounds to the context's dirty region, see above.
+inline void MarkDirty(cairo_t *context, const UserBounds &bounds) {
+  if (!bounds.IsEmpty()) {
+    MarkDirty(context, bounds.left, bounds.top, bounds.right, bounds.bottom);
+  }
+}
+
+
+/// Marks the context's complete clip region as dirty, *e.g.* after
+/// painting a gradient.
+void MarkClipDirty(cairo_t *context);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_DIRTY_REGION_H__
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <cstdint>
 
 #include <math.h>
 #include <cairo/cairo.h>
@@ -14,11 +16,18 @@
 #include <viren2d/styles.h>
 #include <viren2d/drawing.h>
 
+#include <helpers/culling.h>
+#include <helpers/dirty_region.h>
+#include <helpers/fast_raster.h>
+#include <helpers/font_cache.h>
+#include <helpers/glyph_atlas.h>
+#include <helpers/text_cache.h>
 #include <helpers/logging.h>
 
 
 namespace viren2d {
 namespace helpers {
+class MarkerSpriteCache;
 //---------------------------------------------------- Sanity checks
 // To be used by all drawing helpers.
 
@@ -57,6 +66,27 @@ inline bool CheckCanvas(cairo_surface_t *surface, cairo_t *context) {
 }
 
 
+/// Returns true if the given ImageBuffer can be used as memory of a
+/// Cairo ARGB32 image surface, *i.e.* it can be wrapped via
+/// `cairo_image_surface_create_for_data` without copying.
+inline bool IsCairoCompatibleBuffer(const ImageBuffer &buffer) {
+  if (!buffer.IsValid()
+      || (buffer.BufferType() != ImageBufferType::UInt8)
+      || (buffer.Channels() != 4)
+      || (buffer.PixelStride() != 4)) {
+    return false;
+  }
+
+  // Cairo requires 32-bit aligned rows. Larger strides, e.g. of padded
+  // rows or of views onto a larger image, are fine.
+  const int min_stride = cairo_format_stride_for_width(
+        CAIRO_FORMAT_ARGB32, buffer.Width());
+  return (buffer.RowStride() >= min_stride)
+      && ((buffer.RowStride() % 4) == 0)
+      && ((reinterpret_cast<std::uintptr_t>(buffer.ImmutableData()) % 4) == 0);
+}
+
+
 /// Checks if the line style is valid.
 inline bool CheckLineStyle(const LineStyle &style) {
   if (!style.IsValid()) {
@@ -96,6 +126,101 @@ inline bool CheckLineStyleAndFill(
 }
 
 
+//---------------------------------------------------- Context state
+
+/// Resets the drawing state of the given context, *i.e.* clip
+/// region, transformation, current path, source and line settings,
+/// so that a context can be reused for a new canvas.
+/// Font settings are not reset, because these will always be
+/// set up by ApplyTextStyle.
+inline void ResetContext(cairo_t *context) {
+  if (!context) {
+    return;
+  }
+
+  cairo_reset_clip(context);
+  cairo_identity_matrix(context);
+  cairo_new_path(context);
+  cairo_set_source_rgba(context, 0.0, 0.0, 0.0, 1.0);
+  cairo_set_operator(context, CAIRO_OPERATOR_OVER);
+  cairo_set_dash(context, nullptr, 0, 0.0);
+  cairo_set_line_width(context, 2.0);
+  cairo_set_line_cap(context, CAIRO_LINE_CAP_BUTT);
+  cairo_set_line_join(context, CAIRO_LINE_JOIN_MITER);
+}
+
+
+/// Key to store the `RenderQuality` as user data of a Cairo context.
+inline const cairo_user_data_key_t *RenderQualityKey() {
+  static const cairo_user_data_key_t key{};
+  return &key;
+}
+
+
+/// Sets up the anti-aliasing and tolerance of the given context for the
+/// requested quality. This state persists across `cairo_save` and
+/// `cairo_restore`, and thus applies to all subsequent drawing helpers.
+inline void ApplyRenderQuality(cairo_t *context, RenderQuality quality) {
+  if (!context) {
+    return;
+  }
+
+  switch (quality) {
+    case RenderQuality::Fast:
+      cairo_set_antialias(context, CAIRO_ANTIALIAS_FAST);
+      cairo_set_tolerance(context, 0.5);
+      break;
+
+    case RenderQuality::Balanced:
+      cairo_set_antialias(context, CAIRO_ANTIALIAS_DEFAULT);
+      cairo_set_tolerance(context, 0.1);
+      break;
+
+    case RenderQuality::Best:
+      cairo_set_antialias(context, CAIRO_ANTIALIAS_BEST);
+      cairo_set_tolerance(context, 0.01);
+      break;
+  }
+
+  // Store the enum value (offset by 1, so that unset user data can
+  // be distinguished):
+  cairo_set_user_data(
+        context, RenderQualityKey(),
+        reinterpret_cast<void *>(static_cast<std::uintptr_t>(quality) + 1),
+        nullptr);
+}
+
+
+/// Returns the render quality of the given context, see
+/// `ApplyRenderQuality`.
+inline RenderQuality GetRenderQuality(cairo_t *context) {
+  const auto value = context
+      ? reinterpret_cast<std::uintptr_t>(
+          cairo_get_user_data(context, RenderQualityKey()))
+      : 0;
+  if (value == 0) {
+    return RenderQuality::Balanced;
+  }
+  return static_cast<RenderQuality>(value - 1);
+}
+
+
+/// Returns the filter to sample image patterns at the given quality.
+inline cairo_filter_t ImageFilter(RenderQuality quality) {
+  switch (quality) {
+    case RenderQuality::Fast:
+      return CAIRO_FILTER_NEAREST;
+
+    case RenderQuality::Balanced:
+      return CAIRO_FILTER_GOOD;
+
+    case RenderQuality::Best:
+      return CAIRO_FILTER_BEST;
+  }
+  return CAIRO_FILTER_GOOD;
+}
+
+
 //---------------------------------------------------- ApplyXXX
 // To be used by all drawing helpers.
 
@@ -179,18 +304,29 @@ inline void ApplyMarkerStyle(
 
 /// Changes the given Cairo context to use the
 /// given LineStyle definitions.
+///
+/// If the path consists only of horizontal and vertical segments at
+/// pixel centers (*e.g.* unrotated boxes or grids), set `axis_aligned`.
+/// Then, anti-aliasing will be disabled for `RenderQuality::Fast`.
+/// Since the anti-aliasing mode also applies to filling, this style
+/// should be applied before filling such a path.
 inline void ApplyLineStyle(
     cairo_t *context,
     const LineStyle &style,
-    bool ignore_dash = false) {
+    bool ignore_dash = false,
+    bool axis_aligned = false) {
   SPDLOG_TRACE(
-        "helpers::ApplyLineStyle: style={:s}, ignore_dash={:s}.",
-        style, ignore_dash);
+        "helpers::ApplyLineStyle: style={:s}, ignore_dash={:s}, "
+        "axis_aligned={:s}.", style, ignore_dash, axis_aligned);
 
   if (!context) {
     return;
   }
 
+  if (axis_aligned && (GetRenderQuality(context) == RenderQuality::Fast)) {
+    cairo_set_antialias(context, CAIRO_ANTIALIAS_NONE);
+  }
+
   cairo_set_line_width(context, style.width);
   cairo_set_line_cap(context, LineCap2Cairo(style.cap));
   cairo_set_line_join(context, LineJoin2Cairo(style.join));
@@ -220,6 +356,17 @@ inline void ApplyTextStyle(
     return;
   }
 
+  // Reuse the resolved font (face & size) from the font cache to avoid
+  // the font lookup of Cairo's toy API (i.e. `cairo_select_font_face`).
+  const auto font = GetCachedFont(context, text_style);
+  if (font) {
+    cairo_set_scaled_font(context, font->scaled_font);
+    if (apply_color) {
+      ApplyColor(context, text_style.color);
+    }
+    return;
+  }
+
   cairo_select_font_face(
       context, text_style.family.c_str(),
       (text_style.italic ? CAIRO_FONT_SLANT_ITALIC : CAIRO_FONT_SLANT_NORMAL),
@@ -266,16 +413,31 @@ public:
 
   void PlaceText(cairo_t *context) const;
 
+  /// Composites the text from the glyph atlas, see `BlitAtlasText`.
+  /// Returns false if nothing has been drawn.
+  bool PlaceText(
+      cairo_surface_t *surface, cairo_t *context,
+      const GlyphAtlas &atlas, const Color &color) const;
+
   double Width() const { return width; }
 
   double Height() const { return height; }
 
+  /// Returns the axis-aligned bounding box. Valid results are only
+  /// available **after** `Align` was called.
+  Rect BoundingBox() const;
+
 private:
   /// Pointer to the C-string text used to
   /// initialize this `TextLine` instance.
   const char *text;
 
 
+  /// Cached glyphs of this text (for the font used by `Init`), or
+  /// nullptr if the text cache is disabled.
+  std::shared_ptr<const ShapedText> shaped;
+
+
   /// Reference point for `cairo_show_text`, which
   /// will be set **after** `Align` has been called.
   Vec2d reference_point;
@@ -353,6 +515,14 @@ public:
   void PlaceText(cairo_t *context) const;
 
 
+  /// Composites the text lines from the given glyph atlas. Lines which
+  /// are not supported by the atlas will be drawn via Cairo, thus the
+  /// context's source must already be set to the text color.
+  void PlaceText(
+      cairo_surface_t *surface, cairo_t *context,
+      const GlyphAtlas &atlas, const Color &color) const;
+
+
   /// Returns the width of the text box. This might differ from
   /// the actual width (maximum line width and padding) if  a fixed size box
   /// is requested.
@@ -428,10 +598,26 @@ bool DrawBoundingBox2D(
     const std::vector<std::string> &label_right, bool right_top_to_bottom);
 
 
+bool DrawBoundingBoxes2D(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<Rect> &boxes,
+    const std::vector<BoundingBox2DStyle> &styles,
+    const std::vector<std::size_t> &style_indices,
+    const std::vector<std::string> &labels);
+
+
 inline bool DrawCircle(
     cairo_surface_t *surface, cairo_t *context,
     Vec2d center, double radius, const LineStyle &line_style,
     const Color &fill_color) {
+  if ((radius > 0.0) && IsOutsideViewport(
+        context, center + 0.5, radius + StrokeMargin(line_style.width))) {
+    return true;
+  }
+  if (FastDrawCircle(
+        surface, context, center, radius, line_style, fill_color)) {
+    return true;
+  }
   return DrawArc(surface, context, center, radius, 0, 360, line_style,
           false, fill_color);
 }
@@ -472,15 +658,41 @@ bool DrawLine(
     Vec2d from, Vec2d to, const LineStyle &line_style);
 
 
+/// Strokes multiple line segments at once, *i.e.* with a single style
+/// setup. The endpoints are given as consecutive (from, to) pairs.
+bool DrawLineSegments(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<Vec2d> &endpoints, const LineStyle &line_style);
+
+
+/// Draws a single marker. If a sprite cache is given, the marker will
+/// be stamped from its pre-rasterized sprite (at a sub-pixel-quantized
+/// position) instead of rendering its path.
 bool DrawMarker(
     cairo_surface_t *surface, cairo_t *context,
-    Vec2d pos, const MarkerStyle &style);
+    Vec2d pos, const MarkerStyle &style,
+    MarkerSpriteCache *sprite_cache = nullptr);
 
 
+/// Draws multiple markers in the same order as repeated `DrawMarker` calls.
+/// Consecutive markers of the same effective color (*i.e.* the marker's
+/// color, or the style's color if the former is invalid) which don't
+/// overlap are rendered via a single path and a single fill or stroke.
+/// If a sprite cache is given, all markers are stamped from their
+/// pre-rasterized sprites instead.
+bool DrawMarkers(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<std::pair<Vec2d, Color>> &markers,
+    const MarkerStyle &style, MarkerSpriteCache *sprite_cache = nullptr);
+
+
+/// Draws a polygon. If a positive tolerance (in pixels) is given, the
+/// points will be simplified before, see `SimplifyPolyline`.
 bool DrawPolygon(
     cairo_surface_t *surface, cairo_t *context,
     const std::vector<Vec2d> &points,
-    const LineStyle &line_style, Color fill_color);
+    const LineStyle &line_style, Color fill_color,
+    double simplify_tolerance = 0.0);
 
 
 bool DrawRect(
@@ -495,14 +707,31 @@ Rect DrawText(cairo_surface_t *surface, cairo_t *context,
     const TextStyle &text_style, const Vec2d &padding,
     double rotation, const LineStyle &box_line_style,
     const Color &box_fill_color, double box_corner_radius,
-    const Vec2d &fixed_box_size);
+    const Vec2d &fixed_box_size, bool bitmap_text = false);
 
 
+/// Draws a trajectory. If a positive tolerance (in pixels) is given, the
+/// points will be simplified before, see `SimplifyPolyline`. The
+/// fade-out colors still follow the length along the original points.
 bool DrawTrajectory(
+    cairo_surface_t *surface, cairo_t *context,
+    const Vec2d *points, std::size_t num_points, const LineStyle &style,
+    Color color_fade_out, bool oldest_position_first,
+    const std::function<double(double)> &mix_factor,
+    int fade_out_levels = 0, double simplify_tolerance = 0.0);
+
+
+inline bool DrawTrajectory(
     cairo_surface_t *surface, cairo_t *context,
     const std::vector<Vec2d> &points, const LineStyle &style,
     Color color_fade_out, bool oldest_position_first,
-    const std::function<double(double)> &mix_factor);
+    const std::function<double(double)> &mix_factor,
+    int fade_out_levels = 0, double simplify_tolerance = 0.0) {
+  return DrawTrajectory(
+        surface, context, points.data(), points.size(), style,
+        color_fade_out, oldest_position_first, mix_factor,
+        fade_out_levels, simplify_tolerance);
+}
 
 
 bool DrawXYZAxes(
@@ -1,9 +1,11 @@
 // STL
+#include <algorithm>
 #include <string>
 #include <exception>
 #include <cmath>
 #include <cstdlib>
 #include <tuple>
+#include <vector>
 
 // non-STL, external
 #include <werkzeugkiste/geometry/utils.h>
@@ -13,6 +15,7 @@ namespace wgu = werkzeugkiste::geometry;
 // Custom
 #include <helpers/drawing_helpers.h>
 #include <helpers/enum.h>
+#include <helpers/polyline_simplification.h>
 
 
 namespace viren2d {
@@ -270,6 +273,16 @@ AlignBoundingBoxLabels(
 }
 
 
+/// Returns the maximum distance of a box' contour pixels from its
+/// center, used to cull off-screen boxes. Half the diagonal covers
+/// any rotation.
+inline double BoundingBoxMargin(
+    const Rect &box, const BoundingBox2DStyle &style) {
+  return 0.5 * std::sqrt(box.width * box.width + box.height * box.height)
+      + StrokeMargin(style.line_style.width);
+}
+
+
 bool DrawBoundingBox2D(
     cairo_surface_t *surface, cairo_t *context, Rect bounding_box,
     const BoundingBox2DStyle &style,
@@ -298,6 +311,21 @@ bool DrawBoundingBox2D(
     return false;
   }
 
+  // Labels can only overflow the box if they are not clipped:
+  const bool has_labels = !label_top.empty() || !label_bottom.empty()
+      || !label_left.empty() || !label_right.empty();
+  const bool overflowing_labels = has_labels && !style.clip_label;
+  if (overflowing_labels) {
+    // The labels will be marked dirty after they have been aligned.
+    MarkDirty(
+          context, Vec2d(bounding_box.cx, bounding_box.cy) + 0.5,
+          BoundingBoxMargin(bounding_box, style));
+  } else if (IsOutsideViewport(
+        context, Vec2d(bounding_box.cx, bounding_box.cy) + 0.5,
+        BoundingBoxMargin(bounding_box, style))) {
+    return true;
+  }
+
   //-------------------- Drawing
   // In a nutshell:
   // * (optional) Fill the box background
@@ -395,6 +423,15 @@ bool DrawBoundingBox2D(
       cairo_save(context);
       cairo_rotate(context, aligned.canvas_rotation);
       aligned.text.PlaceText(context);
+      if (overflowing_labels) {
+        // Same margin as for `DrawText`, which covers glyphs exceeding
+        // their logical extent:
+        const Rect text_box = aligned.text.BoundingBox();
+        const double margin = std::abs(style.text_style.size);
+        MarkDirty(
+              context, text_box.left() - margin, text_box.top() - margin,
+              text_box.right() + margin, text_box.bottom() + margin);
+      }
       cairo_restore(context);
     }
   }
@@ -405,12 +442,473 @@ bool DrawBoundingBox2D(
 }
 
 
+//---------------------------------------------------- BoundingBoxes 2D
+namespace {
+/// Returns the intersection of two axis-aligned rectangles, or an invalid
+/// (empty) rectangle if they don't overlap.
+inline Rect IntersectAxisAligned(const Rect &a, const Rect &b) {
+  const double left = std::max(a.left(), b.left());
+  const double right = std::min(a.right(), b.right());
+  const double top = std::max(a.top(), b.top());
+  const double bottom = std::min(a.bottom(), b.bottom());
+  if ((right <= left) || (bottom <= top)) {
+    return Rect();
+  }
+  return Rect::FromLRTB(left, right, top, bottom);
+}
+
+
+/// Fills (or strokes) the given axis-aligned rectangles. Opaque rectangles
+/// are combined into a single path, translucent ones must be drawn one at a
+/// time to blend overlapping regions exactly as consecutive calls would.
+void RenderRectBatch(
+    cairo_t *context, const std::vector<Rect> &rects,
+    bool opaque, bool stroke) {
+  if (rects.empty()) {
+    return;
+  }
+
+  for (const auto &rect : rects) {
+    cairo_rectangle(
+          context, rect.left(), rect.top(), rect.width, rect.height);
+    if (!opaque) {
+      if (stroke) {
+        cairo_stroke(context);
+      } else {
+        cairo_fill(context);
+      }
+    }
+  }
+
+  if (opaque) {
+    if (stroke) {
+      cairo_stroke(context);
+    } else {
+      cairo_fill(context);
+    }
+  }
+}
+} // anonymous namespace
+
+
+bool DrawBoundingBoxes2D(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<Rect> &boxes,
+    const std::vector<BoundingBox2DStyle> &styles,
+    const std::vector<std::size_t> &style_indices,
+    const std::vector<std::string> &labels) {
+  //-------------------- Sanity checks
+  if (!CheckCanvas(surface, context)) {
+    return false;
+  }
+
+  if (boxes.empty()) {
+    return true;
+  }
+
+  if (styles.empty()) {
+    SPDLOG_WARN("Cannot draw bounding boxes without any style!");
+    return false;
+  }
+
+  if (!style_indices.empty() && (style_indices.size() != boxes.size())) {
+    SPDLOG_WARN(
+          "Number of style indices ({:d}) must match the number of "
+          "bounding boxes ({:d})!", style_indices.size(), boxes.size());
+    return false;
+  }
+
+  if (!labels.empty() && (labels.size() != boxes.size())) {
+    SPDLOG_WARN(
+          "Number of labels ({:d}) must match the number of "
+          "bounding boxes ({:d})!", labels.size(), boxes.size());
+    return false;
+  }
+
+  bool success = true;
+  std::vector<bool> valid_styles(styles.size());
+  for (std::size_t idx = 0; idx < styles.size(); ++idx) {
+    valid_styles[idx] = styles[idx].IsValid();
+    if (!valid_styles[idx]) {
+      SPDLOG_WARN(
+            "Skipping bounding boxes with invalid style #{:d}: {:s}!",
+            idx, styles[idx]);
+      success = false;
+    }
+  }
+
+  //-------------------- Grouping
+  // Boxes are grouped by their style (the style table is usually tiny,
+  // thus we simply bucket them). Rotated or rounded boxes cannot be
+  // batched and will be drawn one by one after all others.
+  // Boxes outside the viewport are skipped, unless their labels
+  // could overflow.
+  std::vector<std::vector<std::size_t>> groups(styles.size());
+  std::vector<std::size_t> single_boxes;
+  const Viewport viewport(context);
+  const Viewport counting = viewport.Counting();
+  std::size_t num_culled = 0;
+  for (std::size_t idx = 0; idx < boxes.size(); ++idx) {
+    const std::size_t style_idx =
+        style_indices.empty() ? 0 : style_indices[idx];
+    if (style_idx >= styles.size()) {
+      SPDLOG_WARN(
+            "Skipping bounding box #{:d}, its style index {:d} is out "
+            "of range!", idx, style_idx);
+      success = false;
+      continue;
+    }
+
+    if (!valid_styles[style_idx]) {
+      continue;
+    }
+
+    if (!boxes[idx].IsValid()) {
+      SPDLOG_WARN(
+            "Skipping invalid bounding box #{:d}: {:s}!", idx, boxes[idx]);
+      success = false;
+      continue;
+    }
+
+    const bool has_label = !labels.empty() && !labels[idx].empty();
+    const Vec2d center = Vec2d(boxes[idx].cx, boxes[idx].cy) + 0.5;
+    const double margin = BoundingBoxMargin(boxes[idx], styles[style_idx]);
+    if ((styles[style_idx].clip_label || !has_label)
+        && !viewport.Intersects(center, margin)) {
+      if (!counting.Intersects(center, margin)) {
+        ++num_culled;
+      }
+      continue;
+    }
+
+    if ((boxes[idx].rotation != 0.0) || (boxes[idx].radius > 0.0)) {
+      single_boxes.push_back(idx);
+    } else {
+      groups[style_idx].push_back(idx);
+    }
+  }
+
+  CountCulled(context, num_culled);
+
+  //-------------------- Layout
+  // In a nutshell (see also `DrawBoundingBox2D`):
+  // * Compute all label extents, requiring the font to be set up only
+  //   once per style.
+  // * Fill all box backgrounds and the label text boxes (clipped to
+  //   their box).
+  // * Stroke all box contours.
+  // * Render all labels (optionally clipped by their box).
+  struct GroupLayout {
+    std::vector<Rect> contours;
+    std::vector<Rect> backgrounds;
+    std::vector<Rect> text_boxes;
+    std::vector<SingleLineText> lines;
+    std::vector<Rect> line_clips;
+  };
+  std::vector<GroupLayout> layouts(styles.size());
+  UserBounds dirty;
+
+  cairo_save(context);
+  for (std::size_t style_idx = 0; style_idx < styles.size(); ++style_idx) {
+    const auto &group = groups[style_idx];
+    if (group.empty()) {
+      continue;
+    }
+
+    const BoundingBox2DStyle &style = styles[style_idx];
+    GroupLayout &layout = layouts[style_idx];
+    layout.contours.reserve(group.size());
+
+    const bool fill_text_box = style.TextFillColor().IsValid();
+    const HorizontalAlignment halign = style.text_style.halign;
+    ApplyTextStyle(context, style.text_style, false);
+    cairo_font_extents_t font_extent;
+    FontExtents(context, style.text_style, &font_extent);
+
+    for (std::size_t box_idx : group) {
+      // Shift coordinates to the pixel center to correctly draw 1px borders
+      Rect box(boxes[box_idx]);
+      box += 0.5;
+      layout.contours.push_back(box);
+      const double margin = StrokeMargin(style.line_style.width);
+      dirty.Add(
+            box.left() - margin, box.top() - margin,
+            box.right() + margin, box.bottom() + margin);
+
+      Rect background(box);
+      if (!labels.empty() && !labels[box_idx].empty()) {
+        SingleLineText line(
+              labels[box_idx].c_str(), context, &font_extent);
+        const double text_height = line.Height() + 2.0 * style.label_padding.Y();
+
+        // Same placement as a single-line top label of `DrawBoundingBox2D`:
+        double x = box.cx;
+        if (halign == HorizontalAlignment::Left) {
+          x = box.left() + style.label_padding.X();
+        } else if (halign == HorizontalAlignment::Right) {
+          x = box.right() - style.label_padding.X();
+        }
+        line.Align(
+              Vec2d(x, box.top() + style.label_padding.Y() + line.Height()),
+              VerticalAlignment::Bottom | halign);
+        layout.lines.push_back(line);
+        if (style.clip_label) {
+          layout.line_clips.push_back(box);
+        } else {
+          const Rect text_box = line.BoundingBox();
+          const double margin = std::abs(style.text_style.size);
+          dirty.Add(
+                text_box.left() - margin, text_box.top() - margin,
+                text_box.right() + margin, text_box.bottom() + margin);
+        }
+
+        if (fill_text_box) {
+          const Rect text_box = IntersectAxisAligned(
+                box, Rect::FromLTWH(
+                  box.left(), box.top(), box.width, text_height));
+          if (text_box.IsValid()) {
+            layout.text_boxes.push_back(text_box);
+          }
+          background = IntersectAxisAligned(
+                box, Rect::FromLTWH(
+                  box.left(), box.top() + text_height,
+                  box.width, box.height - text_height));
+        }
+      }
+
+      if (background.IsValid()) {
+        layout.backgrounds.push_back(background);
+      }
+    }
+  }
+
+  MarkDirty(context, dirty);
+
+  //-------------------- Drawing
+  for (std::size_t style_idx = 0; style_idx < styles.size(); ++style_idx) {
+    const GroupLayout &layout = layouts[style_idx];
+    const auto box_fill = styles[style_idx].BoxFillColor();
+    if (box_fill.IsValid()) {
+      ApplyColor(context, box_fill);
+      RenderRectBatch(
+            context, layout.backgrounds, box_fill.alpha >= 1.0, false);
+    }
+
+    const auto text_fill = styles[style_idx].TextFillColor();
+    if (text_fill.IsValid()) {
+      ApplyColor(context, text_fill);
+      RenderRectBatch(
+            context, layout.text_boxes, text_fill.alpha >= 1.0, false);
+    }
+  }
+
+  for (std::size_t style_idx = 0; style_idx < styles.size(); ++style_idx) {
+    const GroupLayout &layout = layouts[style_idx];
+    if (layout.contours.empty()) {
+      continue;
+    }
+    const LineStyle &line_style = styles[style_idx].line_style;
+    ApplyLineStyle(context, line_style);
+    RenderRectBatch(
+          context, layout.contours, line_style.color.alpha >= 1.0, true);
+  }
+
+  for (std::size_t style_idx = 0; style_idx < styles.size(); ++style_idx) {
+    const GroupLayout &layout = layouts[style_idx];
+    if (layout.lines.empty()) {
+      continue;
+    }
+
+    ApplyTextStyle(context, styles[style_idx].text_style, true);
+    const bool clip = !layout.line_clips.empty();
+    for (std::size_t line_idx = 0; line_idx < layout.lines.size(); ++line_idx) {
+      if (clip) {
+        const Rect &box = layout.line_clips[line_idx];
+        cairo_save(context);
+        cairo_rectangle(context, box.left(), box.top(), box.width, box.height);
+        cairo_clip(context);
+        layout.lines[line_idx].PlaceText(context);
+        cairo_restore(context);
+      } else {
+        layout.lines[line_idx].PlaceText(context);
+      }
+    }
+  }
+  cairo_restore(context);
+
+  //-------------------- Non-batchable boxes
+  for (std::size_t box_idx : single_boxes) {
+    const std::size_t style_idx =
+        style_indices.empty() ? 0 : style_indices[box_idx];
+    std::vector<std::string> label_top;
+    if (!labels.empty() && !labels[box_idx].empty()) {
+      label_top.push_back(labels[box_idx]);
+    }
+    success &= DrawBoundingBox2D(
+          surface, context, boxes[box_idx], styles[style_idx],
+          label_top, {}, {}, false, {}, true);
+  }
+
+  return success;
+}
+
+
 //---------------------------------------------------- Trajectory 2D
+namespace {
+/// Returns the color at the given proportion along the trajectory.
+inline Color TrajectoryColor(
+    const Color &color_head, const Color &color_fade_out,
+    bool oldest_position_first, double proportion_color_head) {
+  return oldest_position_first
+      ? color_fade_out.Mix(color_head, proportion_color_head)
+      : color_head.Mix(color_fade_out, proportion_color_head);
+}
+
+
+/// Strokes each segment with its exact linear color gradient. Segments
+/// outside the viewport (enlarged by the margin) are skipped.
+/// The colors depend on the length along the (original, *i.e.* not
+/// simplified) trajectory up to each point, see `CumulativeLengths`.
+void StrokeTrajectoryGradients(
+    cairo_t *context, const Vec2d *points, std::size_t num_points,
+    const std::vector<double> &lengths,
+    const Color &color_head, const Color &color_fade_out,
+    bool oldest_position_first,
+    const std::function<double(double)> &mix_factor,
+    const Viewport &viewport, double margin) {
+  const double total_length = lengths.back();
+  double processed_length = 0.0;
+  double proportion_color_head = mix_factor(0.0);
+  const Color &color_first = oldest_position_first
+      ? color_fade_out
+      : color_head;
+  const Color &color_last = oldest_position_first
+      ? color_head
+      : color_fade_out;
+  Color color_from = color_first.Mix(
+        color_last, mix_factor(proportion_color_head));
+  Color color_to;
+
+  // Fading out requires a separate path for each line segment,
+  // so that we can apply the color gradient.
+  for (std::size_t idx = 1; idx < num_points; ++idx) {
+    if (!viewport.Intersects(points[idx-1], points[idx], margin)) {
+      // The colors still have to be computed along the whole trajectory.
+      processed_length = lengths[idx];
+      proportion_color_head = mix_factor(processed_length / total_length);
+      color_from = TrajectoryColor(
+            color_head, color_fade_out, oldest_position_first,
+            proportion_color_head);
+      continue;
+    }
+
+    cairo_pattern_t *pattern = cairo_pattern_create_linear(
+        points[idx-1].X(), points[idx-1].Y(),
+        points[idx].X(), points[idx].Y());
+    // See ApplyColor() on why we have to use bgra:
+    cairo_pattern_add_color_stop_rgba(pattern, 0.0,
+        color_from.blue, color_from.green,
+        color_from.red, color_from.alpha);
+
+    // The stop color of the current segment's color gradient
+    // depends on how far we are along the trajectory:
+    processed_length = lengths[idx];
+    proportion_color_head = mix_factor(processed_length / total_length);
+    color_to = TrajectoryColor(
+          color_head, color_fade_out, oldest_position_first,
+          proportion_color_head);
+    cairo_pattern_add_color_stop_rgba(
+          pattern, 1.0,
+          color_to.blue, color_to.green,
+          color_to.red, color_to.alpha);
+
+    // Draw the current line segment with this linear color gradient:
+    cairo_move_to(context, points[idx-1].X(), points[idx-1].Y());
+    cairo_line_to(context, points[idx].X(), points[idx].Y());
+    cairo_set_source(context, pattern);
+    cairo_stroke(context);
+    cairo_pattern_destroy(pattern);
+    color_from = color_to;
+  }
+}
+
+
+/// Bins the segments into `num_levels` solid colors and strokes
+/// each bin as a single path. See `StrokeTrajectoryGradients` for
+/// the lengths.
+void StrokeTrajectoryBuckets(
+    cairo_t *context, const Vec2d *points, std::size_t num_points,
+    const std::vector<double> &lengths,
+    const Color &color_head, const Color &color_fade_out,
+    bool oldest_position_first,
+    const std::function<double(double)> &mix_factor,
+    int num_levels) {
+  // Consecutive segments which fall into the same bin form a run, which
+  // will be drawn as a connected polyline (i.e. the line join is applied).
+  struct Run {
+    int level;
+    std::size_t first;
+    std::size_t last;
+  };
+  std::vector<Run> runs;
+
+  const double total_length = lengths.back();
+  const double max_level = static_cast<double>(num_levels - 1);
+  for (std::size_t idx = 1; idx < num_points; ++idx) {
+    // Each segment is colored as its center would be in the exact mode.
+    const double proportion = (total_length > 0.0)
+        ? mix_factor((lengths[idx-1] + lengths[idx]) / (2.0 * total_length))
+        : 0.0;
+
+    const int level = (num_levels > 1)
+        ? static_cast<int>(std::lround(
+            std::min(1.0, std::max(0.0, proportion)) * max_level))
+        : 0;
+    if (!runs.empty() && (runs.back().level == level)) {
+      runs.back().last = idx;
+    } else {
+      runs.push_back({level, idx - 1, idx});
+    }
+  }
+
+  std::vector<bool> stroked(static_cast<std::size_t>(num_levels), false);
+  for (std::size_t run_idx = 0; run_idx < runs.size(); ++run_idx) {
+    const int level = runs[run_idx].level;
+    if (stroked[level]) {
+      continue;
+    }
+    stroked[level] = true;
+
+    // Collect all runs of this level (the mixing function is not
+    // necessarily monotonic) into a single path.
+    for (std::size_t other = run_idx; other < runs.size(); ++other) {
+      if (runs[other].level != level) {
+        continue;
+      }
+      const Run &run = runs[other];
+      cairo_move_to(context, points[run.first].X(), points[run.first].Y());
+      for (std::size_t idx = run.first + 1; idx <= run.last; ++idx) {
+        cairo_line_to(context, points[idx].X(), points[idx].Y());
+      }
+    }
+
+    const double proportion = (num_levels > 1)
+        ? (level / max_level) : 0.5;
+    ApplyColor(
+          context, TrajectoryColor(
+            color_head, color_fade_out, oldest_position_first, proportion));
+    cairo_stroke(context);
+  }
+}
+} // anonymous namespace
+
+
 bool DrawTrajectory(
       cairo_surface_t *surface, cairo_t *context,
-      const std::vector<Vec2d> &points, const LineStyle &style,
+      const Vec2d *points, std::size_t num_points, const LineStyle &style,
       Color color_fade_out, bool oldest_position_first,
-      const std::function<double(double)> &mix_factor) {
+      const std::function<double(double)> &mix_factor,
+      int fade_out_levels, double simplify_tolerance) {
   if (!CheckCanvas(surface, context)) {
     return false;
   }
@@ -424,7 +922,7 @@ bool DrawTrajectory(
     return false;
   }
 
-  if (points.size() < 2) {
+  if (num_points < 2) {
     SPDLOG_WARN("Input trajectory must have at least 2 points!");
     return false;
   }
@@ -434,59 +932,72 @@ bool DrawTrajectory(
   }
   const bool fade_out = color_fade_out.IsValid() && (color_fade_out != style.color);
 
+  const double margin = StrokeMargin(style.width);
+  if (IsOutsideViewport(context, points, num_points, margin)) {
+    return true;
+  }
+
+  // The fade-out colors depend on the length along the original
+  // trajectory, which must not change due to the simplification.
+  std::vector<double> lengths;
+  if (fade_out) {
+    lengths = CumulativeLengths(points, num_points);
+  }
+
+  std::vector<Vec2d> simplified;
+  if (simplify_tolerance > 0.0) {
+    const auto keep = SimplifyPolyline(
+          points, num_points, simplify_tolerance);
+    if (keep.size() < num_points) {
+      simplified.reserve(keep.size());
+      std::vector<double> kept_lengths;
+      kept_lengths.reserve(fade_out ? keep.size() : 0);
+      for (std::size_t idx : keep) {
+        simplified.push_back(points[idx]);
+        if (fade_out) {
+          kept_lengths.push_back(lengths[idx]);
+        }
+      }
+      lengths.swap(kept_lengths);
+    }
+  }
+  const Vec2d *path = simplified.empty() ? points : simplified.data();
+  const std::size_t path_size = simplified.empty()
+      ? num_points : simplified.size();
+
   cairo_save(context);
   ApplyLineStyle(context, style);
-  if (fade_out) {
-    const double total_length = wgu::LengthPolygon(points);
-    double processed_length = 0.0;
-    double proportion_color_head = mix_factor(0.0);
-    const Color &color_first = oldest_position_first
-        ? color_fade_out
-        : style.color;
-    const Color &color_last = oldest_position_first
-        ? style.color
-        : color_fade_out;
-    Color color_from = color_first.Mix(
-          color_last, mix_factor(proportion_color_head));
-    Color color_to;
-
-    // Fading out requires a separate path for each line segment,
-    // so that we can apply the color gradient.
-    for (std::size_t idx = 1; idx < points.size(); ++idx) {
-      cairo_pattern_t *pattern = cairo_pattern_create_linear(
-          points[idx-1].X(), points[idx-1].Y(),
-          points[idx].X(), points[idx].Y());
-      // See ApplyColor() on why we have to use bgra:
-      cairo_pattern_add_color_stop_rgba(pattern, 0.0,
-          color_from.blue, color_from.green,
-          color_from.red, color_from.alpha);
-
-      // The stop color of the current segment's color gradient
-      // depends on how far we are along the trajectory:
-      processed_length += points[idx-1].DistanceEuclidean(points[idx]);
-      proportion_color_head = mix_factor(processed_length / total_length);
-      color_to = oldest_position_first
-          ? color_fade_out.Mix(style.color, proportion_color_head)
-          : style.color.Mix(color_fade_out, proportion_color_head);
-      cairo_pattern_add_color_stop_rgba(
-            pattern, 1.0,
-            color_to.blue, color_to.green,
-            color_to.red, color_to.alpha);
-
-      // Draw the current line segment with this linear color gradient:
-      cairo_move_to(context, points[idx-1].X(), points[idx-1].Y());
-      cairo_line_to(context, points[idx].X(), points[idx].Y());
-      cairo_set_source(context, pattern);
-      cairo_stroke(context);
-      cairo_pattern_destroy(pattern);
-      color_from = color_to;
+  if (fade_out && (fade_out_levels > 0)) {
+    StrokeTrajectoryBuckets(
+          context, path, path_size, lengths, style.color, color_fade_out,
+          oldest_position_first, mix_factor, fade_out_levels);
+  } else if (fade_out) {
+    StrokeTrajectoryGradients(
+          context, path, path_size, lengths, style.color, color_fade_out,
+          oldest_position_first, mix_factor, Viewport(context), margin);
+  } else if (!style.IsDashed()) {
+    // The whole trajectory should be drawn with the same color. Thus,
+    // we can create a single path, which only contains the visible runs:
+    const Viewport viewport(context);
+    const auto runs = VisiblePolylineRuns(viewport, path, path_size, margin);
+    if (runs.empty()
+        && (!viewport.HasCountingRegion()
+            || VisiblePolylineRuns(
+                 viewport.Counting(), path, path_size, margin).empty())) {
+      CountCulled(context);
+    }
+    for (const auto &run : runs) {
+      cairo_move_to(context, path[run.first].X(), path[run.first].Y());
+      for (std::size_t idx = run.first + 1; idx <= run.second; ++idx) {
+        cairo_line_to(context, path[idx].X(), path[idx].Y());
+      }
     }
+    cairo_stroke(context);
   } else {
-    // The whole trajectory should be drawn with the same
-    // color. Thus, we can create a single path:
-    cairo_move_to(context, points[0].X(), points[0].Y());
-    for (std::size_t idx = 1; idx < points.size(); ++idx) {
-      cairo_line_to(context, points[idx].X(), points[idx].Y());
+    // Dash patterns must not restart, so we cannot trim the path:
+    cairo_move_to(context, path[0].X(), path[0].Y());
+    for (std::size_t idx = 1; idx < path_size; ++idx) {
+      cairo_line_to(context, path[idx].X(), path[idx].Y());
     }
     cairo_stroke(context);
   }
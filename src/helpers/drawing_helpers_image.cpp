@@ -1,6 +1,7 @@
 // STL
 #include <string>
 #include <exception>
+#include <cmath>
 
 // Non-STL external
 #include <helpers/drawing_helpers.h>
@@ -16,12 +17,10 @@ bool DrawImageHelper(
     double alpha, double scale_x, double scale_y,
     double rotation, double clip_factor,
     LineStyle line_style) {
-  const int stride = cairo_format_stride_for_width(
-      CAIRO_FORMAT_ARGB32, img_u8_c4.Width());
-  if (stride != img_u8_c4.RowStride()) {
+  if (!IsCairoCompatibleBuffer(img_u8_c4)) {
     SPDLOG_ERROR(
-        "ImageBuffer stride {} does not match optimal cairo stride {}!",
-        img_u8_c4.RowStride(), stride);
+        "ImageBuffer {:s} (row stride {:d}) cannot be wrapped by a cairo "
+        "surface!", img_u8_c4.ToString(), img_u8_c4.RowStride());
     return false;
   }
 
@@ -124,15 +123,17 @@ bool DrawImageHelper(
   // Paint the image onto the (already clipped) canvas.
   // Removing the const-ness is not a problem, because the cairo image
   // surface is only used to copy the data onto the canvas. There will be
-  // no write access.
+  // no write access (thus, we must not trigger a copy-on-write either).
   cairo_surface_t *imsurf = cairo_image_surface_create_for_data(
-        const_cast<ImageBuffer &>(img_u8_c4).MutableData(),
+        const_cast<unsigned char *>(img_u8_c4.ImmutableData()),
         CAIRO_FORMAT_ARGB32,
         img_u8_c4.Width(),
         img_u8_c4.Height(),
         img_u8_c4.RowStride());
   cairo_set_source_surface(
         context, imsurf, pattern_offset.X(), pattern_offset.Y());
+  cairo_pattern_set_filter(
+        cairo_get_source(context), ImageFilter(GetRenderQuality(context)));
   cairo_paint_with_alpha(context, alpha);
   cairo_surface_destroy(imsurf);
 
@@ -166,8 +167,17 @@ bool DrawImage(
     return false;
   }
 
-  if ((image.BufferType() == ImageBufferType::UInt8)
-      && (image.Channels() == 4)) {
+  // The anchor lies within the (scaled & rotated) image, thus its
+  // pixels are at most width + height away from the position. This
+  // check also avoids converting invisible images.
+  if (IsOutsideViewport(
+        context, position,
+        image.Width() * std::abs(scale_x) + image.Height() * std::abs(scale_y)
+          + StrokeMargin(line_style.width))) {
+    return true;
+  }
+
+  if (IsCairoCompatibleBuffer(image)) {
     return DrawImageHelper(
           context, image, position, anchor,
           alpha, scale_x, scale_y, rotation, clip_factor,
@@ -1,4 +1,5 @@
 // STL
+#include <algorithm>
 #include <string>
 #include <iomanip>
 #include <exception>
@@ -7,6 +8,9 @@
 #include <tuple>
 #include <cstdlib>
 #include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
 // non-STL, external
 #include <werkzeugkiste/geometry/utils.h>
@@ -16,6 +20,8 @@ namespace wkg = werkzeugkiste::geometry;
 
 // Custom
 #include <helpers/drawing_helpers.h>
+#include <helpers/marker_sprite_cache.h>
+#include <helpers/polyline_simplification.h>
 #include <helpers/enum.h>
 
 
@@ -68,6 +74,11 @@ bool DrawArc(
   // Move to the center of the pixel coordinates:
   center += 0.5;
 
+  if (IsOutsideViewport(
+        context, center, radius + StrokeMargin(line_style.width))) {
+    return true;
+  }
+
   cairo_save(context);
   cairo_arc(context, center.X(), center.Y(), radius,
             wkg::Deg2Rad(angle1), wkg::Deg2Rad(angle2));
@@ -180,6 +191,12 @@ bool DrawArrow(
       ? (from - tip_dir_1st_b)
       : Vec2d();
 
+  if (IsOutsideViewport(
+        context, from, to,
+        std::abs(tip_length) + StrokeMargin(arrow_style.width))) {
+    return true;
+  }
+
   // Start drawing
   cairo_save(context);
 
@@ -284,6 +301,13 @@ bool DrawEllipse(
   // Shift to the pixel center (so 1px borders are drawn correctly).
   ellipse += 0.5;
 
+  if (IsOutsideViewport(
+        context, Vec2d(ellipse.cx, ellipse.cy),
+        0.5 * std::max(ellipse.major_axis, ellipse.minor_axis)
+          + StrokeMargin(line_style.width))) {
+    return true;
+  }
+
   // We'll scale the context, so we can draw the ellipse as a
   // unit circle.
   const double scale_x = ellipse.major_axis / 2.0;
@@ -404,6 +428,7 @@ bool DrawGradient(
   // `cairo_paint` would not.
   cairo_set_source(context, pattern);
   cairo_mask(context, pattern);
+  MarkClipDirty(context);
   cairo_restore(context);
   cairo_pattern_destroy(pattern);
   return true;
@@ -435,10 +460,6 @@ bool DrawGrid(
     std::swap(top_left.val[1], bottom_right.val[1]);
   }
 
-  // Switch to given line style
-  cairo_save(context);
-  helpers::ApplyLineStyle(context, line_style);
-
   // Check grid limits
   double left = top_left.X();
   double right = bottom_right.X();
@@ -453,6 +474,23 @@ bool DrawGrid(
           cairo_image_surface_get_height(surface));
   }
 
+  if (IsOutsideViewport(
+        context, Vec2d(left, top), Vec2d(right, bottom),
+        StrokeMargin(line_style.width))) {
+    return true;
+  }
+
+  // Pixel-aligned grids can be rendered without Cairo:
+  if (FastDrawGrid(
+        surface, context, left, top, right, bottom,
+        spacing_x, spacing_y, line_style)) {
+    return true;
+  }
+
+  // Switch to given line style
+  cairo_save(context);
+  helpers::ApplyLineStyle(context, line_style, false, true);
+
   // Draw the grid. To support thin lines, we need to
   // shift the coordinates by half a pixel.
   auto num_steps = static_cast<int>(std::floor((right - left) / spacing_x));
@@ -485,6 +523,16 @@ bool DrawLine(
     return false;
   }
 
+  if (IsOutsideViewport(
+        context, from, to, StrokeMargin(line_style.width))) {
+    return true;
+  }
+
+  // Horizontal & vertical lines can be rendered without Cairo:
+  if (FastDrawLine(surface, context, from, to, line_style)) {
+    return true;
+  }
+
   // Adjust coordinates to support thin (1px) lines
   from += 0.5;
   to += 0.5;
@@ -504,7 +552,64 @@ bool DrawLine(
 }
 
 
+//---------------------------------------------------- Line segments
+bool DrawLineSegments(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<Vec2d> &endpoints, const LineStyle &line_style) {
+  if (!CheckCanvas(surface, context)
+      || !CheckLineStyle(line_style)) {
+    return false;
+  }
+
+  if ((endpoints.size() % 2) != 0) {
+    SPDLOG_WARN(
+          "Line segments require an even number of endpoints, got {:d}!",
+          endpoints.size());
+    return false;
+  }
+
+  cairo_save(context);
+  helpers::ApplyLineStyle(context, line_style);
+
+  // All segments are added as separate sub-paths, thus each
+  // one starts its own dash pattern, the same as `DrawLine`.
+  // Invisible segments can simply be skipped.
+  const Viewport viewport(context);
+  const Viewport counting = viewport.Counting();
+  const double margin = StrokeMargin(line_style.width);
+  std::size_t num_culled = 0;
+  UserBounds dirty;
+  for (std::size_t idx = 0; idx < endpoints.size(); idx += 2) {
+    const Vec2d from = endpoints[idx] + 0.5;
+    const Vec2d to = endpoints[idx + 1] + 0.5;
+    if (!viewport.Intersects(from, to, margin)) {
+      if (!counting.Intersects(from, to, margin)) {
+        ++num_culled;
+      }
+      continue;
+    }
+    dirty.Add(from, to, margin);
+    cairo_move_to(context, from.X(), from.Y());
+    cairo_line_to(context, to.X(), to.Y());
+  }
+  cairo_stroke(context);
+  CountCulled(context, num_culled);
+  MarkDirty(context, dirty);
+
+  cairo_restore(context);
+  return true;
+}
+
+
 //---------------------------------------------------- Marker
+/// Returns the maximum distance of a marker's pixels (including its
+/// background) from its position, used to cull off-screen markers.
+inline double MarkerMargin(const MarkerStyle &style) {
+  return std::abs(style.size) + std::max(0.0, style.background_border)
+      + StrokeMargin(style.thickness);
+}
+
+
 /// Returns the number of steps needed to draw the given n-gon, the rotation
 /// angle for the context, and the interior angle.
 inline std::tuple<int, double, double> NGonMarkerSteps(Marker m) {
@@ -549,59 +654,12 @@ inline std::tuple<int, double, double> NGonMarkerSteps(Marker m) {
   }
 }
 
-bool DrawMarker(
-    cairo_surface_t *surface, cairo_t *context,
-    Vec2d pos, const MarkerStyle &style) {
-  // General idea for all markers implemented so far:
-  // * Translate the canvas
-  // * Create the path(s), i.e. the marker shape's outline
-  // * Either fill or stroke (xor! I don't want to deal
-  //   with the effects of partially translucent colors
-  //   which overlap between fill and stroke)
-
-  // Sanity checks
-  if (!CheckCanvas(surface, context)) {
-    return false;
-  }
-
-  if (!style.IsValid()) {
-    std::string s("Cannot draw with invalid marker style ");
-    s += style.ToString();
-    s += '!';
-    SPDLOG_WARN(s);
-    return false;
-  }
-
-  cairo_save(context);
-
-  // Move to the center of the pixel coordinates, so each
-  // marker can be drawn as if it's at the origin:
-  pos += 0.5;
-  cairo_translate(context, pos.X(), pos.Y());
-
-  const double miter_limit = cairo_get_miter_limit(context);
+/// Extends the current path by the given marker's shape, centered at
+/// the origin of the current user space. Note that this changes the
+/// transformation matrix (the caller must restore it).
+void PathHelperMarker(
+    cairo_t *context, const MarkerStyle &style, double miter_limit) {
   double half_size = style.size / 2.0;
-
-  // Optionally draw a bubble (or square) behind the marker to improve contrast
-  if (style.background_color.IsValid()) {
-    ApplyColor(context, style.background_color);
-    if (style.marker == Marker::Square) {
-      cairo_rectangle(
-            context,
-            -half_size - style.background_border,
-            -half_size - style.background_border,
-            style.size + 2 * style.background_border,
-            style.size + 2 * style.background_border);
-    } else {
-      cairo_arc(
-            context, 0.0, 0.0, half_size + style.background_border,
-            0.0, 2 * M_PI);
-    }
-    cairo_fill(context);
-  }
-
-  ApplyMarkerStyle(context, style);
-  cairo_new_path(context);
   switch (style.marker) {
     case Marker::Circle:
     case Marker::Point: {
@@ -756,6 +814,194 @@ bool DrawMarker(
         break;
       }
   }
+}
+
+
+/// Extends the current path by the background shape (*i.e.* the
+/// bubble or square) of the given marker, centered at the origin.
+inline void PathHelperMarkerBackground(
+    cairo_t *context, const MarkerStyle &style) {
+  const double half_size = style.size / 2.0;
+  if (style.marker == Marker::Square) {
+    cairo_rectangle(
+          context,
+          -half_size - style.background_border,
+          -half_size - style.background_border,
+          style.size + 2 * style.background_border,
+          style.size + 2 * style.background_border);
+  } else {
+    cairo_new_sub_path(context);
+    cairo_arc(
+          context, 0.0, 0.0, half_size + style.background_border,
+          0.0, 2 * M_PI);
+  }
+}
+
+
+std::shared_ptr<const MarkerSprite> RenderMarkerSprite(
+    const MarkerStyle &style, double miter_limit, RenderQuality quality,
+    int phase_x, int phase_y) {
+  auto sprite = std::make_shared<MarkerSprite>();
+  sprite->half_size = MarkerSpriteHalfSize(style);
+  const int dim = 2 * sprite->half_size + 2;
+  const double cx = sprite->half_size
+      + static_cast<double>(phase_x) / kMarkerSpriteSubpixelSteps;
+  const double cy = sprite->half_size
+      + static_cast<double>(phase_y) / kMarkerSpriteSubpixelSteps;
+
+  // The masks only store the coverage, thus we draw with an
+  // opaque source (which is Cairo's default). Both masks must be
+  // rasterized with the same anti-aliasing as the painter's canvas.
+  if (style.background_color.IsValid()) {
+    sprite->background_mask = cairo_image_surface_create(
+          CAIRO_FORMAT_A8, dim, dim);
+    cairo_t *context = cairo_create(sprite->background_mask);
+    ApplyRenderQuality(context, quality);
+    cairo_translate(context, cx, cy);
+    PathHelperMarkerBackground(context, style);
+    cairo_fill(context);
+    cairo_destroy(context);
+    cairo_surface_flush(sprite->background_mask);
+  }
+
+  sprite->marker_mask = cairo_image_surface_create(CAIRO_FORMAT_A8, dim, dim);
+  cairo_t *context = cairo_create(sprite->marker_mask);
+  ApplyRenderQuality(context, quality);
+  cairo_set_miter_limit(context, miter_limit);
+  cairo_translate(context, cx, cy);
+  ApplyMarkerStyle(context, style);
+  cairo_set_source_rgba(context, 0.0, 0.0, 0.0, 1.0);
+  cairo_new_path(context);
+  PathHelperMarker(context, style, miter_limit);
+  if (style.IsFilled()) {
+    cairo_fill(context);
+  } else {
+    cairo_stroke(context);
+  }
+  cairo_destroy(context);
+  cairo_surface_flush(sprite->marker_mask);
+
+  SPDLOG_TRACE(
+        "Rasterized {:d}x{:d} marker sprite for {:s}, phase=({:d}, {:d}).",
+        dim, dim, style, phase_x, phase_y);
+  return sprite;
+}
+
+
+/// Returns true if the markers should be stamped from sprites.
+inline bool UseMarkerSprites(
+    MarkerSpriteCache *sprite_cache, const MarkerStyle &style) {
+  return (sprite_cache != nullptr)
+      && (sprite_cache->Capacity() > 0)
+      && (MarkerSpriteHalfSize(style) <= kMarkerSpriteMaxHalfSize);
+}
+
+
+/// Stamps markers from their sprites. Requires an identity transformation
+/// and the source color to be set up by the caller. Markers at positions
+/// which cannot be represented (too far off the canvas) are skipped.
+class MarkerStamper {
+public:
+  MarkerStamper(
+      cairo_t *context, MarkerSpriteCache *sprite_cache,
+      const MarkerStyle &style)
+    : context_(context), cache_(sprite_cache), style_(style),
+      half_size_(MarkerSpriteHalfSize(style)),
+      miter_limit_(cairo_get_miter_limit(context)),
+      quality_(GetRenderQuality(context))
+  {}
+
+  void Stamp(const Vec2d &pos, bool background) {
+    int x, y, phase_x, phase_y;
+    if (!QuantizeMarkerPosition(
+          pos, half_size_, x, y, phase_x, phase_y)) {
+      return;
+    }
+
+    // Look up each sub-pixel phase only once per batch, to avoid
+    // locking the cache for each marker:
+    auto &sprite = sprites_[phase_y * kMarkerSpriteSubpixelSteps + phase_x];
+    if (!sprite) {
+      sprite = cache_->Get(
+          style_, miter_limit_, quality_, phase_x, phase_y);
+    }
+
+    cairo_mask_surface(
+          context_,
+          background ? sprite->background_mask : sprite->marker_mask,
+          x, y);
+  }
+
+private:
+  cairo_t *context_;
+  MarkerSpriteCache *cache_;
+  const MarkerStyle &style_;
+  int half_size_;
+  double miter_limit_;
+  RenderQuality quality_;
+  std::shared_ptr<const MarkerSprite> sprites_[
+      kMarkerSpriteSubpixelSteps * kMarkerSpriteSubpixelSteps];
+};
+
+
+bool DrawMarker(
+    cairo_surface_t *surface, cairo_t *context,
+    Vec2d pos, const MarkerStyle &style,
+    MarkerSpriteCache *sprite_cache) {
+  // General idea for all markers implemented so far:
+  // * Translate the canvas
+  // * Create the path(s), i.e. the marker shape's outline
+  // * Either fill or stroke (xor! I don't want to deal
+  //   with the effects of partially translucent colors
+  //   which overlap between fill and stroke)
+
+  // Sanity checks
+  if (!CheckCanvas(surface, context)) {
+    return false;
+  }
+
+  if (!style.IsValid()) {
+    std::string s("Cannot draw with invalid marker style ");
+    s += style.ToString();
+    s += '!';
+    SPDLOG_WARN(s);
+    return false;
+  }
+
+  if (IsOutsideViewport(context, pos + 0.5, MarkerMargin(style))) {
+    return true;
+  }
+
+  cairo_save(context);
+
+  if (UseMarkerSprites(sprite_cache, style)) {
+    cairo_identity_matrix(context);
+    MarkerStamper stamper(context, sprite_cache, style);
+    if (style.background_color.IsValid()) {
+      ApplyColor(context, style.background_color);
+      stamper.Stamp(pos, true);
+    }
+    ApplyColor(context, style.color);
+    stamper.Stamp(pos, false);
+    cairo_restore(context);
+    return true;
+  }
+
+  // Move to the center of the pixel coordinates, so each
+  // marker can be drawn as if it's at the origin:
+  pos += 0.5;
+  cairo_translate(context, pos.X(), pos.Y());
+
+  // Optionally draw a bubble (or square) behind the marker to improve contrast
+  if (style.background_color.IsValid()) {
+    ApplyColor(context, style.background_color);
+    PathHelperMarkerBackground(context, style);
+    cairo_fill(context);
+  }
+
+  ApplyMarkerStyle(context, style);
+  cairo_new_path(context);
+  PathHelperMarker(context, style, cairo_get_miter_limit(context));
 
   if (style.IsFilled()) {
     cairo_fill(context);
@@ -768,12 +1014,257 @@ bool DrawMarker(
 }
 
 
+//---------------------------------------------------- Markers (batch)
+namespace {
+/// Keeps track of the device-space bounding boxes of the markers which
+/// will be drawn via a single path. This is only possible if their pixels
+/// don't overlap, otherwise both the drawing order and the blending of
+/// the anti-aliased edges would differ from drawing them one by one.
+class MarkerOverlapGrid {
+public:
+  MarkerOverlapGrid(cairo_t *context, double margin) {
+    cairo_get_matrix(context, &matrix_);
+    // Half size of a marker's box in device space, enlarged by one
+    // pixel to separate the anti-aliased edges.
+    const double scale = std::max(
+          std::abs(matrix_.xx) + std::abs(matrix_.xy),
+          std::abs(matrix_.yx) + std::abs(matrix_.yy));
+    // Two boxes overlap if their centers are less than two half sizes
+    // apart along both axes, which is also used as the cell size.
+    cell_size_ = 2.0 * (margin * scale + 1.0);
+  }
+
+
+  /// Adds the box of the marker at the given (user space) position.
+  /// Returns false (and doesn't add the box) if it overlaps any of the
+  /// previously added boxes or if it cannot be located, *i.e.* the
+  /// position is not finite.
+  bool TryAdd(const Vec2d &pos) {
+    double x = pos.X();
+    double y = pos.Y();
+    cairo_matrix_transform_point(&matrix_, &x, &y);
+    if (!std::isfinite(x) || !std::isfinite(y)) {
+      return false;
+    }
+
+    // Boxes can only overlap if they are in neighboring cells.
+    const int64_t cell_x = static_cast<int64_t>(std::floor(x / cell_size_));
+    const int64_t cell_y = static_cast<int64_t>(std::floor(y / cell_size_));
+    for (int64_t dy = -1; dy <= 1; ++dy) {
+      for (int64_t dx = -1; dx <= 1; ++dx) {
+        const auto it = cells_.find(CellKey(cell_x + dx, cell_y + dy));
+        if (it == cells_.end()) {
+          continue;
+        }
+        for (const auto &center : it->second) {
+          if ((std::abs(center.X() - x) < cell_size_)
+              && (std::abs(center.Y() - y) < cell_size_)) {
+            return false;
+          }
+        }
+      }
+    }
+    cells_[CellKey(cell_x, cell_y)].push_back(Vec2d(x, y));
+    return true;
+  }
+
+
+  /// Removes all boxes.
+  void Clear() { cells_.clear(); }
+
+private:
+  cairo_matrix_t matrix_;
+  double cell_size_;
+  std::unordered_map<uint64_t, std::vector<Vec2d>> cells_;
+
+  static uint64_t CellKey(int64_t x, int64_t y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32)
+        | static_cast<uint64_t>(static_cast<uint32_t>(y));
+  }
+};
+
+
+/// Appends the paths of the given markers to the current path, using
+/// absolute coordinates.
+inline void PathHelperMarkerBatch(
+    cairo_t *context, const std::vector<std::pair<Vec2d, Color>> &markers,
+    std::vector<std::size_t>::const_iterator begin,
+    std::vector<std::size_t>::const_iterator end,
+    const MarkerStyle &style, const cairo_matrix_t &matrix,
+    bool background) {
+  const double miter_limit = cairo_get_miter_limit(context);
+  for (auto it = begin; it != end; ++it) {
+    const Vec2d pos = markers[*it].first + 0.5;
+    cairo_set_matrix(context, &matrix);
+    cairo_translate(context, pos.X(), pos.Y());
+    // The path is stored in device space, so we can change the
+    // transformation between the sub-paths:
+    cairo_new_sub_path(context);
+    if (background) {
+      PathHelperMarkerBackground(context, style);
+    } else {
+      PathHelperMarker(context, style, miter_limit);
+    }
+  }
+  // Fill/stroke with the original transformation:
+  cairo_set_matrix(context, &matrix);
+}
+} // anonymous namespace
+
+
+bool DrawMarkers(
+    cairo_surface_t *surface, cairo_t *context,
+    const std::vector<std::pair<Vec2d, Color>> &markers,
+    const MarkerStyle &style, MarkerSpriteCache *sprite_cache) {
+  if (!CheckCanvas(surface, context)) {
+    return false;
+  }
+
+  if (markers.empty()) {
+    return true;
+  }
+
+  auto effective_color = [&markers, &style](std::size_t idx) -> const Color& {
+    return markers[idx].second.IsValid() ? markers[idx].second : style.color;
+  };
+  const Viewport viewport(context);
+  const Viewport counting = viewport.Counting();
+  const double margin = MarkerMargin(style);
+  std::vector<std::size_t> visible;
+  visible.reserve(markers.size());
+  std::size_t num_culled = 0;
+  UserBounds dirty;
+  for (std::size_t idx = 0; idx < markers.size(); ++idx) {
+    if (viewport.Intersects(markers[idx].first + 0.5, margin)) {
+      visible.push_back(idx);
+      dirty.Add(markers[idx].first + 0.5, margin);
+    } else if (!counting.Intersects(markers[idx].first + 0.5, margin)) {
+      ++num_culled;
+    }
+  }
+  CountCulled(context, num_culled);
+  MarkDirty(context, dirty);
+
+  // Split the visible markers into runs which can be drawn via a single
+  // path each, *i.e.* consecutive markers of the same effective color
+  // which don't overlap. The runs are drawn in input order, thus the
+  // result is the same as drawing each marker separately.
+  // Markers with an invalid style are skipped.
+  const bool use_sprites = UseMarkerSprites(sprite_cache, style);
+  MarkerStyle s(style);
+  bool success = true;
+  bool valid_color = false;
+  bool break_run = true;
+  MarkerOverlapGrid grid(context, margin);
+  std::vector<std::size_t> valid;
+  valid.reserve(visible.size());
+  std::vector<std::pair<std::size_t, std::size_t>> runs;
+  for (std::size_t pos = 0; pos < visible.size(); ++pos) {
+    const std::size_t idx = visible[pos];
+    if ((pos == 0)
+        || (effective_color(idx) != effective_color(visible[pos - 1]))) {
+      s.color = effective_color(idx);
+      valid_color = s.IsValid();
+      if (!valid_color) {
+        std::string msg("Cannot draw with invalid marker style ");
+        msg += s.ToString();
+        msg += '!';
+        SPDLOG_WARN(msg);
+        success = false;
+      }
+      break_run = true;
+    }
+
+    if (!valid_color) {
+      continue;
+    }
+
+    if (use_sprites) {
+      // Sprites are stamped one by one, thus they don't need runs
+      valid.push_back(idx);
+      continue;
+    }
+
+    if (break_run || !grid.TryAdd(markers[idx].first + 0.5)) {
+      grid.Clear();
+      // A marker which cannot be located ends up in its own run
+      break_run = !grid.TryAdd(markers[idx].first + 0.5);
+      runs.push_back(std::make_pair(valid.size(), valid.size()));
+    }
+    valid.push_back(idx);
+    runs.back().second = valid.size();
+  }
+
+  if (valid.empty()) {
+    return success;
+  }
+
+  cairo_save(context);
+
+  if (use_sprites) {
+    // Each marker is stamped individually and in input order, thus
+    // overlapping markers are stacked & blended the same way as if they
+    // were drawn one by one.
+    cairo_identity_matrix(context);
+    MarkerStamper stamper(context, sprite_cache, style);
+    const bool background = style.background_color.IsValid();
+    for (std::size_t pos = 0; pos < valid.size(); ++pos) {
+      const std::size_t idx = valid[pos];
+      if (background) {
+        ApplyColor(context, style.background_color);
+        stamper.Stamp(markers[idx].first, true);
+      }
+
+      if (background || (pos == 0)
+          || (effective_color(idx) != effective_color(valid[pos - 1]))) {
+        ApplyColor(context, effective_color(idx));
+      }
+      stamper.Stamp(markers[idx].first, false);
+    }
+
+    cairo_restore(context);
+    return success;
+  }
+
+  cairo_matrix_t matrix;
+  cairo_get_matrix(context, &matrix);
+  cairo_new_path(context);
+
+  // Since the markers of a run don't overlap, all of their (optional)
+  // background bubbles and then all of their shapes can be filled or
+  // stroked at once, even if the colors are translucent.
+  for (const auto &run : runs) {
+    if (style.background_color.IsValid()) {
+      ApplyColor(context, style.background_color);
+      PathHelperMarkerBatch(
+            context, markers, valid.cbegin() + run.first,
+            valid.cbegin() + run.second, style, matrix, true);
+      cairo_fill(context);
+    }
+
+    s.color = effective_color(valid[run.first]);
+    ApplyMarkerStyle(context, s);
+    PathHelperMarkerBatch(
+          context, markers, valid.cbegin() + run.first,
+          valid.cbegin() + run.second, s, matrix, false);
+    if (s.IsFilled()) {
+      cairo_fill(context);
+    } else {
+      cairo_stroke(context);
+    }
+  }
+
+  cairo_restore(context);
+  return success;
+}
+
+
 //---------------------------------------------------- Polygon
 bool DrawPolygon(
     cairo_surface_t *surface, cairo_t *context,
     const std::vector<Vec2d> &points,
     const LineStyle &line_style,
-    Color fill_color) {
+    Color fill_color, double simplify_tolerance) {
   if (!CheckCanvas(surface, context)
       || !CheckLineStyleAndFill(line_style, fill_color)) {
     return false;
@@ -784,13 +1275,50 @@ bool DrawPolygon(
     return false;
   }
 
+  const double margin = StrokeMargin(line_style.width) + 0.5;
+  if (IsOutsideViewport(context, points, margin)) {
+    return true;
+  }
+
+  std::vector<Vec2d> simplified;
+  if (simplify_tolerance > 0.0) {
+    const auto keep = SimplifyPolyline(points, simplify_tolerance);
+    if (keep.size() < points.size()) {
+      simplified.reserve(keep.size());
+      for (std::size_t idx : keep) {
+        simplified.push_back(points[idx]);
+      }
+    }
+  }
+  const std::vector<Vec2d> &path = simplified.empty() ? points : simplified;
+
   cairo_save(context);
-  auto from = points[0] + 0.5;
-  cairo_move_to(context, from.X(), from.Y());
-  for (std::size_t idx = 1; idx < points.size(); ++idx) {
-    auto to = points[idx] + 0.5;
-    cairo_line_to(context, to.X(), to.Y());
-    from = to;
+  if (!fill_color.IsValid() && !line_style.IsDashed()) {
+    // The contour is not closed, thus a long polygon can be trimmed
+    // to its visible runs (and each run becomes a separate sub-path).
+    const Viewport viewport(context);
+    const auto runs = VisiblePolylineRuns(viewport, path, margin);
+    if (runs.empty()
+        && (!viewport.HasCountingRegion()
+            || VisiblePolylineRuns(viewport.Counting(), path, margin).empty())) {
+      CountCulled(context);
+    }
+    for (const auto &run : runs) {
+      const auto from = path[run.first] + 0.5;
+      cairo_move_to(context, from.X(), from.Y());
+      for (std::size_t idx = run.first + 1; idx <= run.second; ++idx) {
+        const auto to = path[idx] + 0.5;
+        cairo_line_to(context, to.X(), to.Y());
+      }
+    }
+  } else {
+    auto from = path[0] + 0.5;
+    cairo_move_to(context, from.X(), from.Y());
+    for (std::size_t idx = 1; idx < path.size(); ++idx) {
+      auto to = path[idx] + 0.5;
+      cairo_line_to(context, to.X(), to.Y());
+      from = to;
+    }
   }
   if (fill_color.IsValid()) {
     helpers::ApplyColor(context, fill_color);
@@ -823,6 +1351,19 @@ bool DrawRect(
     return false;
   }
 
+  // Half the diagonal covers any rotation:
+  if (IsOutsideViewport(
+        context, Vec2d(rect.cx, rect.cy) + 0.5,
+        0.5 * std::sqrt(rect.width * rect.width + rect.height * rect.height)
+          + StrokeMargin(line_style.width))) {
+    return true;
+  }
+
+  // Simple boxes can be rendered without Cairo:
+  if (FastDrawRect(surface, context, rect, line_style, fill_color)) {
+    return true;
+  }
+
   // Shift to the pixel center (so 1px borders are drawn correctly)
   rect += 0.5;
 
@@ -839,12 +1380,17 @@ bool DrawRect(
           rect.width, rect.height);
   }
 
+  // Apply the line style first, so that filling and stroking use the
+  // same anti-aliasing mode (which depends on the render quality):
+  helpers::ApplyLineStyle(
+        context, line_style, false,
+        (rect.radius <= 0.0) && (std::fmod(rect.rotation, 90.0) == 0.0));
   if (fill_color.IsValid()) {
     helpers::ApplyColor(context, fill_color);
     cairo_fill_preserve(context);
+    helpers::ApplyColor(context, line_style.color);
   }
 
-  helpers::ApplyLineStyle(context, line_style);
   cairo_stroke(context);
   // Restore context
   cairo_restore(context);
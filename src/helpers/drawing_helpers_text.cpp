@@ -65,15 +65,38 @@ void SingleLineText::Align(
 }
 
 
+Rect SingleLineText::BoundingBox() const {
+  return Rect::FromLTWH(
+        reference_point.X() + bearing_x + 0.5,
+        reference_point.Y() + bearing_y + 0.5,
+        width, height);
+}
+
+
 void SingleLineText::PlaceText(cairo_t *context) const {
   // Shift to the pixel center, and move to the origin of the
   // first glyph. Then, let Cairo render the text:
   const auto position = reference_point + 0.5;
+  // The cached glyphs can only be used if we draw with the same font
+  // which was used to measure the text.
+  if (shaped && (cairo_get_scaled_font(context) == shaped->scaled_font)) {
+    ShowShapedText(context, *shaped, position.X(), position.Y());
+    return;
+  }
   cairo_move_to(context, position.X(), position.Y());
   cairo_show_text(context, text);
 }
 
 
+bool SingleLineText::PlaceText(
+    cairo_surface_t *surface, cairo_t *context,
+    const GlyphAtlas &atlas, const Color &color) const {
+  const auto position = reference_point + 0.5;
+  return BlitAtlasText(
+        surface, context, atlas, text, position.X(), position.Y(), color);
+}
+
+
 void SingleLineText::Init(
     cairo_t *context, cairo_font_extents_t *font_metrics) {
   // Compute extent:
@@ -81,7 +104,12 @@ void SingleLineText::Init(
   //   height: either actual height or
   //     font height.
   cairo_text_extents_t text_extent;
-  cairo_text_extents(context, text, &text_extent);
+  shaped = GetShapedText(context, text);
+  if (shaped) {
+    text_extent = shaped->extents;
+  } else {
+    cairo_text_extents(context, text, &text_extent);
+  }
 
   width = std::round(text_extent.width);
   bearing_x = std::round(text_extent.x_bearing);
@@ -102,7 +130,7 @@ MultiLineText::MultiLineText(
   : top_left(0.0, 0.0), padding(0.0, 0.0), fixed_size(0.0, 0.0),
     width(0.0), height(0.0), style(text_style) {
   cairo_font_extents_t font_extent;
-  cairo_font_extents(context, &font_extent);
+  FontExtents(context, text_style, &font_extent);
 
   for (std::size_t idx = 0; idx < text.size(); ++idx) {
     lines.push_back(
@@ -201,6 +229,17 @@ void MultiLineText::PlaceText(cairo_t *context) const {
 }
 
 
+void MultiLineText::PlaceText(
+    cairo_surface_t *surface, cairo_t *context,
+    const GlyphAtlas &atlas, const Color &color) const {
+  for (const auto &line : lines) {
+    if (!line.PlaceText(surface, context, atlas, color)) {
+      line.PlaceText(context);
+    }
+  }
+}
+
+
 double MultiLineText::Width() const {
   return (fixed_size.Width() > 0.0)
       ? fixed_size.Width()
@@ -227,7 +266,7 @@ Rect DrawText(cairo_surface_t *surface, cairo_t *context,
     const TextStyle &text_style, const Vec2d &padding,
     double rotation, const LineStyle &box_line_style,
     const Color &box_fill_color, double box_corner_radius,
-    const Vec2d &fixed_box_size) {
+    const Vec2d &fixed_box_size, bool bitmap_text) {
   if (!CheckCanvas(surface, context)) {
     return Rect();
   }
@@ -285,20 +324,34 @@ Rect DrawText(cairo_surface_t *surface, cairo_t *context,
   cairo_stroke(context);
 #endif  // VIREN2D_DEBUG_TEXT_EXTENT
 
-  // Reuse DrawRect() if we need to draw a text box:
-  if (box_fill_color.IsValid() || box_line_style.IsValid()) {
-    DrawRect(
-          surface, context,
-          mlt.BoundingBox(box_corner_radius),
-          box_line_style, box_fill_color);
+  // Skip the text if it lies outside the viewport. The margin covers
+  // glyphs which exceed their logical extent and the box contour.
+  const Rect text_box = mlt.BoundingBox(box_corner_radius);
+  const double margin = std::abs(text_style.size)
+      + StrokeMargin(box_line_style.width);
+  if (!IsOutsideViewport(
+        context, text_box.left() - margin, text_box.top() - margin,
+        text_box.right() + margin, text_box.bottom() + margin)) {
+    // Reuse DrawRect() if we need to draw a text box:
+    if (box_fill_color.IsValid() || box_line_style.IsValid()) {
+      DrawRect(
+            surface, context, text_box,
+            box_line_style, box_fill_color);
+    }
+
+    // Now that the optional text box has been drawn, we
+    // have to make sure that we plot the text in the
+    // correct color.
+    ApplyColor(context, text_style.color);
+    // The glyph atlas is only available for unrotated text:
+    const auto atlas = bitmap_text ? GetGlyphAtlas(context) : nullptr;
+    if (atlas) {
+      mlt.PlaceText(surface, context, *atlas, text_style.color);
+    } else {
+      mlt.PlaceText(context);
+    }
   }
 
-  // Now that the optional text box has been drawn, we
-  // have to make sure that we plot the text in the
-  // correct color.
-  ApplyColor(context, text_style.color);
-  mlt.PlaceText(context);
-
   // Pop the original context.
   cairo_new_path(context);
   cairo_restore(context);
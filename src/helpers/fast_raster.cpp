@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <helpers/fast_raster.h>
+#include <helpers/drawing_helpers.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Converts a color component to 16 bit, exactly like Cairo does.
+inline std::uint32_t ColorToShort(double value) {
+  return static_cast<std::uint32_t>(
+        std::min(1.0, std::max(0.0, value)) * 65535.0 + 0.5);
+}
+
+
+/// Returns true if the style would be stroked exactly like a solid,
+/// rectilinear path, *i.e.* without dashes.
+inline bool IsSolidLineStyle(const LineStyle &style) {
+  return style.IsValid() && style.dash_pattern.empty();
+}
+
+
+/// Returns the fill color to be used along with the given line style, or
+/// an invalid color if the combination cannot be rendered natively.
+/// Follows the conventions of `CheckLineStyleAndFill`.
+inline bool ResolveStyles(const LineStyle &line_style, Color &fill_color) {
+  if (fill_color.IsSpecialSame()) {
+    fill_color = line_style.color.WithAlpha(fill_color.alpha);
+  }
+  if (!line_style.IsValid()) {
+    // Cairo would stroke an invalid style with the fill color if it
+    // has a positive width. This corner case is left to Cairo.
+    return fill_color.IsValid() && (line_style.width <= 0.0);
+  }
+  return line_style.dash_pattern.empty();
+}
+
+
+/// Adds the pixels of the given rectangular ring, *i.e.* outer minus
+/// inner, as (up to) 4 disjoint rectangles.
+void AddRing(
+    const PixelRect &outer, const PixelRect &inner,
+    std::vector<PixelRect> &rects) {
+  if (inner.IsEmpty()) {
+    rects.push_back(outer);
+    return;
+  }
+  rects.emplace_back(outer.left, outer.top, outer.right, inner.top);
+  rects.emplace_back(outer.left, inner.bottom, outer.right, outer.bottom);
+  rects.emplace_back(outer.left, inner.top, inner.left, inner.bottom);
+  rects.emplace_back(inner.right, inner.top, outer.right, inner.bottom);
+}
+
+
+/// Computes the pixel span [x0, x1) of the given row whose centers lie
+/// within the circle. Returns false if the row does not intersect it.
+inline bool CircleSpan(
+    double cx, double cy, double radius, int row, int &x0, int &x1) {
+  const double dy = (row + 0.5) - cy;
+  const double sq = radius * radius - dy * dy;
+  if ((radius <= 0.0) || (sq < 0.0)) {
+    return false;
+  }
+  const double half = std::sqrt(sq);
+  x0 = static_cast<int>(std::ceil(cx - half - 0.5));
+  x1 = static_cast<int>(std::floor(cx + half - 0.5)) + 1;
+  return x0 < x1;
+}
+} // anonymous namespace
+
+
+//---------------------------------------------------- PixelColor
+PixelColor::PixelColor(const Color &color) {
+  // Cairo stores the colors in BGRA order, see `ApplyColor`. Thus, our
+  // red component ends up in the lowest byte of the native pixel.
+  const double alpha = std::min(1.0, std::max(0.0, color.alpha));
+  const std::uint32_t a = ColorToShort(alpha) >> 8;
+  const std::uint32_t r = ColorToShort(color.blue * alpha) >> 8;
+  const std::uint32_t g = ColorToShort(color.green * alpha) >> 8;
+  const std::uint32_t b = ColorToShort(color.red * alpha) >> 8;
+  pixel = (a << 24) | (r << 16) | (g << 8) | b;
+  inv_alpha = 255 - a;
+}
+
+
+//---------------------------------------------------- PixelCanvas
+bool PixelCanvas::Init(cairo_surface_t *surface, cairo_t *context) {
+  if (!surface || !context
+      || (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE)
+      || (cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
+      || (cairo_get_operator(context) != CAIRO_OPERATOR_OVER)) {
+    return false;
+  }
+
+  cairo_matrix_t ctm;
+  cairo_get_matrix(context, &ctm);
+  if ((ctm.xx != 1.0) || (ctm.yy != 1.0)
+      || (ctm.xy != 0.0) || (ctm.yx != 0.0)) {
+    return false;
+  }
+
+  surface_ = surface;
+  offset_x_ = ctm.x0;
+  offset_y_ = ctm.y0;
+  width_ = cairo_image_surface_get_width(surface);
+  height_ = cairo_image_surface_get_height(surface);
+  stride_ = cairo_image_surface_get_stride(surface);
+
+  // We can only honor axis-aligned, pixel-aligned clip regions.
+  clip_.clear();
+  cairo_rectangle_list_t *clip = cairo_copy_clip_rectangle_list(context);
+  if (clip->status != CAIRO_STATUS_SUCCESS) {
+    cairo_rectangle_list_destroy(clip);
+    return false;
+  }
+  for (int idx = 0; idx < clip->num_rectangles; ++idx) {
+    const auto &r = clip->rectangles[idx];
+    const double left = r.x + offset_x_;
+    const double top = r.y + offset_y_;
+    const double right = left + r.width;
+    const double bottom = top + r.height;
+    if ((left != std::floor(left)) || (top != std::floor(top))
+        || (right != std::floor(right)) || (bottom != std::floor(bottom))) {
+      cairo_rectangle_list_destroy(clip);
+      return false;
+    }
+    PixelRect rect(
+          std::max(0, static_cast<int>(left)),
+          std::max(0, static_cast<int>(top)),
+          std::min(width_, static_cast<int>(right)),
+          std::min(height_, static_cast<int>(bottom)));
+    if (!rect.IsEmpty()) {
+      clip_.push_back(rect);
+    }
+  }
+  cairo_rectangle_list_destroy(clip);
+
+  // Complete pending drawing operations before accessing the memory.
+  cairo_surface_flush(surface);
+  data_ = cairo_image_surface_get_data(surface);
+  dirty_ = PixelRect();
+  return data_ != nullptr;
+}
+
+
+bool PixelCanvas::ToPixel(
+    double user, bool horizontal, bool snap, int &pixel) const {
+  const double device = user + (horizontal ? offset_x_ : offset_y_);
+  constexpr double limit = 1e7;
+  if (!std::isfinite(device) || (std::abs(device) > limit)) {
+    return false;
+  }
+
+  const double rounded = std::floor(device + 0.5);
+  if (!snap && (std::abs(device - rounded) > 1e-9)) {
+    return false;
+  }
+  pixel = static_cast<int>(rounded);
+  return true;
+}
+
+
+void PixelCanvas::Fill(const PixelRect &rect, const PixelColor &color) {
+  for (const auto &clip : clip_) {
+    const PixelRect r(
+          std::max(rect.left, clip.left), std::max(rect.top, clip.top),
+          std::min(rect.right, clip.right), std::min(rect.bottom, clip.bottom));
+    if (r.IsEmpty()) {
+      continue;
+    }
+
+    AddDirty(r);
+    const int num_pixels = r.right - r.left;
+    for (int row = r.top; row < r.bottom; ++row) {
+      std::uint32_t *dst = Row(row) + r.left;
+      if (color.IsOpaque()) {
+        std::fill_n(dst, num_pixels, color.pixel);
+      } else {
+        for (int col = 0; col < num_pixels; ++col) {
+          dst[col] = BlendOver(dst[col], color);
+        }
+      }
+    }
+  }
+}
+
+
+void PixelCanvas::FillUnion(
+    const std::vector<PixelRect> &rects, const PixelColor &color) {
+  // Blending an opaque color multiple times does not change the result.
+  if (color.IsOpaque()) {
+    for (const auto &rect : rects) {
+      Fill(rect, color);
+    }
+    return;
+  }
+
+  PixelRect bounds(width_, height_, 0, 0);
+  for (const auto &rect : rects) {
+    if (!rect.IsEmpty()) {
+      bounds.left = std::min(bounds.left, rect.left);
+      bounds.top = std::min(bounds.top, rect.top);
+      bounds.right = std::max(bounds.right, rect.right);
+      bounds.bottom = std::max(bounds.bottom, rect.bottom);
+    }
+  }
+  bounds.top = std::max(bounds.top, 0);
+  bounds.bottom = std::min(bounds.bottom, height_);
+  if (bounds.IsEmpty()) {
+    return;
+  }
+
+  // Merge the spans of each row, then blend each pixel once.
+  std::vector<std::pair<int, int>> spans;
+  for (int row = bounds.top; row < bounds.bottom; ++row) {
+    spans.clear();
+    for (const auto &rect : rects) {
+      if ((row >= rect.top) && (row < rect.bottom)
+          && (rect.left < rect.right)) {
+        spans.emplace_back(rect.left, rect.right);
+      }
+    }
+    std::sort(spans.begin(), spans.end());
+    std::size_t idx = 0;
+    while (idx < spans.size()) {
+      int x0 = spans[idx].first;
+      int x1 = spans[idx].second;
+      for (++idx; (idx < spans.size()) && (spans[idx].first <= x1); ++idx) {
+        x1 = std::max(x1, spans[idx].second);
+      }
+      FillSpan(row, x0, x1, color);
+    }
+  }
+}
+
+
+void PixelCanvas::AddDirty(const PixelRect &rect) {
+  if (dirty_.IsEmpty()) {
+    dirty_ = rect;
+  } else {
+    dirty_.left = std::min(dirty_.left, rect.left);
+    dirty_.top = std::min(dirty_.top, rect.top);
+    dirty_.right = std::max(dirty_.right, rect.right);
+    dirty_.bottom = std::max(dirty_.bottom, rect.bottom);
+  }
+}
+
+
+void PixelCanvas::Finish() {
+  if (surface_ && !dirty_.IsEmpty()) {
+    cairo_surface_mark_dirty_rectangle(
+          surface_, dirty_.left, dirty_.top,
+          dirty_.right - dirty_.left, dirty_.bottom - dirty_.top);
+  }
+  dirty_ = PixelRect();
+}
+
+
+//---------------------------------------------------- Primitives
+bool FastDrawRect(
+    cairo_surface_t *surface, cairo_t *context,
+    const Rect &rect, const LineStyle &line_style, Color fill_color) {
+  if ((rect.rotation != 0.0) || (rect.radius > 0.0) || !rect.IsValid()
+      || !ResolveStyles(line_style, fill_color)) {
+    return false;
+  }
+
+  const bool stroke = line_style.IsValid();
+  if (stroke && (line_style.join != LineJoin::Miter)) {
+    return false;
+  }
+
+  PixelCanvas canvas;
+  if (!canvas.Init(surface, context)) {
+    return false;
+  }
+  const bool snap = (GetRenderQuality(context) == RenderQuality::Fast);
+
+  // Shift to the pixel center, see `DrawRect`.
+  const double left = rect.left() + 0.5;
+  const double right = rect.right() + 0.5;
+  const double top = rect.top() + 0.5;
+  const double bottom = rect.bottom() + 0.5;
+  const double half_width = stroke ? (line_style.width / 2.0) : 0.0;
+
+  PixelRect outer;
+  PixelRect inner;
+  if (stroke) {
+    if (!canvas.ToPixel(left - half_width, true, snap, outer.left)
+        || !canvas.ToPixel(right + half_width, true, snap, outer.right)
+        || !canvas.ToPixel(top - half_width, false, snap, outer.top)
+        || !canvas.ToPixel(bottom + half_width, false, snap, outer.bottom)
+        || !canvas.ToPixel(left + half_width, true, snap, inner.left)
+        || !canvas.ToPixel(right - half_width, true, snap, inner.right)
+        || !canvas.ToPixel(top + half_width, false, snap, inner.top)
+        || !canvas.ToPixel(bottom - half_width, false, snap, inner.bottom)) {
+      return false;
+    }
+  }
+
+  PixelColor stroke_color;
+  if (stroke) {
+    stroke_color = PixelColor(line_style.color);
+  }
+
+  PixelRect fill_rect;
+  if (fill_color.IsValid()) {
+    if (stroke && stroke_color.IsOpaque()) {
+      // An opaque stroke covers the partially filled border pixels.
+      fill_rect = inner;
+    } else if (!canvas.ToPixel(left, true, snap, fill_rect.left)
+               || !canvas.ToPixel(right, true, snap, fill_rect.right)
+               || !canvas.ToPixel(top, false, snap, fill_rect.top)
+               || !canvas.ToPixel(bottom, false, snap, fill_rect.bottom)) {
+      return false;
+    }
+  }
+
+  if (fill_color.IsValid() && !fill_rect.IsEmpty()) {
+    canvas.Fill(fill_rect, PixelColor(fill_color));
+  }
+
+  if (stroke) {
+    std::vector<PixelRect> ring;
+    AddRing(outer, inner, ring);
+    for (const auto &r : ring) {
+      canvas.Fill(r, stroke_color);
+    }
+  }
+  canvas.Finish();
+  return true;
+}
+
+
+bool FastDrawLine(
+    cairo_surface_t *surface, cairo_t *context,
+    const Vec2d &from, const Vec2d &to, const LineStyle &line_style) {
+  const bool horizontal = (from.Y() == to.Y());
+  const bool vertical = (from.X() == to.X());
+  if ((horizontal == vertical) || !IsSolidLineStyle(line_style)
+      || (line_style.cap == LineCap::Round)) {
+    return false;
+  }
+
+  PixelCanvas canvas;
+  if (!canvas.Init(surface, context)) {
+    return false;
+  }
+  const bool snap = (GetRenderQuality(context) == RenderQuality::Fast);
+
+  // Shift to the pixel center, see `DrawLine`.
+  const double half_width = line_style.width / 2.0;
+  const double cap = LineCapOffset(line_style.cap, line_style.width);
+  // Along the line:
+  const double a0 = (horizontal ? std::min(from.X(), to.X())
+                                : std::min(from.Y(), to.Y())) + 0.5 - cap;
+  const double a1 = (horizontal ? std::max(from.X(), to.X())
+                                : std::max(from.Y(), to.Y())) + 0.5 + cap;
+  // Across the line:
+  const double c = (horizontal ? from.Y() : from.X()) + 0.5;
+
+  int p0, p1, q0, q1;
+  if (!canvas.ToPixel(a0, horizontal, snap, p0)
+      || !canvas.ToPixel(a1, horizontal, snap, p1)
+      || !canvas.ToPixel(c - half_width, !horizontal, snap, q0)
+      || !canvas.ToPixel(c + half_width, !horizontal, snap, q1)) {
+    return false;
+  }
+
+  canvas.Fill(
+        horizontal ? PixelRect(p0, q0, p1, q1) : PixelRect(q0, p0, q1, p1),
+        PixelColor(line_style.color));
+  canvas.Finish();
+  return true;
+}
+
+
+bool FastDrawGrid(
+    cairo_surface_t *surface, cairo_t *context,
+    double left, double top, double right, double bottom,
+    double spacing_x, double spacing_y, const LineStyle &line_style) {
+  if (!IsSolidLineStyle(line_style) || (line_style.cap == LineCap::Round)) {
+    return false;
+  }
+
+  PixelCanvas canvas;
+  if (!canvas.Init(surface, context)) {
+    return false;
+  }
+  const bool snap = (GetRenderQuality(context) == RenderQuality::Fast);
+
+  const double half_width = line_style.width / 2.0;
+  const double cap = LineCapOffset(line_style.cap, line_style.width);
+
+  // Collect all lines first, because we must not draw anything if a
+  // single one is not supported.
+  std::vector<PixelRect> lines;
+  int p0, p1;
+  if (!canvas.ToPixel(top - cap, false, snap, p0)
+      || !canvas.ToPixel(bottom + cap, false, snap, p1)) {
+    return false;
+  }
+  // Same iteration as in `DrawGrid`:
+  auto num_steps = static_cast<int>(std::floor((right - left) / spacing_x));
+  double x = left + 0.5;
+  for (int step = 0; step <= num_steps; ++step, x += spacing_x) {
+    int q0, q1;
+    if (!canvas.ToPixel(x - half_width, true, snap, q0)
+        || !canvas.ToPixel(x + half_width, true, snap, q1)) {
+      return false;
+    }
+    lines.emplace_back(q0, p0, q1, p1);
+  }
+
+  if (!canvas.ToPixel(left - cap, true, snap, p0)
+      || !canvas.ToPixel(right + cap, true, snap, p1)) {
+    return false;
+  }
+  num_steps = static_cast<int>(std::floor((bottom - top) / spacing_y));
+  double y = top + 0.5;
+  for (int step = 0; step <= num_steps; ++step, y += spacing_y) {
+    int q0, q1;
+    if (!canvas.ToPixel(y - half_width, false, snap, q0)
+        || !canvas.ToPixel(y + half_width, false, snap, q1)) {
+      return false;
+    }
+    lines.emplace_back(p0, q0, p1, q1);
+  }
+
+  canvas.FillUnion(lines, PixelColor(line_style.color));
+  canvas.Finish();
+  return true;
+}
+
+
+bool FastDrawCircle(
+    cairo_surface_t *surface, cairo_t *context,
+    const Vec2d &center, double radius,
+    const LineStyle &line_style, Color fill_color) {
+  if ((GetRenderQuality(context) != RenderQuality::Fast)
+      || !(radius > 0.0) || !ResolveStyles(line_style, fill_color)) {
+    return false;
+  }
+
+  PixelCanvas canvas;
+  if (!canvas.Init(surface, context)) {
+    return false;
+  }
+
+  // Device coordinates of the center, shifted to the pixel center (see
+  // `DrawArc`).
+  double cx = center.X() + 0.5;
+  double cy = center.Y() + 0.5;
+  canvas.ToDevice(cx, cy);
+  constexpr double limit = 1e7;
+  if (!std::isfinite(cx) || !std::isfinite(cy)
+      || (std::abs(cx) > limit) || (std::abs(cy) > limit)
+      || !std::isfinite(radius) || (radius > limit)) {
+    return false;
+  }
+
+  const bool stroke = line_style.IsValid();
+  const double half_width = stroke ? (line_style.width / 2.0) : 0.0;
+  const double outer_radius = radius + half_width;
+  const double inner_radius = radius - half_width;
+  PixelColor stroke_color;
+  if (stroke) {
+    stroke_color = PixelColor(line_style.color);
+  }
+  // An opaque stroke covers the border of the filled disk.
+  const double fill_radius = (stroke && stroke_color.IsOpaque())
+      ? inner_radius : radius;
+  PixelColor fill;
+  if (fill_color.IsValid()) {
+    fill = PixelColor(fill_color);
+  }
+
+  const int row0 = std::max(
+        0, static_cast<int>(std::floor(cy - outer_radius)));
+  const int row1 = std::min(
+        cairo_image_surface_get_height(surface),
+        static_cast<int>(std::ceil(cy + outer_radius)) + 1);
+  for (int row = row0; row < row1; ++row) {
+    int x0, x1;
+    if (fill_color.IsValid() && CircleSpan(cx, cy, fill_radius, row, x0, x1)) {
+      canvas.FillSpan(row, x0, x1, fill);
+    }
+
+    if (stroke && CircleSpan(cx, cy, outer_radius, row, x0, x1)) {
+      int i0, i1;
+      if (CircleSpan(cx, cy, inner_radius, row, i0, i1)) {
+        canvas.FillSpan(row, x0, i0, stroke_color);
+        canvas.FillSpan(row, i1, x1, stroke_color);
+      } else {
+        canvas.FillSpan(row, x0, x1, stroke_color);
+      }
+    }
+  }
+  canvas.Finish();
+  return true;
+}
+
+} // namespace helpers
+} // namespace viren2d
@@ -0,0 +1,190 @@
+#ifndef __VIREN2D_FAST_RASTER_H__
+#define __VIREN2D_FAST_RASTER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/colors.h>
+#include <viren2d/primitives.h>
+#include <viren2d/styles.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// An axis-aligned rectangle in device space, which covers the pixels
+/// [left, right) x [top, bottom).
+struct PixelRect {
+  int left = 0;
+  int top = 0;
+  int right = 0;
+  int bottom = 0;
+
+  PixelRect() = default;
+  PixelRect(int l, int t, int r, int b)
+    : left(l), top(t), right(r), bottom(b) {}
+
+  bool IsEmpty() const { return (left >= right) || (top >= bottom); }
+};
+
+
+/// A solid source color, premultiplied and packed into a native
+/// ARGB32 pixel exactly like Cairo/pixman would do it.
+struct PixelColor {
+  /// Premultiplied pixel value.
+  std::uint32_t pixel = 0;
+
+  /// 255 - alpha, *i.e.* the weight of the destination for `OVER`.
+  std::uint32_t inv_alpha = 255;
+
+  PixelColor() = default;
+  explicit PixelColor(const Color &color);
+
+  bool IsOpaque() const { return inv_alpha == 0; }
+};
+
+
+/// Direct access to the memory of an ARGB32 image surface for simple
+/// compositing (`OVER` with a solid color) which bypasses Cairo.
+///
+/// Workflow:
+///   1) Call `Init`. If it returns false, direct access is not possible
+///      for the context's current state and Cairo must be used.
+///   2) Convert coordinates via `ToPixel` and composite via
+///      `Fill`/`FillUnion`/`FillSpan`.
+///   3) Call `Finish` to notify Cairo about the modified pixels.
+class PixelCanvas {
+public:
+  PixelCanvas() = default;
+
+  /// Returns false if the surface is not an ARGB32 image surface, or if
+  /// the context is rotated or scaled, uses an operator other than
+  /// `OVER`, or has a clip region which is not pixel-aligned.
+  bool Init(cairo_surface_t *surface, cairo_t *context);
+
+
+  /// Converts the user space coordinate to device space. If `snap` is
+  /// false, it must lie on the pixel grid. Otherwise, it will be rounded
+  /// to the closest grid line.
+  bool ToPixel(double user, bool horizontal, bool snap, int &pixel) const;
+
+
+  /// Converts the user space point to device space.
+  void ToDevice(double &x, double &y) const {
+    x += offset_x_;
+    y += offset_y_;
+  }
+
+
+  /// Composites the solid color over the given pixels.
+  void Fill(const PixelRect &rect, const PixelColor &color);
+
+
+  /// Composites the solid color over the union of the given (possibly
+  /// overlapping) rectangles, *i.e.* each pixel will be blended at most
+  /// once. This is required for translucent colors, as Cairo also
+  /// composites a stroke or fill as a whole.
+  void FillUnion(const std::vector<PixelRect> &rects, const PixelColor &color);
+
+
+  /// Composites the solid color over the pixels [x0, x1) of the given row.
+  void FillSpan(int row, int x0, int x1, const PixelColor &color) {
+    Fill(PixelRect(x0, row, x1, row + 1), color);
+  }
+
+
+  /// Returns the pixel-aligned clip region (already intersected with
+  /// the surface).
+  const std::vector<PixelRect> &ClipRects() const { return clip_; }
+
+
+  /// Returns a pointer to the first pixel of the given row.
+  std::uint32_t *Row(int row) {
+    return reinterpret_cast<std::uint32_t *>(data_ + row * stride_);
+  }
+
+
+  /// Marks the given pixels as modified, see `Finish`.
+  void AddDirty(const PixelRect &rect);
+
+
+  /// Notifies Cairo about the modified pixels.
+  void Finish();
+
+
+private:
+  cairo_surface_t *surface_ = nullptr;
+  unsigned char *data_ = nullptr;
+  int stride_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+  double offset_x_ = 0.0;
+  double offset_y_ = 0.0;
+  std::vector<PixelRect> clip_;
+  PixelRect dirty_;
+};
+
+
+/// Blends the solid color over a single pixel (`OVER` operator), with
+/// the same rounding as pixman.
+inline std::uint32_t BlendOver(std::uint32_t dst, const PixelColor &color) {
+  std::uint32_t rb = (dst & 0x00ff00ffu) * color.inv_alpha + 0x00800080u;
+  rb = ((rb + ((rb >> 8) & 0x00ff00ffu)) >> 8) & 0x00ff00ffu;
+  std::uint32_t ag = ((dst >> 8) & 0x00ff00ffu) * color.inv_alpha + 0x00800080u;
+  ag = (ag + ((ag >> 8) & 0x00ff00ffu)) & 0xff00ff00u;
+  return (rb | ag) + color.pixel;
+}
+
+
+/// Scales all four channels of the pixel by `m / 255`, with the same
+/// rounding as pixman.
+inline std::uint32_t ScalePixel(std::uint32_t pixel, std::uint32_t m) {
+  std::uint32_t rb = (pixel & 0x00ff00ffu) * m + 0x00800080u;
+  rb = ((rb + ((rb >> 8) & 0x00ff00ffu)) >> 8) & 0x00ff00ffu;
+  std::uint32_t ag = ((pixel >> 8) & 0x00ff00ffu) * m + 0x00800080u;
+  ag = (ag + ((ag >> 8) & 0x00ff00ffu)) & 0xff00ff00u;
+  return rb | ag;
+}
+
+
+// The following drawing functions render simple primitives directly into
+// the canvas memory. They return false (without drawing anything) if the
+// primitive or the context state is not supported. Then, the caller must
+// fall back to Cairo.
+// Pixel-aligned geometry is rendered exactly as Cairo would. For
+// `RenderQuality::Fast`, the geometry will be snapped to the pixel grid
+// instead, and circles will be drawn without anti-aliasing.
+
+/// Draws an axis-aligned, non-rounded rectangle, see `DrawRect`.
+bool FastDrawRect(
+    cairo_surface_t *surface, cairo_t *context,
+    const Rect &rect, const LineStyle &line_style, Color fill_color);
+
+
+/// Draws a horizontal or vertical line, see `DrawLine`.
+bool FastDrawLine(
+    cairo_surface_t *surface, cairo_t *context,
+    const Vec2d &from, const Vec2d &to, const LineStyle &line_style);
+
+
+/// Draws the grid lines within the given (already adjusted) limits,
+/// see `DrawGrid`.
+bool FastDrawGrid(
+    cairo_surface_t *surface, cairo_t *context,
+    double left, double top, double right, double bottom,
+    double spacing_x, double spacing_y, const LineStyle &line_style);
+
+
+/// Draws a circle without anti-aliasing. Only supported for
+/// `RenderQuality::Fast`, see `DrawCircle`.
+bool FastDrawCircle(
+    cairo_surface_t *surface, cairo_t *context,
+    const Vec2d &center, double radius,
+    const LineStyle &line_style, Color fill_color);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_FAST_RASTER_H__
@@ -0,0 +1,171 @@
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include <helpers/font_cache.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+CachedFont::~CachedFont() {
+  if (scaled_font) {
+    cairo_scaled_font_destroy(scaled_font);
+  }
+  if (face) {
+    cairo_font_face_destroy(face);
+  }
+}
+
+
+namespace {
+/// Family, italic, bold & size.
+using FontKey = std::tuple<std::string, bool, bool, int>;
+
+
+/// The process-wide font cache.
+struct FontCache {
+  std::mutex mutex;
+  std::map<FontKey, std::shared_ptr<const CachedFont>> fonts;
+  std::size_t capacity = kMaxCachedFonts;
+};
+
+
+FontCache &GlobalFontCache() {
+  // Intentionally leaked, so that the cache can still be used (and
+  // safely released) during static destruction.
+  static FontCache *cache = new FontCache();
+  return *cache;
+}
+
+
+std::shared_ptr<const CachedFont> ResolveFont(
+    cairo_t *context, const TextStyle &text_style) {
+  auto font = std::make_shared<CachedFont>();
+  font->face = cairo_toy_font_face_create(
+        text_style.family.c_str(),
+        (text_style.italic ? CAIRO_FONT_SLANT_ITALIC : CAIRO_FONT_SLANT_NORMAL),
+        (text_style.bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL));
+  if (cairo_font_face_status(font->face) != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_WARN(
+          "Cannot resolve font family \"{:s}\".", text_style.family);
+    return nullptr;
+  }
+
+  // Use the same options Cairo would use for this surface, so that the
+  // glyphs are rendered exactly as with the toy API.
+  cairo_font_options_t *options = cairo_font_options_create();
+  cairo_surface_get_font_options(cairo_get_target(context), options);
+  cairo_font_options_t *context_options = cairo_font_options_create();
+  cairo_get_font_options(context, context_options);
+  cairo_font_options_merge(options, context_options);
+  cairo_font_options_destroy(context_options);
+
+  cairo_matrix_t font_matrix;
+  cairo_matrix_init_scale(
+        &font_matrix, static_cast<double>(text_style.size),
+        static_cast<double>(text_style.size));
+  cairo_matrix_t ctm;
+  cairo_matrix_init_identity(&ctm);
+  font->scaled_font = cairo_scaled_font_create(
+        font->face, &font_matrix, &ctm, options);
+  cairo_font_options_destroy(options);
+
+  if (cairo_scaled_font_status(font->scaled_font) != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_WARN(
+          "Cannot create a scaled font for \"{:s}\", size {:d}.",
+          text_style.family, text_style.size);
+    return nullptr;
+  }
+  cairo_scaled_font_extents(font->scaled_font, &font->extents);
+  return font;
+}
+} // anonymous namespace
+
+
+std::shared_ptr<const CachedFont> GetCachedFont(
+    cairo_t *context, const TextStyle &text_style) {
+  if (!context) {
+    return nullptr;
+  }
+
+  FontKey key(
+        text_style.family, text_style.italic,
+        text_style.bold, text_style.size);
+  FontCache &cache = GlobalFontCache();
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.capacity == 0) {
+      return nullptr;
+    }
+    auto it = cache.fonts.find(key);
+    if (it != cache.fonts.end()) {
+      return it->second;
+    }
+  }
+
+  // Resolve the font without holding the lock, as this may take a while
+  // (font config lookup). If another thread resolved the same font in the
+  // meantime, we use the already cached one.
+  auto font = ResolveFont(context, text_style);
+  if (!font) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.capacity == 0) {
+    // Disabled in the meantime, but the resolved font is still valid
+    return font;
+  }
+  if (cache.fonts.size() >= cache.capacity) {
+    SPDLOG_DEBUG(
+          "Font cache exceeds {:d} fonts, flushing.", cache.capacity);
+    cache.fonts.clear();
+  }
+  return cache.fonts.emplace(std::move(key), font).first->second;
+}
+
+
+void ClearFontCache() {
+  FontCache &cache = GlobalFontCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.fonts.clear();
+}
+
+
+void SetFontCacheCapacity(std::size_t capacity) {
+  FontCache &cache = GlobalFontCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.capacity = capacity;
+  if (cache.fonts.size() > capacity) {
+    cache.fonts.clear();
+  }
+}
+
+
+std::size_t FontCacheCapacity() {
+  FontCache &cache = GlobalFontCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.capacity;
+}
+
+
+void FontExtents(
+    cairo_t *context, const TextStyle &text_style,
+    cairo_font_extents_t *extents) {
+  cairo_matrix_t ctm;
+  cairo_get_matrix(context, &ctm);
+  if ((ctm.xx == 1.0) && (ctm.yy == 1.0)
+      && (ctm.xy == 0.0) && (ctm.yx == 0.0)) {
+    const auto font = GetCachedFont(context, text_style);
+    if (font) {
+      *extents = font->extents;
+      return;
+    }
+  }
+  cairo_font_extents(context, extents);
+}
+
+} // namespace helpers
+} // namespace viren2d
@@ -0,0 +1,74 @@
+#ifndef __VIREN2D_FONT_CACHE_H__
+#define __VIREN2D_FONT_CACHE_H__
+
+#include <cstddef>
+#include <memory>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/styles.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// By default, fonts are cached until this number of different text
+/// styles (family, slant, weight & size) is exceeded. Then, the cache
+/// will be flushed.
+constexpr std::size_t kMaxCachedFonts = 64;
+
+
+/// A resolved font, *i.e.* font face and scaled font (for an untransformed
+/// context), along with its extents.
+struct CachedFont {
+  CachedFont() = default;
+  ~CachedFont();
+
+  CachedFont(const CachedFont &) = delete;
+  CachedFont &operator=(const CachedFont &) = delete;
+
+  /// The resolved font face (we hold a reference).
+  cairo_font_face_t *face = nullptr;
+
+  /// The font face scaled to the text style's size (we hold a reference).
+  cairo_scaled_font_t *scaled_font = nullptr;
+
+  /// Extents of the scaled font.
+  cairo_font_extents_t extents;
+};
+
+
+/// Returns the font for the given text style from the process-wide font
+/// cache, or nullptr if the font could not be resolved or the cache is
+/// disabled.
+/// The font will be resolved (via the context's target surface font
+/// options) upon the first request. This function is thread-safe.
+std::shared_ptr<const CachedFont> GetCachedFont(
+    cairo_t *context, const TextStyle &text_style);
+
+
+/// Removes all fonts from the process-wide font cache.
+void ClearFontCache();
+
+
+/// Sets the maximum number of cached fonts. If the capacity is 0, the
+/// cache is disabled and fonts are selected via Cairo's toy API.
+void SetFontCacheCapacity(std::size_t capacity);
+
+
+/// Returns the maximum number of cached fonts.
+std::size_t FontCacheCapacity();
+
+
+/// Computes the font extents for the given text style, which must
+/// have been set up via `ApplyTextStyle` before.
+/// If the context is not rotated or scaled, the cached extents will
+/// be used. Otherwise, they will be queried from Cairo.
+void FontExtents(
+    cairo_t *context, const TextStyle &text_style,
+    cairo_font_extents_t *extents);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_FONT_CACHE_H__
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <helpers/glyph_atlas.h>
+#include <helpers/fast_raster.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Additional border around each glyph's ink extent to capture the
+/// anti-aliased edges.
+constexpr int kGlyphMargin = 2;
+
+/// Atlases are cached until this number of fonts is exceeded. Then,
+/// the cache will be flushed.
+constexpr std::size_t kMaxCachedAtlases = 16;
+
+
+/// Returns true if the context is not rotated, scaled or sheared.
+inline bool IsTranslationOnly(cairo_t *context) {
+  cairo_matrix_t ctm;
+  cairo_get_matrix(context, &ctm);
+  return (ctm.xx == 1.0) && (ctm.yy == 1.0)
+      && (ctm.xy == 0.0) && (ctm.yx == 0.0);
+}
+} // anonymous namespace
+
+
+//---------------------------------------------------- Atlas
+GlyphAtlas::GlyphAtlas(cairo_scaled_font_t *scaled_font)
+  : scaled_font_(cairo_scaled_font_reference(scaled_font)),
+    mask_(nullptr),
+    num_phases_(
+      (cairo_version() >= CAIRO_VERSION_ENCODE(1, 17, 6)) ? 4 : 1),
+    row_height_(0) {
+  // Measure all glyphs to lay out the atlas as a single row of cells.
+  constexpr int num_glyphs = kLastChar - kFirstChar + 1;
+  std::array<unsigned long, num_glyphs> indices;
+  int atlas_width = 0;
+  int atlas_height = 0;
+  for (int idx = 0; idx < num_glyphs; ++idx) {
+    const char text[2] = {static_cast<char>(kFirstChar + idx), '\0'};
+    cairo_glyph_t *glyphs = nullptr;
+    int num = 0;
+    if ((cairo_scaled_font_text_to_glyphs(
+           scaled_font_, 0.0, 0.0, text, 1, &glyphs, &num,
+           nullptr, nullptr, nullptr) != CAIRO_STATUS_SUCCESS)
+        || (num != 1)) {
+      cairo_glyph_free(glyphs);
+      SPDLOG_WARN(
+            "Cannot rasterize glyph atlas, character '{:s}' is not "
+            "supported.", text);
+      return;
+    }
+    indices[idx] = glyphs[0].index;
+    cairo_glyph_free(glyphs);
+
+    cairo_glyph_t glyph{indices[idx], 0.0, 0.0};
+    cairo_text_extents_t extents;
+    cairo_scaled_font_glyph_extents(scaled_font_, &glyph, 1, &extents);
+
+    AtlasGlyph &g = glyphs_[idx];
+    g.advance_x = extents.x_advance;
+    g.advance_y = extents.y_advance;
+    if ((extents.width > 0.0) && (extents.height > 0.0)) {
+      g.offset_x = static_cast<int>(std::floor(extents.x_bearing)) - kGlyphMargin;
+      g.offset_y = static_cast<int>(std::floor(extents.y_bearing)) - kGlyphMargin;
+      g.width = static_cast<int>(std::ceil(extents.width)) + 2 * kGlyphMargin + 1;
+      g.height = static_cast<int>(std::ceil(extents.height)) + 2 * kGlyphMargin + 1;
+    }
+    g.atlas_x = atlas_width;
+    g.atlas_y = 0;
+    atlas_width += g.width;
+    atlas_height = std::max(atlas_height, g.height);
+  }
+
+  row_height_ = atlas_height;
+  cairo_surface_t *mask = cairo_image_surface_create(
+        CAIRO_FORMAT_A8, std::max(1, atlas_width),
+        std::max(1, atlas_height * num_phases_ * num_phases_));
+  if (cairo_surface_status(mask) != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_WARN("Cannot allocate the glyph atlas.");
+    cairo_surface_destroy(mask);
+    return;
+  }
+
+  // Render each glyph once per sub-pixel phase. Cairo quantizes these
+  // origins exactly like the positions passed to `BlitAtlasText`, thus
+  // each row holds the masks Cairo would composite for this phase.
+  cairo_t *context = cairo_create(mask);
+  cairo_set_scaled_font(context, scaled_font_);
+  cairo_set_source_rgba(context, 0.0, 0.0, 0.0, 1.0);
+  std::vector<cairo_glyph_t> glyphs;
+  glyphs.reserve(num_glyphs * num_phases_ * num_phases_);
+  for (int phase_y = 0; phase_y < num_phases_; ++phase_y) {
+    for (int phase_x = 0; phase_x < num_phases_; ++phase_x) {
+      const double row_y = (phase_y * num_phases_ + phase_x) * row_height_;
+      for (int idx = 0; idx < num_glyphs; ++idx) {
+        const AtlasGlyph &g = glyphs_[idx];
+        if (g.width > 0) {
+          glyphs.push_back({
+              indices[idx],
+              g.atlas_x - g.offset_x
+                + static_cast<double>(phase_x) / num_phases_,
+              row_y + g.atlas_y - g.offset_y
+                + static_cast<double>(phase_y) / num_phases_});
+        }
+      }
+    }
+  }
+  cairo_show_glyphs(context, glyphs.data(), static_cast<int>(glyphs.size()));
+  cairo_destroy(context);
+  cairo_surface_flush(mask);
+  mask_ = mask;
+}
+
+
+GlyphAtlas::~GlyphAtlas() {
+  if (mask_) {
+    cairo_surface_destroy(mask_);
+  }
+  cairo_scaled_font_destroy(scaled_font_);
+}
+
+
+bool GlyphAtlas::Supports(const char *text) {
+  if (!text) {
+    return false;
+  }
+  for (const char *c = text; *c != '\0'; ++c) {
+    if ((*c < kFirstChar) || (*c > kLastChar)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+const unsigned char *GlyphAtlas::Data() const {
+  return cairo_image_surface_get_data(mask_);
+}
+
+
+int GlyphAtlas::Stride() const {
+  return cairo_image_surface_get_stride(mask_);
+}
+
+
+int GlyphAtlas::Quantize(double pos, int &phase) const {
+  // Same as the PHASE/POSITION macros of Cairo's image compositor, which
+  // center the phases on the quarter pixels. With a single phase, this
+  // reduces to rounding (as in Cairo < 1.17.6).
+  const double shifted = pos + 0.5 / num_phases_;
+  const double pixel = std::floor(shifted);
+  phase = static_cast<int>(
+        std::floor(num_phases_ * shifted) - num_phases_ * pixel);
+  return static_cast<int>(pixel);
+}
+
+
+const unsigned char *GlyphAtlas::Mask(
+    const AtlasGlyph &glyph, int phase_x, int phase_y) const {
+  const int row_y = (phase_y * num_phases_ + phase_x) * row_height_;
+  return Data() + (row_y + glyph.atlas_y) * Stride() + glyph.atlas_x;
+}
+
+
+//---------------------------------------------------- Atlas cache
+std::shared_ptr<const GlyphAtlas> GetGlyphAtlas(cairo_t *context) {
+  if (!context || !IsTranslationOnly(context)) {
+    return nullptr;
+  }
+
+  cairo_scaled_font_t *scaled_font = cairo_get_scaled_font(context);
+  if (cairo_scaled_font_status(scaled_font) != CAIRO_STATUS_SUCCESS) {
+    return nullptr;
+  }
+
+  // Intentionally leaked, see `GlobalFontCache`. As each atlas holds a
+  // reference to its font, a font's address cannot be reused while it
+  // is a key of this map.
+  static std::mutex *mutex = new std::mutex();
+  static auto *atlases = new std::map<
+      const cairo_scaled_font_t *, std::shared_ptr<const GlyphAtlas>>();
+
+  std::lock_guard<std::mutex> lock(*mutex);
+  auto it = atlases->find(scaled_font);
+  if (it != atlases->end()) {
+    return it->second;
+  }
+
+  auto atlas = std::make_shared<const GlyphAtlas>(scaled_font);
+  if (!atlas->IsValid()) {
+    return nullptr;
+  }
+  if (atlases->size() >= kMaxCachedAtlases) {
+    atlases->clear();
+  }
+  atlases->emplace(scaled_font, atlas);
+  return atlas;
+}
+
+
+//---------------------------------------------------- Blitting
+bool BlitAtlasText(
+    cairo_surface_t *surface, cairo_t *context, const GlyphAtlas &atlas,
+    const char *text, double x, double y, const Color &color) {
+  if (!GlyphAtlas::Supports(text)
+      || (cairo_get_scaled_font(context) != atlas.ScaledFont())) {
+    return false;
+  }
+
+  PixelCanvas canvas;
+  if (!canvas.Init(surface, context)) {
+    return false;
+  }
+
+  const PixelColor src(color);
+  const int mask_stride = atlas.Stride();
+
+  double pen_x = x;
+  double pen_y = y;
+  canvas.ToDevice(pen_x, pen_y);
+  for (const char *c = text; *c != '\0'; ++c) {
+    const AtlasGlyph &glyph = atlas.Glyph(*c);
+    int phase_x, phase_y;
+    const int origin_x = atlas.Quantize(pen_x, phase_x);
+    const int origin_y = atlas.Quantize(pen_y, phase_y);
+    pen_x += glyph.advance_x;
+    pen_y += glyph.advance_y;
+    if (glyph.width == 0) {
+      continue;
+    }
+
+    const unsigned char *mask = atlas.Mask(glyph, phase_x, phase_y);
+    const int left = origin_x + glyph.offset_x;
+    const int top = origin_y + glyph.offset_y;
+    for (const auto &clip : canvas.ClipRects()) {
+      const PixelRect r(
+            std::max(left, clip.left), std::max(top, clip.top),
+            std::min(left + glyph.width, clip.right),
+            std::min(top + glyph.height, clip.bottom));
+      if (r.IsEmpty()) {
+        continue;
+      }
+
+      canvas.AddDirty(r);
+      for (int row = r.top; row < r.bottom; ++row) {
+        const unsigned char *mask_row = mask
+            + (row - top) * mask_stride + (r.left - left);
+        std::uint32_t *dst = canvas.Row(row) + r.left;
+        for (int col = r.left; col < r.right; ++col, ++mask_row, ++dst) {
+          const std::uint32_t m = *mask_row;
+          if (m == 0) {
+            continue;
+          }
+          // OVER operator with the mask applied to the source (like
+          // pixman's solid-color, A8-mask compositing):
+          PixelColor masked;
+          masked.pixel = ScalePixel(src.pixel, m);
+          masked.inv_alpha = 255 - (masked.pixel >> 24);
+          *dst = BlendOver(*dst, masked);
+        }
+      }
+    }
+  }
+
+  canvas.Finish();
+  return true;
+}
+
+} // namespace helpers
+} // namespace viren2d
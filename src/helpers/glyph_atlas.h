@@ -0,0 +1,122 @@
+#ifndef __VIREN2D_GLYPH_ATLAS_H__
+#define __VIREN2D_GLYPH_ATLAS_H__
+
+#include <array>
+#include <memory>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/colors.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Location of a pre-rasterized glyph within the `GlyphAtlas`.
+struct AtlasGlyph {
+  /// Top-left corner of the glyph's mask within the atlas.
+  int atlas_x = 0;
+  int atlas_y = 0;
+
+  /// Size of the glyph's mask.
+  int width = 0;
+  int height = 0;
+
+  /// Top-left corner of the mask relative to the glyph's origin.
+  int offset_x = 0;
+  int offset_y = 0;
+
+  /// Distance to the next glyph's origin.
+  double advance_x = 0.0;
+  double advance_y = 0.0;
+};
+
+
+/// The printable ASCII glyphs of a scaled font, pre-rasterized into a
+/// single A8 mask. This allows compositing short labels (*e.g.* IDs or
+/// scores) directly into the canvas memory, without Cairo's text
+/// rendering overhead.
+///
+/// Glyphs are placed on the same grid as Cairo's image compositor uses:
+/// Since Cairo 1.17.6, glyph origins are quantized to quarter pixels
+/// and each glyph is rasterized once per sub-pixel phase. Older versions
+/// round the origins to full pixels. The atlas holds one row of glyphs
+/// per (horizontal & vertical) phase.
+class GlyphAtlas {
+public:
+  static constexpr char kFirstChar = ' ';
+  static constexpr char kLastChar = '~';
+
+  /// Rasterizes all supported glyphs of the given (untransformed)
+  /// scaled font.
+  explicit GlyphAtlas(cairo_scaled_font_t *scaled_font);
+  ~GlyphAtlas();
+
+  GlyphAtlas(const GlyphAtlas &) = delete;
+  GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+  /// Returns true if the atlas has been rasterized successfully.
+  bool IsValid() const { return mask_ != nullptr; }
+
+  /// Returns true if all characters of the text can be rendered via
+  /// this atlas.
+  static bool Supports(const char *text);
+
+  /// Returns the scaled font which has been rasterized.
+  const cairo_scaled_font_t *ScaledFont() const { return scaled_font_; }
+
+  /// Returns the glyph of a supported character.
+  const AtlasGlyph &Glyph(char c) const {
+    return glyphs_[static_cast<std::size_t>(c - kFirstChar)];
+  }
+
+  /// Returns the A8 mask data.
+  const unsigned char *Data() const;
+
+  /// Returns the row stride of the A8 mask in bytes.
+  int Stride() const;
+
+  /// Returns the number of sub-pixel phases per axis, *i.e.* 4 for
+  /// Cairo >= 1.17.6, 1 otherwise.
+  int NumPhases() const { return num_phases_; }
+
+  /// Quantizes a device coordinate of a glyph origin the same way Cairo
+  /// does. Returns the integer pixel position and sets `phase` to the
+  /// sub-pixel phase within `[0, NumPhases())`.
+  int Quantize(double pos, int &phase) const;
+
+  /// Returns the top-left corner of the glyph's mask, rasterized at the
+  /// given sub-pixel phases.
+  const unsigned char *Mask(
+      const AtlasGlyph &glyph, int phase_x, int phase_y) const;
+
+private:
+  cairo_scaled_font_t *scaled_font_;
+  cairo_surface_t *mask_;
+  int num_phases_;
+  int row_height_;
+  std::array<AtlasGlyph, kLastChar - kFirstChar + 1> glyphs_;
+};
+
+
+/// Returns the glyph atlas for the context's current font from the
+/// process-wide atlas cache, or nullptr if the context is rotated or
+/// scaled. This function is thread-safe.
+std::shared_ptr<const GlyphAtlas> GetGlyphAtlas(cairo_t *context);
+
+
+/// Composites the text (with its origin at the given user space position)
+/// directly into the canvas memory.
+///
+/// Returns false if this is not possible, *e.g.* if the text contains
+/// unsupported characters, if the context is transformed or has a
+/// non-rectangular clip region. In this case, nothing has been drawn and
+/// the text must be rendered via Cairo.
+bool BlitAtlasText(
+    cairo_surface_t *surface, cairo_t *context, const GlyphAtlas &atlas,
+    const char *text, double x, double y, const Color &color);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_GLYPH_ATLAS_H__
@@ -1,8 +1,12 @@
 #ifndef __VIREN2D_IMAGEBUFFER_HELPERS_H__
 #define __VIREN2D_IMAGEBUFFER_HELPERS_H__
 
+#include <cstdint>
 #include <stdexcept>
 #include <sstream>
+#include <mutex>
+#include <type_traits>
+#include <utility>
 
 #include <werkzeugkiste/geometry/utils.h>
 
@@ -10,59 +14,130 @@
 #include <viren2d/styles.h>
 
 #include <helpers/logging.h>
+#include <helpers/channel_shuffle.h>
 #include <helpers/color_conversion.h>
+#include <helpers/thread_pool.h>
 
 namespace wkg = werkzeugkiste::geometry;
 
 namespace viren2d {
 namespace helpers {
 
-template<typename _Tp> inline
-void SwapChannels(ImageBuffer &buffer, int ch1, int ch2) {
-  int rows = buffer.Height();
-  int values_per_row = buffer.Width() * buffer.Channels();
+/// Returns true if all given buffers are contiguous, *i.e.* pixel loops
+/// over these buffers can treat the image as a single row. Otherwise,
+/// each row must be processed separately, because rows may be padded
+/// (see `RowStride`) or the buffers may be views.
+inline bool AreContiguous(const ImageBuffer &buffer) {
+  return buffer.IsContiguous();
+}
+
 
-  // If the memory is contiguous, we can speed up the
-  // following loop, similar to the efficient OpenCV matrix scan:
+template<typename... _Ts> inline
+bool AreContiguous(const ImageBuffer &buffer, const _Ts &... others) {
+  return buffer.IsContiguous() && AreContiguous(others...);
+}
+
+
+/// Calls `fn(row, cols)` for all rows of the given buffers, which must
+/// have the same size. The rows are split into chunks that are processed
+/// concurrently, see `ParallelFor`.
+///
+/// If all buffers are contiguous, each chunk is passed as a single row,
+/// *i.e.* `fn` is called with the first row of the chunk and `cols` is
+/// the number of pixels of the whole chunk. Thus, `fn` must not assume
+/// `cols == Width()` and should only access the pixels via `AtUnchecked`
+/// or by stepping a row pointer by the pixel stride.
+template<typename _Fn, typename... _Ts> inline
+void ParallelForRows(
+    const _Fn &fn, const ImageBuffer &buffer, const _Ts &... others) {
+  const int width = buffer.Width();
+  // If the memory is contiguous, we can speed up the pixel loops,
+  // similar to the efficient OpenCV matrix scan:
   // https://docs.opencv.org/2.4/doc/tutorials/core/how_to_scan_images/how_to_scan_images.html#the-efficient-way
-  if (buffer.IsContiguous()) {
-    values_per_row *= rows;
-    rows = 1;
-  }
-
-  _Tp *ptr_row;
-  for (int row = 0; row < rows; ++row) {
-    ptr_row = buffer.MutablePtr<_Tp>(row, 0, 0);
-    for (int col = 0; col < values_per_row; col += buffer.Channels()) {
-      _Tp tmp = ptr_row[col + ch1];
-      ptr_row[col + ch1] = ptr_row[col + ch2];
-      ptr_row[col + ch2] = tmp;
+  const bool contiguous = AreContiguous(buffer, others...);
+  ParallelFor(buffer.Height(), width, [&](int first_row, int end_row) {
+    if (contiguous) {
+      fn(first_row, (end_row - first_row) * width);
+    } else {
+      for (int row = first_row; row < end_row; ++row) {
+        fn(row, width);
+      }
+    }
+  });
+}
+
+
+/// Copies/reorders the channels via the SIMD kernels of `ChannelShuffle`
+/// (see its documentation for the meaning of `map`). Returns false if the
+/// kernels can't be used, *i.e.* for element types other than `uint8_t` or
+/// `float`, or if the pixels are not packed (e.g. numpy views). In this
+/// case, the caller must fall back to its own pixel loop.
+template<typename _Tp> inline
+bool ShuffleChannels(
+    const ImageBuffer &src, ImageBuffer &dst, const int *map) {
+  if (!std::is_same<_Tp, uint8_t>::value && !std::is_same<_Tp, float>::value) {
+    return false;
+  }
+
+  if ((src.PixelStride() != src.Channels() * src.ElementSize())
+      || (dst.PixelStride() != dst.Channels() * dst.ElementSize())) {
+    return false;
+  }
+
+  const _Tp fill = static_cast<_Tp>(255);
+  const ChannelShuffle shuffle(
+        sizeof(_Tp), src.Channels(), dst.Channels(), map, &fill,
+        ChannelShuffleLevel());
+  ParallelForRows([&](int row, int cols) {
+    shuffle.Run(
+          reinterpret_cast<const unsigned char *>(
+            src.ImmutablePtr<_Tp>(row, 0, 0)),
+          reinterpret_cast<unsigned char *>(dst.MutablePtr<_Tp>(row, 0, 0)),
+          cols);
+  }, src, dst);
+  return true;
+}
+
+
+template<typename _Tp> inline
+void SwapChannels(ImageBuffer &buffer, int ch1, int ch2) {
+  // Copy-on-write must happen before the rows are distributed among
+  // the threads (and may change the memory layout).
+  buffer.MutableData();
+
+  int map[kMaxShuffleChannels] = {0, 1, 2, 3};
+  if (buffer.Channels() <= kMaxShuffleChannels) {
+    std::swap(map[ch1], map[ch2]);
+    if (ShuffleChannels<_Tp>(buffer, buffer, map)) {
+      return;
     }
   }
+
+  ParallelForRows([&](int row, int cols) {
+    for (int col = 0; col < cols; ++col) {
+      _Tp tmp = buffer.AtUnchecked<_Tp>(row, col, ch1);
+      buffer.AtUnchecked<_Tp>(row, col, ch1) =
+          buffer.AtUnchecked<_Tp>(row, col, ch2);
+      buffer.AtUnchecked<_Tp>(row, col, ch2) = tmp;
+    }
+  }, buffer);
 }
 
 
 template<typename _Tp>
 ImageBuffer ExtractChannel(const ImageBuffer &src, int channel) {
   ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
+  if ((src.Channels() <= kMaxShuffleChannels)
+      && ShuffleChannels<_Tp>(src, dst, &channel)) {
+    return dst;
+  }
 
-  int rows = src.Height();
-  int values_per_row = src.Width() * src.Channels();
-  if (src.IsContiguous()) {
-    values_per_row *= rows;
-    rows = 1;
-  }
-
-  _Tp const *src_row;
-  _Tp *dst_ptr = dst.MutablePtr<_Tp>(0, 0, 0);
-  int dst_col = 0;
-  for (int row = 0; row < rows; ++row) {
-    src_row = src.ImmutablePtr<_Tp>(row, 0, 0);
-    for (int col = channel; col < values_per_row; col += src.Channels()) {
-      dst_ptr[dst_col] = src_row[col];
-      ++dst_col;
+  ParallelForRows([&](int row, int cols) {
+    for (int col = 0; col < cols; ++col) {
+      dst.AtUnchecked<_Tp>(row, col, 0) =
+          src.AtUnchecked<_Tp>(row, col, channel);
     }
-  }
+  }, src, dst);
   return dst;
 }
 
@@ -103,16 +178,12 @@ ImageBuffer ConversionHelperGray(
 
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
-
-  int rows = src.Height();
-  int cols = src.Width(); // src channels is 1
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
+  const int map[] = {0, 0, 0, -1};
+  if (ShuffleChannels<_Tp>(src, dst, map)) {
+    return dst;
   }
 
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       dst.AtUnchecked<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
       dst.AtUnchecked<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 0);
@@ -121,7 +192,7 @@ ImageBuffer ConversionHelperGray(
         dst.AtUnchecked<_Tp>(row, col, 3) = 255;
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -201,37 +272,32 @@ ImageBuffer ConversionHelperRGB(
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
+  const int map[] = {0, 1, 2, (src.Channels() == 4) ? 3 : -1};
+  if (ShuffleChannels<_Tp>(src, dst, map)) {
+    return dst;
   }
 
   const bool add_alpha = (channels_out == 4);
-  for (int row = 0; row < rows; ++row) {
-//    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0);
-//    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0);
+  ParallelForRows([&](int row, int cols) {
+    // Within a row, the pixels are `PixelStride()` bytes apart (which
+    // also covers strided memory, e.g. numpy slices/views).
+    const unsigned char *src_ptr = reinterpret_cast<const unsigned char *>(
+          src.ImmutablePtr<_Tp>(row, 0, 0));
+    _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
     for (int col = 0; col < cols; ++col) {
-      // FIXME: pointer access is much faster, but we need to take care
-      //   of strided memory (e.g. numpy slices/views). Could implement a
-      //   generic "pixelwise iterator"
-//      *dst_ptr++ = *src_ptr++;
-//      *dst_ptr++ = *src_ptr++;
-//      *dst_ptr++ = *src_ptr++;
-      dst.AtUnchecked<_Tp>(row, col, 0) = src.AtUnchecked<_Tp>(row, col, 0);
-      dst.AtUnchecked<_Tp>(row, col, 1) = src.AtUnchecked<_Tp>(row, col, 1);
-      dst.AtUnchecked<_Tp>(row, col, 2) = src.AtUnchecked<_Tp>(row, col, 2);
+      const _Tp *src_px = reinterpret_cast<const _Tp *>(src_ptr);
+      *dst_ptr++ = src_px[0];
+      *dst_ptr++ = src_px[1];
+      *dst_ptr++ = src_px[2];
       // Two cases:
       // * RGBA --> RGB, we're already done
       // * RGB  --> RGBA, we must add the alpha channel
       if (add_alpha) {
-        dst.AtUnchecked<_Tp>(0, col, 3) = 255;
-//        *dst_ptr++ = 255;
+        *dst_ptr++ = static_cast<_Tp>(255);
       }
+      src_ptr += src.PixelStride();
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -293,22 +359,13 @@ ImageBuffer RGBx2Gray(
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), channels_out, src.BufferType());
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
   const int ch_r = is_bgr_format ? 2 : 0;
   const int ch_b = is_bgr_format ? 0 : 2;
-  _Tp luminance;
 
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
     for (int col = 0; col < cols; ++col) {
-      luminance = CvtHelperRGB2Gray(
+      const _Tp luminance = CvtHelperRGB2Gray(
             src.AtUnchecked<_Tp>(row, col, ch_r),
             src.AtUnchecked<_Tp>(row, col, 1),
             src.AtUnchecked<_Tp>(row, col, ch_b));
@@ -328,7 +385,7 @@ ImageBuffer RGBx2Gray(
         }
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -459,37 +516,46 @@ void MinMaxLocation(
     throw std::out_of_range(msg.str());
   }
 
-  int rows = buf.Height();
-  int cols = buf.Width();
-  if (buf.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
+  // Each chunk is reduced separately. To report the first occurrence
+  // (in row-major order) of the extrema, the chunk results are merged
+  // by comparing the pixel indices upon ties.
   _Tp _minval = buf.AtUnchecked<_Tp>(0, 0, channel);
   _Tp _maxval = buf.AtUnchecked<_Tp>(0, 0, channel);
-  Vec2i _minloc{0, 0};
-  Vec2i _maxloc{0, 0};
-  // To report the image location, we need to keep track
-  // of it (in case we're working with a contiguous buffer...)
-  Vec2i curr_loc{0, -1};
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
-      curr_loc[0] = col % buf.Width();
-      if (curr_loc[0] == 0) {
-        ++curr_loc[1];
-      }
+  std::int64_t _minidx = 0;
+  std::int64_t _maxidx = 0;
+  std::mutex merge_mutex;
+  ParallelForRows([&](int row, int cols) {
+    _Tp chunk_minval = buf.AtUnchecked<_Tp>(row, 0, channel);
+    _Tp chunk_maxval = chunk_minval;
+    int chunk_mincol = 0;
+    int chunk_maxcol = 0;
+    for (int col = 1; col < cols; ++col) {
       const _Tp val = buf.AtUnchecked<_Tp>(row, col, channel);
-      if (val < _minval) {
-        _minval = val;
-        _minloc = curr_loc;
+      if (val < chunk_minval) {
+        chunk_minval = val;
+        chunk_mincol = col;
       }
-      if (val > _maxval) {
-        _maxval = val;
-        _maxloc = curr_loc;
+      if (val > chunk_maxval) {
+        chunk_maxval = val;
+        chunk_maxcol = col;
       }
     }
-  }
+
+    // For contiguous chunks, `col` may exceed the width, but the pixel
+    // index is computed the same way.
+    const std::int64_t first = static_cast<std::int64_t>(row) * buf.Width();
+    std::lock_guard<std::mutex> lock(merge_mutex);
+    if ((chunk_minval < _minval)
+        || (!(_minval < chunk_minval) && (first + chunk_mincol < _minidx))) {
+      _minval = chunk_minval;
+      _minidx = first + chunk_mincol;
+    }
+    if ((chunk_maxval > _maxval)
+        || (!(_maxval > chunk_maxval) && (first + chunk_maxcol < _maxidx))) {
+      _maxval = chunk_maxval;
+      _maxidx = first + chunk_maxcol;
+    }
+  }, buf);
 
   if (min_val) {
     *min_val = static_cast<double>(_minval);
@@ -498,10 +564,14 @@ void MinMaxLocation(
     *max_val = static_cast<double>(_maxval);
   }
   if (min_loc) {
-    *min_loc = _minloc;
+    *min_loc = Vec2i(
+          static_cast<int>(_minidx % buf.Width()),
+          static_cast<int>(_minidx / buf.Width()));
   }
   if (max_loc) {
-    *max_loc = _maxloc;
+    *max_loc = Vec2i(
+          static_cast<int>(_maxidx % buf.Width()),
+          static_cast<int>(_maxidx / buf.Width()));
   }
 }
 
@@ -537,14 +607,7 @@ ImageBuffer BlendConstant(
   // with values from the buffer that has more channels.
   const ImageBuffer &rem_channels = (src1.Channels() > src2.Channels()) ? src1 : src2;
 
-  int rows = src1.Height();
-  int cols = src1.Width();
-  if (src1.IsContiguous() && src2.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < channels_to_blend) {
@@ -557,7 +620,7 @@ ImageBuffer BlendConstant(
         }
       }
     }
-  }
+  }, src1, src2, dst);
 
   return dst;
 }
@@ -578,14 +641,7 @@ ImageBuffer BlendWeightsImpl(
   const ImageBuffer &rem_channels =
       (src1.Channels() > src2.Channels()) ? src1 : src2;
 
-  int rows = src1.Height();
-  int cols = src1.Width();
-  if (src1.IsContiguous() && src2.IsContiguous() && alpha2.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < channels_to_blend) {
@@ -600,7 +656,7 @@ ImageBuffer BlendWeightsImpl(
         }
       }
     }
-  }
+  }, src1, src2, alpha2, dst);
 
   return dst;
 }
@@ -670,24 +726,18 @@ ImageBuffer DimImpl(
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), src.Channels(), src.BufferType());
 
-  int rows = src.Height();
-  int cols = src.Width();
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
-    const _T *src_ptr = src.ImmutablePtr<_T>(row, 0);
+  ParallelForRows([&](int row, int cols) {
+    const unsigned char *src_px = reinterpret_cast<const unsigned char *>(
+          src.ImmutablePtr<_T>(row, 0));
     _T *dst_ptr = dst.MutablePtr<_T>(row, 0);
     for (int col = 0; col < cols; ++col) {
+      const _T *src_ptr = reinterpret_cast<const _T *>(src_px);
       for (int ch = 0; ch < src.Channels(); ++ch) {
-        *dst_ptr = static_cast<_T>(alpha * (*src_ptr));
-        ++dst_ptr;
-        ++src_ptr;
+        *dst_ptr++ = static_cast<_T>(alpha * src_ptr[ch]);
       }
+      src_px += src.PixelStride();
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -718,15 +768,7 @@ ImageBuffer ToUInt8(const ImageBuffer &src, int channels_out, uint8_t scale) {
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), channels_out, ImageBufferType::UInt8);
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       for (int ch = 0; ch < channels_out; ++ch) {
         if (ch < src.Channels()) {
@@ -741,7 +783,7 @@ ImageBuffer ToUInt8(const ImageBuffer &src, int channels_out, uint8_t scale) {
         }
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -758,22 +800,14 @@ ImageBuffer ToFloat(const ImageBuffer &src, float scale) {
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), src.Channels(), ImageBufferType::Float);
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       for (int ch = 0; ch < src.Channels(); ++ch) {
         dst.AtUnchecked<float>(row, col, ch) = static_cast<float>(
                 scale * src.AtUnchecked<_Tp>(row, col, ch));
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -784,23 +818,16 @@ template <typename _Tp_src, ImageBufferType _BTp_dst>
 ImageBuffer ConvertTypeImpl(
     const ImageBuffer &src, double scale) {
   ImageBuffer dst(src.Height(), src.Width(), src.Channels(), _BTp_dst);
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
 
   using _Tp_dst = image_buffer_t<_BTp_dst>;
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     for (int col = 0; col < cols; ++col) {
       for (int ch = 0; ch < src.Channels(); ++ch) {
         dst.AtUnchecked<_Tp_dst>(row, col, ch) = static_cast<_Tp_dst>(
                 scale * src.AtUnchecked<_Tp_src>(row, col, ch));
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -859,26 +886,21 @@ ImageBuffer Magnitude(const ImageBuffer &src) {
 
   ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
 
-  int rows = src.Height();
-  int cols = src.Width();
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
-    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0, 0);
+    const unsigned char *src_px = reinterpret_cast<const unsigned char *>(
+          src.ImmutablePtr<_Tp>(row, 0, 0));
 
     for (int col = 0; col < cols; ++col) {
+      const _Tp *src_ptr = reinterpret_cast<const _Tp *>(src_px);
       _Tp sqr_sum = 0.0f;
       for (int ch = 0; ch < src.Channels(); ++ch) {
-        const _Tp val = *src_ptr++;
-        sqr_sum += (val * val);
+        sqr_sum += (src_ptr[ch] * src_ptr[ch]);
       }
       *dst_ptr++ = std::sqrt(sqr_sum);
+      src_px += src.PixelStride();
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -899,27 +921,22 @@ ImageBuffer Orientation(const ImageBuffer &src, float invalid) {
 
   ImageBuffer dst(src.Height(), src.Width(), 1, src.BufferType());
 
-  int rows = src.Height();
-  int cols = src.Width();
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
     _Tp *dst_ptr = dst.MutablePtr<_Tp>(row, 0, 0);
-    const _Tp *src_ptr = src.ImmutablePtr<_Tp>(row, 0, 0);
+    const unsigned char *src_px = reinterpret_cast<const unsigned char *>(
+          src.ImmutablePtr<_Tp>(row, 0, 0));
 
     for (int col = 0; col < cols; ++col) {
-      _Tp u = *src_ptr++;
-      _Tp v = *src_ptr++;
+      const _Tp u = reinterpret_cast<const _Tp *>(src_px)[0];
+      const _Tp v = reinterpret_cast<const _Tp *>(src_px)[1];
+      src_px += src.PixelStride();
       if (wkg::IsEpsZero(u) && wkg::IsEpsZero(v)) {
         *dst_ptr++ = static_cast<_Tp>(invalid);
       } else {
         *dst_ptr++ = std::atan2(v, u);
       }
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include <helpers/marker_sprite_cache.h>
+#include <helpers/drawing_helpers.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+//---------------------------------------------------- Sprite
+MarkerSprite::~MarkerSprite() {
+  if (marker_mask) {
+    cairo_surface_destroy(marker_mask);
+  }
+  if (background_mask) {
+    cairo_surface_destroy(background_mask);
+  }
+}
+
+
+int MarkerSpriteHalfSize(const MarkerStyle &style) {
+  // Cover the background bubble, miter joins (up to Cairo's default
+  // limit) and anti-aliasing:
+  const double extent = style.size / 2.0
+      + std::max(0.0, style.background_border)
+      + 5.0 * std::max(0.0, style.thickness) + 2.0;
+  if (!std::isfinite(extent)
+      || (extent > static_cast<double>(kMarkerSpriteMaxHalfSize))) {
+    return kMarkerSpriteMaxHalfSize + 1;
+  }
+  return static_cast<int>(std::ceil(extent));
+}
+
+
+bool QuantizeMarkerPosition(
+    const Vec2d &pos, int half_size, int &x, int &y,
+    int &phase_x, int &phase_y) {
+  // Markers are drawn at the center of the pixel, see `DrawMarker`.
+  const double cx = pos.X() + 0.5;
+  const double cy = pos.Y() + 0.5;
+  constexpr double limit = 1e7;
+  if (!std::isfinite(cx) || !std::isfinite(cy)
+      || (std::abs(cx) > limit) || (std::abs(cy) > limit)) {
+    return false;
+  }
+
+  double fx = std::floor(cx);
+  double fy = std::floor(cy);
+  phase_x = static_cast<int>(std::lround((cx - fx) * kMarkerSpriteSubpixelSteps));
+  phase_y = static_cast<int>(std::lround((cy - fy) * kMarkerSpriteSubpixelSteps));
+  if (phase_x == kMarkerSpriteSubpixelSteps) {
+    phase_x = 0;
+    fx += 1.0;
+  }
+  if (phase_y == kMarkerSpriteSubpixelSteps) {
+    phase_y = 0;
+    fy += 1.0;
+  }
+
+  x = static_cast<int>(fx) - half_size;
+  y = static_cast<int>(fy) - half_size;
+  return true;
+}
+
+
+//---------------------------------------------------- Cache
+bool MarkerSpriteCache::Key::operator==(const Key &other) const {
+  return (marker == other.marker)
+      && (size == other.size)
+      && (thickness == other.thickness)
+      && (background_border == other.background_border)
+      && (miter_limit == other.miter_limit)
+      && (filled == other.filled)
+      && (background == other.background)
+      && (cap == other.cap)
+      && (join == other.join)
+      && (quality == other.quality)
+      && (phase_x == other.phase_x)
+      && (phase_y == other.phase_y);
+}
+
+
+std::size_t MarkerSpriteCache::KeyHash::operator()(const Key &key) const {
+  std::size_t seed = std::hash<int>{}(static_cast<int>(key.marker));
+  auto combine = [&seed](std::size_t h) {
+    seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  };
+  combine(std::hash<double>{}(key.size));
+  combine(std::hash<double>{}(key.thickness));
+  combine(std::hash<double>{}(key.background_border));
+  combine(std::hash<double>{}(key.miter_limit));
+  combine(std::hash<int>{}(
+      (key.filled ? 1 : 0) | (key.background ? 2 : 0)
+      | (static_cast<int>(key.cap) << 2)
+      | (static_cast<int>(key.join) << 5)
+      | (static_cast<int>(key.quality) << 8)));
+  combine(std::hash<int>{}(
+      key.phase_x * kMarkerSpriteSubpixelSteps + key.phase_y));
+  return seed;
+}
+
+
+MarkerSpriteCache::MarkerSpriteCache(std::size_t capacity)
+  : capacity_(capacity) {
+  SPDLOG_DEBUG("MarkerSpriteCache: capacity={:d}.", capacity);
+}
+
+
+std::size_t MarkerSpriteCache::Capacity() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return capacity_;
+}
+
+
+void MarkerSpriteCache::SetCapacity(std::size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  EvictExcess();
+}
+
+
+std::size_t MarkerSpriteCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+
+void MarkerSpriteCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lookup_.clear();
+  entries_.clear();
+}
+
+
+std::shared_ptr<const MarkerSprite> MarkerSpriteCache::Get(
+    const MarkerStyle &style, double miter_limit, RenderQuality quality,
+    int phase_x, int phase_y) {
+  Key key;
+  key.marker = style.marker;
+  key.size = style.size;
+  key.thickness = style.thickness;
+  key.background_border = style.background_border;
+  key.miter_limit = miter_limit;
+  key.filled = style.IsFilled();
+  key.background = style.background_color.IsValid();
+  key.cap = style.cap;
+  key.join = style.join;
+  key.quality = quality;
+  key.phase_x = phase_x;
+  key.phase_y = phase_y;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = lookup_.find(key);
+  if (it != lookup_.end()) {
+    // Move to the front, i.e. mark as most recently used
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+  }
+
+  auto sprite = RenderMarkerSprite(
+      style, miter_limit, quality, phase_x, phase_y);
+  if (capacity_ > 0) {
+    entries_.emplace_front(key, sprite);
+    lookup_[key] = entries_.begin();
+    EvictExcess();
+  }
+  return sprite;
+}
+
+
+void MarkerSpriteCache::EvictExcess() {
+  while (entries_.size() > capacity_) {
+    lookup_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+} // namespace helpers
+} // namespace viren2d
@@ -0,0 +1,152 @@
+#ifndef __VIREN2D_MARKER_SPRITE_CACHE_H__
+#define __VIREN2D_MARKER_SPRITE_CACHE_H__
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <cairo/cairo.h>
+
+#include <viren2d/drawing.h>
+#include <viren2d/primitives.h>
+#include <viren2d/styles.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Number of sub-pixel positions per pixel (and axis) at which markers
+/// will be pre-rasterized. Thus, the position of a stamped marker deviates
+/// at most 1/8th of a pixel from its exact position.
+constexpr int kMarkerSpriteSubpixelSteps = 4;
+
+
+/// Markers larger than this (including their background bubble) will
+/// not be cached, but always rendered via their path.
+constexpr int kMarkerSpriteMaxHalfSize = 128;
+
+
+/// A pre-rasterized marker, *i.e.* alpha masks of its shape and of
+/// its (optional) background bubble. The masks are independent of the
+/// marker's colors.
+struct MarkerSprite {
+  MarkerSprite() = default;
+  ~MarkerSprite();
+
+  MarkerSprite(const MarkerSprite &) = delete;
+  MarkerSprite &operator=(const MarkerSprite &) = delete;
+
+  /// A8 mask of the marker shape.
+  cairo_surface_t *marker_mask = nullptr;
+
+  /// A8 mask of the background shape, or nullptr if the style
+  /// has no background.
+  cairo_surface_t *background_mask = nullptr;
+
+  /// The marker's center is located at (half_size + phase) in the masks.
+  int half_size = 0;
+};
+
+
+/// Returns the half size of the sprite for the given marker style.
+int MarkerSpriteHalfSize(const MarkerStyle &style);
+
+
+/// Rasterizes the given marker style at the given render quality, such
+/// that its center is located at the given sub-pixel phase (in steps of
+/// 1/kMarkerSpriteSubpixelSteps).
+std::shared_ptr<const MarkerSprite> RenderMarkerSprite(
+    const MarkerStyle &style, double miter_limit, RenderQuality quality,
+    int phase_x, int phase_y);
+
+
+/// Splits the marker position into the integer top-left corner of its
+/// sprite and the quantized sub-pixel phase.
+/// Returns false if the position cannot be represented (*e.g.* if it
+/// is not finite or too far off the canvas).
+bool QuantizeMarkerPosition(
+    const Vec2d &pos, int half_size, int &x, int &y,
+    int &phase_x, int &phase_y);
+
+
+/// A thread-safe least-recently-used cache of marker sprites.
+///
+/// Sprites are keyed by the marker's shape parameters, *i.e.* everything
+/// except its colors, by the render quality and by the sub-pixel phase.
+/// Thus, markers which only differ in position and color share the same
+/// sprites.
+class MarkerSpriteCache {
+public:
+  /// Creates a cache which holds up to `capacity` sprites.
+  explicit MarkerSpriteCache(std::size_t capacity);
+
+  MarkerSpriteCache(const MarkerSpriteCache &) = delete;
+  MarkerSpriteCache &operator=(const MarkerSpriteCache &) = delete;
+
+
+  /// Returns the maximum number of cached sprites.
+  std::size_t Capacity() const;
+
+
+  /// Changes the maximum number of cached sprites. A capacity of 0
+  /// disables the cache.
+  void SetCapacity(std::size_t capacity);
+
+
+  /// Returns the number of currently cached sprites.
+  std::size_t Size() const;
+
+
+  /// Removes all sprites.
+  void Clear();
+
+
+  /// Returns the sprite for the given style, render quality and sub-pixel
+  /// phase, which will be rasterized if it is not yet cached.
+  /// The returned sprite stays valid even if it is evicted meanwhile.
+  std::shared_ptr<const MarkerSprite> Get(
+      const MarkerStyle &style, double miter_limit, RenderQuality quality,
+      int phase_x, int phase_y);
+
+
+private:
+  struct Key {
+    Marker marker;
+    double size;
+    double thickness;
+    double background_border;
+    double miter_limit;
+    bool filled;
+    bool background;
+    LineCap cap;
+    LineJoin join;
+    RenderQuality quality;
+    int phase_x;
+    int phase_y;
+
+    bool operator==(const Key &other) const;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const;
+  };
+
+  using Entry = std::pair<Key, std::shared_ptr<const MarkerSprite>>;
+
+  std::size_t capacity_;
+
+  /// Most recently used sprites are at the front.
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup_;
+  mutable std::mutex mutex_;
+
+  void EvictExcess();
+};
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_MARKER_SPRITE_CACHE_H__
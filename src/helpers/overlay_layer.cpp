@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <helpers/overlay_layer.h>
+#include <helpers/dirty_region.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+OverlayLayer::~OverlayLayer() {
+  if (surface) {
+    cairo_surface_destroy(surface);
+  }
+}
+
+
+cairo_surface_t *CreateLayerSurface(int width, int height) {
+  // Image surfaces are zero-initialized, i.e. fully transparent.
+  cairo_surface_t *surface = cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_WARN(
+          "Cannot create a {:d}x{:d} layer surface: {:s}",
+          width, height,
+          cairo_status_to_string(cairo_surface_status(surface)));
+    cairo_surface_destroy(surface);
+    return nullptr;
+  }
+  return surface;
+}
+
+
+std::unique_ptr<OverlayLayer> FinalizeLayer(cairo_surface_t *surface) {
+  auto layer = std::make_unique<OverlayLayer>();
+  if (!surface) {
+    return layer;
+  }
+
+  cairo_surface_flush(surface);
+  const int width = cairo_image_surface_get_width(surface);
+  const int height = cairo_image_surface_get_height(surface);
+  const int stride = cairo_image_surface_get_stride(surface);
+  const unsigned char *data = cairo_image_surface_get_data(surface);
+  layer->canvas_width = width;
+  layer->canvas_height = height;
+
+  // Find the bounding box of the non-transparent pixels. Since the
+  // colors are premultiplied, a pixel is transparent iff it is 0.
+  int left = width;
+  int right = -1;
+  int top = height;
+  int bottom = -1;
+  for (int row = 0; row < height; ++row) {
+    const std::uint32_t *pixels = reinterpret_cast<const std::uint32_t *>(
+          data + static_cast<std::size_t>(row) * stride);
+    int first = 0;
+    while ((first < width) && (pixels[first] == 0)) {
+      ++first;
+    }
+    if (first == width) {
+      continue;
+    }
+    int last = width - 1;
+    while (pixels[last] == 0) {
+      --last;
+    }
+    left = std::min(left, first);
+    right = std::max(right, last);
+    top = std::min(top, row);
+    bottom = row;
+  }
+
+  if (right < left) {
+    // Nothing has been drawn onto this layer.
+    cairo_surface_destroy(surface);
+    return layer;
+  }
+
+  layer->left = left;
+  layer->top = top;
+  layer->width = right - left + 1;
+  layer->height = bottom - top + 1;
+  if ((layer->width == width) && (layer->height == height)) {
+    layer->surface = surface;
+    return layer;
+  }
+
+  // Only keep the bounding box, which also reduces the memory footprint:
+  cairo_surface_t *cropped = cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, layer->width, layer->height);
+  if (cairo_surface_status(cropped) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(cropped);
+    layer->left = 0;
+    layer->top = 0;
+    layer->width = width;
+    layer->height = height;
+    layer->surface = surface;
+    return layer;
+  }
+
+  unsigned char *dst = cairo_image_surface_get_data(cropped);
+  const int dst_stride = cairo_image_surface_get_stride(cropped);
+  const std::size_t row_bytes = static_cast<std::size_t>(layer->width) * 4;
+  for (int row = 0; row < layer->height; ++row) {
+    std::memcpy(
+          dst + static_cast<std::size_t>(row) * dst_stride,
+          data + static_cast<std::size_t>(top + row) * stride + left * 4,
+          row_bytes);
+  }
+  cairo_surface_mark_dirty(cropped);
+  cairo_surface_destroy(surface);
+  layer->surface = cropped;
+  return layer;
+}
+
+
+void CompositeLayer(cairo_t *context, const OverlayLayer &layer) {
+  if (!context || layer.IsEmpty()) {
+    return;
+  }
+
+  // An integer-aligned rectangle with an untransformed surface source is
+  // a single (SIMD-optimized) blit in pixman.
+  cairo_save(context);
+  cairo_identity_matrix(context);
+  cairo_set_operator(context, CAIRO_OPERATOR_OVER);
+  cairo_set_source_surface(context, layer.surface, layer.left, layer.top);
+  cairo_rectangle(context, layer.left, layer.top, layer.width, layer.height);
+  cairo_fill(context);
+  MarkDirty(
+        context, layer.left, layer.top,
+        layer.left + layer.width, layer.top + layer.height);
+  cairo_restore(context);
+}
+
+} // namespace helpers
+} // namespace viren2d
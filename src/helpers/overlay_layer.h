@@ -0,0 +1,62 @@
+#ifndef __VIREN2D_OVERLAY_LAYER_H__
+#define __VIREN2D_OVERLAY_LAYER_H__
+
+#include <memory>
+
+#include <cairo/cairo.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Pre-rendered overlay content, see `Painter::BeginLayer`.
+///
+/// Only the bounding box of the non-transparent pixels is kept, *i.e.*
+/// the surface covers the canvas region (left, top, width, height).
+struct OverlayLayer {
+  OverlayLayer() = default;
+  ~OverlayLayer();
+
+  OverlayLayer(const OverlayLayer &) = delete;
+  OverlayLayer &operator=(const OverlayLayer &) = delete;
+
+  /// ARGB32 surface, which will be nullptr if the layer doesn't contain
+  /// any visible pixel.
+  cairo_surface_t *surface = nullptr;
+
+  /// Size of the canvas the layer has been rendered for.
+  int canvas_width = 0;
+  int canvas_height = 0;
+
+  /// Region of the canvas which is covered by the surface.
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+
+  /// Returns true if the layer doesn't contain any visible pixel.
+  inline bool IsEmpty() const {
+    return (surface == nullptr) || (width <= 0) || (height <= 0);
+  }
+};
+
+
+/// Creates a transparent, canvas-sized ARGB32 surface to render a layer
+/// into. Returns nullptr if the surface cannot be created.
+cairo_surface_t *CreateLayerSurface(int width, int height);
+
+
+/// Crops the rendered layer surface to the bounding box of its
+/// non-transparent pixels. Takes ownership of the surface.
+std::unique_ptr<OverlayLayer> FinalizeLayer(cairo_surface_t *surface);
+
+
+/// Blends the layer onto the given context (using the `OVER` operator
+/// and the context's current clip region). The context's transformation
+/// is ignored, *i.e.* the layer is aligned with the canvas pixels.
+void CompositeLayer(cairo_t *context, const OverlayLayer &layer);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_OVERLAY_LAYER_H__
@@ -0,0 +1,113 @@
+#include <utility>
+
+#include <helpers/polyline_simplification.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Returns the squared distance between the point and the line segment.
+inline double SquaredDistanceToSegment(
+    const Vec2d &pt, const Vec2d &from, const Vec2d &to) {
+  const Vec2d dir = to - from;
+  const Vec2d diff = pt - from;
+  const double length_sq = dir.LengthSquared();
+  if (length_sq <= 0.0) {
+    return diff.LengthSquared();
+  }
+
+  const double t = diff.Dot(dir) / length_sq;
+  if (t <= 0.0) {
+    return diff.LengthSquared();
+  }
+  if (t >= 1.0) {
+    return (pt - to).LengthSquared();
+  }
+  return (diff - t * dir).LengthSquared();
+}
+} // anonymous namespace
+
+
+std::vector<std::size_t> SimplifyPolyline(
+    const Vec2d *points, std::size_t num_points, double tolerance) {
+  std::vector<std::size_t> indices;
+  if (!(tolerance > 0.0) || (num_points < 3)) {
+    indices.reserve(num_points);
+    for (std::size_t idx = 0; idx < num_points; ++idx) {
+      indices.push_back(idx);
+    }
+    return indices;
+  }
+
+  // Each stage may move the polyline by half the tolerance:
+  const double stage_tolerance_sq = 0.25 * tolerance * tolerance;
+
+  // Radial distance pass
+  std::vector<std::size_t> radial;
+  radial.push_back(0);
+  const std::size_t last = num_points - 1;
+  for (std::size_t idx = 1; idx < last; ++idx) {
+    if ((points[idx] - points[radial.back()]).LengthSquared()
+        > stage_tolerance_sq) {
+      radial.push_back(idx);
+    }
+  }
+  radial.push_back(last);
+
+  // Douglas-Peucker, with an explicit stack of (first, last) ranges
+  // into the radially reduced vertices.
+  std::vector<bool> keep(radial.size(), false);
+  keep.front() = true;
+  keep.back() = true;
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+  ranges.push_back(std::make_pair(0, radial.size() - 1));
+  while (!ranges.empty()) {
+    const auto range = ranges.back();
+    ranges.pop_back();
+    const Vec2d &from = points[radial[range.first]];
+    const Vec2d &to = points[radial[range.second]];
+
+    double max_dist_sq = stage_tolerance_sq;
+    std::size_t split = range.first;
+    for (std::size_t idx = range.first + 1; idx < range.second; ++idx) {
+      const double dist_sq = SquaredDistanceToSegment(
+            points[radial[idx]], from, to);
+      if (dist_sq > max_dist_sq) {
+        max_dist_sq = dist_sq;
+        split = idx;
+      }
+    }
+
+    if (split != range.first) {
+      keep[split] = true;
+      ranges.push_back(std::make_pair(range.first, split));
+      ranges.push_back(std::make_pair(split, range.second));
+    }
+  }
+
+  indices.reserve(radial.size());
+  for (std::size_t idx = 0; idx < radial.size(); ++idx) {
+    if (keep[idx]) {
+      indices.push_back(radial[idx]);
+    }
+  }
+  return indices;
+}
+
+
+std::vector<double> CumulativeLengths(
+    const Vec2d *points, std::size_t num_points) {
+  std::vector<double> lengths;
+  lengths.reserve(num_points);
+  double length = 0.0;
+  for (std::size_t idx = 0; idx < num_points; ++idx) {
+    if (idx > 0) {
+      length += points[idx - 1].DistanceEuclidean(points[idx]);
+    }
+    lengths.push_back(length);
+  }
+  return lengths;
+}
+
+} // namespace helpers
+} // namespace viren2d
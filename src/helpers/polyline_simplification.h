@@ -0,0 +1,55 @@
+#ifndef __VIREN2D_POLYLINE_SIMPLIFICATION_H__
+#define __VIREN2D_POLYLINE_SIMPLIFICATION_H__
+
+#include <cstddef>
+#include <vector>
+
+#include <viren2d/primitives.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Computes the indices of the vertices which should be kept to
+/// approximate the polyline within the given tolerance (in pixels),
+/// *i.e.* no removed vertex is farther than `tolerance` away from the
+/// simplified polyline.
+///
+/// The first and last vertex will always be kept. The simplification
+/// consists of two stages:
+/// * A linear-time radial distance pass, which drops all vertices that
+///   are closer than the tolerance to the previously kept vertex. This
+///   collapses the dense point clouds of tracks recorded at high frame
+///   rates.
+/// * Douglas-Peucker on the remaining vertices (iterative, using the
+///   distance to the segment to handle tracks which reverse direction).
+///   This is O(n log n) on average.
+///
+/// Returns all indices if the tolerance is not positive.
+std::vector<std::size_t> SimplifyPolyline(
+    const Vec2d *points, std::size_t num_points, double tolerance);
+
+
+/// Simplifies the polyline, see above.
+inline std::vector<std::size_t> SimplifyPolyline(
+    const std::vector<Vec2d> &points, double tolerance) {
+  return SimplifyPolyline(points.data(), points.size(), tolerance);
+}
+
+
+/// Returns the length along the polyline up to each of its vertices,
+/// *i.e.* the first entry is 0 and the last entry is the total length.
+std::vector<double> CumulativeLengths(
+    const Vec2d *points, std::size_t num_points);
+
+
+/// Returns the length along the polyline up to each vertex, see above.
+inline std::vector<double> CumulativeLengths(
+    const std::vector<Vec2d> &points) {
+  return CumulativeLengths(points.data(), points.size());
+}
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_POLYLINE_SIMPLIFICATION_H__
@@ -0,0 +1,189 @@
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <helpers/text_cache.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+ShapedText::~ShapedText() {
+  if (scaled_font) {
+    cairo_scaled_font_destroy(scaled_font);
+  }
+}
+
+
+namespace {
+/// Scaled font & text. As each cached entry holds a reference to its
+/// scaled font, the font's address cannot be reused while it is part
+/// of a key.
+using TextKey = std::pair<const cairo_scaled_font_t *, std::string>;
+
+
+struct TextKeyHash {
+  std::size_t operator()(const TextKey &key) const {
+    const std::size_t h = std::hash<const void *>{}(key.first);
+    return h ^ (std::hash<std::string>{}(key.second)
+                + 0x9e3779b9 + (h << 6) + (h >> 2));
+  }
+};
+
+
+/// The process-wide least-recently-used text cache.
+struct TextCache {
+  using Entry = std::pair<TextKey, std::shared_ptr<const ShapedText>>;
+
+  std::mutex mutex;
+  std::size_t capacity = kDefaultTextCacheSize;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+
+  /// Most recently used lines are at the front.
+  std::list<Entry> entries;
+  std::unordered_map<TextKey, std::list<Entry>::iterator, TextKeyHash> lookup;
+
+  void EvictExcess() {
+    while (entries.size() > capacity) {
+      lookup.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+};
+
+
+TextCache &GlobalTextCache() {
+  // Intentionally leaked, see `GlobalFontCache`.
+  static TextCache *cache = new TextCache();
+  return *cache;
+}
+
+
+std::shared_ptr<const ShapedText> ShapeText(
+    cairo_scaled_font_t *scaled_font, const char *text) {
+  cairo_glyph_t *glyphs = nullptr;
+  int num_glyphs = 0;
+  const cairo_status_t status = cairo_scaled_font_text_to_glyphs(
+        scaled_font, 0.0, 0.0, text, -1, &glyphs, &num_glyphs,
+        nullptr, nullptr, nullptr);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    SPDLOG_WARN(
+          "Cannot convert text \"{:s}\" to glyphs: {:s}.",
+          text, cairo_status_to_string(status));
+    return nullptr;
+  }
+
+  auto shaped = std::make_shared<ShapedText>();
+  shaped->scaled_font = cairo_scaled_font_reference(scaled_font);
+  shaped->glyphs.assign(glyphs, glyphs + num_glyphs);
+  cairo_glyph_free(glyphs);
+  cairo_scaled_font_glyph_extents(
+        scaled_font, shaped->glyphs.data(), num_glyphs, &shaped->extents);
+  return shaped;
+}
+} // anonymous namespace
+
+
+std::shared_ptr<const ShapedText> GetShapedText(
+    cairo_t *context, const char *text) {
+  if (!context || !text) {
+    return nullptr;
+  }
+
+  TextCache &cache = GlobalTextCache();
+  cairo_scaled_font_t *scaled_font = cairo_get_scaled_font(context);
+  if (cairo_scaled_font_status(scaled_font) != CAIRO_STATUS_SUCCESS) {
+    return nullptr;
+  }
+
+  TextKey key(scaled_font, text);
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.capacity == 0) {
+      return nullptr;
+    }
+
+    auto it = cache.lookup.find(key);
+    if (it != cache.lookup.end()) {
+      ++cache.hits;
+      cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+      return it->second->second;
+    }
+    ++cache.misses;
+  }
+
+  auto shaped = ShapeText(scaled_font, text);
+  if (!shaped) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  // Another thread may have shaped the same text meanwhile
+  if ((cache.capacity > 0) && (cache.lookup.find(key) == cache.lookup.end())) {
+    cache.entries.emplace_front(key, shaped);
+    cache.lookup[std::move(key)] = cache.entries.begin();
+    cache.EvictExcess();
+  }
+  return shaped;
+}
+
+
+void ShowShapedText(
+    cairo_t *context, const ShapedText &shaped, double x, double y) {
+  if (shaped.glyphs.empty()) {
+    cairo_move_to(context, x, y);
+    return;
+  }
+
+  // Reuse the buffer, as labels are shown one after the other
+  thread_local std::vector<cairo_glyph_t> positioned;
+  positioned.assign(shaped.glyphs.begin(), shaped.glyphs.end());
+  for (auto &glyph : positioned) {
+    glyph.x += x;
+    glyph.y += y;
+  }
+  cairo_show_glyphs(
+        context, positioned.data(), static_cast<int>(positioned.size()));
+  // Leave the current point behind the text, as `cairo_show_text` would
+  cairo_move_to(
+        context, x + shaped.extents.x_advance, y + shaped.extents.y_advance);
+}
+
+
+void SetTextCacheCapacity(std::size_t capacity) {
+  TextCache &cache = GlobalTextCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.capacity = capacity;
+  cache.EvictExcess();
+}
+
+
+std::size_t TextCacheCapacity() {
+  TextCache &cache = GlobalTextCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.capacity;
+}
+
+
+void TextCacheStatistics(
+    std::size_t &size, std::size_t &hits, std::size_t &misses) {
+  TextCache &cache = GlobalTextCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  size = cache.entries.size();
+  hits = cache.hits;
+  misses = cache.misses;
+}
+
+
+void ResetTextCacheStatistics() {
+  TextCache &cache = GlobalTextCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.hits = 0;
+  cache.misses = 0;
+}
+
+} // namespace helpers
+} // namespace viren2d
@@ -0,0 +1,74 @@
+#ifndef __VIREN2D_TEXT_CACHE_H__
+#define __VIREN2D_TEXT_CACHE_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cairo/cairo.h>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Default number of text lines kept by the process-wide text cache.
+constexpr std::size_t kDefaultTextCacheSize = 1024;
+
+
+/// A text line which has already been converted to glyphs (for a specific
+/// scaled font), along with its extents.
+struct ShapedText {
+  ShapedText() = default;
+  ~ShapedText();
+
+  ShapedText(const ShapedText &) = delete;
+  ShapedText &operator=(const ShapedText &) = delete;
+
+  /// The scaled font which was used to create the glyphs (we hold a
+  /// reference).
+  cairo_scaled_font_t *scaled_font = nullptr;
+
+  /// Glyphs, positioned relative to the text origin (0, 0).
+  std::vector<cairo_glyph_t> glyphs;
+
+  /// Extents of the text, as returned by `cairo_text_extents`.
+  cairo_text_extents_t extents;
+};
+
+
+/// Returns the shaped text line for the context's current font from the
+/// process-wide text cache, or nullptr if the cache is disabled or the
+/// text cannot be shaped. This function is thread-safe.
+std::shared_ptr<const ShapedText> GetShapedText(
+    cairo_t *context, const char *text);
+
+
+/// Renders the shaped text with its origin at the given position.
+/// The context's current font must be the one used for shaping.
+void ShowShapedText(
+    cairo_t *context, const ShapedText &shaped, double x, double y);
+
+
+/// Changes the capacity of the process-wide text cache. A capacity of
+/// 0 disables the cache.
+void SetTextCacheCapacity(std::size_t capacity);
+
+
+/// Returns the capacity of the process-wide text cache.
+std::size_t TextCacheCapacity();
+
+
+/// Returns the current number of entries, hits and misses of the
+/// process-wide text cache.
+void TextCacheStatistics(
+    std::size_t &size, std::size_t &hits, std::size_t &misses);
+
+
+/// Resets the hit/miss counters of the process-wide text cache.
+void ResetTextCacheStatistics();
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_TEXT_CACHE_H__
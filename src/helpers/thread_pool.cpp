@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <helpers/thread_pool.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+namespace helpers {
+namespace {
+/// Set while the calling thread processes the chunks of a loop, such that
+/// nested loops run serially instead of waiting for the busy pool.
+thread_local bool inside_parallel_loop = false;
+
+
+/// Number of threads of loops started by this thread, -1 if not set.
+thread_local int scoped_parallel_threads = -1;
+
+
+std::atomic<int> parallel_threads{0};
+std::atomic<int> parallel_threshold{kDefaultParallelThreshold};
+
+
+class ParallelLoopGuard {
+public:
+  ParallelLoopGuard() : previous_(inside_parallel_loop) {
+    inside_parallel_loop = true;
+  }
+
+  ~ParallelLoopGuard() {
+    inside_parallel_loop = previous_;
+  }
+
+private:
+  bool previous_;
+};
+
+
+void RunSerially(int num_chunks, const std::function<void(int)> &body) {
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    body(chunk);
+  }
+}
+} // anonymous namespace
+
+
+struct ThreadPool::State {
+  /// Held by the thread which currently runs a loop.
+  std::mutex run_mutex;
+
+  /// Guards all of the following members except for `next_chunk`.
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+
+  std::vector<std::thread> workers;
+  bool stop = false;
+
+  /// Incremented for each loop, so workers can tell that a new loop started.
+  std::uint64_t generation = 0;
+
+  /// Number of workers (with the lowest indices) which take part in the
+  /// current loop, and how many of them are still busy.
+  int participants = 0;
+  int pending = 0;
+
+  const std::function<void(int)> *body = nullptr;
+  int num_chunks = 0;
+  std::atomic<int> next_chunk{0};
+  std::exception_ptr error;
+
+
+  /// Claims and processes chunks until none are left.
+  void ProcessChunks() {
+    ParallelLoopGuard guard;
+    for (int chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+      try {
+        (*body)(chunk);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        // Skip the remaining chunks
+        next_chunk = num_chunks;
+      }
+    }
+  }
+
+
+  /// Waits for and takes part in loops. Starts with the generation at
+  /// the time the worker was created, since it may only acquire the
+  /// mutex after the (first) loop has been announced.
+  void WorkerLoop(int index, std::uint64_t seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [this, seen]() {
+        return stop || (generation != seen);
+      });
+      if (stop) {
+        return;
+      }
+      seen = generation;
+      if (index >= participants) {
+        continue;
+      }
+
+      lock.unlock();
+      ProcessChunks();
+      lock.lock();
+      if (--pending == 0) {
+        done.notify_one();
+      }
+    }
+  }
+
+
+  /// Starts workers until there are at least `num_workers`. Must be
+  /// called while holding `mutex`. Returns the number of workers.
+  int EnsureWorkers(int num_workers) {
+    while (static_cast<int>(workers.size()) < num_workers) {
+      const int index = static_cast<int>(workers.size());
+      const std::uint64_t start = generation;
+      try {
+        workers.emplace_back([this, index, start]() {
+          WorkerLoop(index, start);
+        });
+      } catch (const std::system_error &e) {
+        SPDLOG_WARN(
+              "Could not start thread pool worker #{:d}: {:s}",
+              index, e.what());
+        break;
+      }
+    }
+    return static_cast<int>(workers.size());
+  }
+};
+
+
+ThreadPool::ThreadPool() : state_(new State()) {
+}
+
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stop = true;
+  }
+  state_->wake.notify_all();
+  for (auto &worker : state_->workers) {
+    worker.join();
+  }
+}
+
+
+void ThreadPool::Run(
+    int num_chunks, int num_threads,
+    const std::function<void(int)> &body) {
+  if ((num_chunks < 2) || (num_threads < 2) || inside_parallel_loop) {
+    RunSerially(num_chunks, body);
+    return;
+  }
+
+  std::unique_lock<std::mutex> run_lock(state_->run_mutex, std::try_to_lock);
+  if (!run_lock.owns_lock()) {
+    RunSerially(num_chunks, body);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    // Previous (wider) loops may have started more workers than this
+    // loop is allowed to use.
+    const int requested = std::min(num_threads, num_chunks) - 1;
+    const int participants = std::min(
+          state_->EnsureWorkers(requested), requested);
+    state_->body = &body;
+    state_->num_chunks = num_chunks;
+    state_->next_chunk = 0;
+    state_->error = nullptr;
+    state_->participants = participants;
+    state_->pending = participants;
+    ++state_->generation;
+  }
+  state_->wake.notify_all();
+
+  state_->ProcessChunks();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->done.wait(lock, [this]() { return state_->pending == 0; });
+    state_->body = nullptr;
+    std::swap(error, state_->error);
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+
+int ThreadPool::NumWorkers() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return static_cast<int>(state_->workers.size());
+}
+
+
+ThreadPool &DefaultThreadPool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+
+void SetParallelThreads(int num_threads) {
+  parallel_threads = std::max(0, num_threads);
+}
+
+
+int ParallelThreads() {
+  return parallel_threads.load();
+}
+
+
+int SetScopedParallelThreads(int num_threads) {
+  const int previous = scoped_parallel_threads;
+  scoped_parallel_threads = num_threads;
+  return previous;
+}
+
+
+void SetParallelThreshold(int num_pixels) {
+  parallel_threshold = std::max(0, num_pixels);
+}
+
+
+int ParallelThreshold() {
+  return parallel_threshold.load();
+}
+
+
+int ResolveParallelThreads(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = (scoped_parallel_threads >= 0)
+        ? scoped_parallel_threads : parallel_threads.load();
+  }
+  if (num_threads <= 0) {
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  return std::max(1, num_threads);
+}
+
+
+void ParallelFor(
+    int num_rows, int row_width,
+    const std::function<void(int, int)> &body,
+    int num_threads) {
+  if (num_rows <= 0) {
+    return;
+  }
+
+  const std::int64_t num_pixels = static_cast<std::int64_t>(num_rows)
+      * static_cast<std::int64_t>(row_width);
+  num_threads = ResolveParallelThreads(num_threads);
+  if ((num_threads < 2) || (num_rows < 2)
+      || (num_pixels < ParallelThreshold())) {
+    body(0, num_rows);
+    return;
+  }
+
+  const int num_chunks = std::min(num_rows, kChunksPerThread * num_threads);
+  DefaultThreadPool().Run(
+        num_chunks, num_threads, [&](int chunk) {
+    const std::int64_t rows = num_rows;
+    body(static_cast<int>((chunk * rows) / num_chunks),
+         static_cast<int>(((chunk + 1) * rows) / num_chunks));
+  });
+}
+
+} // namespace helpers
+} // namespace viren2d
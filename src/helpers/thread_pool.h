@@ -0,0 +1,107 @@
+#ifndef __VIREN2D_THREAD_POOL_H__
+#define __VIREN2D_THREAD_POOL_H__
+
+#include <functional>
+#include <memory>
+
+
+namespace viren2d {
+namespace helpers {
+
+/// Default minimum number of pixels for which per-pixel ImageBuffer
+/// operations are distributed among multiple threads.
+constexpr int kDefaultParallelThreshold = 256 * 256;
+
+
+/// Number of chunks per thread into which a parallel loop is split. Using
+/// more chunks than threads balances the load if some threads are slowed
+/// down (*e.g.* by other processes).
+constexpr int kChunksPerThread = 4;
+
+
+/// Persistent worker threads which process the chunks of parallel loops.
+///
+/// Workers are started on demand and wait for the next loop afterwards,
+/// *i.e.* a loop doesn't pay the cost of spawning threads. The pool runs
+/// a single loop at a time.
+class ThreadPool {
+public:
+  ThreadPool();
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Calls `body(chunk)` for each chunk in `[0, num_chunks)`, using the
+  /// calling thread and up to `num_threads - 1` workers, and blocks until
+  /// all chunks have been processed.
+  ///
+  /// The chunks are processed by the calling thread alone if the pool is
+  /// busy with another loop, or if `Run` is invoked from within a loop
+  /// body (nested loops). If `body` throws, the remaining chunks will be
+  /// skipped and the first exception is rethrown.
+  void Run(int num_chunks, int num_threads,
+           const std::function<void(int)> &body);
+
+  /// Returns the number of started worker threads.
+  int NumWorkers() const;
+
+  struct State;
+
+private:
+  std::unique_ptr<State> state_;
+};
+
+
+/// Returns the process-wide thread pool of `ParallelFor`.
+ThreadPool &DefaultThreadPool();
+
+
+/// Sets the process-wide number of threads of `ParallelFor`. Values <= 0
+/// select the number of hardware threads.
+void SetParallelThreads(int num_threads);
+
+
+/// Returns the process-wide setting, see `SetParallelThreads`.
+int ParallelThreads();
+
+
+/// Overrides the number of threads of `ParallelFor` loops which are started
+/// by the calling thread. Pass -1 to remove the override. Returns the
+/// previous override.
+int SetScopedParallelThreads(int num_threads);
+
+
+/// Sets the minimum number of pixels for which `ParallelFor` distributes
+/// the work. Smaller images are always processed serially.
+void SetParallelThreshold(int num_pixels);
+
+
+/// Returns the minimum number of pixels, see `SetParallelThreshold`.
+int ParallelThreshold();
+
+
+/// Returns the number of threads which a loop should use: `num_threads` if
+/// positive, otherwise the calling thread's override (if set) or the
+/// process-wide setting. The result is always at least 1.
+int ResolveParallelThreads(int num_threads = 0);
+
+
+/// Calls `body(first_row, end_row)` for consecutive, disjoint row ranges
+/// which cover `[0, num_rows)`. The ranges are processed concurrently by
+/// the `DefaultThreadPool`, unless the image (`num_rows * row_width`
+/// pixels) is smaller than the `ParallelThreshold` or only a single thread
+/// should be used. Serial loops invoke `body(0, num_rows)` exactly once.
+///
+/// Args:
+///   num_threads: Number of threads for this loop. Values <= 0 select
+///     the configured number, see `ResolveParallelThreads`.
+void ParallelFor(
+    int num_rows, int row_width,
+    const std::function<void(int, int)> &body,
+    int num_threads = 0);
+
+} // namespace helpers
+} // namespace viren2d
+
+#endif // __VIREN2D_THREAD_POOL_H__
@@ -9,6 +9,8 @@
 #include <utility> // pair
 #include <tuple>
 #include <functional> // std::function
+#include <memory> // std::shared_ptr
+#include <mutex>
 
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -37,6 +39,8 @@
 
 #include <helpers/logging.h>
 #include <helpers/color_conversion.h>
+#include <helpers/buffer_pool.h>
+#include <helpers/thread_pool.h>
 
 
 namespace viren2d {
@@ -69,19 +73,11 @@ ImageBuffer RGBx2HSV(
   // Create destination buffer (will have contiguous memory)
   ImageBuffer dst(src.Height(), src.Width(), 3, ImageBufferType::UInt8);
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
   const int ch_r = is_bgr_format ? 2 : 0;
   const int ch_b = is_bgr_format ? 0 : 2;
 
-  float hue, sat, val;
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
+    float hue, sat, val;
     unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
     for (int col = 0; col < cols; ++col) {
       std::tie(hue, sat, val) = CvtHelperRGB2HSV(
@@ -94,7 +90,7 @@ ImageBuffer RGBx2HSV(
       *dst_ptr++ = static_cast<unsigned char>(255.0f * sat);
       *dst_ptr++ = static_cast<unsigned char>(255.0f * val);
     }
-  }
+  }, src, dst);
 
   return dst;
 }
@@ -129,21 +125,13 @@ ImageBuffer HSV2RGBx(
   ImageBuffer dst(
         src.Height(), src.Width(), output_channels, ImageBufferType::UInt8);
 
-  int rows = src.Height();
-  int cols = src.Width();
-  // dst was freshly allocated, so it's guaranteed to be contiguous
-  if (src.IsContiguous()) {
-    cols *= rows;
-    rows = 1;
-  }
-
   const int ch_r = request_bgr_format ? 2 : 0;
   const int ch_b = request_bgr_format ? 0 : 2;
 
-  float r, g, b;
-  for (int row = 0; row < rows; ++row) {
+  ParallelForRows([&](int row, int cols) {
+    float r, g, b;
     unsigned char *dst_ptr = dst.MutablePtr<unsigned char>(row, 0, 0);
-    const unsigned char *src_ptr = dst.ImmutablePtr<unsigned char>(row, 0, 0);
+    const unsigned char *src_ptr = src.ImmutablePtr<unsigned char>(row, 0, 0);
     for (int col = 0; col < cols; ++col) {
       std::tie(r, g, b) = CvtHelperHSV2RGB(
           src_ptr[0] * 2.0f,  // Hue input in [0, 180]
@@ -157,12 +145,50 @@ ImageBuffer HSV2RGBx(
         dst_ptr[3] = 255;
       }
       dst_ptr += output_channels;
-      src_ptr += 3;
+      src_ptr += src.PixelStride();
     }
-  }
+  }, src, dst);
 
   return dst;
 }
+
+
+/// Returns the process-wide buffer pool (the default allocator).
+std::shared_ptr<BufferPool> DefaultBufferPool() {
+  static std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+  return pool;
+}
+
+
+/// Guards the currently configured allocator.
+std::mutex &AllocatorMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+
+std::shared_ptr<ImageBufferAllocator> &CurrentAllocator() {
+  static std::shared_ptr<ImageBufferAllocator> allocator = DefaultBufferPool();
+  return allocator;
+}
+
+
+/// Allocates reference-counted memory for the pixel data via the
+/// configured `ImageBufferAllocator`. Returns nullptr if the allocation
+/// fails.
+std::shared_ptr<unsigned char> AllocateStorage(int num_bytes) {
+  std::shared_ptr<ImageBufferAllocator> allocator = GetImageBufferAllocator();
+  const std::size_t size = static_cast<std::size_t>(num_bytes);
+  unsigned char *memory = allocator->Allocate(size);
+  if (!memory) {
+    return nullptr;
+  }
+  // The deleter keeps the allocator alive until the memory is released.
+  return std::shared_ptr<unsigned char>(
+        memory, [allocator, size](unsigned char *ptr) {
+          allocator->Deallocate(ptr, size);
+        });
+}
 }  // namespace helpers
 
 //---------------------------------------------------- ImageBufferType
@@ -340,17 +366,18 @@ ImageBuffer::ImageBuffer()
     row_stride(0),
     pixel_stride(0),
     buffer_type(ImageBufferType::UInt8),
-    owns_data(false) {
+    storage(nullptr) {
   SPDLOG_DEBUG("ImageBuffer default constructor.");
 }
 
 
 ImageBuffer::ImageBuffer(
-    int h, int w, int ch, ImageBufferType buf_type) {
+    int h, int w, int ch, ImageBufferType buf_type, bool pad_rows) {
   SPDLOG_DEBUG(
         "ImageBuffer constructor allocating memory for a "
-        "{:d}x{:d}x{:d} {:s} image.",
-        h, w, ch, ImageBufferTypeToString(buf_type));
+        "{:d}x{:d}x{:d} {:s} image{:s}.",
+        h, w, ch, ImageBufferTypeToString(buf_type),
+        (pad_rows ? " with padded rows" : ""));
   height = h;
   width = w;
   channels = ch;
@@ -358,15 +385,18 @@ ImageBuffer::ImageBuffer(
   element_size = ElementSizeFromImageBufferType(buf_type);
   pixel_stride = channels * element_size;
   row_stride = width * pixel_stride;
+  if (pad_rows) {
+    row_stride = ((row_stride + kImageBufferAlignment - 1)
+                  / kImageBufferAlignment) * kImageBufferAlignment;
+  }
   const int num_bytes = height * row_stride;
-  owns_data = true;
-  data = static_cast<unsigned char*>(std::malloc(num_bytes));
+  storage = helpers::AllocateStorage(num_bytes);
+  data = storage.get();
   if (!data) {
     SPDLOG_CRITICAL(
           "Cannot allocate {:d} bytes to construct a {:d}x{:d}x{:d} {:s} ImageBuffer!",
           num_bytes, w, h, ch, ImageBufferTypeToString(buf_type));
     // Reset this ImageBuffer:
-    owns_data = false;
     Cleanup();
   }
 }
@@ -378,33 +408,23 @@ ImageBuffer::~ImageBuffer() {
 }
 
 
-ImageBuffer::ImageBuffer(const ImageBuffer &other) noexcept {
+ImageBuffer::ImageBuffer(const ImageBuffer &other)
+  : data(other.data),
+    height(other.height),
+    width(other.width),
+    channels(other.channels),
+    element_size(other.element_size),
+    row_stride(other.row_stride),
+    pixel_stride(other.pixel_stride),
+    buffer_type(other.buffer_type),
+    storage(other.storage),
+    view_pin(other.view_pin) {
+  // Owned memory is only referenced, see `EnsureUniqueData`. Pinned memory,
+  // however, may change at any time, thus we need a snapshot:
   SPDLOG_DEBUG(
         "ImageBuffer copy constructor, with other: {:s}.", other.ToString());
-  height = other.height;
-  width = other.width;
-  channels = other.channels;
-  element_size = other.element_size;
-  buffer_type = other.buffer_type;
-  row_stride = other.row_stride;
-  pixel_stride = other.pixel_stride;
-  owns_data = other.owns_data;
-
-  if (other.owns_data) {
-    const int num_bytes = other.NumBytes();
-    data = static_cast<unsigned char*>(std::malloc(num_bytes));
-    if (data) {
-      std::memcpy(data, other.data, num_bytes);
-    } else {
-      SPDLOG_CRITICAL(
-            "Cannot allocate {:d} bytes to copy construct an ImageBuffer "
-            "from {:s}!", num_bytes, other.ToString());
-      // Reset this ImageBuffer:
-      owns_data = false;
-      Cleanup();
-    }
-  } else {
-    data = other.data;
+  if (other.IsPinned()) {
+    DetachData();
   }
 }
 
@@ -418,10 +438,11 @@ ImageBuffer::ImageBuffer(ImageBuffer &&other) noexcept
     row_stride(other.row_stride),
     pixel_stride(other.pixel_stride),
     buffer_type(other.buffer_type),
-    owns_data(other.owns_data) {
+    storage(std::move(other.storage)),
+    pin(std::move(other.pin)),
+    view_pin(std::move(other.view_pin)) {
   SPDLOG_DEBUG("ImageBuffer move constructor.");
-  // Reset "other", but ensure that the memory won't be freed:
-  other.owns_data = false;
+  // Reset "other" (it no longer references the memory):
   other.Cleanup();
 }
 
@@ -442,7 +463,9 @@ ImageBuffer &ImageBuffer::operator=(ImageBuffer &&other) noexcept {
   std::swap(row_stride, other.row_stride);
   std::swap(pixel_stride, other.pixel_stride);
   std::swap(buffer_type, other.buffer_type);
-  std::swap(owns_data, other.owns_data);
+  std::swap(storage, other.storage);
+  std::swap(pin, other.pin);
+  std::swap(view_pin, other.view_pin);
   return *this;
 }
 
@@ -457,7 +480,6 @@ void ImageBuffer::CreateSharedBuffer(unsigned char *buffer, int height, int widt
   // Clean up first (if this instance already holds image data)
   Cleanup();
 
-  this->owns_data = false;
   this->data = buffer;
   this->width = width;
   this->height = height;
@@ -484,14 +506,14 @@ void ImageBuffer::CreateCopiedBuffer(
 
   this->element_size = ElementSizeFromImageBufferType(buffer_type);
   const int num_bytes = height * width * channels * element_size;
-  data = static_cast<unsigned char*>(std::malloc(num_bytes));
+  storage = helpers::AllocateStorage(num_bytes);
+  data = storage.get();
   if (!data) {
     std::ostringstream msg;
     msg << "Cannot allocate " << num_bytes << " bytes to copy ImageBuffer!";
     SPDLOG_ERROR(msg.str());
     throw std::runtime_error(msg.str());
   }
-  owns_data = true;
   this->width = width;
   this->height = height;
   this->channels = channels;
@@ -579,11 +601,17 @@ ImageBuffer ImageBuffer::ROI(int left, int top, int roi_width, int roi_height) {
     throw std::out_of_range(msg.str());
   }
 
+  // The view will usually be used to modify this buffer, thus it must
+  // not point to memory which is also referenced by other buffers. As
+  // long as the view exists, later copies of this buffer must not share
+  // the memory either:
+  std::shared_ptr<void> roi_pin = storage ? PinData() : view_pin;
   ImageBuffer roi;
   unsigned char *roi_data = data + ByteOffset(top, left, 0);
   roi.CreateSharedBuffer(
         roi_data, roi_height, roi_width, channels,
         row_stride, pixel_stride, buffer_type);
+  roi.view_pin = std::move(roi_pin);
   return roi;
 }
 
@@ -654,8 +682,66 @@ void ImageBuffer::SwapChannels(int ch1, int ch2) {
 }
 
 
+std::shared_ptr<void> ImageBuffer::PinData() {
+  if (!storage) {
+    return nullptr;
+  }
+
+  auto handle = pin.lock();
+  if (handle && (*handle == storage)) {
+    return handle;
+  }
+
+  // Other owners must keep the current content:
+  EnsureUniqueData();
+  SPDLOG_TRACE("ImageBuffer::PinData: Pinning {:s}.", ToString());
+  handle = std::make_shared<std::shared_ptr<unsigned char>>(storage);
+  pin = handle;
+  return handle;
+}
+
+
+bool ImageBuffer::IsPinned() const {
+  const auto handle = pin.lock();
+  return storage && handle && (*handle == storage);
+}
+
+
 void ImageBuffer::TakeOwnership() {
-  owns_data = true;
+  if (data && !storage) {
+    storage = std::shared_ptr<unsigned char>(data, std::free);
+  }
+}
+
+
+void ImageBuffer::DetachData() {
+  SPDLOG_TRACE(
+        "ImageBuffer::DetachData: Copying memory referenced by {:d} buffers.",
+        storage.use_count());
+  // The other buffers keep the current memory alive until the copy
+  // has been created.
+  if ((pixel_stride == channels * element_size)
+      && (row_stride >= width * pixel_stride)) {
+    // Owned memory is usually either contiguous or has padded rows. Then,
+    // we keep the layout and copy the whole block at once:
+    const int num_bytes = height * row_stride;
+    std::shared_ptr<unsigned char> copy = helpers::AllocateStorage(num_bytes);
+    if (!copy) {
+      std::ostringstream msg;
+      msg << "Cannot allocate " << num_bytes << " bytes to copy ImageBuffer!";
+      SPDLOG_ERROR(msg.str());
+      throw std::runtime_error(msg.str());
+    }
+    std::memcpy(copy.get(), data, num_bytes);
+    storage = std::move(copy);
+    data = storage.get();
+  } else {
+    ImageBuffer copy;
+    copy.CreateCopiedBuffer(
+          data, height, width, channels,
+          row_stride, pixel_stride, element_size, buffer_type);
+    *this = std::move(copy);
+  }
 }
 
 
@@ -1262,7 +1348,7 @@ std::string ImageBuffer::ToString() const {
     << "x" << channels
     << ", " << ImageBufferTypeToString(buffer_type);
 
-  if (owns_data)
+  if (storage)
     s << ", copied memory";
   else
     s << ", shared memory";
@@ -1275,14 +1361,18 @@ std::string ImageBuffer::ToString() const {
 
 void ImageBuffer::Cleanup() {
   SPDLOG_TRACE("ImageBuffer::Cleanup().");
-  if (data && owns_data) {
+  if (storage) {
     SPDLOG_TRACE(
-          "ImageBuffer freeing {:d}x{:d}x{:d}={:d} entries a {:d} byte(s).",
-          width, height, channels, NumElements(), item_size);
-    std::free(data);
+          "ImageBuffer releasing {:d}x{:d}x{:d}={:d} entries a {:d} byte(s), "
+          "referenced by {:d} buffers.",
+          width, height, channels, NumElements(), item_size,
+          storage.use_count());
+    // The memory will be freed by the last referencing ImageBuffer:
+    storage.reset();
   }
+  pin.reset();
+  view_pin.reset();
   data = nullptr;
-  owns_data = false;
   width = 0;
   height = 0;
   channels = 0;
@@ -1535,4 +1625,77 @@ void SaveImageUInt8(
   }
 }
 
+//---------------------------------------------------- Allocation
+void SetImageBufferAllocator(std::shared_ptr<ImageBufferAllocator> allocator) {
+  SPDLOG_DEBUG("Setting {:s} ImageBuffer allocator.",
+               (allocator ? "custom" : "default"));
+  if (!allocator) {
+    allocator = helpers::DefaultBufferPool();
+  }
+  std::lock_guard<std::mutex> lock(helpers::AllocatorMutex());
+  helpers::CurrentAllocator() = std::move(allocator);
+}
+
+
+std::shared_ptr<ImageBufferAllocator> GetImageBufferAllocator() {
+  std::lock_guard<std::mutex> lock(helpers::AllocatorMutex());
+  return helpers::CurrentAllocator();
+}
+
+
+void SetImageBufferPoolCapacity(std::size_t num_bytes) {
+  SPDLOG_DEBUG("Setting ImageBuffer pool capacity to {:d} bytes.", num_bytes);
+  helpers::DefaultBufferPool()->SetCapacity(num_bytes);
+}
+
+
+std::size_t ImageBufferPoolCapacity() {
+  return helpers::DefaultBufferPool()->Capacity();
+}
+
+
+ImageBufferPoolStatistics GetImageBufferPoolStatistics(bool reset) {
+  return helpers::DefaultBufferPool()->Statistics(reset);
+}
+
+
+void ReleaseImageBufferPool() {
+  SPDLOG_DEBUG("Releasing the ImageBuffer pool.");
+  helpers::DefaultBufferPool()->Release();
+}
+
+//---------------------------------------------------- Multi-threading
+void SetImageBufferThreads(int num_threads) {
+  SPDLOG_DEBUG("Setting ImageBuffer threads to {:d}.", num_threads);
+  helpers::SetParallelThreads(num_threads);
+}
+
+
+int ImageBufferThreads() {
+  return helpers::ParallelThreads();
+}
+
+
+void SetImageBufferParallelThreshold(int num_pixels) {
+  SPDLOG_DEBUG(
+        "Setting ImageBuffer parallel threshold to {:d} pixels.", num_pixels);
+  helpers::SetParallelThreshold(num_pixels);
+}
+
+
+int ImageBufferParallelThreshold() {
+  return helpers::ParallelThreshold();
+}
+
+
+ImageBufferThreadsScope::ImageBufferThreadsScope(int num_threads)
+  : previous_(helpers::SetScopedParallelThreads(std::max(0, num_threads))) {
+}
+
+
+ImageBufferThreadsScope::~ImageBufferThreadsScope() {
+  helpers::SetScopedParallelThreads(previous_);
+}
+
+
 } // namespace viren2d
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <viren2d/trajectory_store.h>
+#include <helpers/logging.h>
+
+
+namespace viren2d {
+TrajectoryStore::TrajectoryStore(std::size_t capacity, int smoothing_window)
+  : capacity_(capacity),
+    smoothing_window_((smoothing_window > 1) ? smoothing_window : 0) {
+  if (capacity < 2) {
+    std::ostringstream msg;
+    msg << "A trajectory store must keep at least 2 positions per track, "
+           "but capacity is " << capacity << '!';
+    throw std::invalid_argument(msg.str());
+  }
+}
+
+
+bool TrajectoryStore::Contains(TrackID track_id) const {
+  return tracks_.find(track_id) != tracks_.end();
+}
+
+
+std::vector<TrajectoryStore::TrackID> TrajectoryStore::TrackIDs() const {
+  std::vector<TrackID> ids;
+  ids.reserve(tracks_.size());
+  for (const auto &entry : tracks_) {
+    ids.push_back(entry.first);
+  }
+  return ids;
+}
+
+
+std::size_t TrajectoryStore::NumPoints(TrackID track_id) const {
+  const auto it = tracks_.find(track_id);
+  return (it != tracks_.end()) ? NumPoints(it->second) : 0;
+}
+
+
+std::vector<Vec2d> TrajectoryStore::Points(TrackID track_id) const {
+  const auto it = tracks_.find(track_id);
+  if (it == tracks_.end()) {
+    return std::vector<Vec2d>();
+  }
+  const Vec2d *data = Data(it->second);
+  return std::vector<Vec2d>(data, data + NumPoints(it->second));
+}
+
+
+void TrajectoryStore::Append(TrackID track_id, const Vec2d &position) {
+  Track &track = tracks_[track_id];
+  const std::size_t index = track.num_appended++;
+
+  const std::size_t neighbors = static_cast<std::size_t>(
+        smoothing_window_ / 2);
+  if (neighbors == 0) {
+    Store(track, index, position);
+    return;
+  }
+
+  // The averages of the most recent positions use the raw positions
+  // [index - 2 * neighbors, index]. Additionally, we need to remember
+  // the position which just left this window.
+  const std::size_t window = 2 * neighbors + 1;
+  if (track.recent.empty()) {
+    track.recent.resize(window + 1);
+    track.window_sum = Vec2d(0.0, 0.0);
+  }
+  const std::size_t num_recent = track.recent.size();
+  track.recent[index % num_recent] = position;
+
+  // Update the running sum over [lower, index]:
+  const std::size_t lower = (index >= window) ? (index - window + 1) : 0;
+  if ((index % num_recent) == 0) {
+    // Re-sum once per revolution of the ring buffer to prevent
+    // accumulating floating point errors on long tracks.
+    track.window_sum = Vec2d(0.0, 0.0);
+    for (std::size_t idx = lower; idx <= index; ++idx) {
+      track.window_sum += track.recent[idx % num_recent];
+    }
+  } else {
+    track.window_sum += position;
+    if (index >= window) {
+      track.window_sum -= track.recent[(index - window) % num_recent];
+    }
+  }
+
+  // The new position affects the averages of its preceding neighbors,
+  // i.e. [index - neighbors, index]. Their windows all end at the new
+  // position, but start at (at most) `neighbors` positions before them.
+  // The first of these is the only one with a complete window, thus its
+  // average won't change anymore.
+  const std::size_t first = (index >= neighbors) ? (index - neighbors) : 0;
+  const std::size_t oldest_kept = (index >= capacity_)
+      ? (index - capacity_ + 1) : 0;
+  Vec2d sum = track.window_sum;
+  std::size_t start = lower;
+  for (std::size_t idx = first; idx <= index; ++idx) {
+    const std::size_t idx_start = (idx >= neighbors) ? (idx - neighbors) : 0;
+    for (; start < idx_start; ++start) {
+      sum -= track.recent[start % num_recent];
+    }
+    if (idx >= oldest_kept) {
+      Store(track, idx, sum / static_cast<double>(index - start + 1));
+    }
+  }
+}
+
+
+bool TrajectoryStore::SetColor(TrackID track_id, const Color &color) {
+  auto it = tracks_.find(track_id);
+  if (it == tracks_.end()) {
+    return false;
+  }
+  it->second.color = color;
+  return true;
+}
+
+
+Color TrajectoryStore::GetColor(TrackID track_id) const {
+  const auto it = tracks_.find(track_id);
+  return (it != tracks_.end()) ? it->second.color : Color::Invalid;
+}
+
+
+bool TrajectoryStore::Remove(TrackID track_id) {
+  return tracks_.erase(track_id) > 0;
+}
+
+
+void TrajectoryStore::Clear() {
+  tracks_.clear();
+}
+
+
+void TrajectoryStore::ForEachTrack(
+    const std::function<void(
+      TrackID, const Vec2d *, std::size_t, const Color &)> &visitor) const {
+  for (const auto &entry : tracks_) {
+    visitor(
+          entry.first, Data(entry.second), NumPoints(entry.second),
+          entry.second.color);
+  }
+}
+
+
+std::string TrajectoryStore::ToString() const {
+  std::ostringstream s;
+  s << "TrajectoryStore(" << tracks_.size()
+    << ((tracks_.size() == 1) ? " track" : " tracks")
+    << ", capacity=" << capacity_;
+  if (smoothing_window_ > 0) {
+    s << ", smoothing_window=" << smoothing_window_;
+  }
+  s << ')';
+  return s.str();
+}
+
+
+void TrajectoryStore::Store(
+    Track &track, std::size_t index, const Vec2d &position) const {
+  if (track.points.size() <= capacity_) {
+    // The ring buffer hasn't wrapped around yet, so the positions are
+    // stored consecutively.
+    if (index < capacity_) {
+      if (index < track.points.size()) {
+        track.points[index] = position;
+      } else {
+        track.points.push_back(position);
+      }
+      return;
+    }
+
+    // Switch to the double-mapped layout, i.e. mirror the positions
+    // into the second half:
+    track.points.resize(2 * capacity_);
+    std::copy(
+          track.points.begin(), track.points.begin() + capacity_,
+          track.points.begin() + capacity_);
+  }
+
+  const std::size_t slot = index % capacity_;
+  track.points[slot] = position;
+  track.points[slot + capacity_] = position;
+}
+
+
+std::size_t TrajectoryStore::NumPoints(const Track &track) const {
+  return std::min(track.num_appended, capacity_);
+}
+
+
+const Vec2d *TrajectoryStore::Data(const Track &track) const {
+  if (track.points.size() <= capacity_) {
+    return track.points.data();
+  }
+  // The oldest kept position and its successors are contiguous, because
+  // each slot is mirrored at slot + capacity.
+  const std::size_t oldest = track.num_appended - capacity_;
+  return track.points.data() + (oldest % capacity_);
+}
+
+} // namespace viren2d
@@ -0,0 +1,228 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/imagebuffer.h>
+#include <helpers/buffer_pool.h>
+
+
+namespace {
+/// Forwards to the buffer pool and counts the calls.
+class CountingAllocator : public viren2d::ImageBufferAllocator {
+public:
+  unsigned char *Allocate(std::size_t num_bytes) override {
+    ++num_allocations;
+    return pool.Allocate(num_bytes);
+  }
+
+  void Deallocate(unsigned char *memory, std::size_t num_bytes) override {
+    ++num_deallocations;
+    pool.Deallocate(memory, num_bytes);
+  }
+
+  viren2d::helpers::BufferPool pool;
+  std::atomic<int> num_allocations{0};
+  std::atomic<int> num_deallocations{0};
+};
+} // anonymous namespace
+
+
+TEST(BufferPoolTest, SizeClasses) {
+  using viren2d::helpers::BufferPool;
+  EXPECT_EQ(64, BufferPool::SizeClass(0));
+  EXPECT_EQ(64, BufferPool::SizeClass(1));
+  EXPECT_EQ(64, BufferPool::SizeClass(64));
+  EXPECT_EQ(128, BufferPool::SizeClass(65));
+  EXPECT_EQ(1024, BufferPool::SizeClass(1000));
+  EXPECT_EQ(6291456, BufferPool::SizeClass(1920 * 1080 * 3));
+
+  for (std::size_t num_bytes = 1; num_bytes < 100000; num_bytes += 37) {
+    const std::size_t size_class = BufferPool::SizeClass(num_bytes);
+    EXPECT_GE(size_class, num_bytes);
+    EXPECT_EQ(0, size_class % 64);
+    EXPECT_LE(size_class, std::max<std::size_t>(64, num_bytes + num_bytes / 8 + 64));
+    // Each class maps onto itself:
+    EXPECT_EQ(size_class, BufferPool::SizeClass(size_class));
+  }
+}
+
+
+TEST(BufferPoolTest, Recycling) {
+  viren2d::helpers::BufferPool pool(1 << 20);
+  EXPECT_EQ(1 << 20, pool.Capacity());
+
+  unsigned char *a = pool.Allocate(1000);
+  ASSERT_NE(nullptr, a);
+  auto stats = pool.Statistics(false);
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.bytes_retained);
+
+  pool.Deallocate(a, 1000);
+  stats = pool.Statistics(false);
+  EXPECT_EQ(1024, stats.bytes_retained);
+  EXPECT_EQ(1, stats.blocks_retained);
+
+  // Same size class reuses the block
+  unsigned char *b = pool.Allocate(1020);
+  EXPECT_EQ(a, b);
+  stats = pool.Statistics(true);
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.bytes_retained);
+  EXPECT_EQ(0, stats.blocks_retained);
+
+  // Different size class must not
+  pool.Deallocate(b, 1020);
+  unsigned char *c = pool.Allocate(2000);
+  EXPECT_NE(b, c);
+  stats = pool.Statistics(false);
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(1024, stats.bytes_retained);
+
+  // More blocks than the thread cache holds go to the shared lists
+  std::vector<unsigned char *> blocks;
+  for (std::size_t idx = 0; idx < 3 * viren2d::helpers::kThreadCacheBlocks; ++idx) {
+    blocks.push_back(pool.Allocate(2000));
+  }
+  for (unsigned char *block : blocks) {
+    pool.Deallocate(block, 2000);
+  }
+  stats = pool.Statistics(true);
+  EXPECT_EQ(1 + blocks.size(), stats.blocks_retained);
+  for (std::size_t idx = 0; idx < blocks.size(); ++idx) {
+    blocks[idx] = pool.Allocate(2000);
+  }
+  stats = pool.Statistics(false);
+  EXPECT_EQ(blocks.size(), stats.hits);
+  EXPECT_EQ(0, stats.misses);
+
+  for (unsigned char *block : blocks) {
+    pool.Deallocate(block, 2000);
+  }
+  pool.Deallocate(c, 2000);
+  pool.Release();
+  stats = pool.Statistics(false);
+  EXPECT_EQ(0, stats.bytes_retained);
+  EXPECT_EQ(0, stats.blocks_retained);
+}
+
+
+TEST(BufferPoolTest, Capacity) {
+  viren2d::helpers::BufferPool pool(4096);
+
+  // Blocks which would exceed the capacity are freed immediately
+  unsigned char *large = pool.Allocate(8192);
+  pool.Deallocate(large, 8192);
+  EXPECT_EQ(0, pool.Statistics(false).bytes_retained);
+
+  std::vector<unsigned char *> blocks;
+  for (int idx = 0; idx < 6; ++idx) {
+    blocks.push_back(pool.Allocate(1024));
+  }
+  for (unsigned char *block : blocks) {
+    pool.Deallocate(block, 1024);
+  }
+  auto stats = pool.Statistics(false);
+  EXPECT_EQ(4096, stats.bytes_retained);
+  EXPECT_EQ(4, stats.blocks_retained);
+
+  // Reducing the capacity trims the shared free lists
+  pool.SetCapacity(2048);
+  EXPECT_EQ(2048, pool.Capacity());
+  EXPECT_LE(pool.Statistics(false).bytes_retained, 4096);
+  pool.Release();
+  EXPECT_EQ(0, pool.Statistics(false).bytes_retained);
+
+  pool.SetCapacity(0);
+  unsigned char *block = pool.Allocate(10);
+  pool.Deallocate(block, 10);
+  EXPECT_EQ(0, pool.Statistics(false).blocks_retained);
+}
+
+
+TEST(BufferPoolTest, Threads) {
+  viren2d::helpers::BufferPool pool(1 << 24);
+  constexpr int kNumThreads = 4;
+  constexpr int kNumIterations = 500;
+
+  // Allocate in one thread and free in another, while other threads
+  // recycle their own blocks.
+  std::vector<unsigned char *> handover(kNumIterations, nullptr);
+  std::vector<std::thread> workers;
+  for (int tidx = 0; tidx < kNumThreads; ++tidx) {
+    workers.emplace_back([&pool, &handover, tidx]() {
+      for (int iter = 0; iter < kNumIterations; ++iter) {
+        const std::size_t num_bytes = 100 + 300 * ((iter + tidx) % 5);
+        unsigned char *block = pool.Allocate(num_bytes);
+        ASSERT_NE(nullptr, block);
+        block[0] = static_cast<unsigned char>(tidx);
+        block[num_bytes - 1] = static_cast<unsigned char>(iter);
+        EXPECT_EQ(static_cast<unsigned char>(tidx), block[0]);
+        pool.Deallocate(block, num_bytes);
+      }
+      if (tidx == 0) {
+        for (int iter = 0; iter < kNumIterations; ++iter) {
+          handover[iter] = pool.Allocate(4000);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (unsigned char *block : handover) {
+    pool.Deallocate(block, 4000);
+  }
+
+  // The exited threads have returned their cached blocks
+  const auto stats = pool.Statistics(false);
+  EXPECT_EQ(kNumThreads * kNumIterations + kNumIterations,
+            static_cast<int>(stats.hits + stats.misses));
+  EXPECT_GT(stats.hits, stats.misses);
+  pool.Release();
+  EXPECT_EQ(0, pool.Statistics(false).bytes_retained);
+}
+
+
+TEST(BufferPoolTest, ImageBufferAllocator) {
+  auto allocator = std::make_shared<CountingAllocator>();
+  viren2d::SetImageBufferAllocator(allocator);
+  EXPECT_EQ(allocator, viren2d::GetImageBufferAllocator());
+
+  {
+    viren2d::ImageBuffer buf(10, 20, 3, viren2d::ImageBufferType::UInt8);
+    EXPECT_EQ(1, allocator->num_allocations);
+    viren2d::ImageBuffer copy(buf);
+    EXPECT_EQ(1, allocator->num_allocations);
+    viren2d::ImageBuffer converted = buf.ToChannels(4);
+    EXPECT_EQ(2, allocator->num_allocations);
+    EXPECT_EQ(0, allocator->num_deallocations);
+  }
+  EXPECT_EQ(2, allocator->num_deallocations);
+
+  // Buffers return their memory to the allocator which provided it
+  viren2d::ImageBuffer buf(10, 20, 3, viren2d::ImageBufferType::Float);
+  viren2d::SetImageBufferAllocator(nullptr);
+  EXPECT_NE(allocator, viren2d::GetImageBufferAllocator());
+  buf = viren2d::ImageBuffer();
+  EXPECT_EQ(3, allocator->num_allocations);
+  EXPECT_EQ(3, allocator->num_deallocations);
+
+  // The default pool reuses the memory of released buffers
+  viren2d::GetImageBufferPoolStatistics(true);
+  for (int idx = 0; idx < 5; ++idx) {
+    viren2d::ImageBuffer tmp(480, 640, 3, viren2d::ImageBufferType::UInt8);
+    EXPECT_TRUE(tmp.IsValid());
+  }
+  const auto stats = viren2d::GetImageBufferPoolStatistics();
+  EXPECT_EQ(5, stats.hits + stats.misses);
+  EXPECT_GE(stats.hits, 4);
+  viren2d::ReleaseImageBufferPool();
+  EXPECT_EQ(0, viren2d::GetImageBufferPoolStatistics().bytes_retained);
+}
@@ -0,0 +1,275 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/imagebuffer.h>
+#include <helpers/channel_shuffle.h>
+
+
+namespace {
+/// Restores the process-wide kernel & multi-threading settings upon
+/// destruction.
+class ShuffleSettingsGuard {
+public:
+  ShuffleSettingsGuard()
+    : level_(viren2d::helpers::ChannelShuffleLevel()),
+      threads_(viren2d::ImageBufferThreads()),
+      threshold_(viren2d::ImageBufferParallelThreshold()) {
+  }
+
+  ~ShuffleSettingsGuard() {
+    viren2d::helpers::SetChannelShuffleLevel(level_);
+    viren2d::SetImageBufferThreads(threads_);
+    viren2d::SetImageBufferParallelThreshold(threshold_);
+  }
+
+private:
+  viren2d::helpers::SimdLevel level_;
+  int threads_;
+  int threshold_;
+};
+
+
+/// Returns all instruction sets which can be tested on this host.
+std::vector<viren2d::helpers::SimdLevel> SupportedLevels() {
+  using viren2d::helpers::SimdLevel;
+  std::vector<SimdLevel> levels;
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3,
+                          SimdLevel::AVX2, SimdLevel::AVX512}) {
+    if (level <= viren2d::helpers::SupportedSimdLevel()) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+
+/// Per-pixel reference implementation of a channel shuffle.
+std::vector<unsigned char> ShuffleReference(
+    const std::vector<unsigned char> &src, int element_size,
+    int src_channels, int dst_channels, const int *map,
+    const unsigned char *fill, int num_pixels) {
+  std::vector<unsigned char> dst(num_pixels * dst_channels * element_size);
+  for (int idx = 0; idx < num_pixels; ++idx) {
+    for (int ch = 0; ch < dst_channels; ++ch) {
+      unsigned char *out = &dst[(idx * dst_channels + ch) * element_size];
+      if (map[ch] < 0) {
+        std::memcpy(out, fill, element_size);
+      } else {
+        std::memcpy(
+              out, &src[(idx * src_channels + map[ch]) * element_size],
+              element_size);
+      }
+    }
+  }
+  return dst;
+}
+
+
+/// Fills the buffers with the same (non-trivial) values.
+template <typename _Tp, typename _Tref>
+void FillPattern(viren2d::ImageBuffer &buf, viren2d::ImageBuffer &ref) {
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      for (int ch = 0; ch < buf.Channels(); ++ch) {
+        const int value = (row * 37 + col * 13 + ch * 101) % 251;
+        buf.AtUnchecked<_Tp>(row, col, ch) = static_cast<_Tp>(value);
+        ref.AtUnchecked<_Tref>(row, col, ch) = static_cast<_Tref>(value);
+      }
+    }
+  }
+}
+
+
+/// Checks that both buffers have the same shape and values.
+template <typename _Tp, typename _Tref>
+::testing::AssertionResult IsEqual(
+    const viren2d::ImageBuffer &expected, const viren2d::ImageBuffer &buf) {
+  if ((expected.Width() != buf.Width())
+      || (expected.Height() != buf.Height())
+      || (expected.Channels() != buf.Channels())) {
+    return ::testing::AssertionFailure()
+        << "Buffers differ: " << expected.ToString()
+        << " vs. " << buf.ToString();
+  }
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      for (int ch = 0; ch < buf.Channels(); ++ch) {
+        if (static_cast<double>(expected.AtUnchecked<_Tref>(row, col, ch))
+            != static_cast<double>(buf.AtUnchecked<_Tp>(row, col, ch))) {
+          return ::testing::AssertionFailure()
+              << "Buffers " << buf.ToString() << " differ at row " << row
+              << ", col " << col << ", ch " << ch;
+        }
+      }
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+
+/// Compares the SIMD-accelerated conversions of `_Tp` buffers against the
+/// templated pixel loops, which are used for the `_Tref` buffers.
+template <typename _Tp, typename _Tref>
+void CheckConversions(
+    viren2d::ImageBufferType type, viren2d::ImageBufferType ref_type) {
+  using viren2d::ImageBuffer;
+  for (int height : {1, 3}) {
+    for (int width = 1; width < 70; width += (width < 40) ? 1 : 13) {
+      for (int channels : {1, 3, 4}) {
+        ImageBuffer buf(height, width, channels, type);
+        ImageBuffer ref(height, width, channels, ref_type);
+        FillPattern<_Tp, _Tref>(buf, ref);
+
+        for (int out_channels : {3, 4}) {
+          EXPECT_TRUE((IsEqual<_Tp, _Tref>(
+                ref.ToChannels(out_channels), buf.ToChannels(out_channels))))
+              << "channels " << channels << " --> " << out_channels;
+        }
+
+        for (int ch = 0; ch < channels; ++ch) {
+          EXPECT_TRUE((IsEqual<_Tp, _Tref>(ref.Channel(ch), buf.Channel(ch))))
+              << "extracting channel " << ch << " of " << channels;
+        }
+
+        for (int ch1 = 0; ch1 < channels; ++ch1) {
+          for (int ch2 = ch1 + 1; ch2 < channels; ++ch2) {
+            ImageBuffer swapped = buf.DeepCopy();
+            ImageBuffer ref_swapped = ref.DeepCopy();
+            swapped.SwapChannels(ch1, ch2);
+            ref_swapped.SwapChannels(ch1, ch2);
+            EXPECT_TRUE((IsEqual<_Tp, _Tref>(ref_swapped, swapped)))
+                << "swapping channels " << ch1 << " & " << ch2;
+          }
+        }
+      }
+    }
+  }
+}
+} // anonymous namespace
+
+
+TEST(ChannelShuffleTest, Kernels) {
+  using viren2d::helpers::ChannelShuffle;
+  using viren2d::helpers::SimdLevel;
+
+  // Input channels, output channels & the corresponding channel maps
+  const std::vector<std::vector<int>> configs = {
+    {1, 3, 0, 0, 0},      // Gray --> RGB
+    {1, 4, 0, 0, 0, -1},  // Gray --> RGBA
+    {3, 4, 0, 1, 2, -1},  // RGB --> RGBA
+    {3, 4, 2, 1, 0, -1},  // RGB --> BGRA
+    {4, 3, 0, 1, 2},      // RGBA --> RGB
+    {4, 3, 2, 1, 0},      // RGBA --> BGR
+    {3, 3, 2, 1, 0},      // RGB --> BGR
+    {4, 4, 2, 1, 0, 3},   // RGBA --> BGRA
+    {4, 4, 0, 3, 2, 1},
+    {2, 2, 1, 0},
+    {3, 1, 1},            // Channel extraction
+    {4, 1, 3},
+    {2, 1, 0}
+  };
+
+  const unsigned char fill[8] = {0x11, 0x22, 0x33, 0x44,
+                                 0x55, 0x66, 0x77, 0x88};
+  const int guard = 64;
+  const unsigned char guard_value = 0xA5;
+
+  for (SimdLevel level : SupportedLevels()) {
+    for (int element_size : {1, 2, 4, 8}) {
+      for (const auto &config : configs) {
+        const int src_channels = config[0];
+        const int dst_channels = config[1];
+        const int *map = &config[2];
+        const ChannelShuffle shuffle(
+              element_size, src_channels, dst_channels, map, fill, level);
+        EXPECT_LE(shuffle.Level(), level);
+
+        for (int num_pixels = 1; num_pixels < 100; ++num_pixels) {
+          std::vector<unsigned char> src(
+                num_pixels * src_channels * element_size);
+          for (std::size_t idx = 0; idx < src.size(); ++idx) {
+            src[idx] = static_cast<unsigned char>((idx * 7 + 3) % 256);
+          }
+
+          const std::vector<unsigned char> expected = ShuffleReference(
+                src, element_size, src_channels, dst_channels, map, fill,
+                num_pixels);
+
+          // The kernels must not write beyond the output pixels
+          std::vector<unsigned char> dst(expected.size() + guard, guard_value);
+          shuffle.Run(src.data(), dst.data(), num_pixels);
+          EXPECT_EQ(
+                0, std::memcmp(expected.data(), dst.data(), expected.size()))
+              << "level " << static_cast<int>(level) << ", element size "
+              << element_size << ", " << src_channels << " --> "
+              << dst_channels << " channels, " << num_pixels << " pixels";
+          for (int idx = 0; idx < guard; ++idx) {
+            EXPECT_EQ(guard_value, dst[expected.size() + idx]);
+          }
+
+          if (src_channels == dst_channels) {
+            shuffle.Run(src.data(), src.data(), num_pixels);
+            EXPECT_EQ(src, expected)
+                << "in-place, level " << static_cast<int>(level)
+                << ", element size " << element_size << ", "
+                << src_channels << " channels, " << num_pixels << " pixels";
+          }
+        }
+      }
+    }
+  }
+}
+
+
+TEST(ChannelShuffleTest, KernelSelection) {
+  using viren2d::helpers::ChannelShuffle;
+  using viren2d::helpers::SimdLevel;
+
+  const int gray_to_rgba[] = {0, 0, 0, -1};
+  const uint8_t alpha = 255;
+  for (SimdLevel level : SupportedLevels()) {
+    const ChannelShuffle shuffle(1, 1, 4, gray_to_rgba, &alpha, level);
+    EXPECT_EQ(level, shuffle.Level());
+  }
+
+  // 8-byte elements with 4 channels exceed the 16 byte input window
+  const int swap[] = {1, 0, 2, 3};
+  const ChannelShuffle scalar(8, 4, 4, swap, nullptr);
+  EXPECT_EQ(SimdLevel::Scalar, scalar.Level());
+
+  // Invalid configurations
+  EXPECT_THROW(ChannelShuffle(3, 1, 3, gray_to_rgba, &alpha),
+               std::invalid_argument);
+  EXPECT_THROW(ChannelShuffle(1, 0, 3, gray_to_rgba, &alpha),
+               std::invalid_argument);
+  EXPECT_THROW(ChannelShuffle(1, 1, 5, gray_to_rgba, &alpha),
+               std::invalid_argument);
+  EXPECT_THROW(ChannelShuffle(1, 1, 4, gray_to_rgba, nullptr),
+               std::invalid_argument);
+  EXPECT_THROW(ChannelShuffle(1, 2, 3, swap, nullptr),
+               std::invalid_argument);
+}
+
+
+TEST(ChannelShuffleTest, ImageBufferConversions) {
+  using viren2d::ImageBufferType;
+  ShuffleSettingsGuard guard;
+
+  for (int num_threads : {1, 3}) {
+    viren2d::SetImageBufferThreads(num_threads);
+    viren2d::SetImageBufferParallelThreshold((num_threads > 1) ? 0 : 1 << 30);
+
+    for (auto level : SupportedLevels()) {
+      viren2d::helpers::SetChannelShuffleLevel(level);
+      EXPECT_EQ(level, viren2d::helpers::ChannelShuffleLevel());
+
+      CheckConversions<uint8_t, int16_t>(
+            ImageBufferType::UInt8, ImageBufferType::Int16);
+      CheckConversions<float, double>(
+            ImageBufferType::Float, ImageBufferType::Double);
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#include <exception>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/display_list.h>
+
+
+TEST(DisplayListTest, Recording) {
+  viren2d::DisplayList list;
+  EXPECT_TRUE(list.Empty());
+  EXPECT_EQ(0, list.NumStyles());
+
+  viren2d::LineStyle line_style(2.0, "navy-blue");
+  list.AddLine({0.0, 0.0}, {10.0, 10.0}, line_style);
+  list.AddLine({10.0, 0.0}, {0.0, 10.0}, line_style);
+  list.AddCircle({5.0, 5.0}, 3.0, line_style, viren2d::Color::Invalid);
+  EXPECT_EQ(3, list.NumCommands());
+  // Identical styles must be stored only once:
+  EXPECT_EQ(1, list.NumStyles());
+
+  list.AddRect(
+        viren2d::Rect(5.0, 5.0, 4.0, 2.0), line_style, "crimson!40");
+  EXPECT_EQ(4, list.NumCommands());
+  EXPECT_EQ(2, list.NumStyles());
+
+  const auto &cmd = list.Commands()[2];
+  EXPECT_EQ(viren2d::DrawCommandType::Circle, cmd.type);
+  EXPECT_EQ(line_style, list.GetLineStyle(cmd.style));
+  EXPECT_FALSE(list.GetColor(cmd.fill).IsValid());
+  EXPECT_DOUBLE_EQ(3.0, list.Parameters(cmd)[2]);
+
+  viren2d::DisplayList other;
+  other.AddLine({1.0, 1.0}, {2.0, 2.0}, viren2d::LineStyle(5.0, "black"));
+  list.Append(other);
+  EXPECT_EQ(5, list.NumCommands());
+  EXPECT_EQ(3, list.NumStyles());
+  EXPECT_EQ(
+        viren2d::LineStyle(5.0, "black"),
+        list.GetLineStyle(list.Commands()[4].style));
+
+  list.Clear();
+  EXPECT_TRUE(list.Empty());
+  EXPECT_EQ(0, list.NumStyles());
+}
+
+
+TEST(DisplayListTest, Optimization) {
+  viren2d::DisplayList list;
+  viren2d::LineStyle opaque(2.0, "black");
+  viren2d::LineStyle translucent(2.0, "black!50");
+
+  // Invisible commands should be dropped:
+  list.AddLine({0.0, 0.0}, {10.0, 10.0}, viren2d::LineStyle::Invalid);
+  list.AddCircle({5.0, 5.0}, 0.0, opaque, viren2d::Color::Invalid);
+  list.AddText({}, {5.0, 5.0}, viren2d::Anchor::Center,
+               viren2d::TextStyle(), {0.0, 0.0}, 0.0);
+  EXPECT_EQ(3, list.NumCommands());
+  EXPECT_TRUE(list.Optimized().Empty());
+
+  // Unless a transparent marker has a visible background:
+  viren2d::MarkerStyle transparent_marker;
+  transparent_marker.color = "black!0";
+  list.AddMarker({5.0, 5.0}, transparent_marker);
+  EXPECT_TRUE(list.Optimized().Empty());
+  transparent_marker.background_color = "white";
+  list.AddMarker({5.0, 5.0}, transparent_marker);
+  EXPECT_EQ(1, list.Optimized().NumCommands());
+
+  // Consecutive opaque lines should be merged:
+  list.Clear();
+  list.AddLine({0.0, 0.0}, {10.0, 10.0}, opaque);
+  list.AddLine({10.0, 0.0}, {0.0, 10.0}, opaque);
+  list.AddLine({5.0, 0.0}, {5.0, 10.0}, opaque);
+  auto optimized = list.Optimized();
+  ASSERT_EQ(1, optimized.NumCommands());
+  EXPECT_EQ(viren2d::DrawCommandType::Lines, optimized.Commands()[0].type);
+  EXPECT_EQ(12, optimized.Commands()[0].count);
+
+  // ... but translucent lines must not be merged:
+  list.AddLine({0.0, 5.0}, {10.0, 5.0}, translucent);
+  list.AddLine({0.0, 6.0}, {10.0, 6.0}, translucent);
+  optimized = list.Optimized();
+  EXPECT_EQ(3, optimized.NumCommands());
+
+  // Markers of the same style should be merged, too:
+  list.Clear();
+  viren2d::MarkerStyle marker_style;
+  list.AddMarker({1.0, 1.0}, marker_style);
+  list.AddMarkers({{{2.0, 2.0}, "crimson"}, {{3.0, 3.0}, "navy-blue"}},
+                  marker_style);
+  list.AddMarker({4.0, 4.0}, marker_style);
+  optimized = list.Optimized();
+  ASSERT_EQ(1, optimized.NumCommands());
+  const auto &cmd = optimized.Commands()[0];
+  EXPECT_EQ(viren2d::DrawCommandType::Markers, cmd.type);
+  EXPECT_EQ(24, cmd.count);
+  const double *params = optimized.Parameters(cmd);
+  EXPECT_DOUBLE_EQ(1.0, params[0]);
+  EXPECT_DOUBLE_EQ(4.0, params[18]);
+
+  // Different styles break a batch, unless we sort by state:
+  list.AddLine({0.0, 0.0}, {10.0, 10.0}, opaque);
+  list.AddMarker({5.0, 5.0}, marker_style);
+  EXPECT_EQ(3, list.Optimized().NumCommands());
+  EXPECT_EQ(2, list.Optimized(true).NumCommands());
+}
@@ -1,4 +1,6 @@
 #include <exception>
+#include <cstdint>
+#include <cstring>
 
 #include <gtest/gtest.h>
 #include <werkzeugkiste/geometry/utils.h>
@@ -696,3 +698,240 @@ TEST(ImageBufferTest, ROIInt16) {
   EXPECT_TRUE(CheckChannelConstant(roi, 1, 42));
   EXPECT_TRUE(CheckChannelConstant(roi, 2, 0));
 }
+
+
+TEST(ImageBufferTest, PaddedRows) {
+  // Allocated memory is always aligned
+  viren2d::ImageBuffer tight(5, 7, 3, viren2d::ImageBufferType::UInt8);
+  tight.SetToScalar<uint8_t>(0);
+  EXPECT_TRUE(tight.IsContiguous());
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(tight.ImmutableData())
+               % viren2d::kImageBufferAlignment);
+
+  viren2d::ImageBuffer buf(5, 7, 3, viren2d::ImageBufferType::UInt8, true);
+  EXPECT_TRUE(buf.OwnsData());
+  EXPECT_FALSE(buf.IsContiguous());
+  EXPECT_EQ(64, buf.RowStride());
+  EXPECT_EQ(3, buf.PixelStride());
+  for (int row = 0; row < buf.Height(); ++row) {
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(buf.ImmutablePtr<uint8_t>(row, 0))
+                 % viren2d::kImageBufferAlignment);
+    // Garbage in the padding must not leak into any result
+    std::memset(buf.MutablePtr<uint8_t>(row, buf.Width()), 77,
+                buf.RowStride() - buf.Width() * buf.PixelStride());
+    for (int col = 0; col < buf.Width(); ++col) {
+      buf.AtUnchecked<uint8_t>(row, col, 0) = static_cast<uint8_t>(row);
+      buf.AtUnchecked<uint8_t>(row, col, 1) = static_cast<uint8_t>(col);
+      buf.AtUnchecked<uint8_t>(row, col, 2) = 200;
+    }
+  }
+
+  // Row sizes which are already aligned don't need padding
+  viren2d::ImageBuffer aligned(3, 16, 4, viren2d::ImageBufferType::UInt8, true);
+  EXPECT_TRUE(aligned.IsContiguous());
+
+  // Conversions must add the alpha channel to every row
+  viren2d::ImageBuffer rgba = buf.ToChannels(4);
+  EXPECT_TRUE(CheckChannelConstant(rgba, 2, 200));
+  EXPECT_TRUE(CheckChannelConstant(rgba, 3, 255));
+  viren2d::ImageBuffer rgba_roi = buf.ROI(2, 1, 4, 3).ToChannels(4);
+  EXPECT_TRUE(CheckChannelConstant(rgba_roi, 3, 255));
+  EXPECT_EQ(3, rgba_roi.AtChecked<uint8_t>(2, 0, 0));
+  EXPECT_EQ(5, rgba_roi.AtChecked<uint8_t>(2, 3, 1));
+
+  viren2d::ImageBuffer channel = buf.Channel(1);
+  viren2d::ImageBuffer dimmed = buf.Dim(0.5);
+  viren2d::ImageBuffer converted = buf.AsType(viren2d::ImageBufferType::Int16, 2.0);
+  viren2d::ImageBuffer blended = buf.Blend(tight.ToChannels(4), 0.0);
+  viren2d::ImageBuffer rgb = buf.ToChannels(4).ToChannels(3);
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      EXPECT_EQ(col, channel.AtChecked<uint8_t>(row, col, 0));
+      EXPECT_EQ(row / 2, dimmed.AtChecked<uint8_t>(row, col, 0));
+      EXPECT_EQ(100, dimmed.AtChecked<uint8_t>(row, col, 2));
+      EXPECT_EQ(2 * col, converted.AtChecked<int16_t>(row, col, 1));
+      EXPECT_EQ(row, blended.AtChecked<uint8_t>(row, col, 0));
+      EXPECT_EQ(col, rgb.AtChecked<uint8_t>(row, col, 1));
+    }
+  }
+
+  // Copy-on-write keeps the padded layout, deep copies are contiguous
+  viren2d::ImageBuffer copy(buf);
+  copy.AtChecked<uint8_t>(0, 0, 0) = 9;
+  EXPECT_NE(buf.ImmutableData(), copy.ImmutableData());
+  EXPECT_EQ(64, copy.RowStride());
+  EXPECT_EQ(4, copy.AtChecked<uint8_t>(4, 6, 0));
+  viren2d::ImageBuffer deep = buf.DeepCopy();
+  EXPECT_TRUE(deep.IsContiguous());
+  EXPECT_EQ(6, deep.AtChecked<uint8_t>(4, 6, 1));
+}
+
+TEST(ImageBufferTest, CopyOnWrite) {
+  viren2d::ImageBuffer buf(3, 4, 2, viren2d::ImageBufferType::UInt8);
+  buf.SetToPixel<uint8_t>(10, 20);
+  EXPECT_EQ(1, buf.UseCount());
+
+  // Copies share the memory until either one is modified
+  viren2d::ImageBuffer copy(buf);
+  EXPECT_TRUE(copy.OwnsData());
+  EXPECT_EQ(2, buf.UseCount());
+  EXPECT_EQ(buf.ImmutableData(), copy.ImmutableData());
+
+  copy.AtChecked<uint8_t>(1, 2, 0) = 99;
+  EXPECT_NE(buf.ImmutableData(), copy.ImmutableData());
+  EXPECT_EQ(1, buf.UseCount());
+  EXPECT_EQ(1, copy.UseCount());
+  EXPECT_EQ(10, buf.AtChecked<uint8_t>(1, 2, 0));
+  EXPECT_EQ(99, copy.AtChecked<uint8_t>(1, 2, 0));
+  EXPECT_TRUE(CheckChannelConstant(copy, 1, static_cast<uint8_t>(20)));
+
+  // The last owner may modify the memory in-place
+  const unsigned char *ptr = copy.ImmutableData();
+  copy.SwapChannels(0, 1);
+  EXPECT_EQ(ptr, copy.ImmutableData());
+
+  // In-place operations must not affect other owners
+  viren2d::ImageBuffer assigned;
+  assigned = buf;
+  EXPECT_EQ(2, buf.UseCount());
+  assigned.SwapChannels(0, 1);
+  EXPECT_TRUE(CheckChannelConstant(buf, 0, static_cast<uint8_t>(10)));
+  EXPECT_TRUE(CheckChannelConstant(assigned, 0, static_cast<uint8_t>(20)));
+
+  // Moving transfers the reference
+  viren2d::ImageBuffer moved(std::move(assigned));
+  EXPECT_FALSE(assigned.IsValid());
+  EXPECT_EQ(1, moved.UseCount());
+
+  // A mutable ROI view requires exclusive memory, too
+  viren2d::ImageBuffer other(buf);
+  viren2d::ImageBuffer roi = buf.ROI(1, 1, 2, 2);
+  EXPECT_FALSE(roi.OwnsData());
+  EXPECT_EQ(0, roi.UseCount());
+  roi.SetToScalar<uint8_t>(0);
+  EXPECT_EQ(0, buf.AtChecked<uint8_t>(1, 1, 0));
+  EXPECT_TRUE(CheckChannelConstant(other, 0, static_cast<uint8_t>(10)));
+
+  // Copies of shared views remain views onto the same memory
+  viren2d::ImageBuffer roi_copy(roi);
+  EXPECT_FALSE(roi_copy.OwnsData());
+  EXPECT_EQ(roi.ImmutableData(), roi_copy.ImmutableData());
+
+  // Deep copies never share the memory
+  viren2d::ImageBuffer deep = buf.DeepCopy();
+  EXPECT_EQ(1, buf.UseCount());
+  EXPECT_NE(buf.ImmutableData(), deep.ImmutableData());
+}
+
+
+TEST(ImageBufferTest, PinnedData) {
+  viren2d::ImageBuffer buf(3, 4, 4, viren2d::ImageBufferType::UInt8);
+  buf.SetToScalar<uint8_t>(10);
+  viren2d::ImageBuffer before(buf);
+  EXPECT_EQ(2, buf.UseCount());
+
+  // Pinning switches to exclusive memory, such that previous copies keep
+  // their content
+  auto pin = buf.PinData();
+  ASSERT_TRUE(pin != nullptr);
+  EXPECT_TRUE(buf.IsPinned());
+  EXPECT_FALSE(before.IsPinned());
+  EXPECT_NE(buf.ImmutableData(), before.ImmutableData());
+  EXPECT_EQ(pin, buf.PinData());
+
+  // The writer's handle doesn't count as another owner, thus mutable
+  // access must not detach the buffer from the writer's memory
+  unsigned char *ptr = buf.MutableData();
+  EXPECT_EQ(1, buf.UseCount());
+  buf.AtChecked<uint8_t>(1, 1, 0) = 20;
+  EXPECT_EQ(ptr, buf.MutableData());
+
+  // Copies are snapshots, which don't change along with the writer
+  viren2d::ImageBuffer snapshot(buf);
+  viren2d::ImageBuffer assigned;
+  assigned = buf;
+  EXPECT_NE(ptr, snapshot.ImmutableData());
+  EXPECT_NE(ptr, assigned.ImmutableData());
+  EXPECT_FALSE(snapshot.IsPinned());
+  EXPECT_EQ(1, buf.UseCount());
+  ptr[0] = 42;
+  EXPECT_EQ(42, buf.AtChecked<uint8_t>(0, 0, 0));
+  EXPECT_EQ(10, snapshot.AtChecked<uint8_t>(0, 0, 0));
+  EXPECT_EQ(20, snapshot.AtChecked<uint8_t>(1, 1, 0));
+  EXPECT_EQ(10, assigned.AtChecked<uint8_t>(0, 0, 0));
+
+  // Moving keeps the pin
+  viren2d::ImageBuffer moved(std::move(buf));
+  EXPECT_TRUE(moved.IsPinned());
+  EXPECT_EQ(ptr, moved.MutableData());
+
+  // The handle keeps the memory alive
+  moved = viren2d::ImageBuffer();
+  EXPECT_FALSE(moved.IsPinned());
+  ptr[1] = 7;
+
+  // Once released, copies share the memory again
+  viren2d::ImageBuffer other(2, 2, 4, viren2d::ImageBufferType::UInt8);
+  auto other_pin = other.PinData();
+  other_pin.reset();
+  EXPECT_FALSE(other.IsPinned());
+  viren2d::ImageBuffer shared(other);
+  EXPECT_EQ(other.ImmutableData(), shared.ImmutableData());
+
+  // Shared buffers cannot be pinned
+  viren2d::ImageBuffer roi = other.ROI(0, 0, 1, 1);
+  EXPECT_TRUE(roi.PinData() == nullptr);
+  EXPECT_FALSE(roi.IsPinned());
+}
+
+
+TEST(ImageBufferTest, ROIAndCopies) {
+  viren2d::ImageBuffer buf(4, 5, 1, viren2d::ImageBufferType::UInt8);
+  buf.SetToScalar<uint8_t>(10);
+
+  // Copies taken while a view exists must not change along with the view
+  viren2d::ImageBuffer roi = buf.ROI(1, 1, 2, 2);
+  EXPECT_TRUE(buf.IsPinned());
+  viren2d::ImageBuffer copy(buf);
+  viren2d::ImageBuffer assigned;
+  assigned = buf;
+  EXPECT_NE(buf.ImmutableData(), copy.ImmutableData());
+  roi.SetToScalar<uint8_t>(20);
+  EXPECT_EQ(20, buf.AtChecked<uint8_t>(1, 1));
+  EXPECT_EQ(20, buf.AtChecked<uint8_t>(2, 2));
+  EXPECT_EQ(10, copy.AtChecked<uint8_t>(1, 1));
+  EXPECT_EQ(10, assigned.AtChecked<uint8_t>(2, 2));
+
+  // Modifying the copy must not detach the source from its view
+  copy.AtChecked<uint8_t>(0, 0) = 30;
+  roi.AtChecked<uint8_t>(0, 0) = 40;
+  EXPECT_EQ(40, buf.AtChecked<uint8_t>(1, 1));
+  EXPECT_EQ(10, buf.AtChecked<uint8_t>(0, 0));
+
+  // Nested views and copies of views keep the memory pinned, too
+  viren2d::ImageBuffer nested = roi.ROI(1, 1, 1, 1);
+  viren2d::ImageBuffer roi_copy(roi);
+  roi = viren2d::ImageBuffer();
+  EXPECT_TRUE(buf.IsPinned());
+  viren2d::ImageBuffer later(buf);
+  nested.AtChecked<uint8_t>(0, 0) = 50;
+  EXPECT_EQ(50, buf.AtChecked<uint8_t>(2, 2));
+  EXPECT_EQ(20, later.AtChecked<uint8_t>(2, 2));
+
+  // The views keep the memory alive
+  const unsigned char *ptr = buf.ImmutableData();
+  buf = viren2d::ImageBuffer();
+  roi_copy.AtChecked<uint8_t>(0, 1) = 60;
+  EXPECT_EQ(60, ptr[1 * 5 + 2]);
+
+  // Once all views are gone, copies share the memory again
+  viren2d::ImageBuffer other(2, 2, 1, viren2d::ImageBufferType::UInt8);
+  {
+    viren2d::ImageBuffer tmp = other.ROI(0, 0, 1, 1);
+    EXPECT_TRUE(other.IsPinned());
+  }
+  EXPECT_FALSE(other.IsPinned());
+  viren2d::ImageBuffer shared(other);
+  EXPECT_EQ(other.ImmutableData(), shared.ImmutableData());
+  EXPECT_EQ(2, other.UseCount());
+}
@@ -318,6 +318,123 @@ def test_pixelation():
     assert np.all(img_np[:, :2, 1] == 42)
     assert np.all(img_np[3:, 2:, 1] == 33)
 
+
+def test_buffer_pool():
+    capacity = viren2d.image_buffer_pool_capacity()
+    assert capacity > 0
+
+    viren2d.release_image_buffer_pool()
+    viren2d.image_buffer_pool_statistics(reset=True)
+    img_np = np.zeros((48, 64), dtype=np.uint8)
+    for _ in range(5):
+        buf = viren2d.ImageBuffer(img_np, copy=True)
+        rgb = buf.to_channels(3)
+        assert rgb.shape == (48, 64, 3)
+        del buf, rgb
+    stats = viren2d.image_buffer_pool_statistics()
+    assert stats.capacity == capacity
+    assert stats.hits + stats.misses == 10
+    assert stats.hits >= 8
+    assert stats.bytes_retained >= 48 * 64 * 4
+    assert stats.blocks_retained == 2
+    assert 'ImageBufferPoolStatistics' in repr(stats)
+
+    viren2d.release_image_buffer_pool()
+    stats = viren2d.image_buffer_pool_statistics(reset=True)
+    assert stats.bytes_retained == 0
+    assert stats.blocks_retained == 0
+    stats = viren2d.image_buffer_pool_statistics()
+    assert stats.hits == 0
+    assert stats.misses == 0
+
+    # Without capacity, memory is always returned to the system
+    viren2d.set_image_buffer_pool_capacity(0)
+    assert viren2d.image_buffer_pool_capacity() == 0
+    buf = viren2d.ImageBuffer(img_np, copy=True)
+    del buf
+    assert viren2d.image_buffer_pool_statistics().bytes_retained == 0
+    viren2d.set_image_buffer_pool_capacity(capacity)
+
+
+def test_parallel_operations():
+    threads = viren2d.image_buffer_threads()
+    threshold = viren2d.image_buffer_parallel_threshold()
+    assert threads >= 0
+    assert threshold > 0
+
+    viren2d.set_image_buffer_threads(3)
+    assert viren2d.image_buffer_threads() == 3
+    viren2d.set_image_buffer_parallel_threshold(0)
+    assert viren2d.image_buffer_parallel_threshold() == 0
+
+    rng = np.random.default_rng(42)
+    img_np = rng.integers(0, 256, size=(121, 87, 3), dtype=np.uint8)
+    weights_np = rng.random((121, 87), dtype=np.float32)
+    flow_np = rng.standard_normal((121, 87, 2)).astype(np.float32)
+    # Both contiguous inputs and (non-contiguous) views
+    for img in [img_np, img_np[3:-2, 5:-1, :]]:
+        buf = viren2d.ImageBuffer(img, copy=False)
+        other = viren2d.ImageBuffer(img[::-1, :, :].copy())
+        weights = viren2d.ImageBuffer(
+            weights_np[:img.shape[0], :img.shape[1]].copy())
+        flow = viren2d.ImageBuffer(
+            flow_np[:img.shape[0], :img.shape[1], :].copy())
+
+        def _process():
+            return [
+                buf.to_channels(4), buf.to_float32(), buf.dim(0.3),
+                viren2d.convert_rgb2gray(buf, 3),
+                viren2d.convert_rgb2hsv(buf),
+                buf.blend_constant(other, 0.4),
+                buf.blend_mask(other, weights),
+                flow.magnitude(), flow.orientation(),
+                buf.channel(1).min_max()]
+
+        with viren2d.ImageBufferThreadsScope(1) as scope:
+            assert scope.num_threads == 1
+            assert 'ImageBufferThreadsScope' in repr(scope)
+            expected = _process()
+        result = _process()
+        for exp, res in zip(expected[:-1], result[:-1]):
+            np.testing.assert_array_equal(np.array(exp), np.array(res))
+        assert expected[-1] == result[-1]
+
+    viren2d.set_image_buffer_threads(threads)
+    viren2d.set_image_buffer_parallel_threshold(threshold)
+
+
+def test_channel_conversions():
+    # Packed uint8/float32 buffers are converted via SIMD kernels, which
+    # must yield the same results as numpy (and the strided views, which
+    # use the generic pixel loops).
+    rng = np.random.default_rng(7)
+    for dtype in [np.uint8, np.float32]:
+        for channels in [1, 3, 4]:
+            data = rng.integers(
+                0, 256, size=(9, 2 * 67, channels)).astype(dtype)
+            for img in [np.ascontiguousarray(data[:, ::2]), data[:, ::2]]:
+                buf = viren2d.ImageBuffer(img, copy=False)
+                rgb = np.dstack([img[:, :, 0]] * 3) if channels == 1 \
+                    else img[:, :, :3]
+                alpha = np.full(img.shape[:2] + (1,), 255, dtype=dtype)
+                np.testing.assert_array_equal(np.array(buf.to_channels(3)), rgb)
+                np.testing.assert_array_equal(
+                    np.array(buf.to_channels(4)),
+                    img if channels == 4 else np.dstack([rgb, alpha]))
+
+                for ch in range(channels):
+                    np.testing.assert_array_equal(
+                        np.array(buf.channel(ch)).reshape(img.shape[:2]),
+                        img[:, :, ch])
+
+                if channels > 1:
+                    swapped = viren2d.ImageBuffer(img.copy())
+                    swapped.swap_channels(0, channels - 1)
+                    expected = img.copy()
+                    expected[:, :, [0, channels - 1]] = \
+                        img[:, :, [channels - 1, 0]]
+                    np.testing.assert_array_equal(np.array(swapped), expected)
+
 #FIXME test color conversions:
 # convert_gray2rgb
 # convert_rgb2gray
@@ -63,6 +63,252 @@ def test_painter_basics():
     assert p.height == 800
 
 
+def test_canvas_sharing():
+    p = viren2d.Painter()
+    # By default, the image is copied:
+    frame = np.zeros((60, 80, 4), dtype=np.uint8)
+    assert not p.set_canvas_image(frame)
+    assert p.draw_rect(viren2d.Rect((40, 30), (20, 20)), fill_color='white')
+    assert np.all(frame == 0)
+
+    # Compatible RGBA frames can be shared
+    assert p.set_canvas_image(frame, copy=False)
+    assert p.width == 80
+    assert p.height == 60
+    assert p.draw_rect(viren2d.Rect((40, 30), (20, 20)), fill_color='white')
+    assert not np.all(frame == 0)
+    assert np.array_equal(frame, np.array(p.canvas, copy=False))
+
+    # The painter must keep the shared memory alive
+    frame = np.zeros((30, 20, 4), dtype=np.uint8)
+    assert p.set_canvas_image(frame, copy=False)
+    del frame
+    assert p.draw_line((0, 0), (20, 30))
+    assert p.canvas.width == 20
+
+    # Same for ImageBuffer
+    buf = viren2d.ImageBuffer(np.zeros((30, 20, 4), dtype=np.uint8), copy=True)
+    assert p.set_canvas_image(buf, copy=False)
+    assert p.draw_rect(viren2d.Rect((10, 15), (10, 10)), fill_color='black')
+    assert np.array_equal(np.array(buf, copy=False), np.array(p.canvas, copy=False))
+
+    # Incompatible layouts will be copied
+    frame = np.zeros((60, 80, 3), dtype=np.uint8)
+    assert not p.set_canvas_image(frame, copy=False)
+    frame = np.zeros((60, 80, 4), dtype=np.uint8)
+    assert not p.set_canvas_image(frame[:, 10:50, :], copy=False)
+    assert p.width == 40
+    frame.flags.writeable = False
+    assert not p.set_canvas_image(frame, copy=False)
+
+
+def test_canvas_reuse():
+    p = viren2d.Painter(height=60, width=80, color='black')
+    assert p.set_clip_rect(viren2d.Rect((10, 10), (20, 20)))
+    assert p.draw_rect(viren2d.Rect((40, 30), (20, 20)), fill_color='white')
+
+    # Setting up a canvas of the same size must not keep the previous
+    # content or the clip region
+    p.set_canvas_rgb(height=60, width=80, color=(0.5, 0.5, 0.5, 0.5))
+    canvas = np.array(p.canvas, copy=True)
+    assert np.all(canvas[:, :, 3] == canvas[0, 0, 3])
+    p.set_canvas_rgb(height=60, width=80, color='white')
+    assert p.draw_rect(viren2d.Rect((40, 30), (80, 60)), fill_color='black')
+    assert np.all(np.array(p.canvas, copy=False)[:, :, :3] == 0)
+
+    # Same for image inputs
+    frame = np.full((60, 80, 3), 23, dtype=np.uint8)
+    p.set_canvas_image(frame)
+    canvas = np.array(p.canvas, copy=False)
+    assert np.all(canvas[:, :, :3] == 23)
+    assert np.all(canvas[:, :, 3] == 255)
+
+    # Re-initializing the canvas from a view onto itself
+    p.set_canvas_image(p.canvas)
+    assert np.all(np.array(p.canvas, copy=False)[:, :, :3] == 23)
+    assert not p.set_canvas_image(p.canvas, copy=False)
+    assert np.all(np.array(p.canvas, copy=False)[:, :, :3] == 23)
+
+    # Size changes
+    p.set_canvas_rgb(height=20, width=10)
+    assert p.width == 10
+    assert p.height == 20
+
+
+def test_canvas_import():
+    p = viren2d.Painter()
+    # Odd widths exercise the scalar code path for the remaining pixels
+    for width in [1, 17, 83]:
+        rgb = np.random.randint(0, 256, (5, width, 3), dtype=np.uint8)
+        p.set_canvas_image(rgb)
+        canvas = np.array(p.canvas, copy=False)
+        assert np.array_equal(canvas[:, :, :3], rgb)
+        assert np.all(canvas[:, :, 3] == 255)
+
+        # BGR input
+        p.set_canvas_image(rgb[:, :, ::-1].copy(), is_bgr=True)
+        assert np.array_equal(np.array(p.canvas, copy=False)[:, :, :3], rgb)
+        # BGR input must always be copied
+        bgra = np.dstack((rgb[:, :, ::-1], np.full((5, width), 255, dtype=np.uint8)))
+        assert not p.set_canvas_image(bgra, copy=False, is_bgr=True)
+        assert np.array_equal(np.array(p.canvas, copy=False)[:, :, :3], rgb)
+
+        # Non-contiguous input
+        p.set_canvas_image(bgra[:, :, :3], is_bgr=True)
+        assert np.array_equal(np.array(p.canvas, copy=False)[:, :, :3], rgb)
+
+        # Grayscale
+        gray = rgb[:, :, 0].copy()
+        p.set_canvas_image(gray)
+        canvas = np.array(p.canvas, copy=False)
+        for ch in range(3):
+            assert np.array_equal(canvas[:, :, ch], gray)
+        assert np.all(canvas[:, :, 3] == 255)
+
+    # Translucent pixels must be premultiplied
+    rgba = np.zeros((3, 20, 4), dtype=np.uint8)
+    rgba[:, :, 0] = 200
+    rgba[:, :, 1] = 100
+    rgba[:, :, 2] = 255
+    rgba[:, :, 3] = 128
+    rgba[:, 0, 3] = 255
+    rgba[:, 1, 3] = 0
+    p.set_canvas_image(rgba)
+    canvas = np.array(p.canvas, copy=False)
+    assert np.array_equal(canvas[:, 2:, 0], np.full((3, 18), 100))
+    assert np.array_equal(canvas[:, 2:, 1], np.full((3, 18), 50))
+    assert np.array_equal(canvas[:, 2:, 2], np.full((3, 18), 128))
+    assert np.array_equal(canvas[:, 0, :], rgba[:, 0, :])
+    assert np.all(canvas[:, 1, :] == 0)
+
+
+def test_canvas_export():
+    p = viren2d.Painter()
+    rgb = np.random.randint(0, 256, (7, 45, 3), dtype=np.uint8)
+    p.set_canvas_image(rgb)
+
+    # Default behavior is unchanged
+    assert p.get_canvas().channels == 4
+
+    # Newly allocated buffers
+    assert np.array_equal(np.array(p.get_canvas(layout='rgb')), rgb)
+    assert np.array_equal(np.array(p.get_canvas(layout='bgr')), rgb[:, :, ::-1])
+    bgra = np.array(p.get_canvas(layout=viren2d.CanvasLayout.BGRA))
+    assert np.array_equal(bgra[:, :, :3], rgb[:, :, ::-1])
+    assert np.all(bgra[:, :, 3] == 255)
+    gray = np.array(p.get_canvas(layout='gray'))
+    assert gray.ndim == 2 or gray.shape[2] == 1
+    expected = np.array(viren2d.ImageBuffer(rgb).to_channels(1)).reshape(gray.shape)
+    assert np.max(np.abs(gray.astype(np.int32) - expected.astype(np.int32))) <= 1
+
+    # Preallocated output
+    out = np.zeros((7, 45, 3), dtype=np.uint8)
+    res = p.get_canvas(out=out)
+    assert res is out
+    assert np.array_equal(out, rgb)
+    p.get_canvas(out=out, layout='bgr')
+    assert np.array_equal(out, rgb[:, :, ::-1])
+
+    # Non-contiguous output
+    out = np.zeros((7, 45, 4), dtype=np.uint8)
+    p.get_canvas(out=out[:, :, :3], layout='rgb')
+    assert np.array_equal(out[:, :, :3], rgb)
+    assert np.all(out[:, :, 3] == 0)
+
+    # Invalid outputs
+    with pytest.raises(ValueError):
+        p.get_canvas(out=np.zeros((7, 44, 3), dtype=np.uint8))
+    with pytest.raises(ValueError):
+        p.get_canvas(out=np.zeros((7, 45, 3), dtype=np.float32))
+    with pytest.raises(ValueError):
+        p.get_canvas(out=np.zeros((7, 45, 3), dtype=np.uint8), layout='rgba')
+    with pytest.raises(ValueError):
+        p.get_canvas(out=p.canvas, layout='rgba')
+
+    # Exported RGBA uses straight alpha
+    rgba = np.zeros((3, 20, 4), dtype=np.uint8)
+    rgba[:, :, 0] = 200
+    rgba[:, :, 3] = 128
+    p.set_canvas_image(rgba)
+    exported = np.array(p.get_canvas(layout='rgba'))
+    assert np.all(np.abs(exported[:, :, 0].astype(np.int32) - 200) <= 1)
+    assert np.all(exported[:, :, 3] == 128)
+
+
+def test_display_list():
+    def draw(painter):
+        style = viren2d.LineStyle(width=3, color='navy-blue')
+        painter.draw_line((10, 10), (90, 60), style)
+        painter.draw_line((90, 10), (10, 60), style)
+        painter.draw_circle((50, 40), 20, style, fill_color='crimson!40')
+        painter.draw_rect(
+            viren2d.Rect((50, 40), (30, 20)), style, fill_color='same!20')
+        painter.draw_marker((30, 30), viren2d.MarkerStyle(marker='*'))
+        painter.draw_markers(
+            [((20, 20), 'black'), ((40, 20), 'invalid')],
+            viren2d.MarkerStyle(marker='o'))
+        painter.draw_trajectory(
+            [(5, 5), (30, 15), (50, 50)], style, fade_out_color='white')
+        painter.draw_text(['Text'], (50, 70))
+
+    expected = viren2d.Painter(height=100, width=120, color='white')
+    draw(expected)
+    expected = np.array(expected.canvas, copy=True)
+
+    # Recording must not modify the canvas
+    p = viren2d.Painter(height=100, width=120, color='white')
+    overlay = viren2d.DisplayList()
+    assert not p.is_recording
+    p.begin_recording(overlay)
+    assert p.is_recording
+    draw(p)
+    # Not supported while recording:
+    assert not p.set_clip_circle((50, 50), 10)
+    p.end_recording()
+    assert not p.is_recording
+    assert len(overlay) == 8
+    assert overlay.num_commands == 8
+    assert np.all(np.array(p.canvas, copy=False) == 255)
+
+    # Replay must be pixel-identical to drawing directly
+    assert p.draw_display_list(overlay)
+    assert np.array_equal(expected, np.array(p.canvas, copy=True))
+
+    # The optimized list merges the two lines into a single stroke. Thus,
+    # only the anti-aliasing at their intersection may differ slightly.
+    optimized = overlay.optimized()
+    assert len(optimized) == len(overlay) - 1
+    p.set_canvas_rgb(height=100, width=120, color='white')
+    assert p.draw_display_list(optimized)
+    diff = np.abs(
+        expected.astype(np.int16) - np.array(p.canvas).astype(np.int16))
+    assert np.mean(diff) < 0.5
+
+    # A list can be replayed onto another canvas
+    other = viren2d.Painter(height=50, width=60, color='black')
+    assert other.draw_display_list(overlay)
+
+    overlay.clear()
+    assert len(overlay) == 0
+
+    # Transparent markers with a visible background must be kept
+    for marker in ['o', 's']:
+        markers = viren2d.DisplayList()
+        p.begin_recording(markers)
+        p.draw_marker((60, 50), viren2d.MarkerStyle(
+            marker=marker, size=15, color='black!0', bg_color='crimson'))
+        p.end_recording()
+        optimized = markers.optimized()
+        assert len(optimized) == len(markers) == 1
+        p.set_canvas_rgb(height=100, width=120, color='white')
+        assert p.draw_display_list(markers)
+        expected = np.array(p.canvas, copy=True)
+        assert not np.all(expected == 255)
+        p.set_canvas_rgb(height=100, width=120, color='white')
+        assert p.draw_display_list(optimized)
+        assert np.array_equal(expected, np.array(p.canvas, copy=True))
+
+
 def is_valid_line(line_style):
     if line_style is None:
         return False
@@ -113,6 +359,60 @@ def line_style_configurations():
 
 
 
+def test_tiled_rendering():
+    rng = np.random.default_rng(42)
+    overlay = viren2d.DisplayList()
+    p = viren2d.Painter()
+    assert p.render_threads == 1
+    p.begin_recording(overlay)
+    style = viren2d.LineStyle(width=3, color='navy-blue!80', cap='round')
+    for _ in range(200):
+        cx, cy = rng.uniform(-20, 420), rng.uniform(-20, 320)
+        p.draw_rect(viren2d.Rect((cx, cy), (40, 25), rotation=rng.uniform(0, 90)),
+                    style, fill_color='same!20')
+        p.draw_circle((cy, cx), rng.uniform(1, 30), style)
+        p.draw_line((cx, cy), (cy, cx), style)
+        p.draw_text(['Label'], (cx, cy), anchor='center')
+    p.draw_markers(
+        [((rng.uniform(0, 400), rng.uniform(0, 300)), 'invalid')
+         for _ in range(500)], viren2d.MarkerStyle(marker='*'))
+    p.draw_grid(spacing_x=30, spacing_y=30, line_style=viren2d.LineStyle(1, 'gray!40'))
+    # Batches which are partially (or completely) off-screen
+    p.draw_markers(
+        [((rng.uniform(-200, 600), rng.uniform(-200, 500)), 'crimson')
+         for _ in range(300)], viren2d.MarkerStyle(marker='o'))
+    p.draw_markers([((x, -50), 'black') for x in range(0, 400, 20)])
+    p.draw_markers([((x, 400), 'black') for x in range(0, 400, 20)])
+    p.draw_trajectory([(-50 + 10 * i, 350 + 5 * np.sin(i)) for i in range(50)], style)
+    p.draw_polygon([(100, -30), (200, -80), (150, -20)], style)
+    p.draw_bounding_boxes_2d(
+        [viren2d.Rect.from_ltwh(rng.uniform(-300, 600), rng.uniform(-300, 500), 30, 20)
+         for _ in range(100)])
+    p.end_recording()
+
+    p.set_canvas_rgb(height=300, width=400, color='white')
+    p.reset_num_culled_primitives()
+    assert p.draw_display_list(overlay)
+    expected = np.array(p.canvas, copy=True)
+    expected_culled = p.num_culled_primitives
+    assert expected_culled > 40
+
+    # Tile-parallel rendering must be byte-identical to the serial path
+    # and report the same culled primitives
+    for threads in [2, 3, 4, 8, 16, 0]:
+        p.render_threads = threads
+        assert p.render_threads == threads
+        p.set_canvas_rgb(height=300, width=400, color='white')
+        p.reset_num_culled_primitives()
+        assert p.draw_display_list(overlay)
+        assert np.array_equal(expected, np.array(p.canvas, copy=True))
+        assert p.num_culled_primitives == expected_culled
+
+    # Negative values are clamped to 0, i.e. all hardware threads
+    p.render_threads = -3
+    assert p.render_threads == 0
+
+
 def test_draw_arc():
     # Try drawing on uninitialized canvas
     p = viren2d.Painter()
@@ -361,6 +661,162 @@ def test_draw_marker():
     assert p.draw_markers(marker_style=style, markers=markers)
 
 
+def test_draw_markers_batched():
+    # Batched markers must look the same as drawing them one by one.
+    # The markers don't overlap, so only the anti-aliasing of rotated
+    # shapes could differ slightly.
+    positions = [(20 + 30 * (i % 12), 20 + 30 * (i // 12)) for i in range(96)]
+    colors = ['crimson', 'invalid', 'navy-blue', 'teal-green!60']
+    markers = [(pos, colors[i % len(colors)]) for i, pos in enumerate(positions)]
+    for marker in viren2d.Marker.list_all():
+        for filled in [True, False]:
+            for bg_color in ['invalid', 'white', 'azure!50']:
+                style = viren2d.MarkerStyle(
+                    marker=marker, size=15, thickness=2, color='black',
+                    filled=filled, bg_border=3, bg_color=bg_color)
+
+                expected = viren2d.Painter(height=260, width=380, color='gray')
+                for pos, color in markers:
+                    s = style.copy()
+                    if color != 'invalid':
+                        s.color = color
+                    assert expected.draw_marker(pos, s)
+
+                p = viren2d.Painter(height=260, width=380, color='gray')
+                assert p.draw_markers(markers, style)
+
+                diff = np.abs(
+                    np.array(expected.canvas).astype(np.int16)
+                    - np.array(p.canvas).astype(np.int16))
+                assert np.mean(diff) < 0.1
+
+    # Invalid colors are skipped, but the remaining markers are drawn
+    style = viren2d.MarkerStyle(color='invalid')
+    p = viren2d.Painter(height=100, width=100, color='white')
+    assert not p.draw_markers([((10, 10), 'invalid'), ((50, 50), 'black')], style)
+    assert np.any(np.array(p.canvas)[:, :, :3] < 255)
+
+
+def test_draw_markers_overlapping():
+    # Overlapping markers must be drawn in input order, i.e. a later
+    # marker (or its background bubble) covers the earlier ones, no matter
+    # which colors they have.
+    rng = np.random.default_rng(23)
+    positions = rng.uniform(10, 90, size=(120, 2))
+    colors = ['crimson', 'navy-blue', 'invalid', 'teal-green!60']
+    # Include runs of the same color, which overlap each other
+    markers = [(tuple(pos), colors[(i // 3) % len(colors)])
+               for i, pos in enumerate(positions)]
+    for marker in ['o', 'x', '*', 's']:
+        for bg_color in ['invalid', 'white', 'azure!50']:
+            style = viren2d.MarkerStyle(
+                marker=marker, size=11, thickness=2, color='black',
+                filled=(marker != 'x'), bg_border=2, bg_color=bg_color)
+
+            expected = viren2d.Painter(height=100, width=100, color='gray')
+            expected.marker_cache_size = 0
+            for pos, color in markers:
+                s = style.copy()
+                if color != 'invalid':
+                    s.color = color
+                assert expected.draw_marker(pos, s)
+
+            p = viren2d.Painter(height=100, width=100, color='gray')
+            p.marker_cache_size = 0
+            assert p.draw_markers(markers, style)
+
+            diff = np.abs(
+                np.array(expected.canvas).astype(np.int16)
+                - np.array(p.canvas).astype(np.int16))
+            # Only the anti-aliasing of rotated shapes may differ slightly,
+            # a different stacking order would change whole marker regions.
+            assert np.mean(diff) < 0.1
+            assert np.count_nonzero(diff > 32) == 0
+
+
+def test_marker_sprites():
+    p = viren2d.Painter(height=200, width=300, color='white')
+    # The cache is opt-in
+    assert p.marker_cache_size == 0
+    # Markers at integer positions are not affected by the sub-pixel
+    # quantization, thus the stamped sprites look the same as the
+    # rendered paths:
+    markers = [((15 + 30 * (i % 9), 15 + 30 * (i // 9)), 'invalid')
+               for i in range(54)]
+    for marker in viren2d.Marker.list_all():
+        for bg_color in ['invalid', 'black!40']:
+            style = viren2d.MarkerStyle(
+                marker=marker, size=13, thickness=2, color='navy-blue!90',
+                bg_color=bg_color, bg_border=2)
+            p.marker_cache_size = 0
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            assert p.draw_markers(markers, style)
+            expected = np.array(p.canvas, copy=True).astype(np.int16)
+
+            p.marker_cache_size = 64
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            assert p.draw_markers(markers, style)
+            # Repeat to stamp the cached sprites
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            assert p.draw_markers(markers, style)
+            diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+            assert np.mean(diff) < 0.1
+
+            # Single markers use the same sprites
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            for pos, _ in markers:
+                assert p.draw_marker(pos, style)
+            diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+            assert np.mean(diff) < 0.1
+
+    # Overlapping sprites are stacked in input order, regardless of
+    # their colors
+    markers = [((40 + 3 * (i % 7), 40 + 2 * (i % 5)),
+                ['crimson', 'navy-blue', 'invalid'][i % 3]) for i in range(40)]
+    for bg_color in ['invalid', 'white']:
+        style = viren2d.MarkerStyle(
+            marker='o', size=13, thickness=2, color='black', filled=True,
+            bg_color=bg_color, bg_border=2)
+        p.set_canvas_rgb(height=200, width=300, color='gray')
+        for pos, color in markers:
+            s = style.copy()
+            if color != 'invalid':
+                s.color = color
+            assert p.draw_marker(pos, s)
+        expected = np.array(p.canvas, copy=True)
+        p.set_canvas_rgb(height=200, width=300, color='gray')
+        assert p.draw_markers(markers, style)
+        assert np.array_equal(expected, np.array(p.canvas))
+
+    # Sprites are rasterized at the painter's render quality, i.e. changing
+    # the quality must not reuse sprites of another quality
+    markers = [((15 + 30 * (i % 9), 15 + 30 * (i // 9)), 'invalid')
+               for i in range(54)]
+    style = viren2d.MarkerStyle(
+        marker='o', size=13, thickness=2, color='navy-blue',
+        bg_color='black!40', bg_border=2)
+    reference = viren2d.Painter(height=200, width=300, color='white')
+    assert reference.marker_cache_size == 0
+    p.marker_cache_size = 64
+    for quality in ['best', 'fast', 'balanced', 'fast']:
+        reference.render_quality = quality
+        reference.set_canvas_rgb(height=200, width=300, color='white')
+        assert reference.draw_markers(markers, style)
+        expected = np.array(reference.canvas, copy=True).astype(np.int16)
+
+        p.render_quality = quality
+        p.set_canvas_rgb(height=200, width=300, color='white')
+        assert p.draw_markers(markers, style)
+        diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+        assert np.mean(diff) < 0.1
+    p.render_quality = 'balanced'
+
+    # Sub-pixel positions and positions far off the canvas
+    assert p.draw_markers([((10.3, 20.8), 'red'), ((1e9, -1e9), 'blue')])
+    p.marker_cache_size = 0
+    assert p.marker_cache_size == 0
+
+
 def test_draw_polygon():
     # Try drawing on uninitialized canvas
     p = viren2d.Painter()
@@ -478,6 +934,156 @@ def test_draw_text():
     assert res.is_valid()
 
 
+def test_text_font_cache():
+    # Fonts are resolved once and then reused by all painters. The text
+    # must look the same as without the cache, no matter which style was
+    # used before.
+    default_size = viren2d.font_cache_size()
+    assert default_size > 0
+
+    def _render(painter, text_style):
+        painter.set_canvas_rgb(height=100, width=300, color='white')
+        res = painter.draw_text(['Font cache', 'test'], (10, 10), 'top-left',
+                                text_style)
+        assert res.is_valid()
+        return res, np.array(painter.canvas, copy=True)
+
+    styles = list()
+    # Exceed the cache size to also test flushing:
+    for size in range(6, 46):
+        for family, bold in [('monospace', False), ('sans-serif', True)]:
+            styles.append(viren2d.TextStyle(
+                family=family, size=size, bold=bold, italic=size % 2 == 0))
+
+    # The reference is rendered via Cairo's font selection
+    p1 = viren2d.Painter()
+    viren2d.set_font_cache_size(0)
+    assert viren2d.font_cache_size() == 0
+    reference = [_render(p1, style) for style in styles]
+
+    p2 = viren2d.Painter()
+    for cache_size in [default_size, 5]:
+        viren2d.set_font_cache_size(cache_size)
+        assert viren2d.font_cache_size() == cache_size
+        for style, (ref_box, ref_canvas) in zip(reversed(styles), reversed(reference)):
+            box, canvas = _render(p2, style)
+            assert box == ref_box
+            assert np.array_equal(canvas, ref_canvas)
+    viren2d.set_font_cache_size(default_size)
+
+    # Rotated text uses the same fonts
+    assert p1.draw_text(['rotated'], (150, 50), 'center', styles[10],
+                        rotation=30).is_valid()
+
+
+def test_text_cache():
+    default_size = viren2d.text_cache_size()
+    assert default_size > 0
+
+    p = viren2d.Painter(height=200, width=400, color='white')
+    labels = [f'person {i % 5}' for i in range(40)]
+
+    def _render():
+        p.set_canvas_rgb(height=200, width=400, color='white')
+        for idx, label in enumerate(labels):
+            assert p.draw_text(
+                [label], (10 + 90 * (idx % 4), 15 + 18 * (idx // 4))).is_valid()
+        return np.array(p.canvas, copy=True)
+
+    viren2d.text_cache_statistics(reset=True)
+    cached = _render()
+    stats = viren2d.text_cache_statistics()
+    assert stats.capacity == default_size
+    assert stats.size >= 5
+    assert stats.hits >= 35
+    assert stats.misses + stats.hits == len(labels)
+
+    # The cache must not change the rendering:
+    viren2d.set_text_cache_size(0)
+    assert viren2d.text_cache_size() == 0
+    assert viren2d.text_cache_statistics().size == 0
+    viren2d.text_cache_statistics(reset=True)
+    assert np.array_equal(cached, _render())
+    stats = viren2d.text_cache_statistics()
+    assert stats.hits == 0 and stats.misses == 0
+
+    # Least recently used lines are evicted
+    viren2d.set_text_cache_size(3)
+    _render()
+    assert viren2d.text_cache_statistics().size == 3
+    viren2d.set_text_cache_size(default_size)
+
+
+def test_bitmap_text():
+    p = viren2d.Painter(height=200, width=400, color='white')
+    assert not p.bitmap_text
+    text_style = viren2d.TextStyle(size=14, family='monospace', color='navy-blue')
+    labels = [f'ID {i}: {i * 0.37:.2f}' for i in range(24)]
+
+    def _render():
+        p.set_canvas_rgb(height=200, width=400, color='white')
+        boxes = list()
+        for idx, label in enumerate(labels):
+            boxes.append(p.draw_text(
+                [label], (10 + 130 * (idx % 3), 20 + 22 * (idx // 3)),
+                'left', text_style))
+        return boxes, np.array(p.canvas, copy=True).astype(np.int16)
+
+    ref_boxes, expected = _render()
+    p.bitmap_text = True
+    assert p.bitmap_text
+    boxes, canvas = _render()
+    # Layout is not affected, only the glyphs may be shifted slightly:
+    assert boxes == ref_boxes
+    assert np.mean(np.abs(expected - canvas)) < 2.0
+    assert not np.array_equal(canvas, np.full_like(canvas, 255))
+
+    # Unsupported text falls back to the default rendering
+    for args in [(['Grüße'], (200, 100)), (['rotated'], (200, 100))]:
+        p.bitmap_text = False
+        p.set_canvas_rgb(height=200, width=400, color='white')
+        rotation = 30 if args[0][0] == 'rotated' else 0
+        assert p.draw_text(*args, 'center', text_style, rotation=rotation).is_valid()
+        expected = np.array(p.canvas, copy=True)
+        p.bitmap_text = True
+        p.set_canvas_rgb(height=200, width=400, color='white')
+        assert p.draw_text(*args, 'center', text_style, rotation=rotation).is_valid()
+        assert np.array_equal(expected, p.canvas)
+
+    # Text boxes (and translucent text) are supported, too
+    text_style.color = 'crimson!50'
+    assert p.draw_text_box(['Multi-line', 'text box'], (200, 100), 'center',
+                           text_style, fill_color='white!60').is_valid()
+    p.bitmap_text = False
+
+
+def test_bitmap_text_subpixel():
+    # Glyphs must be placed on the same (sub-)pixel grid as Cairo's
+    p = viren2d.Painter(height=200, width=400, color='white')
+    text_style = viren2d.TextStyle(size=13, family='sans-serif', color='navy-blue')
+    fractions = [0.0, 0.1, 0.3, 0.45, 0.55, 0.7, 0.9]
+
+    def _render(bitmap_text):
+        p.bitmap_text = bitmap_text
+        p.set_canvas_rgb(height=200, width=400, color='white')
+        for row, fy in enumerate(fractions):
+            for col, fx in enumerate(fractions):
+                assert p.draw_text(
+                    [f'{row}.{col} Ag'], (5 + 55 * col + fx, 20 + 25 * row + fy),
+                    'left', text_style).is_valid()
+        return np.array(p.canvas, copy=True).astype(np.int16)
+
+    expected = _render(False)
+    canvas = _render(True)
+    p.bitmap_text = False
+    assert not np.array_equal(canvas, np.full_like(canvas, 255))
+    # Only the compositing of overlapping anti-aliased glyph edges may
+    # differ slightly from Cairo's:
+    diff = np.abs(expected - canvas)
+    assert np.mean(diff) < 0.1
+    assert np.count_nonzero(diff > 32) < 1e-4 * diff.size
+
+
 def test_textbox_anchors():
     p = viren2d.Painter(height=300, width=400)
     assert p.is_valid()
@@ -602,6 +1208,410 @@ def test_draw_trajectory():
         assert p.is_valid()
 
 
+def test_trajectory_fade_out_levels():
+    p = viren2d.Painter(height=300, width=400, color='white')
+    assert p.trajectory_fade_out_levels == 0
+    p.trajectory_fade_out_levels = -3
+    assert p.trajectory_fade_out_levels == 0
+
+    t = np.linspace(0, 4 * np.pi, 300)
+    pts = np.column_stack((200 + 150 * np.cos(t) * t / 13,
+                           150 + 120 * np.sin(t) * t / 13))
+    pts = [(x, y) for x, y in pts]
+    line_style = viren2d.LineStyle(width=5, color='navy-blue')
+    assert p.draw_trajectory(pts, line_style, 'white!40')
+    expected = np.array(p.canvas, copy=True).astype(np.int16)
+
+    for levels, tolerance in [(64, 0.5), (16, 1.0), (2, 5.0), (1, 10.0)]:
+        p.trajectory_fade_out_levels = levels
+        assert p.trajectory_fade_out_levels == levels
+        p.set_canvas_rgb(height=300, width=400, color='white')
+        assert p.draw_trajectory(pts, line_style, 'white!40')
+        diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+        assert np.mean(diff) < tolerance
+
+        # All other parameters behave as before
+        assert p.draw_trajectory(
+            pts, line_style, 'black', True, 3, viren2d.fade_out_linear)
+        assert p.draw_trajectory(
+            pts, line_style, 'crimson', fading_factor=lambda v: 1.0 - v)
+        assert p.draw_trajectories(
+            [(pts, 'blue'), (pts[::-1], 'same!40')], line_style, 'white')
+        assert not p.draw_trajectory(pts[:1], line_style, 'white')
+
+
+def test_render_quality():
+    p = viren2d.Painter(height=100, width=200, color='white')
+    assert p.render_quality == viren2d.RenderQuality.Balanced
+    p.render_quality = 'fast'
+    assert p.render_quality == viren2d.RenderQuality.Fast
+    with pytest.raises(RuntimeError):
+        p.render_quality = 'ultra'
+
+    def _num_gray_levels(quality, rect):
+        p.render_quality = quality
+        p.set_canvas_rgb(height=100, width=200, color='white')
+        assert p.draw_rect(rect, viren2d.LineStyle(width=2, color='black'),
+                           fill_color='black!50')
+        return len(np.unique(np.array(p.canvas)[:, :, 0]))
+
+    # Axis-aligned boxes are not anti-aliased in fast mode
+    box = viren2d.Rect.from_ltwh(20, 10, 150, 70)
+    assert _num_gray_levels('fast', box) == 3
+    assert _num_gray_levels('balanced', box) > 3
+    assert _num_gray_levels('best', box) > 3
+    # ... but rotated ones are
+    box.rotation = 20
+    assert _num_gray_levels('fast', box) > 3
+
+    # Images are scaled via nearest-neighbor interpolation in fast mode
+    checkerboard = np.zeros((4, 4, 3), dtype=np.uint8)
+    checkerboard[::2, ::2] = 255
+    checkerboard[1::2, 1::2] = 255
+    for quality, max_levels in [('fast', 2), ('balanced', 255), ('best', 255)]:
+        p.render_quality = quality
+        p.set_canvas_rgb(height=100, width=200, color='white')
+        assert p.draw_image(checkerboard, (0, 0), scale_x=10, scale_y=10)
+        num_levels = len(np.unique(np.array(p.canvas)[:40, :40, 0]))
+        assert 2 <= num_levels <= max_levels
+        if max_levels > 2:
+            assert num_levels > 2
+
+    # Curves are drawn in all modes, and the setting survives reusing
+    # or replacing the canvas
+    for quality in viren2d.RenderQuality.__members__.values():
+        p.render_quality = quality
+        p.set_canvas_rgb(height=100, width=200, color='white')
+        assert p.draw_circle((100, 50), 40, viren2d.LineStyle(width=3))
+        p.set_canvas_rgb(height=60, width=80, color='white')
+        assert p.render_quality == quality
+        assert p.draw_ellipse(viren2d.Ellipse((40, 30), (60, 20)))
+
+
+def test_native_rasterizer():
+    # Pixel-aligned primitives are drawn without Cairo, but must look
+    # exactly the same.
+    p = viren2d.Painter(height=120, width=200, color='white')
+    styles = [(viren2d.LineStyle(width=1, color='black'), None),
+              (viren2d.LineStyle(width=3, color='crimson!60'), None),
+              (viren2d.LineStyle(width=3, color='navy-blue'), 'teal-green!50'),
+              (viren2d.LineStyle(width=5, color='forest-green!30'), 'same!30'),
+              (viren2d.LineStyle.Invalid, 'black!40')]
+    for line_style, fill in styles:
+        for l, t, w, h in [(20, 10, 150, 70), (-30, 60, 80, 100), (100, 50, 2, 2)]:
+            p.set_canvas_rgb(height=120, width=200, color='white')
+            p.draw_rect(viren2d.Rect.from_ltwh(l, t, w, h), line_style, fill)
+            native = np.array(p.canvas, copy=True)
+            p.set_canvas_rgb(height=120, width=200, color='white')
+            # Polygons are not closed, thus we retrace the first edge to
+            # get the same miter join at the first corner:
+            p.draw_polygon(
+                [(l, t), (l + w, t), (l + w, t + h), (l, t + h), (l, t), (l + w, t)],
+                line_style, fill)
+            assert np.array_equal(native, np.array(p.canvas))
+
+    # Lines with square caps
+    p.set_canvas_rgb(height=120, width=200, color='white')
+    assert p.draw_line((10, 20), (50, 20), viren2d.LineStyle(
+        width=1, color='black', cap='square'))
+    assert p.draw_line((80, 90), (80, 30), viren2d.LineStyle(
+        width=3, color='black', cap='square'))
+    expected = np.full((120, 200), 255, dtype=np.uint8)
+    expected[20, 10:51] = 0
+    expected[29:92, 79:82] = 0
+    assert np.array_equal(expected, np.array(p.canvas)[:, :, 0])
+
+    # Translucent grid lines must not be blended twice at the crossings
+    p.set_canvas_rgb(height=120, width=200, color='white')
+    assert p.draw_grid(20, 20, viren2d.LineStyle(width=1, color='black!50'))
+    canvas = np.array(p.canvas)
+    assert len(np.unique(canvas[:, :, 0])) == 2
+    assert canvas[0, 0, 0] == canvas[20, 5, 0] == canvas[20, 40, 0]
+
+    # Fast render quality snaps the geometry and draws aliased circles
+    p.render_quality = 'fast'
+    p.set_canvas_rgb(height=120, width=200, color='white')
+    assert p.draw_circle((100, 60), 30, viren2d.LineStyle(width=2, color='black'),
+                         'crimson')
+    assert p.draw_rect(viren2d.Rect.from_ltwh(5.3, 5.7, 20.2, 10),
+                       viren2d.LineStyle(width=2, color='black!50'))
+    canvas = np.array(p.canvas)
+    assert len(np.unique(canvas[:, :, 0])) == 4
+    filled = np.count_nonzero(np.any(canvas[25:96, 65:137] != 255, axis=2))
+    assert abs(filled - np.pi * 31**2) < 0.03 * np.pi * 31**2
+    p.render_quality = 'balanced'
+
+    # Display lists use the same fast path
+    p.set_canvas_rgb(height=120, width=200, color='white')
+    p.draw_rect(viren2d.Rect.from_ltwh(20, 10, 150, 70), styles[2][0], styles[2][1])
+    expected = np.array(p.canvas, copy=True)
+    p.set_canvas_rgb(height=120, width=200, color='white')
+    overlay = viren2d.DisplayList()
+    p.begin_recording(overlay)
+    p.draw_rect(viren2d.Rect.from_ltwh(20, 10, 150, 70), styles[2][0], styles[2][1])
+    p.end_recording()
+    assert p.draw_display_list(overlay)
+    assert np.array_equal(expected, np.array(p.canvas))
+
+
+def test_viewport_culling():
+    p = viren2d.Painter(height=100, width=150, color='white')
+    assert p.num_culled_primitives == 0
+    style = viren2d.LineStyle(width=5, color='navy-blue')
+
+    # Off-screen primitives are skipped (but still succeed)
+    assert p.draw_line((-60, -50), (-40, 80), style)
+    assert p.draw_circle((300, 50), 40, style, 'crimson')
+    assert p.draw_rect(viren2d.Rect((75, -120), (100, 40), 30), style)
+    assert p.draw_polygon([(200, 0), (300, 0), (250, 90)], style, 'black')
+    assert p.draw_trajectory([(0, 150), (100, 160), (150, 200)], style)
+    assert p.draw_marker((-60, 50), viren2d.MarkerStyle(size=20))
+    assert p.draw_text(['Off-screen'], (400, 50)).is_valid()
+    assert p.draw_bounding_box_2d(
+        viren2d.Rect.from_ltwh(200, 20, 50, 50), label_top=['Object'])
+    assert p.num_culled_primitives == 8
+    assert np.all(np.array(p.canvas) == 255)
+
+    # Each element of a batch is counted
+    assert p.draw_markers(
+        [((-40, 10), 'black'), ((75, 50), 'black'), ((75, 400), 'black')])
+    assert p.num_culled_primitives == 10
+    p.reset_num_culled_primitives()
+    assert p.num_culled_primitives == 0
+
+    # The style width is considered
+    assert p.draw_line((-8, 0), (-8, 100), viren2d.LineStyle(width=20))
+    assert p.num_culled_primitives == 0
+    assert np.any(np.array(p.canvas)[:, 0, :3] != 255)
+
+    # The clip region is considered as well
+    p.set_canvas_rgb(height=100, width=150, color='white')
+    assert p.set_clip_rect(viren2d.Rect.from_ltwh(0, 0, 50, 50))
+    assert p.draw_circle((100, 80), 10, style)
+    assert p.num_culled_primitives == 1
+    assert p.reset_clip()
+
+    # Long polylines are trimmed to their visible runs, which must not
+    # change the result
+    pts = [(20 + 40 * np.cos(a), 50 + 60 * np.sin(a))
+           for a in np.linspace(0, 12 * np.pi, 600)]
+    pts += [(x, 500) for x in range(-100, 200, 10)]
+    pts += [(x, 0.8 * x - 300) for x in range(600, 0, -5)]
+    # Within a larger canvas, the whole polyline is visible:
+    shifted = [(x + 200, y + 400) for x, y in pts]
+    p.reset_num_culled_primitives()
+    for line_style in [style, viren2d.LineStyle(width=3, color='crimson!50')]:
+        for draw in [p.draw_trajectory, p.draw_polygon]:
+            p.set_canvas_rgb(height=100, width=150, color='white')
+            assert draw(pts, line_style)
+            assert p.num_culled_primitives == 0
+            trimmed = np.array(p.canvas, copy=True)
+            p.set_canvas_rgb(height=1000, width=900, color='white')
+            assert draw(shifted, line_style)
+            assert np.array_equal(
+                trimmed, np.array(p.canvas)[400:500, 200:350])
+
+
+def test_polyline_simplification():
+    p = viren2d.Painter(height=200, width=300, color='white')
+    assert p.simplification_tolerance == 0
+    p.simplification_tolerance = -3
+    assert p.simplification_tolerance == 0
+
+    # A densely sampled, slightly jittering track
+    rng = np.random.default_rng(17)
+    t = np.linspace(0, 1, 5000)
+    x = 20 + 260 * t + rng.normal(0, 0.05, t.size)
+    y = 100 + 60 * np.sin(4 * np.pi * t) + rng.normal(0, 0.05, t.size)
+    pts = list(zip(x, y))
+    style = viren2d.LineStyle(width=3, color='navy-blue')
+    for fade_out in ['invalid', 'white!0']:
+        for levels in [0, 8]:
+            p.trajectory_fade_out_levels = levels
+            p.simplification_tolerance = 0
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            assert p.draw_trajectory(pts, style, fade_out_color=fade_out)
+            expected = np.array(p.canvas, copy=True).astype(np.int16)
+            p.simplification_tolerance = 0.5
+            p.set_canvas_rgb(height=200, width=300, color='white')
+            assert p.draw_trajectory(pts, style, fade_out_color=fade_out)
+            diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+            assert np.mean(diff) < 0.5
+    p.trajectory_fade_out_levels = 0
+
+    # Endpoints must be kept
+    p.simplification_tolerance = 1000
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.draw_trajectory(pts, style)
+    simplified = np.array(p.canvas, copy=True)
+    p.simplification_tolerance = 0
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.draw_trajectory([pts[0], pts[-1]], style)
+    assert np.array_equal(simplified, np.array(p.canvas))
+
+    # Polygons and display lists are simplified, too
+    p.simplification_tolerance = 0.5
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.draw_polygon(pts, style, 'same!20')
+    expected = np.array(p.canvas, copy=True)
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    overlay = viren2d.DisplayList()
+    p.begin_recording(overlay)
+    assert p.draw_polygon(pts, style, 'same!20')
+    p.end_recording()
+    assert p.draw_display_list(overlay)
+    assert np.array_equal(expected, np.array(p.canvas))
+
+
+def test_overlay_layers():
+    p = viren2d.Painter()
+    assert not p.begin_layer('static')
+    assert not p.end_layer()
+    assert not p.is_layer_active
+
+    def _draw_static(painter):
+        assert painter.draw_grid(
+            spacing_x=20, spacing_y=20,
+            line_style=viren2d.LineStyle(width=1, color='gray!60'),
+            top_left=(40, 30), bottom_right=(200, 150))
+        assert painter.draw_circle(
+            (150, 100), 30, viren2d.LineStyle(width=3, color='crimson'),
+            'crimson!40')
+
+    # Reference: draw the content directly
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    _draw_static(p)
+    expected = np.array(p.canvas, copy=True).astype(np.int16)
+
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    empty = np.array(p.canvas, copy=True)
+    assert not p.has_layer('static')
+    assert not p.draw_layer('static')
+    assert p.begin_layer('static')
+    assert p.is_layer_active
+    assert not p.begin_layer('other')
+    _draw_static(p)
+    assert p.end_layer()
+    assert not p.is_layer_active
+    # Layers must not modify the canvas until they are drawn
+    assert np.array_equal(empty, np.array(p.canvas))
+    assert p.has_layer('static')
+
+    # Composite the layer onto multiple frames
+    for color in ['white', 'navy-blue']:
+        p.set_canvas_rgb(height=200, width=300, color=color)
+        assert p.draw_layer('static')
+        if color == 'white':
+            diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+            assert np.max(diff) <= 2
+
+    # Empty layers are valid, too
+    assert p.begin_layer('empty')
+    assert p.end_layer()
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.draw_layer('empty')
+    assert np.array_equal(empty, np.array(p.canvas))
+
+    # Changing the canvas ends the active layer
+    assert p.begin_layer('unfinished')
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert not p.is_layer_active
+    assert p.has_layer('unfinished')
+
+    # Layers are not supported while recording
+    overlay = viren2d.DisplayList()
+    p.begin_recording(overlay)
+    assert not p.begin_layer('recorded')
+    assert not p.draw_layer('static')
+    p.end_recording()
+
+    # Layers must be re-rendered for a different canvas size
+    p.set_canvas_rgb(height=100, width=300, color='white')
+    assert not p.has_layer('static')
+    assert not p.draw_layer('static')
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert not p.has_layer('static')
+
+    assert p.invalidate_layer('empty')
+    assert not p.invalidate_layer('empty')
+    p.clear_layers()
+    assert not p.has_layer('unfinished')
+
+
+def test_dirty_rects():
+    def _inside_dirty_rects(painter, x, y):
+        for r in painter.dirty_rects:
+            left = r.cx - r.width / 2
+            top = r.cy - r.height / 2
+            if (left <= x < left + r.width) and (top <= y < top + r.height):
+                return True
+        return False
+
+    p = viren2d.Painter()
+    assert p.dirty_rects == []
+
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.dirty_rects == []
+    background = np.array(p.canvas, copy=True)[:, :, :3]
+    frame = np.zeros((200, 300, 3), dtype=np.uint8)
+    p.get_canvas(out=frame)
+
+    style = viren2d.LineStyle(width=3, color='crimson')
+    assert p.draw_circle((50, 50), 10, style)
+    assert len(p.dirty_rects) == 1
+    assert p.draw_line((250, 150), (280, 180), style)
+    assert len(p.dirty_rects) == 2
+    # Culled primitives don't touch the canvas
+    assert p.draw_line((-100, -100), (-50, -50), style)
+    assert len(p.dirty_rects) == 2
+    assert p.draw_markers([((20, 180), 'navy-blue'), ((500, 20), 'invalid')])
+    assert p.draw_text(['dirty'], (150, 100)).is_valid()
+
+    # Every modified pixel must lie within the dirty rects
+    canvas = np.array(p.canvas)[:, :, :3]
+    ys, xs = np.nonzero(np.any(canvas != background, axis=2))
+    assert len(xs) > 0
+    for x, y in zip(xs, ys):
+        assert _inside_dirty_rects(p, x, y)
+
+    # Copying only the dirty regions yields the full export
+    assert p.copy_dirty_rects(frame) is frame
+    assert np.array_equal(frame, np.array(p.get_canvas(layout='rgb')))
+    bgr = p.copy_dirty_rects(np.zeros((200, 300, 3), dtype=np.uint8), 'bgr')
+    assert np.array_equal(bgr[:, :, ::-1], frame)
+
+    # Restoring the background erases all overlays
+    p.restore_dirty_rects(background)
+    assert p.dirty_rects == []
+    assert np.array_equal(background, np.array(p.canvas)[:, :, :3])
+    assert p.draw_circle((50, 50), 10, style)
+    p.restore_dirty_rects(background[:, :, ::-1].copy(), is_bgr=True)
+    assert np.array_equal(background, np.array(p.canvas)[:, :, :3])
+    with pytest.raises(ValueError):
+        p.restore_dirty_rects(background[:100])
+
+    gradient = viren2d.LinearColorGradient((0, 0), (300, 0))
+    gradient.add_color_stop(0.1, 'crimson!40')
+    gradient.add_color_stop(0.9, 'navy-blue!40')
+    assert p.draw_gradient(gradient)
+    assert len(p.dirty_rects) == 1
+    assert p.dirty_rects[0].width == 300
+    p.reset_dirty_rects()
+    assert p.dirty_rects == []
+
+    # Layers only modify the canvas once they are drawn
+    assert p.begin_layer('overlay')
+    assert p.draw_circle((150, 100), 20, style)
+    assert p.end_layer()
+    assert p.dirty_rects == []
+    assert p.draw_layer('overlay')
+    assert len(p.dirty_rects) == 1
+
+    # Setting up a new canvas resets the dirty region
+    p.set_canvas_rgb(height=200, width=300, color='white')
+    assert p.dirty_rects == []
+
+
 def test_draw_trajectories():
     num_points = 50
     trajectories = list()
@@ -649,6 +1659,65 @@ def test_draw_trajectories():
         fading_factor=viren2d.fade_out_quadratic)
 
 
+def test_trajectory_store():
+    with pytest.raises(ValueError):
+        viren2d.TrajectoryStore(capacity=1)
+
+    store = viren2d.TrajectoryStore(capacity=20, smoothing_window=5)
+    assert store.capacity == 20
+    assert store.smoothing_window == 5
+    assert len(store) == 0
+
+    rng = np.random.default_rng(18)
+    for frame in range(50):
+        for track_id in [3, 1, 7]:
+            if (track_id == 7) and (frame < 48):
+                continue
+            store.append(track_id, (5 * frame + rng.uniform(-2, 2),
+                                    50 * track_id + rng.uniform(-2, 2)))
+    assert store.track_ids == [1, 3, 7]
+    assert 3 in store
+    assert 2 not in store
+    assert store.num_points(1) == 20
+    assert store.num_points(7) == 2
+    assert store.num_points(2) == 0
+    assert len(store.points(3)) == 20
+    assert store.points(2) == []
+
+    assert store.set_color(3, 'crimson')
+    assert not store.set_color(2, 'crimson')
+    assert store.get_color(3) == viren2d.Color('crimson')
+    assert not store.get_color(1).is_valid()
+
+    # Uninitialized canvas
+    p = viren2d.Painter()
+    assert not p.draw_trajectory_store(store)
+
+    # Drawing the store must be identical to drawing its tracks
+    line_style = viren2d.LineStyle(width=3, color='navy-blue')
+    trajectories = [(store.points(tid), store.get_color(tid))
+                    for tid in store.track_ids]
+    for fade_out in ['invalid', 'white!40']:
+        p.set_canvas_rgb(height=400, width=300, color='white')
+        assert p.draw_trajectory_store(store, line_style, fade_out)
+        from_store = np.array(p.canvas, copy=True)
+        p.set_canvas_rgb(height=400, width=300, color='white')
+        assert p.draw_trajectories(
+            trajectories, line_style, fade_out, tail_first=True)
+        assert np.array_equal(from_store, np.array(p.canvas))
+
+    # Tracks with a single position are skipped
+    store.append(9, (20, 20))
+    assert p.draw_trajectory_store(store)
+
+    assert store.remove(3)
+    assert not store.remove(3)
+    assert len(store) == 3
+    store.clear()
+    assert len(store) == 0
+    assert p.draw_trajectory_store(store)
+
+
 def test_bounding_boxes_2d():
     box_style = viren2d.BoundingBox2DStyle(
         line_style=viren2d.LineStyle(),
@@ -679,6 +1748,78 @@ def test_bounding_boxes_2d():
         left_t2b=False, label_right=['Right Edge'], right_t2b=True)
 
 
+def test_bounding_boxes_2d_batched():
+    styles = [
+        viren2d.BoundingBox2DStyle(
+            line_style=viren2d.LineStyle(width=3, color='navy-blue'),
+            text_style=viren2d.TextStyle(halign='left'),
+            box_fill_color='same!20', text_fill_color='white!60',
+            clip_label=True),
+        viren2d.BoundingBox2DStyle(
+            line_style=viren2d.LineStyle(width=2, color='crimson!80'),
+            text_style=viren2d.TextStyle(halign='center'),
+            box_fill_color='invalid', text_fill_color='black',
+            clip_label=False)]
+    # Non-overlapping boxes must look the same as if drawn one by one
+    boxes = np.array(
+        [[20 + 120 * (i % 8), 20 + 150 * (i // 8), 90, 110] for i in range(40)],
+        dtype=np.float32)
+    indices = [i % 2 for i in range(40)]
+    labels = [f'Object {i}' if i % 3 else '' for i in range(40)]
+
+    p = viren2d.Painter(800, 1000, 'white')
+    for box, idx, label in zip(boxes, indices, labels):
+        assert p.draw_bounding_box_2d(
+            viren2d.Rect.from_ltwh(*box), box_style=styles[idx],
+            label_top=[label] if label else [])
+    expected = np.array(p.canvas, copy=True).astype(np.int16)
+
+    p.set_canvas_rgb(800, 1000, 'white')
+    assert p.draw_bounding_boxes_2d(
+        boxes, box_styles=styles, style_indices=np.array(indices),
+        labels=labels)
+    diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+    assert np.mean(diff) < 0.1
+
+    # Other box formats and inputs
+    lrtb = np.column_stack(
+        (boxes[:, 0], boxes[:, 0] + boxes[:, 2],
+         boxes[:, 1], boxes[:, 1] + boxes[:, 3]))
+    p.set_canvas_rgb(800, 1000, 'white')
+    assert p.draw_bounding_boxes_2d(
+        lrtb, box_styles=styles, style_indices=indices, labels=labels,
+        box_format='lrtb')
+    diff = np.abs(expected - np.array(p.canvas).astype(np.int16))
+    assert np.mean(diff) < 0.1
+
+    rects = [viren2d.Rect.from_ltwh(*box) for box in boxes]
+    assert p.draw_bounding_boxes_2d(rects)
+    assert p.draw_bounding_boxes_2d(boxes.astype(np.int32), styles[1])
+    assert p.draw_bounding_boxes_2d(np.zeros((0, 4)))
+    # Rotated & rounded boxes are drawn one by one
+    assert p.draw_bounding_boxes_2d(
+        [viren2d.Rect((100, 100), (50, 80), rotation=30),
+         viren2d.Rect.from_ltwh(300, 300, 80, 80, radius=0.2)],
+        labels=['rotated', 'rounded'])
+
+    # Invalid inputs
+    assert not p.draw_bounding_boxes_2d(boxes, styles, [0, 1])
+    assert not p.draw_bounding_boxes_2d(boxes, styles, labels=['a', 'b'])
+    assert not p.draw_bounding_boxes_2d(
+        boxes[:2], styles, style_indices=[0, 5])
+    assert not p.draw_bounding_boxes_2d(
+        np.array([[10, 10, -5, 20], [10, 10, 20, 20]]))
+    with pytest.raises(ValueError):
+        p.draw_bounding_boxes_2d(np.zeros((3, 5)))
+    with pytest.raises(ValueError):
+        p.draw_bounding_boxes_2d(boxes, box_format='xyxy')
+    with pytest.raises(ValueError):
+        p.draw_bounding_boxes_2d(boxes[:1], style_indices=[-1])
+
+    # Uninitialized painter
+    assert not viren2d.Painter().draw_bounding_boxes_2d(boxes)
+
+
 def test_pinhole_xyz_axes():
     p = viren2d.Painter(1000, 1000, 'white')
     for dt in [np.int64, np.float32, np.float64]:
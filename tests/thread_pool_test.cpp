@@ -0,0 +1,365 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/imagebuffer.h>
+#include <helpers/thread_pool.h>
+
+
+namespace {
+/// Restores the process-wide multi-threading settings upon destruction.
+class ParallelSettingsGuard {
+public:
+  ParallelSettingsGuard()
+    : threads_(viren2d::ImageBufferThreads()),
+      threshold_(viren2d::ImageBufferParallelThreshold()) {
+  }
+
+  ~ParallelSettingsGuard() {
+    viren2d::SetImageBufferThreads(threads_);
+    viren2d::SetImageBufferParallelThreshold(threshold_);
+  }
+
+private:
+  int threads_;
+  int threshold_;
+};
+
+
+/// Checks that both buffers have the same shape, type and content.
+::testing::AssertionResult IsEqual(
+    const viren2d::ImageBuffer &expected, const viren2d::ImageBuffer &buf) {
+  if ((expected.Width() != buf.Width())
+      || (expected.Height() != buf.Height())
+      || (expected.Channels() != buf.Channels())
+      || (expected.BufferType() != buf.BufferType())) {
+    return ::testing::AssertionFailure()
+        << "Buffers differ: " << expected.ToString()
+        << " vs. " << buf.ToString();
+  }
+  const int num_bytes = buf.Width() * buf.Channels() * buf.ElementSize();
+  for (int row = 0; row < buf.Height(); ++row) {
+    if (std::memcmp(expected.ImmutablePtr<unsigned char>(row, 0, 0),
+                    buf.ImmutablePtr<unsigned char>(row, 0, 0),
+                    num_bytes) != 0) {
+      return ::testing::AssertionFailure()
+          << "Buffers " << buf.ToString() << " differ in row " << row;
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+
+/// Fills the buffer with a pattern of repeated values, such that the
+/// extrema occur multiple times.
+template <typename _Tp>
+void FillPattern(viren2d::ImageBuffer &buf, int modulo) {
+  for (int row = 0; row < buf.Height(); ++row) {
+    for (int col = 0; col < buf.Width(); ++col) {
+      for (int ch = 0; ch < buf.Channels(); ++ch) {
+        buf.AtUnchecked<_Tp>(row, col, ch) = static_cast<_Tp>(
+              ((row * 7 + col * 3 + ch * 11) % modulo) / 2);
+      }
+    }
+  }
+}
+} // anonymous namespace
+
+
+TEST(ThreadPoolTest, ParallelFor) {
+  using viren2d::helpers::ParallelFor;
+  ParallelSettingsGuard guard;
+  viren2d::SetImageBufferParallelThreshold(0);
+
+  for (int num_threads : {1, 2, 3, 8}) {
+    for (int num_rows : {1, 2, 7, 100, 1001}) {
+      std::vector<std::atomic<int>> visits(num_rows);
+      std::atomic<int> num_calls{0};
+      ParallelFor(num_rows, 10, [&](int first_row, int end_row) {
+        EXPECT_LE(0, first_row);
+        EXPECT_LT(first_row, end_row);
+        EXPECT_LE(end_row, num_rows);
+        for (int row = first_row; row < end_row; ++row) {
+          ++visits[row];
+        }
+        ++num_calls;
+      }, num_threads);
+
+      for (int row = 0; row < num_rows; ++row) {
+        EXPECT_EQ(1, visits[row]) << "row " << row << ", " << num_threads
+                                  << " threads";
+      }
+      if ((num_threads == 1) || (num_rows == 1)) {
+        EXPECT_EQ(1, num_calls);
+      } else {
+        EXPECT_EQ(std::min(
+                    num_rows, viren2d::helpers::kChunksPerThread * num_threads),
+                  num_calls);
+      }
+    }
+  }
+
+  // Small images are processed serially
+  viren2d::SetImageBufferParallelThreshold(1000);
+  std::atomic<int> num_calls{0};
+  ParallelFor(99, 10, [&](int first_row, int end_row) {
+    EXPECT_EQ(0, first_row);
+    EXPECT_EQ(99, end_row);
+    ++num_calls;
+  }, 4);
+  EXPECT_EQ(1, num_calls);
+
+  ParallelFor(100, 10, [&](int, int) { ++num_calls; }, 4);
+  EXPECT_LT(2, num_calls);
+
+  // Empty loops don't invoke the body at all
+  ParallelFor(0, 10, [&](int, int) { ++num_calls; }, 4);
+  ParallelFor(-3, 10, [&](int, int) { ++num_calls; }, 4);
+  EXPECT_LT(2, num_calls);
+}
+
+
+TEST(ThreadPoolTest, ThreadSettings) {
+  using namespace viren2d::helpers;
+  ParallelSettingsGuard guard;
+
+  viren2d::SetImageBufferThreads(3);
+  EXPECT_EQ(3, viren2d::ImageBufferThreads());
+  EXPECT_EQ(3, ResolveParallelThreads());
+  EXPECT_EQ(5, ResolveParallelThreads(5));
+
+  viren2d::SetImageBufferThreads(-2);
+  EXPECT_EQ(0, viren2d::ImageBufferThreads());
+  EXPECT_LE(1, ResolveParallelThreads());
+
+  viren2d::SetImageBufferThreads(4);
+  {
+    viren2d::ImageBufferThreadsScope serial(1);
+    EXPECT_EQ(1, ResolveParallelThreads());
+    {
+      viren2d::ImageBufferThreadsScope nested(2);
+      EXPECT_EQ(2, ResolveParallelThreads());
+    }
+    EXPECT_EQ(1, ResolveParallelThreads());
+
+    // The override only affects the calling thread
+    std::thread other([]() {
+      EXPECT_EQ(4, ResolveParallelThreads());
+    });
+    other.join();
+  }
+  EXPECT_EQ(4, ResolveParallelThreads());
+
+  viren2d::SetImageBufferParallelThreshold(12345);
+  EXPECT_EQ(12345, viren2d::ImageBufferParallelThreshold());
+  viren2d::SetImageBufferParallelThreshold(-1);
+  EXPECT_EQ(0, viren2d::ImageBufferParallelThreshold());
+}
+
+
+TEST(ThreadPoolTest, NestedAndConcurrentLoops) {
+  using viren2d::helpers::ParallelFor;
+  ParallelSettingsGuard guard;
+  viren2d::SetImageBufferParallelThreshold(0);
+
+  // Nested loops run serially within the outer chunks
+  std::atomic<int> num_visits{0};
+  ParallelFor(16, 1, [&](int first_row, int end_row) {
+    for (int row = first_row; row < end_row; ++row) {
+      ParallelFor(8, 1, [&](int inner_first, int inner_end) {
+        num_visits += inner_end - inner_first;
+      }, 4);
+    }
+  }, 4);
+  EXPECT_EQ(16 * 8, num_visits);
+
+  // Loops started by multiple threads at the same time
+  constexpr int kNumCallers = 4;
+  constexpr int kNumRows = 500;
+  std::vector<std::thread> callers;
+  std::vector<int> sums(kNumCallers, 0);
+  for (int cidx = 0; cidx < kNumCallers; ++cidx) {
+    callers.emplace_back([&sums, cidx]() {
+      for (int iter = 0; iter < 20; ++iter) {
+        std::atomic<int> sum{0};
+        ParallelFor(kNumRows, 1, [&sum](int first_row, int end_row) {
+          for (int row = first_row; row < end_row; ++row) {
+            sum += row;
+          }
+        }, 3);
+        sums[cidx] = sum;
+        EXPECT_EQ((kNumRows * (kNumRows - 1)) / 2, sums[cidx]);
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+}
+
+
+TEST(ThreadPoolTest, WorkerLimit) {
+  viren2d::helpers::ThreadPool pool;
+
+  // Returns the number of distinct threads which processed the chunks
+  auto count_threads = [&pool](int num_threads) {
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    pool.Run(64, num_threads, [&](int) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ids.insert(std::this_thread::get_id());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    return static_cast<int>(ids.size());
+  };
+
+  EXPECT_LE(count_threads(16), 16);
+  EXPECT_EQ(15, pool.NumWorkers());
+
+  // A narrower loop must not use all previously started workers
+  for (int iter = 0; iter < 5; ++iter) {
+    EXPECT_LE(count_threads(2), 2);
+    EXPECT_LE(count_threads(3), 3);
+  }
+  EXPECT_EQ(15, pool.NumWorkers());
+}
+
+
+TEST(ThreadPoolTest, Exceptions) {
+  using viren2d::helpers::ParallelFor;
+  ParallelSettingsGuard guard;
+  viren2d::SetImageBufferParallelThreshold(0);
+
+  EXPECT_THROW(
+        ParallelFor(64, 1, [](int first_row, int end_row) {
+          if ((first_row <= 40) && (40 < end_row)) {
+            throw std::runtime_error("Failure");
+          }
+        }, 4),
+        std::runtime_error);
+
+  // The pool must still be usable afterwards
+  std::atomic<int> num_visits{0};
+  ParallelFor(64, 1, [&](int first_row, int end_row) {
+    num_visits += end_row - first_row;
+  }, 4);
+  EXPECT_EQ(64, num_visits);
+  EXPECT_LE(1, viren2d::helpers::DefaultThreadPool().NumWorkers());
+}
+
+
+TEST(ThreadPoolTest, ImageBufferOperations) {
+  using viren2d::ImageBuffer;
+  using viren2d::ImageBufferType;
+  ParallelSettingsGuard guard;
+  viren2d::SetImageBufferParallelThreshold(0);
+
+  ImageBuffer rgba(53, 97, 4, ImageBufferType::UInt8);
+  FillPattern<uint8_t>(rgba, 509);
+  ImageBuffer other(53, 97, 3, ImageBufferType::UInt8);
+  FillPattern<uint8_t>(other, 201);
+  ImageBuffer weights(53, 97, 1, ImageBufferType::Float);
+  FillPattern<float>(weights, 3);
+  ImageBuffer flow(53, 97, 2, ImageBufferType::Float);
+  FillPattern<float>(flow, 17);
+  ImageBuffer padded(53, 97, 3, ImageBufferType::Int16, true);
+  FillPattern<int16_t>(padded, 1000);
+
+  // Each operation on contiguous as well as non-contiguous inputs
+  std::vector<std::function<ImageBuffer(ImageBuffer &)>> operations{
+    [](ImageBuffer &img) { return img.ToChannels(3); },
+    [](ImageBuffer &img) { return img.ToChannels(4); },
+    [](ImageBuffer &img) { return img.Channel(1); },
+    [](ImageBuffer &img) { return viren2d::ConvertRGB2Gray(img, 4, true); },
+    [](ImageBuffer &img) { return viren2d::ConvertRGB2HSV(img); },
+    [](ImageBuffer &img) {
+      return viren2d::ConvertHSV2RGB(viren2d::ConvertRGB2HSV(img), 4);
+    },
+    [](ImageBuffer &img) { return img.Dim(0.3); },
+    [](ImageBuffer &img) { return img.ToFloat(); },
+    [](ImageBuffer &img) { return img.ToFloat().ToUInt8(4); },
+    [](ImageBuffer &img) { return img.AsType(ImageBufferType::Int32, 3.0); },
+    [&other](ImageBuffer &img) {
+      return img.Blend(other.ROI(0, 0, img.Width(), img.Height()), 0.3);
+    },
+    [&other, &weights](ImageBuffer &img) {
+      return img.Blend(
+            other.ROI(0, 0, img.Width(), img.Height()),
+            weights.ROI(0, 0, img.Width(), img.Height()));
+    },
+    [](ImageBuffer &img) {
+      ImageBuffer swapped = img.DeepCopy();
+      swapped.SwapChannels(0, 2);
+      return swapped;
+    },
+  };
+
+  ImageBuffer rgba_view = rgba.ROI(3, 2, 90, 50);
+  ImageBuffer padded_view = padded.ROI(1, 1, 95, 51);
+  for (std::size_t idx = 0; idx < operations.size(); ++idx) {
+    for (ImageBuffer *img : {&rgba, &rgba_view}) {
+      ImageBuffer expected;
+      {
+        viren2d::ImageBufferThreadsScope serial(1);
+        expected = operations[idx](*img);
+      }
+      for (int num_threads : {2, 3, 8}) {
+        viren2d::ImageBufferThreadsScope scope(num_threads);
+        EXPECT_TRUE(IsEqual(expected, operations[idx](*img)))
+            << "Operation #" << idx << " with " << num_threads << " threads";
+      }
+    }
+  }
+
+  for (ImageBuffer *img : {&flow, &padded}) {
+    ImageBuffer magnitude, orientation;
+    {
+      viren2d::ImageBufferThreadsScope serial(1);
+      magnitude = img->AsType(ImageBufferType::Double).Magnitude();
+      if (img == &flow) {
+        orientation = img->Orientation(-1.0f);
+      }
+    }
+    viren2d::ImageBufferThreadsScope scope(5);
+    EXPECT_TRUE(IsEqual(
+                  magnitude, img->AsType(ImageBufferType::Double).Magnitude()));
+    if (img == &flow) {
+      EXPECT_TRUE(IsEqual(orientation, img->Orientation(-1.0f)));
+    }
+  }
+
+  // MinMaxLocation must report the first occurrence of the extrema
+  for (ImageBuffer *img : {&padded, &padded_view}) {
+    for (int channel = 0; channel < img->Channels(); ++channel) {
+      double min_serial, max_serial, min_parallel, max_parallel;
+      viren2d::Vec2i minloc_serial, maxloc_serial;
+      viren2d::Vec2i minloc_parallel, maxloc_parallel;
+      {
+        viren2d::ImageBufferThreadsScope serial(1);
+        img->MinMaxLocation(
+              &min_serial, &max_serial,
+              &minloc_serial, &maxloc_serial, channel);
+      }
+      for (int num_threads : {2, 4, 7}) {
+        viren2d::ImageBufferThreadsScope scope(num_threads);
+        img->MinMaxLocation(
+              &min_parallel, &max_parallel,
+              &minloc_parallel, &maxloc_parallel, channel);
+        EXPECT_DOUBLE_EQ(min_serial, min_parallel);
+        EXPECT_DOUBLE_EQ(max_serial, max_parallel);
+        EXPECT_EQ(minloc_serial, minloc_parallel);
+        EXPECT_EQ(maxloc_serial, maxloc_parallel);
+      }
+    }
+  }
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <viren2d/trajectory_store.h>
+
+
+namespace {
+/// Reference implementation: centered moving average over the full
+/// history, with truncated windows at both ends.
+std::vector<viren2d::Vec2d> MovingAverage(
+    const std::vector<viren2d::Vec2d> &points, int window) {
+  const int neighbors = window / 2;
+  const int num_points = static_cast<int>(points.size());
+  std::vector<viren2d::Vec2d> smoothed;
+  for (int idx = 0; idx < num_points; ++idx) {
+    const int from = std::max(0, idx - neighbors);
+    const int to = std::min(num_points - 1, idx + neighbors);
+    viren2d::Vec2d sum(0.0, 0.0);
+    for (int j = from; j <= to; ++j) {
+      sum += points[j];
+    }
+    smoothed.push_back(sum / static_cast<double>(to - from + 1));
+  }
+  return smoothed;
+}
+} // anonymous namespace
+
+
+TEST(TrajectoryStoreTest, RingBuffer) {
+  EXPECT_THROW(viren2d::TrajectoryStore(1), std::invalid_argument);
+
+  viren2d::TrajectoryStore store(3);
+  EXPECT_TRUE(store.Empty());
+  EXPECT_EQ(3, store.Capacity());
+  EXPECT_EQ(0, store.SmoothingWindow());
+  EXPECT_EQ(0, store.NumPoints(7));
+  EXPECT_TRUE(store.Points(7).empty());
+
+  for (int idx = 0; idx < 7; ++idx) {
+    store.Append(7, {1.0 * idx, 2.0 * idx});
+    const auto points = store.Points(7);
+    ASSERT_EQ(std::min(idx + 1, 3), static_cast<int>(points.size()));
+    EXPECT_EQ(viren2d::Vec2d(1.0 * idx, 2.0 * idx), points.back());
+    EXPECT_EQ(
+          viren2d::Vec2d(1.0 * std::max(0, idx - 2), 2.0 * std::max(0, idx - 2)),
+          points.front());
+  }
+
+  store.Append(-3, {5.0, 5.0});
+  store.Append(12, {6.0, 6.0});
+  EXPECT_EQ(3, store.NumTracks());
+  EXPECT_EQ(std::vector<viren2d::TrajectoryStore::TrackID>({-3, 7, 12}),
+            store.TrackIDs());
+
+  // Tracks must be visited in ascending order with contiguous positions:
+  std::vector<viren2d::TrajectoryStore::TrackID> visited;
+  store.ForEachTrack(
+        [&](viren2d::TrajectoryStore::TrackID id, const viren2d::Vec2d *points,
+            std::size_t num_points, const viren2d::Color &color) {
+    visited.push_back(id);
+    EXPECT_FALSE(color.IsValid());
+    EXPECT_EQ(store.Points(id),
+              std::vector<viren2d::Vec2d>(points, points + num_points));
+  });
+  EXPECT_EQ(store.TrackIDs(), visited);
+
+  EXPECT_TRUE(store.SetColor(12, "crimson"));
+  EXPECT_FALSE(store.SetColor(13, "crimson"));
+  EXPECT_EQ(viren2d::Color("crimson"), store.GetColor(12));
+  EXPECT_FALSE(store.GetColor(13).IsValid());
+
+  EXPECT_TRUE(store.Remove(7));
+  EXPECT_FALSE(store.Remove(7));
+  EXPECT_FALSE(store.Contains(7));
+  EXPECT_EQ(2, store.NumTracks());
+  store.Clear();
+  EXPECT_TRUE(store.Empty());
+}
+
+
+TEST(TrajectoryStoreTest, IncrementalSmoothing) {
+  std::vector<viren2d::Vec2d> raw;
+  for (int idx = 0; idx < 50; ++idx) {
+    raw.push_back({3.0 * idx + ((idx % 3) - 1), 100.0 - (idx % 5) * 2.0});
+  }
+
+  for (int window : {2, 3, 5, 8}) {
+    for (std::size_t capacity : {2, 7, 20, 100}) {
+      viren2d::TrajectoryStore store(capacity, window);
+      EXPECT_EQ(window, store.SmoothingWindow());
+      for (std::size_t num = 1; num <= raw.size(); ++num) {
+        store.Append(42, raw[num - 1]);
+        const auto expected = MovingAverage(
+              std::vector<viren2d::Vec2d>(raw.begin(), raw.begin() + num),
+              window);
+        const auto points = store.Points(42);
+        ASSERT_EQ(std::min(num, capacity), points.size());
+        const std::size_t offset = num - points.size();
+        for (std::size_t idx = 0; idx < points.size(); ++idx) {
+          EXPECT_NEAR(expected[offset + idx].X(), points[idx].X(), 1e-9);
+          EXPECT_NEAR(expected[offset + idx].Y(), points[idx].Y(), 1e-9);
+        }
+      }
+    }
+  }
+
+  // A window below 2 disables smoothing:
+  viren2d::TrajectoryStore store(10, 1);
+  EXPECT_EQ(0, store.SmoothingWindow());
+  store.Append(1, raw[0]);
+  store.Append(1, raw[1]);
+  EXPECT_EQ(std::vector<viren2d::Vec2d>({raw[0], raw[1]}), store.Points(1));
+}